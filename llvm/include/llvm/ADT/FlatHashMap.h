@@ -0,0 +1,534 @@
+//===- llvm/ADT/FlatHashMap.h - Hash table with control bytes ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the FlatHashMap class, a drop-in alternative to DenseMap
+// for maps that see many erasures or have large values.
+//
+// Next to its buckets, a FlatHashMap keeps one control byte per bucket, which
+// is either empty, deleted, or holds 7 bits of the hash of the key in the
+// bucket.  Lookups scan the control bytes of 16 buckets at a time, with SSE2
+// where available, and only compare the keys whose hash bits match.  Unlike
+// DenseMap, the keys need no empty and tombstone values, and buckets that are
+// not in use are never constructed.
+//
+// Erasing an entry only leaves a tombstone if its group of 16 buckets has
+// been full, which is rare, and the tombstones are dropped whenever the
+// table runs out of empty buckets, so they cannot pile up.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ADT_FLATHASHMAP_H
+#define LLVM_ADT_FLATHASHMAP_H
+
+#include "llvm/ADT/DenseMapInfo.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/type_traits.h"
+#include <algorithm>
+#include <iterator>
+#include <new>
+#include <utility>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace llvm {
+
+/// FlatHashMapGroup - The control bytes of 16 consecutive buckets of a
+/// FlatHashMap.  The match functions return a mask with bit i set if the i'th
+/// byte matches.
+class FlatHashMapGroup {
+public:
+  enum {
+    Size = 16,
+    Empty = -128,
+    Deleted = -2
+    // Buckets in use hold 7 bits of the hash, so they are never negative.
+  };
+
+#if defined(__SSE2__)
+  explicit FlatHashMapGroup(const signed char *Pos)
+    : Ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Pos))) {}
+
+  unsigned match(signed char Hash) const {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(Hash), Ctrl));
+  }
+  unsigned matchEmpty() const {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(Empty), Ctrl));
+  }
+  unsigned matchEmptyOrDeleted() const {
+    return _mm_movemask_epi8(Ctrl);
+  }
+
+private:
+  __m128i Ctrl;
+#else
+  explicit FlatHashMapGroup(const signed char *Pos) {
+    memcpy(Ctrl, Pos, Size);
+  }
+
+  unsigned match(signed char Hash) const {
+    unsigned Mask = 0;
+    for (unsigned i = 0; i != Size; ++i)
+      Mask |= unsigned(Ctrl[i] == Hash) << i;
+    return Mask;
+  }
+  unsigned matchEmpty() const { return match(Empty); }
+  unsigned matchEmptyOrDeleted() const {
+    unsigned Mask = 0;
+    for (unsigned i = 0; i != Size; ++i)
+      Mask |= unsigned(Ctrl[i] < 0) << i;
+    return Mask;
+  }
+
+private:
+  signed char Ctrl[Size];
+#endif
+};
+
+template<typename KeyT, typename ValueT, typename KeyInfoT, bool IsConst>
+class FlatHashMapIterator;
+
+template<typename KeyT, typename ValueT,
+         typename KeyInfoT = DenseMapInfo<KeyT> >
+class FlatHashMap {
+  typedef std::pair<KeyT, ValueT> BucketT;
+  typedef FlatHashMapGroup Group;
+
+  /// Buckets - NumBuckets buckets, followed by their control bytes, in one
+  /// allocation.  Only the buckets with a non-negative control byte are
+  /// constructed.
+  BucketT *Buckets;
+  signed char *Ctrl;
+  unsigned NumBuckets;      // Zero, or a power of two no smaller than 16.
+  unsigned NumEntries;
+  unsigned NumDeleted;
+  unsigned GrowthLeft;      // Empty buckets that may be filled before growing.
+
+public:
+  typedef KeyT key_type;
+  typedef ValueT mapped_type;
+  typedef BucketT value_type;
+
+  FlatHashMap(const FlatHashMap &other) {
+    init(0);
+    CopyFrom(other);
+  }
+
+  explicit FlatHashMap(unsigned NumInitBuckets = 0) {
+    init(NumInitBuckets);
+  }
+
+  template<typename InputIt>
+  FlatHashMap(const InputIt &I, const InputIt &E) {
+    init(0);
+    insert(I, E);
+  }
+
+  ~FlatHashMap() {
+    destroyAll();
+    operator delete(Buckets);
+  }
+
+  typedef FlatHashMapIterator<KeyT, ValueT, KeyInfoT, false> iterator;
+  typedef FlatHashMapIterator<KeyT, ValueT, KeyInfoT, true> const_iterator;
+  inline iterator begin() {
+    return empty() ? end() : iterator(Buckets, Buckets+NumBuckets, Ctrl);
+  }
+  inline iterator end() {
+    return iterator(Buckets+NumBuckets, Buckets+NumBuckets, 0);
+  }
+  inline const_iterator begin() const {
+    return empty() ? end() : const_iterator(Buckets, Buckets+NumBuckets, Ctrl);
+  }
+  inline const_iterator end() const {
+    return const_iterator(Buckets+NumBuckets, Buckets+NumBuckets, 0);
+  }
+
+  bool empty() const { return NumEntries == 0; }
+  unsigned size() const { return NumEntries; }
+
+  /// Grow the map so that it has at least Size buckets. Does not shrink
+  void resize(size_t Size) {
+    if (Size > NumBuckets)
+      rehash(Size);
+  }
+
+  void clear() {
+    if (NumEntries == 0 && NumDeleted == 0) return;
+
+    // If the capacity of the array is huge, and the # elements used is small,
+    // shrink the array.
+    if (NumEntries * 4 < NumBuckets && NumBuckets > 64) {
+      unsigned NewNumBuckets = NumEntries ? NumEntries * 2 : 0;
+      destroyAll();
+      operator delete(Buckets);
+      init(NewNumBuckets);
+      return;
+    }
+
+    destroyAll();
+    memset(Ctrl, Group::Empty, NumBuckets);
+    NumEntries = 0;
+    NumDeleted = 0;
+    GrowthLeft = getMaxLoad(NumBuckets);
+  }
+
+  /// count - Return true if the specified key is in the map.
+  bool count(const KeyT &Val) const {
+    return LookupBucketFor(Val) != -1;
+  }
+
+  iterator find(const KeyT &Val) {
+    int Idx = LookupBucketFor(Val);
+    if (Idx == -1)
+      return end();
+    return iterator(Buckets+Idx, Buckets+NumBuckets, Ctrl+Idx);
+  }
+  const_iterator find(const KeyT &Val) const {
+    int Idx = LookupBucketFor(Val);
+    if (Idx == -1)
+      return end();
+    return const_iterator(Buckets+Idx, Buckets+NumBuckets, Ctrl+Idx);
+  }
+
+  /// lookup - Return the entry for the specified key, or a default
+  /// constructed value if no such entry exists.
+  ValueT lookup(const KeyT &Val) const {
+    int Idx = LookupBucketFor(Val);
+    if (Idx == -1)
+      return ValueT();
+    return Buckets[Idx].second;
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // If the key is already in the map, it returns false and doesn't update the
+  // value.
+  std::pair<iterator, bool> insert(const std::pair<KeyT, ValueT> &KV) {
+    int Idx = LookupBucketFor(KV.first);
+    if (Idx != -1)
+      return std::make_pair(iterator(Buckets+Idx, Buckets+NumBuckets,
+                                     Ctrl+Idx), false);
+
+    Idx = InsertIntoBucket(KV.first, KV.second);
+    return std::make_pair(iterator(Buckets+Idx, Buckets+NumBuckets, Ctrl+Idx),
+                          true);
+  }
+
+  /// insert - Range insertion of pairs.
+  template<typename InputIt>
+  void insert(InputIt I, InputIt E) {
+    for (; I != E; ++I)
+      insert(*I);
+  }
+
+  bool erase(const KeyT &Val) {
+    int Idx = LookupBucketFor(Val);
+    if (Idx == -1)
+      return false;
+    EraseBucket(Idx);
+    return true;
+  }
+  void erase(iterator I) {
+    EraseBucket(&*I - Buckets);
+  }
+
+  void swap(FlatHashMap& RHS) {
+    std::swap(Buckets, RHS.Buckets);
+    std::swap(Ctrl, RHS.Ctrl);
+    std::swap(NumBuckets, RHS.NumBuckets);
+    std::swap(NumEntries, RHS.NumEntries);
+    std::swap(NumDeleted, RHS.NumDeleted);
+    std::swap(GrowthLeft, RHS.GrowthLeft);
+  }
+
+  value_type& FindAndConstruct(const KeyT &Key) {
+    int Idx = LookupBucketFor(Key);
+    if (Idx == -1)
+      Idx = InsertIntoBucket(Key, ValueT());
+    return Buckets[Idx];
+  }
+
+  ValueT &operator[](const KeyT &Key) {
+    return FindAndConstruct(Key).second;
+  }
+
+  FlatHashMap& operator=(const FlatHashMap& other) {
+    if (&other != this)
+      CopyFrom(other);
+    return *this;
+  }
+
+  /// isPointerIntoBucketsArray - Return true if the specified pointer points
+  /// somewhere into the map's array of buckets (i.e. either to a key or
+  /// value in the map).
+  bool isPointerIntoBucketsArray(const void *Ptr) const {
+    return Ptr >= Buckets && Ptr < Buckets+NumBuckets;
+  }
+
+  /// getPointerIntoBucketsArray() - Return an opaque pointer into the buckets
+  /// array.  In conjunction with the previous method, this can be used to
+  /// determine whether an insertion caused the map to reallocate.
+  const void *getPointerIntoBucketsArray() const { return Buckets; }
+
+  /// Return the approximate size (in bytes) of the actual map.
+  /// This is just the raw memory used by the map.
+  /// If entries are pointers to objects, the size of the referenced objects
+  /// are not included.
+  size_t getMemorySize() const {
+    return NumBuckets * (sizeof(BucketT) + 1);
+  }
+
+private:
+  /// getMaxLoad - Return the number of entries and tombstones a table of
+  /// NumBuckets buckets may hold: seven eighths of it, so that every probe
+  /// sequence reaches an empty bucket quickly.
+  static unsigned getMaxLoad(unsigned NumBuckets) {
+    return NumBuckets - NumBuckets / 8;
+  }
+
+  /// getHash - Scramble the hash of Val, whose low bits pick the first group
+  /// to probe and whose top 7 bits go into the control byte.
+  static uint64_t getHash(const KeyT &Val) {
+    uint64_t Hash = uint64_t(KeyInfoT::getHashValue(Val)) *
+                    0xff51afd7ed558ccdULL;
+    return Hash ^ (Hash >> 32);
+  }
+  static signed char getControlByte(uint64_t Hash) {
+    return static_cast<signed char>(Hash >> 57);
+  }
+
+  void init(unsigned InitBuckets) {
+    NumEntries = 0;
+    NumDeleted = 0;
+    if (InitBuckets == 0) {
+      Buckets = 0;
+      Ctrl = 0;
+      NumBuckets = 0;
+      GrowthLeft = 0;
+      return;
+    }
+    NumBuckets = std::max(unsigned(Group::Size),
+                          unsigned(NextPowerOf2(InitBuckets - 1)));
+    Buckets = static_cast<BucketT*>(operator new(NumBuckets *
+                                                 (sizeof(BucketT) + 1)));
+    Ctrl = reinterpret_cast<signed char*>(Buckets + NumBuckets);
+    memset(Ctrl, Group::Empty, NumBuckets);
+    GrowthLeft = getMaxLoad(NumBuckets);
+  }
+
+  /// destroyAll - Destroy the entries, leaving their control bytes alone.
+  void destroyAll() {
+    if (isPodLike<KeyT>::value && isPodLike<ValueT>::value)
+      return;
+    for (unsigned i = 0; i != NumBuckets; ++i)
+      if (Ctrl[i] >= 0)
+        Buckets[i].~BucketT();
+  }
+
+  void CopyFrom(const FlatHashMap& other) {
+    destroyAll();
+    operator delete(Buckets);
+    init(other.NumBuckets);
+    if (NumBuckets == 0)
+      return;
+
+    memcpy(Ctrl, other.Ctrl, NumBuckets);
+    for (unsigned i = 0; i != NumBuckets; ++i)
+      if (Ctrl[i] >= 0)
+        new (&Buckets[i]) BucketT(other.Buckets[i]);
+    NumEntries = other.NumEntries;
+    NumDeleted = other.NumDeleted;
+    GrowthLeft = other.GrowthLeft;
+  }
+
+  /// LookupBucketFor - Return the index of the bucket holding Val, or -1.
+  int LookupBucketFor(const KeyT &Val) const {
+    if (NumBuckets == 0)
+      return -1;
+
+    uint64_t Hash = getHash(Val);
+    signed char H2 = getControlByte(Hash);
+    unsigned GroupMask = NumBuckets / Group::Size - 1;
+    unsigned GroupNo = unsigned(Hash) & GroupMask;
+    for (unsigned ProbeAmt = 1; ; ++ProbeAmt) {
+      Group G(Ctrl + GroupNo * Group::Size);
+      for (unsigned Mask = G.match(H2); Mask; Mask &= Mask - 1) {
+        unsigned Idx = GroupNo * Group::Size + CountTrailingZeros_32(Mask);
+        if (KeyInfoT::isEqual(Buckets[Idx].first, Val))
+          return Idx;
+      }
+      // Insertions fill the first group with room, so the key would be here.
+      if (G.matchEmpty())
+        return -1;
+      // Probe the groups at triangular offsets, which visits all of them.
+      GroupNo = (GroupNo + ProbeAmt) & GroupMask;
+    }
+  }
+
+  /// FindInsertBucket - Return the first empty or deleted bucket on the probe
+  /// sequence of a key with the given hash.
+  unsigned FindInsertBucket(uint64_t Hash) const {
+    unsigned GroupMask = NumBuckets / Group::Size - 1;
+    unsigned GroupNo = unsigned(Hash) & GroupMask;
+    for (unsigned ProbeAmt = 1; ; ++ProbeAmt) {
+      unsigned Mask = Group(Ctrl + GroupNo * Group::Size).matchEmptyOrDeleted();
+      if (Mask)
+        return GroupNo * Group::Size + CountTrailingZeros_32(Mask);
+      GroupNo = (GroupNo + ProbeAmt) & GroupMask;
+    }
+  }
+
+  /// InsertIntoBucket - Add Key, which is not in the map, with Value and
+  /// return its bucket.
+  unsigned InsertIntoBucket(const KeyT &Key, const ValueT &Value) {
+    if (NumBuckets == 0) {
+      init(Group::Size);
+    } else if (GrowthLeft == 0) {
+      // If tombstones take up much of the table, dropping them makes enough
+      // room.  Otherwise, double the size.
+      if (NumEntries * 32 <= NumBuckets * 25)
+        rehash(NumBuckets);
+      else
+        rehash(NumBuckets * 2);
+    }
+
+    uint64_t Hash = getHash(Key);
+    unsigned Idx = FindInsertBucket(Hash);
+    if (Ctrl[Idx] == Group::Empty)
+      --GrowthLeft;
+    else
+      --NumDeleted;
+    Ctrl[Idx] = getControlByte(Hash);
+    new (&Buckets[Idx]) BucketT(Key, Value);
+    ++NumEntries;
+    return Idx;
+  }
+
+  void EraseBucket(unsigned Idx) {
+    assert(Ctrl[Idx] >= 0 && "Erasing a bucket that is not in use!");
+    Buckets[Idx].~BucketT();
+    --NumEntries;
+
+    // A group that still has an empty bucket has never been full, so no probe
+    // sequence continues past it and the bucket may become empty again.
+    // Otherwise lookups must keep probing past it.
+    Group G(Ctrl + (Idx & ~unsigned(Group::Size - 1)));
+    if (G.matchEmpty()) {
+      Ctrl[Idx] = Group::Empty;
+      ++GrowthLeft;
+    } else {
+      Ctrl[Idx] = Group::Deleted;
+      ++NumDeleted;
+    }
+  }
+
+  /// rehash - Move the entries into a new table of at least AtLeast buckets,
+  /// dropping all tombstones.
+  void rehash(unsigned AtLeast) {
+    BucketT *OldBuckets = Buckets;
+    signed char *OldCtrl = Ctrl;
+    unsigned OldNumBuckets = NumBuckets;
+    unsigned OldNumEntries = NumEntries;
+
+    // Make sure the entries fit with room to spare.
+    while (getMaxLoad(AtLeast) <= OldNumEntries)
+      AtLeast *= 2;
+    init(AtLeast);
+
+    for (unsigned i = 0; i != OldNumBuckets; ++i) {
+      if (OldCtrl[i] < 0)
+        continue;
+      uint64_t Hash = getHash(OldBuckets[i].first);
+      unsigned Idx = FindInsertBucket(Hash);
+      Ctrl[Idx] = getControlByte(Hash);
+      new (&Buckets[Idx]) BucketT(OldBuckets[i]);
+      OldBuckets[i].~BucketT();
+    }
+    NumEntries = OldNumEntries;
+    GrowthLeft -= OldNumEntries;
+
+    operator delete(OldBuckets);
+  }
+};
+
+template<typename KeyT, typename ValueT, typename KeyInfoT, bool IsConst>
+class FlatHashMapIterator {
+  typedef std::pair<KeyT, ValueT> Bucket;
+  typedef FlatHashMapIterator<KeyT, ValueT, KeyInfoT, true> ConstIterator;
+  friend class FlatHashMapIterator<KeyT, ValueT, KeyInfoT, true>;
+public:
+  typedef ptrdiff_t difference_type;
+  typedef typename conditional<IsConst, const Bucket, Bucket>::type value_type;
+  typedef value_type *pointer;
+  typedef value_type &reference;
+  typedef std::forward_iterator_tag iterator_category;
+private:
+  pointer Ptr, End;
+  const signed char *Ctrl;
+public:
+  FlatHashMapIterator() : Ptr(0), End(0), Ctrl(0) {}
+
+  FlatHashMapIterator(pointer Pos, pointer E, const signed char *C)
+    : Ptr(Pos), End(E), Ctrl(C) {
+    AdvancePastEmptyBuckets();
+  }
+
+  // If IsConst is true this is a converting constructor from iterator to
+  // const_iterator and the default copy constructor is used.
+  // Otherwise this is a copy constructor for iterator.
+  FlatHashMapIterator(const FlatHashMapIterator<KeyT, ValueT,
+                                                KeyInfoT, false>& I)
+    : Ptr(I.Ptr), End(I.End), Ctrl(I.Ctrl) {}
+
+  reference operator*() const {
+    return *Ptr;
+  }
+  pointer operator->() const {
+    return Ptr;
+  }
+
+  bool operator==(const ConstIterator &RHS) const {
+    return Ptr == RHS.operator->();
+  }
+  bool operator!=(const ConstIterator &RHS) const {
+    return Ptr != RHS.operator->();
+  }
+
+  inline FlatHashMapIterator& operator++() {  // Preincrement
+    ++Ptr;
+    ++Ctrl;
+    AdvancePastEmptyBuckets();
+    return *this;
+  }
+  FlatHashMapIterator operator++(int) {  // Postincrement
+    FlatHashMapIterator tmp = *this; ++*this; return tmp;
+  }
+
+private:
+  void AdvancePastEmptyBuckets() {
+    while (Ptr != End && *Ctrl < 0) {
+      ++Ptr;
+      ++Ctrl;
+    }
+  }
+};
+
+template<typename KeyT, typename ValueT, typename KeyInfoT>
+static inline size_t
+capacity_in_bytes(const FlatHashMap<KeyT, ValueT, KeyInfoT> &X) {
+  return X.getMemorySize();
+}
+
+} // end namespace llvm
+
+#endif
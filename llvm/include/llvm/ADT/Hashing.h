@@ -0,0 +1,31 @@
+//===- llvm/ADT/Hashing.h - Hash functions for in-memory tables -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares hash_value, the hash function shared by the string keyed
+// hash tables: StringMap, FoldingSet and DenseMap<StringRef>.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ADT_HASHING_H
+#define LLVM_ADT_HASHING_H
+
+#include "llvm/ADT/StringRef.h"
+
+namespace llvm {
+
+/// hash_value - Hash the bytes of S, eight at a time, mixing them so that
+/// every input bit affects every bit of the result.
+///
+/// The result depends on the endianness of the host, so it must not be
+/// written to files; use HashString for on-disk hash tables.
+unsigned hash_value(StringRef S);
+
+} // End llvm namespace
+
+#endif
@@ -10,7 +10,7 @@
 // This file defines the 'Statistic' class, which is designed to be an easy way
 // to expose various metrics from passes.  These statistics are printed at the
 // end of a run (from llvm_shutdown), when the -stats command line option is
-// passed on the command line.
+// passed on the command line, or written as JSON with -stats-json.
 //
 // This is useful for reporting information like the number of instructions
 // simplified, optimized or removed by various transformations, like this:
@@ -27,7 +27,7 @@
 #define LLVM_ADT_STATISTIC_H
 
 #include "llvm/Support/Atomic.h"
-#include "llvm/Support/Valgrind.h"
+#include "llvm/Support/Compiler.h"
 
 namespace llvm {
 class raw_ostream;
@@ -35,92 +35,121 @@ class raw_ostream;
 class Statistic {
 public:
   const char *Name;
+  const char *VarName;
   const char *Desc;
+  /// Value - The part of the value that isn't in the per-thread counters:
+  /// what the statistic was set to, and the counts of the threads that
+  /// exited.
   volatile llvm::sys::cas_flag Value;
-  bool Initialized;
+  /// ID - One plus the index of the counter of this statistic in each
+  /// thread's shard of counters, or zero until the statistic is first used.
+  volatile unsigned ID;
+
+  /// CounterChunkSize - The per-thread counters are allocated in chunks of
+  /// this many statistics.
+  enum { CounterChunkSize = 256 };
+
+#ifdef LLVM_THREAD_LOCAL
+  /// ThreadChunks - The chunks of counters of the calling thread, indexed by
+  /// (ID - 1) / CounterChunkSize, or null until the thread first bumps a
+  /// statistic.  Chunks that are null have not been allocated yet.
+  static LLVM_THREAD_LOCAL volatile llvm::sys::cas_flag **ThreadChunks;
+#endif
 
-  llvm::sys::cas_flag getValue() const { return Value; }
+  /// getValue - Return the value of the statistic, which sums up the counters
+  /// of all threads.  This takes a lock and walks the counters of every
+  /// thread that has bumped a statistic, so it is much slower than an update,
+  /// and so is everything that reads the value: the conversion to unsigned,
+  /// the postfix operators, and assignment.
+  llvm::sys::cas_flag getValue() const;
   const char *getName() const { return Name; }
+  const char *getVarName() const { return VarName; }
   const char *getDesc() const { return Desc; }
 
   /// construct - This should only be called for non-global statistics.
   void construct(const char *name, const char *desc) {
-    Name = name; Desc = desc;
-    Value = 0; Initialized = 0;
+    Name = name; VarName = ""; Desc = desc;
+    Value = 0; ID = 0;
   }
 
   // Allow use of this class as the value itself.
-  operator unsigned() const { return Value; }
+  operator unsigned() const { return getValue(); }
   const Statistic &operator=(unsigned Val) {
-    Value = Val;
-    return init();
+    setValue(Val);
+    return *this;
   }
 
+  // The updates only touch the counter of the calling thread, so they don't
+  // need atomic operations and don't contend with other threads.  Reading the
+  // value back, as the postfix operators do, is much slower; see getValue.
   const Statistic &operator++() {
-    // FIXME: This function and all those that follow carefully use an
-    // atomic operation to update the value safely in the presence of
-    // concurrent accesses, but not to read the return value, so the
-    // return value is not thread safe.
-    sys::AtomicIncrement(&Value);
-    return init();
+    ++getCounter();
+    return *this;
   }
 
   unsigned operator++(int) {
-    init();
-    unsigned OldValue = Value;
-    sys::AtomicIncrement(&Value);
+    unsigned OldValue = getValue();
+    ++getCounter();
     return OldValue;
   }
 
   const Statistic &operator--() {
-    sys::AtomicDecrement(&Value);
-    return init();
+    --getCounter();
+    return *this;
   }
 
   unsigned operator--(int) {
-    init();
-    unsigned OldValue = Value;
-    sys::AtomicDecrement(&Value);
+    unsigned OldValue = getValue();
+    --getCounter();
     return OldValue;
   }
 
   const Statistic &operator+=(const unsigned &V) {
     if (!V) return *this;
-    sys::AtomicAdd(&Value, V);
-    return init();
+    getCounter() += V;
+    return *this;
   }
 
   const Statistic &operator-=(const unsigned &V) {
     if (!V) return *this;
-    sys::AtomicAdd(&Value, -V);
-    return init();
+    getCounter() -= V;
+    return *this;
   }
 
   const Statistic &operator*=(const unsigned &V) {
-    sys::AtomicMul(&Value, V);
-    return init();
+    setValue(getValue() * V);
+    return *this;
   }
 
   const Statistic &operator/=(const unsigned &V) {
-    sys::AtomicDiv(&Value, V);
-    return init();
+    setValue(getValue() / V);
+    return *this;
   }
 
 protected:
-  Statistic &init() {
-    bool tmp = Initialized;
-    sys::MemoryFence();
-    if (!tmp) RegisterStatistic();
-    TsanHappensAfter(this);
-    return *this;
+  /// getCounter - Return the counter of this statistic that belongs to the
+  /// calling thread.  No other thread writes it.
+  volatile llvm::sys::cas_flag &getCounter() {
+    unsigned I = ID;
+#ifdef LLVM_THREAD_LOCAL
+    // Once the thread has the chunk, its counter is a couple of loads away.
+    if (I && ThreadChunks)
+      if (volatile llvm::sys::cas_flag *Chunk =
+            ThreadChunks[(I - 1) / CounterChunkSize])
+        return Chunk[(I - 1) % CounterChunkSize];
+#endif
+    if (!I) I = RegisterStatistic();
+    return getThreadCounter(I);
   }
-  void RegisterStatistic();
+  static volatile llvm::sys::cas_flag &getThreadCounter(unsigned ID);
+  void setValue(unsigned Val);
+  unsigned RegisterStatistic();
 };
 
 // STATISTIC - A macro to make definition of statistics really simple.  This
 // automatically passes the DEBUG_TYPE of the file into the statistic.
 #define STATISTIC(VARNAME, DESC) \
-  static llvm::Statistic VARNAME = { DEBUG_TYPE, DESC, 0, 0 }
+  static llvm::Statistic VARNAME = { DEBUG_TYPE, #VARNAME, DESC, 0, 0 }
 
 /// \brief Enable the collection and printing of statistics.
 void EnableStatistics();
@@ -131,9 +160,23 @@ bool AreStatisticsEnabled();
 /// \brief Print statistics to the file returned by CreateInfoOutputFile().
 void PrintStatistics();
 
-/// \brief Print statistics to the given output stream.
+/// \brief Print statistics, followed by the memory of the named bump
+/// allocators, to the given output stream.
 void PrintStatistics(raw_ostream &OS);
 
+/// \brief Print statistics to the given output stream as JSON, for tools to
+/// collect and compare.  The schema is stable:
+///
+///   { "version": 1,
+///     "statistics": [ { "group": <DEBUG_TYPE>, "name": <variable name>,
+///                       "desc": <description>, "value": <integer> }, ... ] }
+///
+/// The statistics are sorted by group, then name.  Statistics that are never
+/// bumped are left out, as they are from the -stats report.  Passing
+/// -stats-json=<file> writes this to the file when the statistics are
+/// printed, in release builds as well.
+void PrintStatisticsJSON(raw_ostream &OS);
+
 } // End llvm namespace
 
 #endif
@@ -139,7 +139,9 @@ void SplitString(StringRef Source,
 
 /// HashString - Hash function for strings.
 ///
-/// This is the Bernstein hash function.
+/// This is the Bernstein hash function.  Its values are stored in on-disk
+/// hash tables, so it must not change; in-memory tables should use the faster
+/// and better mixing hash_value from llvm/ADT/Hashing.h instead.
 //
 // FIXME: Investigate whether a modified bernstein hash function performs
 // better: http://eternallyconfuzzled.com/tuts/algorithms/jsw_tut_hashing.aspx
@@ -744,6 +744,8 @@ public:
     AU.setPreservesAll();
   }
 
+  virtual bool isParallelSafe() const { return true; }
+
   inline bool dominates(const DomTreeNode* A, const DomTreeNode* B) const {
     return DT->dominates(A, B);
   }
@@ -341,6 +341,8 @@ namespace llvm {
     /// and Alias Analysis.
     ///
     virtual void getAnalysisUsage(AnalysisUsage &AU) const;
+
+    virtual bool isParallelSafe() const { return true; }
     
     /// getDependency - Return the instruction on which a memory operation
     /// depends.  See the class comment for more details.  It is illegal to call
@@ -31,6 +31,7 @@
 #include "llvm/Support/ConstantRange.h"
 #include "llvm/ADT/FoldingSet.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/FlatHashMap.h"
 #include <map>
 
 namespace llvm {
@@ -237,9 +238,11 @@ namespace llvm {
     /// counts and things.
     SCEVCouldNotCompute CouldNotCompute;
 
-    /// ValueExprMapType - The typedef for ValueExprMap.
+    /// ValueExprMapType - The typedef for ValueExprMap.  Entries are erased
+    /// whenever a value is modified or deleted, so this is a FlatHashMap,
+    /// which does not accumulate tombstones.
     ///
-    typedef DenseMap<SCEVCallbackVH, const SCEV *, DenseMapInfo<Value *> >
+    typedef FlatHashMap<SCEVCallbackVH, const SCEV *, DenseMapInfo<Value *> >
       ValueExprMapType;
 
     /// ValueExprMap - This is a cache of the values we have analyzed so far.
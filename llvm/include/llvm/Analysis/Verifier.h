@@ -45,9 +45,18 @@ enum VerifierFailureAction {
 ///
 /// Check a module or function for validity.  When the pass is used, the
 /// action indicated by the \p action argument will be used if errors are
-/// found.
+/// found.  With \p OnlyModified, or -verify-modified-only, the bodies of
+/// functions whose modification epoch has not advanced since they were last
+/// found to be well formed are not checked again.  The epoch advances when
+/// instructions or blocks are inserted, removed or moved, on
+/// replaceAllUsesWith and replaceUsesOfWith, and after a pass that reports a
+/// change.  Operands changed in place with setOperand or Use::set outside of
+/// a pass manager leave it unchanged, so the skipped bodies may miss such
+/// edits; call Function::markModified after making them.  The pass can run
+/// on several functions at once under -parallel-function-passes.
 FunctionPass *createVerifierPass(
-  VerifierFailureAction action = AbortProcessAction ///< Action to take
+  VerifierFailureAction action = AbortProcessAction, ///< Action to take
+  bool OnlyModified = false  ///< Skip bodies that have been verified
 );
 
 /// @brief Check a module for errors.
@@ -55,12 +64,15 @@ FunctionPass *createVerifierPass(
 /// If there are no errors, the function returns false. If an error is found,
 /// the action taken depends on the \p action parameter.
 /// This should only be used for debugging, because it plays games with
-/// PassManagers and stuff.
+/// PassManagers and stuff.  \p OnlyModified works as for createVerifierPass,
+/// and likewise does not notice operands changed in place with setOperand or
+/// Use::set unless Function::markModified is called afterwards.
 
 bool verifyModule(
   const Module &M,  ///< The module to be verified
   VerifierFailureAction action = AbortProcessAction, ///< Action to take
-  std::string *ErrorInfo = 0      ///< Information about failures.
+  std::string *ErrorInfo = 0,     ///< Information about failures.
+  bool OnlyModified = false       ///< Skip bodies that have been verified
 );
 
 // verifyFunction - Check a function for errors, useful for use when debugging a
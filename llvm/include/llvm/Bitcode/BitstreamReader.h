@@ -16,6 +16,7 @@
 #define BITSTREAM_READER_H
 
 #include "llvm/Bitcode/BitCodes.h"
+#include "llvm/Support/Endian.h"
 #include <climits>
 #include <string>
 #include <vector>
@@ -125,11 +126,13 @@ class BitstreamCursor {
   const unsigned char *NextChar;
   
   /// CurWord - This is the current data we have pulled from the stream but have
-  /// not returned to the client.
-  uint32_t CurWord;
+  /// not returned to the client.  The stream is read eight bytes at a time,
+  /// except for its last four bytes when it isn't a multiple of eight long.
+  /// The bits above the valid ones are always zero.
+  uint64_t CurWord;
   
   /// BitsInCurWord - This is the number of bits in CurWord that are valid. This
-  /// is always from [0...31] inclusive.
+  /// is always from [0...64] inclusive.
   unsigned BitsInCurWord;
   
   // CurCodeSize - This is the declared size of code values used for the current
@@ -244,8 +247,8 @@ public:
   
   /// JumpToBit - Reset the stream to the specified bit number.
   void JumpToBit(uint64_t BitNo) {
-    uintptr_t ByteNo = uintptr_t(BitNo/8) & ~3;
-    uintptr_t WordBitNo = uintptr_t(BitNo) & 31;
+    uintptr_t ByteNo = uintptr_t(BitNo/8) & ~7;
+    uintptr_t WordBitNo = uintptr_t(BitNo) & 63;
     assert(ByteNo <= (uintptr_t)(BitStream->getLastChar()-
                                  BitStream->getFirstChar()) &&
            "Invalid location");
@@ -257,50 +260,41 @@ public:
     
     // Skip over any bits that are already consumed.
     if (WordBitNo)
-      Read(static_cast<unsigned>(WordBitNo));
+      Read64(static_cast<unsigned>(WordBitNo));
   }
   
   
   uint32_t Read(unsigned NumBits) {
     assert(NumBits <= 32 && "Cannot return more than 32 bits!");
-    // If the field is fully contained by CurWord, return it quickly.
+    // If the field is fully contained by CurWord, return it quickly.  This
+    // includes zero-width fields, which abbreviations may have.
     if (BitsInCurWord >= NumBits) {
-      uint32_t R = CurWord & ((1U << NumBits)-1);
+      uint32_t R = uint32_t(CurWord & ((uint64_t(1) << NumBits) - 1));
       CurWord >>= NumBits;
       BitsInCurWord -= NumBits;
       return R;
     }
 
-    // If we run out of data, stop at the end of the stream.
-    if (NextChar == BitStream->getLastChar()) {
-      CurWord = 0;
-      BitsInCurWord = 0;
-      return 0;
-    }
-
-    unsigned R = CurWord;
-
-    // Read the next word from the stream.
-    CurWord = (NextChar[0] <<  0) | (NextChar[1] << 8) |
-              (NextChar[2] << 16) | (NextChar[3] << 24);
-    NextChar += 4;
-
-    // Extract NumBits-BitsInCurWord from what we just read.
+    // Take what is left of CurWord, and the rest from the next word.
+    uint32_t R = uint32_t(CurWord);
+    unsigned BitsFromCurWord = BitsInCurWord;
     unsigned BitsLeft = NumBits-BitsInCurWord;
-
-    // Be careful here, BitsLeft is in the range [1..32] inclusive.
-    R |= (CurWord & (~0U >> (32-BitsLeft))) << BitsInCurWord;
-
-    // BitsLeft bits have just been used up from CurWord.
-    if (BitsLeft != 32)
-      CurWord >>= BitsLeft;
-    else
-      CurWord = 0;
-    BitsInCurWord = 32-BitsLeft;
+    if (!fillCurWord())
+      return 0;
+    R |= (uint32_t(CurWord) & (~0U >> (32-BitsLeft))) << BitsFromCurWord;
+    CurWord >>= BitsLeft;
+    BitsInCurWord -= BitsLeft;
     return R;
   }
 
   uint64_t Read64(unsigned NumBits) {
+    assert(NumBits && NumBits <= 64 && "Cannot return 0 or more than 64 bits!");
+    if (BitsInCurWord >= NumBits) {
+      uint64_t R = CurWord & (~0ULL >> (64-NumBits));
+      CurWord = NumBits == 64 ? 0 : CurWord >> NumBits;
+      BitsInCurWord -= NumBits;
+      return R;
+    }
     if (NumBits <= 32) return Read(NumBits);
 
     uint64_t V = Read(32);
@@ -309,45 +303,46 @@ public:
 
   uint32_t ReadVBR(unsigned NumBits) {
     uint32_t Piece = Read(NumBits);
-    if ((Piece & (1U << (NumBits-1))) == 0)
+    uint32_t HiBit = 1U << (NumBits-1);
+    if ((Piece & HiBit) == 0)
       return Piece;
 
-    uint32_t Result = 0;
-    unsigned NextBit = 0;
-    while (1) {
-      Result |= (Piece & ((1U << (NumBits-1))-1)) << NextBit;
-
-      if ((Piece & (1U << (NumBits-1))) == 0)
-        return Result;
-
-      NextBit += NumBits-1;
+    uint32_t Result = Piece & (HiBit-1);
+    unsigned NextBit = NumBits-1;
+    do {
       Piece = Read(NumBits);
-    }
+      Result |= (Piece & (HiBit-1)) << NextBit;
+      NextBit += NumBits-1;
+    } while (Piece & HiBit);
+    return Result;
   }
 
   // ReadVBR64 - Read a VBR that may have a value up to 64-bits in size.  The
   // chunk size of the VBR must still be <= 32 bits though.
   uint64_t ReadVBR64(unsigned NumBits) {
     uint32_t Piece = Read(NumBits);
-    if ((Piece & (1U << (NumBits-1))) == 0)
+    uint32_t HiBit = 1U << (NumBits-1);
+    if ((Piece & HiBit) == 0)
       return uint64_t(Piece);
 
-    uint64_t Result = 0;
-    unsigned NextBit = 0;
-    while (1) {
-      Result |= uint64_t(Piece & ((1U << (NumBits-1))-1)) << NextBit;
-
-      if ((Piece & (1U << (NumBits-1))) == 0)
-        return Result;
-
-      NextBit += NumBits-1;
+    uint64_t Result = Piece & (HiBit-1);
+    unsigned NextBit = NumBits-1;
+    do {
       Piece = Read(NumBits);
-    }
+      Result |= uint64_t(Piece & (HiBit-1)) << NextBit;
+      NextBit += NumBits-1;
+    } while (Piece & HiBit);
+    return Result;
   }
 
+  /// SkipToWord - Skip to the next 32-bit boundary of the stream, which
+  /// blocks and blobs are aligned to.
   void SkipToWord() {
-    BitsInCurWord = 0;
-    CurWord = 0;
+    // NextChar is always at a 32-bit boundary, so the next one is right
+    // before the whole 32-bit words that CurWord still holds.
+    unsigned BitsToKeep = BitsInCurWord & ~31U;
+    CurWord >>= BitsInCurWord-BitsToKeep;
+    BitsInCurWord = BitsToKeep;
   }
 
   unsigned ReadCode() {
@@ -376,12 +371,11 @@ public:
 
     // Check that the block wasn't partially defined, and that the offset isn't
     // bogus.
-    const unsigned char *const SkipTo = NextChar + NumWords*4;
-    if (AtEndOfStream() || SkipTo > BitStream->getLastChar() ||
-                           SkipTo < BitStream->getFirstChar())
+    uint64_t SkipTo = GetCurrentBitNo() + uint64_t(NumWords)*32;
+    if (AtEndOfStream() || SkipTo > getStreamSizeInBits())
       return true;
 
-    NextChar = SkipTo;
+    JumpToBit(SkipTo);
     return false;
   }
 
@@ -410,7 +404,7 @@ public:
 
     // Validate that this block is sane.
     if (CurCodeSize == 0 || AtEndOfStream() ||
-        NextChar+NumWords*4 > BitStream->getLastChar())
+        GetCurrentBitNo() + uint64_t(NumWords)*32 > getStreamSizeInBits())
       return true;
 
     return false;
@@ -428,6 +422,34 @@ public:
   }
 
 private:
+  /// fillCurWord - Load the next word of the stream into CurWord, which must
+  /// have been used up.  At the end of the stream, clear CurWord and return
+  /// false.
+  bool fillCurWord() {
+    const unsigned char *LastChar = BitStream->getLastChar();
+    if (LastChar-NextChar >= 8) {
+      CurWord =
+        support::endian::read_le<uint64_t, support::unaligned>(NextChar);
+      NextChar += 8;
+      BitsInCurWord = 64;
+    } else if (NextChar != LastChar) {
+      CurWord =
+        support::endian::read_le<uint32_t, support::unaligned>(NextChar);
+      NextChar += 4;
+      BitsInCurWord = 32;
+    } else {
+      CurWord = 0;
+      BitsInCurWord = 0;
+      return false;
+    }
+    return true;
+  }
+
+  uint64_t getStreamSizeInBits() const {
+    return uint64_t(BitStream->getLastChar() -
+                    BitStream->getFirstChar()) * CHAR_BIT;
+  }
+
   void PopBlockScope() {
     CurCodeSize = BlockScope.back().PrevCodeSize;
 
@@ -503,36 +525,58 @@ public:
         assert(i+2 == e && "array op not second to last?");
         const BitCodeAbbrevOp &EltEnc = Abbv->getOperandInfo(++i);
 
-        // Read all the elements.
-        for (; NumElts; --NumElts)
-          ReadAbbreviatedField(EltEnc, Vals);
+        // Read all the elements, deciding how to only once.
+        Vals.reserve(Vals.size() + NumElts);
+        switch (EltEnc.getEncoding()) {
+        case BitCodeAbbrevOp::Fixed: {
+          unsigned Width = (unsigned)EltEnc.getEncodingData();
+          for (; NumElts; --NumElts)
+            Vals.push_back(Read(Width));
+          break;
+        }
+        case BitCodeAbbrevOp::VBR: {
+          unsigned Width = (unsigned)EltEnc.getEncodingData();
+          for (; NumElts; --NumElts)
+            Vals.push_back(ReadVBR64(Width));
+          break;
+        }
+        case BitCodeAbbrevOp::Char6:
+          for (; NumElts; --NumElts)
+            Vals.push_back(BitCodeAbbrevOp::DecodeChar6(Read(6)));
+          break;
+        default:
+          for (; NumElts; --NumElts)
+            ReadAbbreviatedField(EltEnc, Vals);
+          break;
+        }
       } else if (Op.getEncoding() == BitCodeAbbrevOp::Blob) {
         // Blob case.  Read the number of bytes as a vbr6.
         unsigned NumElts = ReadVBR(6);
         SkipToWord();  // 32-bit alignment
 
         // Figure out where the end of this blob will be including tail padding.
-        const unsigned char *NewEnd = NextChar+((NumElts+3)&~3);
+        uint64_t BlobBitNo = GetCurrentBitNo();
+        uint64_t NewEnd = BlobBitNo + uint64_t((NumElts+3)&~3)*8;
         
         // If this would read off the end of the bitcode file, just set the
         // record to empty and return.
-        if (NewEnd > BitStream->getLastChar()) {
+        if (NewEnd > getStreamSizeInBits()) {
           Vals.append(NumElts, 0);
-          NextChar = BitStream->getLastChar();
+          JumpToBit(getStreamSizeInBits());
           break;
         }
         
         // Otherwise, read the number of bytes.  If we can return a reference to
         // the data, do so to avoid copying it.
+        const unsigned char *Blob = BitStream->getFirstChar() + BlobBitNo/8;
         if (BlobStart) {
-          *BlobStart = (const char*)NextChar;
+          *BlobStart = (const char*)Blob;
           *BlobLen = NumElts;
         } else {
-          for (; NumElts; ++NextChar, --NumElts)
-            Vals.push_back(*NextChar);
+          Vals.append(Blob, Blob+NumElts);
         }
         // Skip over tail padding.
-        NextChar = NewEnd;
+        JumpToBit(NewEnd);
       } else {
         ReadAbbreviatedField(Op, Vals);
       }
@@ -173,6 +173,21 @@ public:
     Out[ByteNo  ] = (unsigned char)(NewWord >> 24);
   }
 
+  // BackpatchBits - Backpatch a 32-bit field that starts at the specified bit
+  // of the output, which need not be word aligned.  The field must already
+  // have been flushed to the output.
+  void BackpatchBits(uint64_t BitNo, uint32_t NewBits) {
+    assert(BitNo + 32 <= Out.size() * 8 && "Field not written yet!");
+    size_t ByteNo = size_t(BitNo / 8);
+    unsigned Shift = unsigned(BitNo % 8);
+    uint64_t Mask = uint64_t(~0U) << Shift;
+    uint64_t Bits = uint64_t(NewBits) << Shift;
+    for (unsigned i = 0; i != 5 && (Mask >> i*8); ++i) {
+      Out[ByteNo+i] &= (unsigned char)~(Mask >> i*8);
+      Out[ByteNo+i] |= (unsigned char)(Bits >> i*8);
+    }
+  }
+
   //===--------------------------------------------------------------------===//
   // Block Manipulation
   //===--------------------------------------------------------------------===//
@@ -525,6 +540,68 @@ public:
 
     return Info.Abbrevs.size()-1+bitc::FIRST_APPLICATION_ABBREV;
   }
+
+  //===--------------------------------------------------------------------===//
+  // Blocks Written Separately
+  //===--------------------------------------------------------------------===//
+
+  /// CopyBlockInfo - Make the abbreviations that Other's BLOCKINFO_BLOCK
+  /// defined available to blocks written by this writer as well, without
+  /// emitting a BLOCKINFO_BLOCK.  The abbreviations are copied rather than
+  /// shared, so the two writers can be used on different threads.
+  void CopyBlockInfo(const BitstreamWriter &Other) {
+    for (unsigned i = 0, e = static_cast<unsigned>(
+           Other.BlockInfoRecords.size()); i != e; ++i) {
+      const BlockInfo &OtherInfo = Other.BlockInfoRecords[i];
+      BlockInfo &Info = getOrCreateBlockInfo(OtherInfo.BlockID);
+      for (unsigned j = 0, je = static_cast<unsigned>(
+             OtherInfo.Abbrevs.size()); j != je; ++j) {
+        const BitCodeAbbrev *OtherAbbv = OtherInfo.Abbrevs[j];
+        BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+        for (unsigned k = 0, ke = OtherAbbv->getNumOperandInfos(); k != ke; ++k)
+          Abbv->Add(OtherAbbv->getOperandInfo(k));
+        Info.Abbrevs.push_back(Abbv);
+      }
+    }
+  }
+
+  /// AppendBlock - Emit a copy of a block that was written on its own, as the
+  /// only contents of Block, by a writer with the same abbreviations (see
+  /// CopyBlockInfo).  The result is the same as if the block had been written
+  /// to this stream directly.
+  void AppendBlock(unsigned BlockID, unsigned CodeLen,
+                   const std::vector<unsigned char> &Block) {
+    // Everything after the block header is word aligned, and so doesn't
+    // depend on where the block starts.  Only the header, whose abbrev ID
+    // width is that of the enclosing block, needs to be written again.  The
+    // copy was written at the top level, where abbrev IDs are 2 bits wide.
+    unsigned HeaderBits = 2 + GetVBRSize(BlockID, bitc::BlockIDWidth) +
+                          GetVBRSize(CodeLen, bitc::CodeLenWidth);
+    unsigned HeaderBytes = (HeaderBits+31)/32*4;
+    assert(Block.size() >= HeaderBytes+4 && "Not a block!");
+    assert(Block.size()-HeaderBytes-4 ==
+           4*size_t(uint32_t(Block[HeaderBytes]) |
+                    uint32_t(Block[HeaderBytes+1]) << 8 |
+                    uint32_t(Block[HeaderBytes+2]) << 16 |
+                    uint32_t(Block[HeaderBytes+3]) << 24) &&
+           "Block size doesn't match the buffer!");
+
+    EmitCode(bitc::ENTER_SUBBLOCK);
+    EmitVBR(BlockID, bitc::BlockIDWidth);
+    EmitVBR(CodeLen, bitc::CodeLenWidth);
+    FlushToWord();
+    Out.insert(Out.end(), Block.begin()+HeaderBytes, Block.end());
+  }
+
+private:
+  /// GetVBRSize - Return the number of bits EmitVBR takes to emit Val.
+  static unsigned GetVBRSize(uint32_t Val, unsigned NumBits) {
+    unsigned Size = NumBits;
+    for (uint32_t Threshold = 1U << (NumBits-1); Val >= Threshold;
+         Val >>= NumBits-1)
+      Size += NumBits;
+    return Size;
+  }
 };
 
 
@@ -43,7 +43,9 @@ namespace bitc {
     
     TYPE_BLOCK_ID_NEW,
 
-    USELIST_BLOCK_ID
+    USELIST_BLOCK_ID,
+
+    FUNCTION_INDEX_BLOCK_ID
   };
 
 
@@ -70,7 +72,12 @@ namespace bitc {
     /// MODULE_CODE_PURGEVALS: [numvals]
     MODULE_CODE_PURGEVALS   = 10,
 
-    MODULE_CODE_GCNAME      = 11   // GCNAME: [strchr x N]
+    MODULE_CODE_GCNAME      = 11,  // GCNAME: [strchr x N]
+
+    // FNINDEX_OFFSET: [offset low 32 bits, offset high 32 bits]
+    //   The bit offset of the FUNCTION_INDEX block from the start of the
+    //   module block's contents.
+    MODULE_CODE_FNINDEX_OFFSET = 12
   };
 
   /// PARAMATTR blocks have code for defining a parameter attribute set.
@@ -319,6 +326,13 @@ namespace bitc {
   enum UseListCodes {
     USELIST_CODE_ENTRY = 1   // USELIST_CODE_ENTRY: TBD.
   };
+
+  /// The function index block (FUNCTION_INDEX_BLOCK_ID) follows the last
+  /// function body, and tells a lazy reader where each body is without
+  /// skipping through all of them.
+  enum FunctionIndexCodes {
+    FNINDEX_CODE_ENTRY = 1   // ENTRY: [valueid, offset]
+  };
 } // End bitc namespace
 } // End llvm namespace
 
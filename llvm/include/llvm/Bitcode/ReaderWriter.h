@@ -23,6 +23,7 @@ namespace llvm {
   class BitstreamWriter;
   class LLVMContext;
   class raw_ostream;
+  class ThreadPool;
   
   /// getLazyBitcodeModule - Read the header of the specified bitcode buffer
   /// and prepare for lazy deserialization of function bodies.  If successful,
@@ -50,12 +51,17 @@ namespace llvm {
 
   /// WriteBitcodeToFile - Write the specified module to the specified
   /// raw output stream.  For streams where it matters, the given stream
-  /// should be in "binary" mode.
-  void WriteBitcodeToFile(const Module *M, raw_ostream &Out);
+  /// should be in "binary" mode.  If Pool is non-null, or the
+  /// -parallel-bitcode-writer option is given, function bodies are encoded
+  /// on the workers of Pool (or of the global pool); the output is the same
+  /// either way.
+  void WriteBitcodeToFile(const Module *M, raw_ostream &Out,
+                          ThreadPool *Pool = 0);
 
   /// WriteBitcodeToStream - Write the specified module to the specified
-  /// raw output stream.
-  void WriteBitcodeToStream(const Module *M, BitstreamWriter &Stream);
+  /// raw output stream.  Pool is as for WriteBitcodeToFile.
+  void WriteBitcodeToStream(const Module *M, BitstreamWriter &Stream,
+                            ThreadPool *Pool = 0);
 
   /// createBitcodeWriterPass - Create and return a pass that writes the module
   /// to the specified ostream.
@@ -49,6 +49,8 @@ public:
   DominatorTreeBase<MachineBasicBlock>& getBase() { return *DT; }
   
   virtual void getAnalysisUsage(AnalysisUsage &AU) const;
+
+  virtual bool isParallelSafe() const { return true; }
   
   /// getRoots -  Return the root blocks of the current CFG.  This may include
   /// multiple blocks if we are computing post dominators.  For forward
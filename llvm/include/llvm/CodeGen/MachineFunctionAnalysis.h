@@ -15,6 +15,7 @@
 #define LLVM_CODEGEN_MACHINE_FUNCTION_ANALYSIS_H
 
 #include "llvm/Pass.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Target/TargetMachine.h"
 
 namespace llvm {
@@ -28,6 +29,10 @@ private:
   const TargetMachine &TM;
   MachineFunction *MF;
   unsigned NextFnNum;
+  /// FunctionNumbers - The numbers of the functions defined when the module
+  /// was initialized, so that every copy of this pass that runs in parallel
+  /// numbers a function as a serial run would.
+  DenseMap<const Function*, unsigned> FunctionNumbers;
 public:
   static char ID;
   explicit MachineFunctionAnalysis(const TargetMachine &tm);
@@ -39,6 +44,12 @@ public:
     return "Machine Function Analysis";
   }
 
+  /// isParallelSafe - Every copy of this pass creates its own
+  /// MachineFunctions.  They share the MachineModuleInfo, which is not
+  /// parallel safe and so still keeps code generator pipelines serial.
+  virtual bool isParallelSafe() const { return true; }
+  virtual Pass *createParallelInstance() const;
+
 private:
   virtual bool doInitialization(Module &M);
   virtual bool runOnFunction(Function &F);
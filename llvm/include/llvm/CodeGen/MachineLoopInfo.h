@@ -113,6 +113,8 @@ public:
 
   virtual void getAnalysisUsage(AnalysisUsage &AU) const;
 
+  virtual bool isParallelSafe() const { return true; }
+
   /// removeLoop - This removes the specified top-level loop from this loop info
   /// object.  The loop is not deleted, as it will presumably be inserted into
   /// another loop.
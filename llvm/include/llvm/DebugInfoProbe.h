@@ -60,6 +60,10 @@ namespace llvm {
     /// finalize - Collect information after running an optimization pass. This
     /// must be used after initialization.
     void finalize(Pass *P, Function &F);
+
+    /// isEnabled - Return true if -enable-debug-info-probe is set, without
+    /// which the probes collect nothing.
+    static bool isEnabled();
   };
 
 } // End llvm namespace
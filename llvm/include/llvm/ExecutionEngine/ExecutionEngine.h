@@ -41,7 +41,9 @@ class JITMemoryManager;
 class MachineCodeInfo;
 class Module;
 class MutexGuard;
+class ObjectCache;
 class TargetData;
+class ThreadPool;
 class Triple;
 class Type;
 
@@ -108,6 +110,13 @@ class ExecutionEngine {
   /// Whether lazy JIT compilation is enabled.
   bool CompilingLazily;
 
+  /// Whether lazily compiled functions are compiled ahead on a background
+  /// thread.
+  bool CompilingInBackground;
+
+  /// The pool background compilation runs on, or null for the global pool.
+  ThreadPool *BackgroundPool;
+
   /// Whether JIT compilation of external global variables is allowed.
   bool GVCompilationDisabled;
 
@@ -142,7 +151,8 @@ protected:
     JITMemoryManager *JMM,
     bool GVsWithCode,
     TargetMachine *TM);
-  static ExecutionEngine *(*InterpCtor)(Module *M, std::string *ErrorStr);
+  static ExecutionEngine *(*InterpCtor)(Module *M, std::string *ErrorStr,
+                                        bool UseBytecode);
 
   /// LazyFunctionCreator - If an unknown function is needed, this function
   /// pointer is invoked to create it.  If this returns null, the JIT will
@@ -329,6 +339,20 @@ public:
   /// for garbage-collecting generated code.
   virtual void freeMachineCodeForFunction(Function *F) = 0;
 
+  /// redirectFunction - Make calls to F, from code this engine generated and
+  /// through its stubs, continue at NewAddr instead, typically code generated
+  /// for F by another engine.  Returns false if the engine cannot do so.
+  virtual bool redirectFunction(Function *F, void *NewAddr) { return false; }
+
+  /// addTier - Hand the functions this engine runs over to EE once they have
+  /// been called, or have gone around a loop, Threshold times.  EE must be a
+  /// JIT created for the same modules; it shares their global variables with
+  /// this engine and is destroyed along with it.  Returns false, without
+  /// taking ownership of EE, if this engine does not support tiering.
+  virtual bool addTier(ExecutionEngine *EE, unsigned Threshold) {
+    return false;
+  }
+
   /// getOrEmitGlobalVariable - Return the address of the specified global
   /// variable, possibly emitting it to memory if needed.  This is used by the
   /// Emitter.
@@ -343,6 +367,13 @@ public:
   virtual void RegisterJITEventListener(JITEventListener *) {}
   virtual void UnregisterJITEventListener(JITEventListener *) {}
 
+  /// setObjectCache - Sets the cache the JIT consults for object files it
+  /// generated earlier for the same module, which saves running code
+  /// generation again.  Does not take ownership of the argument, which may be
+  /// NULL to disable caching.  Only the MCJIT caches objects; other engines
+  /// ignore the cache.
+  virtual void setObjectCache(ObjectCache *) {}
+
   /// DisableLazyCompilation - When lazy compilation is off (the default), the
   /// JIT will eagerly compile every function reachable from the argument to
   /// getPointerToFunction.  If lazy compilation is turned on, the JIT will only
@@ -368,6 +399,30 @@ public:
     return !CompilingLazily;
   }
 
+  /// EnableBackgroundCompilation - When both this and lazy compilation are on,
+  /// every function that gets a lazy stub is also queued to be compiled by a
+  /// single task on Pool, or on the global ThreadPool if Pool is null, and
+  /// its stub is atomically redirected to the code once it is ready.  A
+  /// thread that calls the stub first compiles the function itself, or waits
+  /// for the background task if that is already doing it, so first calls
+  /// rarely pay for code generation.  If the pool has no worker threads,
+  /// functions are only compiled lazily.  Pool must outlive the engine.  The
+  /// same rules as for lazy compilation in a threaded program apply.
+  void EnableBackgroundCompilation(bool Enabled = true, ThreadPool *Pool = 0) {
+    CompilingInBackground = Enabled;
+    BackgroundPool = Pool;
+  }
+  bool isCompilingInBackground() const {
+    return CompilingInBackground;
+  }
+  ThreadPool *getBackgroundThreadPool() const {
+    return BackgroundPool;
+  }
+
+  /// waitForBackgroundCompilation - Return once the functions queued for
+  /// background compilation so far have been compiled.
+  virtual void waitForBackgroundCompilation() {}
+
   /// DisableGVCompilation - If called, the JIT will abort if it's asked to
   /// allocate space and populate a GlobalVariable that is not internal to
   /// the module.
@@ -469,6 +524,9 @@ private:
   std::string MCPU;
   SmallVector<std::string, 4> MAttrs;
   bool UseMCJIT;
+  bool InterpreterBytecode;
+  unsigned Tier1Threshold;
+  unsigned Tier2Threshold;
 
   /// InitEngine - Does the common initialization of default options.
   void InitEngine() {
@@ -481,8 +539,14 @@ private:
     RelocModel = Reloc::Default;
     CMModel = CodeModel::JITDefault;
     UseMCJIT = false;
+    InterpreterBytecode = false;
+    Tier1Threshold = 0;
+    Tier2Threshold = 0;
   }
 
+  /// createTiered - Create the engine requested with setTieredCompilation.
+  ExecutionEngine *createTiered();
+
 public:
   /// EngineBuilder - Constructor for EngineBuilder.  If create() is called and
   /// is successful, the created engine takes ownership of the module.
@@ -573,6 +637,27 @@ public:
     return *this;
   }
 
+  /// setInterpreterBytecode - Set whether the interpreter should translate
+  /// functions to bytecode before running them, as -interpreter-bytecode
+  /// makes every interpreter do.
+  EngineBuilder &setInterpreterBytecode(bool Value) {
+    InterpreterBytecode = Value;
+    return *this;
+  }
+
+  /// setTieredCompilation - Start out interpreting every function, and move
+  /// the ones that turn out to be hot to the JIT: a function is compiled with
+  /// CodeGenOpt::Less once it has been called or has looped Tier1Threshold
+  /// times, and with CodeGenOpt::Aggressive once that count reaches
+  /// Tier2Threshold.  A threshold of zero leaves out that tier, and zero for
+  /// both (the default) disables tiering.  Needs both the interpreter and the
+  /// JIT linked in; the engine kind and optimization level are ignored.
+  EngineBuilder &setTieredCompilation(unsigned Tier1, unsigned Tier2) {
+    Tier1Threshold = Tier1;
+    Tier2Threshold = Tier2;
+    return *this;
+  }
+
   /// setMAttrs - Set cpu-specific attributes.
   template<typename StringSequence>
   EngineBuilder &setMAttrs(const StringSequence &mattrs) {
@@ -15,6 +15,7 @@
 #ifndef LLVM_EXECUTION_ENGINE_JIT_EVENTLISTENER_H
 #define LLVM_EXECUTION_ENGINE_JIT_EVENTLISTENER_H
 
+#include "llvm/ADT/StringRef.h"
 #include "llvm/Support/DataTypes.h"
 #include "llvm/Support/DebugLoc.h"
 
@@ -36,7 +37,8 @@ struct JITEvent_EmittedFunctionDetails {
     DebugLoc Loc;
   };
 
-  /// The machine function the struct contains information for.
+  /// The machine function the struct contains information for.  Null for
+  /// functions loaded by the MCJIT, which have no line information either.
   const MachineFunction *MF;
 
   /// The list of line boundary information, sorted by address.
@@ -77,6 +79,12 @@ public:
 // This returns NULL if support isn't available.
 JITEventListener *createOProfileJITEventListener();
 
+/// createPerfJITEventListener - Return a listener that lists the emitted
+/// functions in /tmp/perf-<pid>.map for the Linux perf tool.  If JITDumpDir is
+/// not empty, the functions are also written, with their code and line
+/// tables, to JITDumpDir/jit-<pid>.dump.  This returns NULL on other systems.
+JITEventListener *createPerfJITEventListener(StringRef JITDumpDir = "");
+
 } // end namespace llvm.
 
 #endif
@@ -0,0 +1,76 @@
+//===- ObjectCache.h - Cache of JIT-compiled object files -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the ObjectCache interface, which lets the MCJIT reuse the
+// object files it produced for a module in an earlier run instead of running
+// code generation again, and DiskObjectCache, an implementation that keeps
+// the objects in a directory bounded in size with least recently used
+// eviction.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTION_ENGINE_OBJECTCACHE_H
+#define LLVM_EXECUTION_ENGINE_OBJECTCACHE_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DataTypes.h"
+#include <string>
+
+namespace llvm {
+
+class MemoryBuffer;
+
+/// ObjectCache - Interface the MCJIT consults before generating code for a
+/// module.  Objects are looked up by a key which the JIT derives from the
+/// module and every target setting that affects the generated code, so a
+/// cache may be shared by any number of engines and processes.
+class ObjectCache {
+  ObjectCache(const ObjectCache &);      // DO NOT IMPLEMENT
+  void operator=(const ObjectCache &);   // DO NOT IMPLEMENT
+public:
+  ObjectCache() {}
+  virtual ~ObjectCache();
+
+  /// getObject - Return the object file cached under Key, or null if there
+  /// is none.  The caller takes ownership of the returned buffer.
+  virtual MemoryBuffer *getObject(StringRef Key) = 0;
+
+  /// notifyObjectCompiled - Called after an object file was generated for
+  /// the module identified by Key.  Obj is still owned by the caller.
+  virtual void notifyObjectCompiled(StringRef Key, const MemoryBuffer *Obj) = 0;
+};
+
+/// DiskObjectCache - An ObjectCache that stores each object as "<Key>.o" in a
+/// directory.  Reading an object marks it as recently used by updating its
+/// modification time, and whenever an object is added the least recently used
+/// ones are removed until the directory is within its limits again.
+class DiskObjectCache : public ObjectCache {
+  std::string Dir;
+  uint64_t MaxSize;
+  unsigned MaxObjects;
+
+  std::string getPathForKey(StringRef Key) const;
+public:
+  /// DiskObjectCache - Cache objects in the directory Dir, which is created
+  /// when needed.  MaxSize bounds the total size in bytes of the cached
+  /// objects and MaxObjects their number; zero means no limit.
+  explicit DiskObjectCache(StringRef Dir, uint64_t MaxSize = 0,
+                           unsigned MaxObjects = 0);
+
+  virtual MemoryBuffer *getObject(StringRef Key);
+  virtual void notifyObjectCompiled(StringRef Key, const MemoryBuffer *Obj);
+
+  /// prune - Remove the least recently used objects until the cache is within
+  /// its limits.  Files that are not cached objects are left alone.
+  void prune();
+};
+
+} // end namespace llvm
+
+#endif
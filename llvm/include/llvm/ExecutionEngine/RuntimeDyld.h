@@ -16,6 +16,7 @@
 
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Memory.h"
+#include <string>
 
 namespace llvm {
 
@@ -44,6 +45,25 @@ public:
   // memory was actually used.
   virtual void endFunctionBody(const char *Name, uint8_t *FunctionStart,
                                uint8_t *FunctionEnd) = 0;
+
+  // Allocate Size bytes, aligned to Alignment, for a section of executable
+  // code. SectionID is a number unique to the section for the lifetime of
+  // the RuntimeDyld, so clients can tell which block holds which section.
+  // By default the section is allocated as a function body, through
+  // startFunctionBody and endFunctionBody. Return null on failure.
+  virtual uint8_t *allocateCodeSection(uintptr_t Size, unsigned Alignment,
+                                       unsigned SectionID);
+
+  // Allocate Size bytes, aligned to Alignment, for a section of data. By
+  // default this is done like allocateCodeSection.
+  virtual uint8_t *allocateDataSection(uintptr_t Size, unsigned Alignment,
+                                       unsigned SectionID);
+
+  // Return the address of the named symbol, which the loaded objects refer
+  // to but don't define. If AbortOnFailure is false and the symbol cannot be
+  // found, return null. By default the symbols of the process are searched.
+  virtual void *getPointerToNamedFunction(const std::string &Name,
+                                          bool AbortOnFailure = true);
 };
 
 class RuntimeDyld {
@@ -63,11 +83,16 @@ public:
   // be the address used for relocation (clients can copy the data around
   // and resolve relocatons based on where they put it).
   void *getSymbolAddress(StringRef Name);
+  // Get the size of the code of the named function, as given by the object
+  // file, or 0 if it is unknown.
+  uint64_t getFunctionSize(StringRef Name);
   // Resolve the relocations for all symbols we currently know about.
   void resolveRelocations();
   // Change the address associated with a symbol when resolving relocations.
   // Any relocations already associated with the symbol will be re-resolved.
   void reassignSymbolAddress(StringRef Name, uint8_t *Addr);
+  // Return true if loading or relocating an object failed.
+  bool hasError();
   StringRef getErrorString();
 };
 
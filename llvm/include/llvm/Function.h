@@ -87,6 +87,11 @@ private:
   ValueSymbolTable *SymTab;               ///< Symbol table of args/instructions
   AttrListPtr AttributeList;              ///< Parameter attributes
 
+  /// ModificationEpoch, VerifiedEpoch - See getModificationEpoch and
+  /// getVerifiedEpoch.
+  unsigned ModificationEpoch;
+  unsigned VerifiedEpoch;
+
   // HasLazyArguments is stored in Value::SubclassData.
   /*bool HasLazyArguments;*/
                    
@@ -188,6 +193,25 @@ public:
     removeAttribute(~0U, N);
   }
 
+  /// getModificationEpoch - Return a counter that advances whenever the body
+  /// of this function changes: when basic blocks or instructions are added,
+  /// removed or moved, when a value it uses is replaced with
+  /// replaceAllUsesWith or replaceUsesOfWith, and when a pass run by a pass
+  /// manager reports that it changed the function.
+  unsigned getModificationEpoch() const { return ModificationEpoch; }
+
+  /// markModified - Advance the modification epoch.  Code that changes the
+  /// body in place outside of a pass manager, e.g. by setting an operand or
+  /// instruction metadata, should call this so that incremental verification
+  /// looks at the function again.  Like any other change to the body, this
+  /// must not race with other users of the function.
+  void markModified() { ++ModificationEpoch; }
+
+  /// getVerifiedEpoch/setVerifiedEpoch - The modification epoch at which the
+  /// verifier last found the body of this function well formed, or zero.
+  unsigned getVerifiedEpoch() const { return VerifiedEpoch; }
+  void setVerifiedEpoch(unsigned Epoch) { VerifiedEpoch = Epoch; }
+
   /// hasGC/getGC/setGC/clearGC - The name of the garbage collection algorithm
   ///                             to use during code generation.
   bool hasGC() const;
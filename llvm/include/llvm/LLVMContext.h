@@ -28,8 +28,9 @@ template <typename T> class SmallVectorImpl;
 /// This is an important class for using LLVM in a threaded context.  It
 /// (opaquely) owns and manages the core "global" data of LLVM's core 
 /// infrastructure, including the type and constant uniquing tables.
-/// LLVMContext itself provides no locking guarantees, so you should be careful
-/// to have one context per thread.
+/// By default LLVMContext provides no locking guarantees, so you should be
+/// careful to have one context per thread.  See setConcurrentUniquing for the
+/// opt-in mode that allows several threads to share one context.
 class LLVMContext {
 public:
   LLVMContextImpl *const pImpl;
@@ -75,6 +76,36 @@ public:
   /// setInlineAsmDiagnosticHandler.
   void *getInlineAsmDiagnosticContext() const;
   
+  /// setConcurrentUniquing - Enable or disable concurrent mode for the
+  /// uniquing tables of this context.  In concurrent mode, types, constants,
+  /// inline asm, metadata and metadata kind IDs may be looked up and created
+  /// from several threads at once, and value handles, instruction metadata
+  /// and debug locations may be changed concurrently.  Each table is protected
+  /// by its own lock, and the ConstantInt table is split into several
+  /// lock-striped shards.  Edits to the use lists of values that are shared
+  /// between functions are locked as well, and so are getOrInsertFunction and
+  /// the symbol lookups of the modules, so different functions can be
+  /// rewritten in parallel.  Walking the use lists of shared values while
+  /// other threads may change them is still not safe.
+  ///
+  /// This must be called while no other thread is using the context.
+  void setConcurrentUniquing(bool Enable);
+
+  /// hasConcurrentUniquing - Return true if setConcurrentUniquing has enabled
+  /// concurrent mode for this context.
+  bool hasConcurrentUniquing() const;
+
+  /// setDiscardValueNames - Enable or disable a mode in which setName leaves
+  /// values other than globals unnamed, which saves the memory and time
+  /// spent on their names when nobody will read them.  A name given before
+  /// this is enabled is kept until it is changed.  The bitcode reader skips
+  /// the names of local values, and the .ll parser, which needs them,
+  /// refuses to run.
+  void setDiscardValueNames(bool Discard);
+
+  /// shouldDiscardValueNames - Return true if setDiscardValueNames has
+  /// enabled discarding the names of values other than globals.
+  bool shouldDiscardValueNames() const;
   
   /// emitError - Emit an error message to the currently installed error handler
   /// with optional location information.  This function returns, so code should
@@ -164,6 +164,26 @@ public:
   /// check state of analysis information. 
   virtual void verifyAnalysis() const;
 
+  /// isParallelSafe - Return true if this pass may be used from several
+  /// threads at once.  For a pass managed by a function pass manager this
+  /// means that separate instances of it, as returned by
+  /// createParallelInstance(), can run on different functions of the same
+  /// module concurrently, touching nothing shared between functions except
+  /// through a context with concurrent uniquing enabled.  The pass manager
+  /// puts the declarations such passes add to the module and the use lists of
+  /// shared values in a fixed order afterwards, but the names of other module
+  /// level values they create would depend on the thread schedule, so they
+  /// must not create any.  For an immutable or module level analysis it means
+  /// that its query methods can be called concurrently.  The default is false.
+  virtual bool isParallelSafe() const;
+
+  /// createParallelInstance - Return a new, unscheduled instance of this pass
+  /// that behaves exactly like this one.  The default creates the pass with
+  /// its registered default constructor, which is only right for passes that
+  /// have no construction-time options; passes that do should override this,
+  /// or return null when they can not be copied.
+  virtual Pass *createParallelInstance() const;
+
   // dumpPassStructure - Implement the -debug-passes=PassStructure option
   virtual void dumpPassStructure(unsigned Offset = 0);
 
@@ -360,6 +380,13 @@ public:
 /// @brief This is the storage for the -time-passes option.
 extern bool TimePassesIsEnabled;
 
+/// If the user specifies the -parallel-function-passes argument on an LLVM
+/// tool command line then the value of this boolean will be true, otherwise
+/// false.  Tools that honor it start multithreading and enable concurrent
+/// uniquing on their context, see Pass::isParallelSafe.
+/// @brief This is the storage for the -parallel-function-passes option.
+extern bool ParallelFunctionPassesEnabled;
+
 } // End llvm namespace
 
 // Include support files that contain important APIs commonly used by Passes,
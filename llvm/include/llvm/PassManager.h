@@ -23,6 +23,7 @@ namespace llvm {
 
 class Pass;
 class Module;
+class ThreadPool;
 
 class PassManagerImpl;
 class FunctionPassManagerImpl;
@@ -58,6 +59,11 @@ public:
   /// whether any of the passes modifies the module, and if so, return true.
   bool run(Module &M);
 
+  /// setThreadPool - When -parallel-function-passes lets function passes run
+  /// on several functions at once, run them on Pool rather than on the global
+  /// thread pool.  Pool must outlive the calls to run.
+  void setThreadPool(ThreadPool *Pool);
+
 private:
   /// addImpl - Add a pass to the queue of passes to run, without
   /// checking whether to add a printer pass.
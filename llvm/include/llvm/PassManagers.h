@@ -96,6 +96,7 @@ namespace llvm {
   class StringRef;
   class Value;
   class Timer;
+  class ThreadPool;
   class PMDataManager;
 
 // enums for debugging strings
@@ -198,6 +199,24 @@ public:
   /// Find analysis usage information for the pass P.
   AnalysisUsage *findAnalysisUsage(Pass *P);
 
+  /// addPassCopy - Register Copy, an instance of the scheduled pass Original
+  /// made to run on another thread, so that it shares Original's analysis
+  /// usage and frees the copies of the passes Original is the last user of.
+  /// Copies maps the scheduled passes of the same pipeline to their copies.
+  void addPassCopy(Pass *Copy, Pass *Original,
+                   const DenseMap<Pass *, Pass *> &Copies);
+
+  /// removePassCopy - Forget a pass registered with addPassCopy, before it is
+  /// deleted.
+  void removePassCopy(Pass *Copy);
+
+  /// setThreadPool - Run function passes in parallel on Pool rather than on
+  /// the global thread pool.
+  void setThreadPool(ThreadPool *P) { Pool = P; }
+
+  /// getThreadPool - Return the pool that function passes run in parallel on.
+  ThreadPool &getThreadPool() const;
+
   virtual ~PMTopLevelManager(); 
 
   /// Add immutable pass and initialize it.
@@ -251,6 +270,9 @@ private:
   SmallVector<ImmutablePass *, 8> ImmutablePasses;
 
   DenseMap<Pass *, AnalysisUsage *> AnUsageMap;
+
+  /// Pool - The pool set with setThreadPool, or null for the global pool.
+  ThreadPool *Pool;
 };
 
 
@@ -407,13 +429,34 @@ private:
 /// sequence them to process one function at a time before processing next 
 /// function.
 class FPPassManager : public ModulePass, public PMDataManager {
+  /// IsWorkerCopy - True for the per-thread copies of a manager made by
+  /// runOnModule to process several functions in parallel.
+  bool IsWorkerCopy;
+
+  /// canRunInParallel - Return true if the functions of M can be handed to
+  /// copies of this manager running on the pool of the top level manager.
+  bool canRunInParallel(Module &M);
+
+  /// createWorkerCopy - Return a copy of this manager with its own instances
+  /// of all of the passes, or null if some pass can not be copied.
+  FPPassManager *createWorkerCopy();
+
+  /// destroyWorkerCopy - Delete a copy made by createWorkerCopy.
+  void destroyWorkerCopy(FPPassManager *Copy);
+
+  /// runOnFunctionsInParallel - Run the passes on every function of M, using
+  /// one copy of this manager per thread.
+  bool runOnFunctionsInParallel(Module &M);
+
 public:
   static char ID;
   explicit FPPassManager() 
-  : ModulePass(ID), PMDataManager() { }
+  : ModulePass(ID), PMDataManager(), IsWorkerCopy(false) { }
   
   /// run - Execute all of the passes scheduled for execution.  Keep track of
   /// whether any of the passes modifies the module, and if so, return true.
+  /// When -parallel-function-passes is given and every pass allows it,
+  /// runOnModule processes several functions at once, see isParallelSafe().
   bool runOnFunction(Function &F);
   bool runOnModule(Module &M);
   
@@ -7,7 +7,8 @@
 //
 //===----------------------------------------------------------------------===//
 //
-// This file defines the MallocAllocator and BumpPtrAllocator interfaces.
+// This file defines the MallocAllocator and BumpPtrAllocator interfaces, and
+// the SlabPool that lets bump allocators share their memory.
 //
 //===----------------------------------------------------------------------===//
 
@@ -17,12 +18,15 @@
 #include "llvm/Support/AlignOf.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/DataTypes.h"
+#include "llvm/Support/Mutex.h"
 #include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <cstddef>
 
 namespace llvm {
+class raw_ostream;
+
 template <typename T> struct ReferenceAdder { typedef T& result; };
 template <typename T> struct ReferenceAdder<T&> { typedef T result; };
 
@@ -66,6 +70,10 @@ public:
   virtual ~SlabAllocator();
   virtual MemSlab *Allocate(size_t Size) = 0;
   virtual void Deallocate(MemSlab *Slab) = 0;
+
+  /// ReleasePages - Tell the allocator that the contents of Slab, which stays
+  /// in use, are dead.  It may give the pages behind them back to the system.
+  virtual void ReleasePages(MemSlab *Slab);
 };
 
 /// MallocSlabAllocator - The default slab allocator for the bump allocator
@@ -83,6 +91,79 @@ public:
   virtual void Deallocate(MemSlab *Slab);
 };
 
+/// SlabPool - A thread-safe slab allocator that keeps the slabs it gets back,
+/// up to a limit, and hands them out again, so that bump allocators which
+/// come and go don't each go back to malloc.  The pages of the slabs it keeps
+/// are given back to the system with madvise(MADV_DONTNEED) where available,
+/// so that a long-running process doesn't hold on to its peak memory.
+class SlabPool : public SlabAllocator {
+  SlabPool(const SlabPool &);        // do not implement
+  void operator=(const SlabPool &);  // do not implement
+
+  sys::Mutex Lock;
+
+  /// FreeSlabs - The slabs we kept, linked through their NextPtr.
+  MemSlab *FreeSlabs;
+
+  /// RetainedBytes - The total size of FreeSlabs.
+  size_t RetainedBytes;
+
+  /// MaxRetainedBytes - Slabs that would take RetainedBytes above this are
+  /// freed instead of being kept.
+  size_t MaxRetainedBytes;
+
+public:
+  explicit SlabPool(size_t MaxRetained = 64 << 20);
+  virtual ~SlabPool();
+
+  /// Allocate - Reuse a kept slab of at least Size bytes, but not more than
+  /// twice that, or malloc a new one.
+  virtual MemSlab *Allocate(size_t Size);
+  virtual void Deallocate(MemSlab *Slab);
+  virtual void ReleasePages(MemSlab *Slab);
+
+  /// getRetainedMemory - Return the number of bytes in the slabs kept for
+  /// reuse.
+  size_t getRetainedMemory();
+
+  /// releaseMemory - Free all the slabs kept for reuse.
+  void releaseMemory();
+
+  /// getShared - Return the pool shared by the whole process.  It is never
+  /// destroyed, so allocators using it may outlive llvm_shutdown.
+  static SlabPool &getShared();
+};
+
+/// AllocatorCounters - The memory held by the bump allocators that were given
+/// the same name with BumpPtrAllocator::setName, to find out which subsystem
+/// owns the memory of a process.  The counters only change when a slab is
+/// allocated or freed, so they cost nothing per allocation.
+struct AllocatorCounters {
+  const char *Name;
+
+  /// NumAllocators - The number of live allocators with this name.
+  unsigned NumAllocators;
+
+  /// NumSlabs, SlabBytes - The slabs these allocators currently hold.
+  unsigned NumSlabs;
+  size_t SlabBytes;
+
+  /// PeakSlabBytes - The highest SlabBytes ever was.
+  size_t PeakSlabBytes;
+
+  /// Next - The counters of the next name, in the order names were first
+  /// used.
+  AllocatorCounters *Next;
+};
+
+/// getAllocatorCounters - Return a copy of the counters of the allocators
+/// named Name.  Every counter is zero if no allocator ever had that name.
+AllocatorCounters getAllocatorCounters(const char *Name);
+
+/// PrintAllocatorStatistics - Print the counters of every allocator name to
+/// OS.  This prints nothing if setName was never called.
+void PrintAllocatorStatistics(raw_ostream &OS);
+
 /// BumpPtrAllocator - This allocator is useful for containers that need
 /// very simple memory allocation strategies.  In particular, this just keeps
 /// allocating memory, and never deletes it until the entire block is dead. This
@@ -120,6 +201,10 @@ class BumpPtrAllocator {
   /// that we can compute how much space was wasted.
   size_t BytesAllocated;
 
+  /// Counters - The counters for this allocator's name, or null if it has
+  /// none.
+  AllocatorCounters *Counters;
+
   /// AlignPtr - Align Ptr to Alignment bytes, rounding up.  Alignment should
   /// be a power of two.  This method rounds up, so AlignPtr(7, 4) == 8 and
   /// AlignPtr(8, 4) == 8.
@@ -133,16 +218,28 @@ class BumpPtrAllocator {
   /// one.
   void DeallocateSlabs(MemSlab *Slab);
 
+  /// AllocateSlab - Get a slab of Size bytes from Allocator, and count it.
+  MemSlab *AllocateSlab(size_t Size);
+
   static MallocSlabAllocator DefaultSlabAllocator;
 
   template<typename T> friend class SpecificBumpPtrAllocator;
 public:
   BumpPtrAllocator(size_t size = 4096, size_t threshold = 4096,
                    SlabAllocator &allocator = DefaultSlabAllocator);
+
+  /// BumpPtrAllocator - Create an allocator with the default slab size that
+  /// gets its slabs from allocator, for instance SlabPool::getShared().
+  explicit BumpPtrAllocator(SlabAllocator &allocator);
   ~BumpPtrAllocator();
 
+  /// setName - Count the memory of this allocator under Name, which must
+  /// outlive the program, from now on.  See AllocatorCounters.
+  void setName(const char *Name);
+
   /// Reset - Deallocate all but the current slab and reset the current pointer
-  /// to the beginning of it, freeing all memory allocated so far.
+  /// to the beginning of it, freeing all memory allocated so far.  The slab
+  /// allocator may give the pages of the current slab back to the system.
   void Reset();
 
   /// Allocate - Allocate space at the specified alignment.
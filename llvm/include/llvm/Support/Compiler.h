@@ -118,6 +118,16 @@
 #define LLVM_ATTRIBUTE_NORETURN
 #endif
 
+// LLVM_THREAD_LOCAL - On compilers that support it, declare a variable of
+// which each thread has its own copy.  Static storage duration and a constant
+// initializer are required.  Left undefined where there is no such keyword.
+#if defined(__GNUC__) && !defined(__APPLE__) && !defined(__MINGW32__) && \
+    !defined(__CYGWIN__)
+#define LLVM_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define LLVM_THREAD_LOCAL __declspec(thread)
+#endif
+
 // LLVM_EXTENSION - Support compilers where we have a keyword to suppress
 // pedantic diagnostics.
 #ifdef __GNUC__
@@ -16,11 +16,13 @@
 
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/DataTypes.h"
+#include <string>
 
 namespace llvm {
 
 class error_code;
 template<class T> class OwningPtr;
+template<typename T> class ArrayRef;
 
 /// MemoryBuffer - This interface provides simple read-only access to a block
 /// of memory, and provides simple methods for reading files and standard input
@@ -59,17 +61,37 @@ public:
     return "Unknown buffer";
   }
 
+  /// AccessHint - How the client is going to use a file.  getFile and
+  /// getOpenFile pass these on to the operating system where it supports
+  /// them, and ignore them elsewhere.
+  enum AccessHint {
+    AH_None = 0,
+    /// AH_Sequential - The file will be read from start to end, so it should
+    /// be read ahead aggressively.
+    AH_Sequential = 1 << 0,
+    /// AH_WillNeed - All of the file will be needed soon, so reading it in
+    /// should start right away.
+    AH_WillNeed = 1 << 1,
+    /// AH_Populate - Read all pages of a mapped file in before returning, so
+    /// that using the buffer takes no page faults.
+    AH_Populate = 1 << 2,
+    /// AH_HugePages - Back a mapped file with huge pages if the system can.
+    AH_HugePages = 1 << 3
+  };
+
   /// getFile - Open the specified file as a MemoryBuffer, returning a new
   /// MemoryBuffer if successful, otherwise returning null.  If FileSize is
   /// specified, this means that the client knows that the file exists and that
-  /// it has the specified size.
+  /// it has the specified size.  Hints is a set of AccessHint flags.
   static error_code getFile(StringRef Filename, OwningPtr<MemoryBuffer> &result,
                             int64_t FileSize = -1,
-                            bool RequiresNullTerminator = true);
+                            bool RequiresNullTerminator = true,
+                            unsigned Hints = AH_None);
   static error_code getFile(const char *Filename,
                             OwningPtr<MemoryBuffer> &result,
                             int64_t FileSize = -1,
-                            bool RequiresNullTerminator = true);
+                            bool RequiresNullTerminator = true,
+                            unsigned Hints = AH_None);
 
   /// getOpenFile - Given an already-open file descriptor, read the file and
   /// return a MemoryBuffer.
@@ -78,7 +100,13 @@ public:
                                 uint64_t FileSize = -1,
                                 uint64_t MapSize = -1,
                                 int64_t Offset = 0,
-                                bool RequiresNullTerminator = true);
+                                bool RequiresNullTerminator = true,
+                                unsigned Hints = AH_None);
+
+  /// prefetchFiles - Ask the operating system to start reading the specified
+  /// files into memory, without waiting for it, so that opening them later
+  /// doesn't have to.  Files that can't be opened are ignored.
+  static void prefetchFiles(ArrayRef<std::string> Filenames);
 
   /// getMemBuffer - Open the specified memory range as a MemoryBuffer.  Note
   /// that InputData must be null terminated if RequiresNullTerminator is true.
@@ -112,13 +140,15 @@ public:
 
   /// getFileOrSTDIN - Open the specified file as a MemoryBuffer, or open stdin
   /// if the Filename is "-".  If an error occurs, this returns null and sets
-  /// ec.
+  /// ec.  Hints is a set of AccessHint flags for the file.
   static error_code getFileOrSTDIN(StringRef Filename,
                                    OwningPtr<MemoryBuffer> &result,
-                                   int64_t FileSize = -1);
+                                   int64_t FileSize = -1,
+                                   unsigned Hints = AH_None);
   static error_code getFileOrSTDIN(const char *Filename,
                                    OwningPtr<MemoryBuffer> &result,
-                                   int64_t FileSize = -1);
+                                   int64_t FileSize = -1,
+                                   unsigned Hints = AH_None);
   
   
   //===--------------------------------------------------------------------===//
@@ -134,6 +164,12 @@ public:
   /// Return information on the memory mechanism used to support the
   /// MemoryBuffer.
   virtual BufferKind getBufferKind() const = 0;  
+
+  /// getResidentSize - Return how many bytes of the buffer are in memory.
+  /// Reading any of the rest of a mapped file takes a page fault that has to
+  /// wait for the disk; comparing this with getBufferSize() before and after
+  /// a phase shows how many such faults the phase took.
+  size_t getResidentSize() const;
 };
 
 } // end namespace llvm
@@ -35,6 +35,13 @@ private:
   AllocatorType Allocator;
 
 public:
+  RecyclingAllocator() {}
+
+  /// RecyclingAllocator - Create the wrapped allocator from Arg, for instance
+  /// the slab allocator a BumpPtrAllocator should use.
+  template<class ArgT>
+  explicit RecyclingAllocator(ArgT &Arg) : Allocator(Arg) {}
+
   ~RecyclingAllocator() { Base.clear(Allocator); }
 
   /// Allocate - Return a pointer to storage for an object of type
@@ -52,6 +59,10 @@ public:
   void Deallocate(SubClass* E) { return Base.Deallocate(Allocator, E); }
 
   void PrintStats() { Base.PrintStats(); }
+
+  /// getAllocator - Return the wrapped allocator.
+  ///
+  AllocatorType &getAllocator() { return Allocator; }
 };
 
 }
@@ -19,6 +19,7 @@
 struct llvm_regex;
 
 namespace llvm {
+  class RegexAutomaton;
   class StringRef;
   template<typename T> class SmallVectorImpl;
 
@@ -33,7 +34,10 @@ namespace llvm {
       /// null string after any newline in the string in addition to its normal
       /// function, and the $ anchor matches the null string before any
       /// newline in the string in addition to its normal function.
-      Newline=2
+      Newline=2,
+      /// Always match with regexec, even where the automaton could be used.
+      /// This is only useful to compare the two.
+      NoAutomaton=4
     };
 
     /// Compiles the given POSIX Extended Regular Expression \arg Regex.
@@ -53,6 +57,13 @@ namespace llvm {
 
     /// matches - Match the regex against a given \arg String.
     ///
+    /// Most patterns are matched in time linear in the length of the string,
+    /// with an automaton built from the pattern on demand; the others are
+    /// matched with regexec, which can backtrack.  Where a match could be
+    /// divided among the subexpressions in more than one way, regexec still
+    /// divides it, looking only at the match the automaton found.  Several
+    /// threads may match with the same Regex at once.
+    ///
     /// \param Matches - If given, on a successful match this will be filled in
     /// with references to the matched group expressions (inside \arg String),
     /// the first group is always the entire pattern.
@@ -74,6 +85,7 @@ namespace llvm {
 
   private:
     struct llvm_regex *preg;
+    RegexAutomaton *Automaton;
     int error;
   };
 }
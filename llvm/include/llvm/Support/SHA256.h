@@ -0,0 +1,54 @@
+//===-- SHA256.h - SHA-256 message digest -----------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares SHA256, which computes the SHA-256 digest of a stream of
+// bytes as specified by FIPS 180-4.  Unlike the hashes in ADT/Hashing.h it is
+// meant for keys that must not collide, such as those of persistent caches.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_SHA256_H
+#define LLVM_SUPPORT_SHA256_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DataTypes.h"
+#include <string>
+
+namespace llvm {
+
+class SHA256 {
+  uint32_t State[8];
+  uint8_t Buffer[64];
+  uint64_t Length;      // Number of bytes added so far.
+
+  void processBlock(const uint8_t *Block);
+
+public:
+  /// DigestSize - The size in bytes of a digest.
+  enum { DigestSize = 32 };
+
+  SHA256() { init(); }
+
+  /// init - Start a new digest, forgetting the data added so far.
+  void init();
+
+  /// update - Add Data to the digest.
+  void update(StringRef Data);
+
+  /// final - Finish the digest and store it in Result.  The object must be
+  /// reinitialized with init before it is used again.
+  void final(uint8_t Result[DigestSize]);
+
+  /// hashToHex - Return the digest of Data as 64 lowercase hex digits.
+  static std::string hashToHex(StringRef Data);
+};
+
+} // end namespace llvm
+
+#endif
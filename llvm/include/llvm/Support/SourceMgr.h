@@ -19,6 +19,8 @@
 #include "llvm/Support/SMLoc.h"
 #include "llvm/ADT/ArrayRef.h"
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace llvm {
   class MemoryBuffer;
@@ -49,6 +51,10 @@ private:
     /// IncludeLoc - This is the location of the parent include, or null if at
     /// the top level.
     SMLoc IncludeLoc;
+
+    /// LineOffsets - The offsets of the newlines in the buffer, in order.
+    /// This is computed the first time a location in the buffer is looked up.
+    mutable std::vector<unsigned> *LineOffsets;
   };
 
   /// Buffers - This is all of the buffers that we are reading from.
@@ -58,17 +64,13 @@ private:
   // include files in.
   std::vector<std::string> IncludeDirectories;
 
-  /// LineNoCache - This is a cache for line number queries, its implementation
-  /// is really private to SourceMgr.cpp.
-  mutable void *LineNoCache;
-
   DiagHandlerTy DiagHandler;
   void *DiagContext;
   
   SourceMgr(const SourceMgr&);    // DO NOT IMPLEMENT
   void operator=(const SourceMgr&); // DO NOT IMPLEMENT
 public:
-  SourceMgr() : LineNoCache(0), DiagHandler(0), DiagContext(0) {}
+  SourceMgr() : DiagHandler(0), DiagContext(0) {}
   ~SourceMgr();
 
   void setIncludeDirs(const std::vector<std::string> &Dirs) {
@@ -106,6 +108,7 @@ public:
     SrcBuffer NB;
     NB.Buffer = F;
     NB.IncludeLoc = IncludeLoc;
+    NB.LineOffsets = 0;
     Buffers.push_back(NB);
     return Buffers.size()-1;
   }
@@ -122,8 +125,16 @@ public:
   int FindBufferContainingLoc(SMLoc Loc) const;
 
   /// FindLineNumber - Find the line number for the specified location in the
-  /// specified file.  This is not a fast method.
-  unsigned FindLineNumber(SMLoc Loc, int BufferID = -1) const;
+  /// specified file.  The first lookup in a file records where all of its
+  /// lines start, which makes the lookups after it a binary search.
+  unsigned FindLineNumber(SMLoc Loc, int BufferID = -1) const {
+    return getLineAndColumn(Loc, BufferID).first;
+  }
+
+  /// getLineAndColumn - Find the line and column numbers, both counted from
+  /// one, for the specified location in the specified file.
+  std::pair<unsigned, unsigned> getLineAndColumn(SMLoc Loc,
+                                                 int BufferID = -1) const;
 
   /// PrintMessage - Emit a message about the specified location with the
   /// specified string.
@@ -147,6 +158,9 @@ public:
   /// @param IncludeLoc - The line of the include.
   /// @param OS the raw_ostream to print on.
   void PrintIncludeStack(SMLoc IncludeLoc, raw_ostream &OS) const;
+
+private:
+  const std::vector<unsigned> &getLineOffsets(unsigned BufferID) const;
 };
 
 
@@ -0,0 +1,181 @@
+//===-- llvm/Support/ThreadPool.h - Work-stealing thread pool ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the ThreadPool class, a shared task scheduler for tools
+// and libraries that want to run independent pieces of work in parallel, along
+// with TaskGroup and the parallel_for_each algorithm built on top of it.
+//
+// Each worker thread owns a deque of tasks.  A worker pushes and pops tasks at
+// the back of its own deque, and when that runs dry it steals from the front
+// of the deque of another worker.  Threads waiting on a TaskGroup help run
+// queued tasks instead of blocking, so groups may be nested freely.
+//
+// When LLVM is built without thread support the pool has no workers and every
+// task is run immediately on the thread that spawns it.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_THREADPOOL_H
+#define LLVM_SUPPORT_THREADPOOL_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/Support/Atomic.h"
+
+namespace llvm {
+
+class TaskGroup;
+class ThreadPool;
+class ThreadPoolImpl;
+
+/// Task - A unit of work that can be scheduled on a ThreadPool.  Tasks are
+/// spawned through a TaskGroup, which takes ownership of them and deletes them
+/// once they have run (or have been cancelled).
+class Task {
+  TaskGroup *Group;
+  friend class TaskGroup;
+  friend class ThreadPoolImpl;
+public:
+  Task() : Group(0) {}
+  virtual ~Task();
+
+  /// run - Do the work of this task.
+  virtual void run() = 0;
+
+  /// getGroup - Return the group this task was spawned into.
+  TaskGroup *getGroup() const { return Group; }
+};
+
+/// TaskGroup - A set of tasks that are waited on, or cancelled, together.  The
+/// destructor waits for all of the tasks in the group to finish.
+class TaskGroup {
+  ThreadPool &Pool;
+  volatile sys::cas_flag NumPending;
+  volatile sys::cas_flag Cancelled;
+
+  TaskGroup(const TaskGroup &);      // DO NOT IMPLEMENT
+  void operator=(const TaskGroup &); // DO NOT IMPLEMENT
+  friend class ThreadPoolImpl;
+public:
+  explicit TaskGroup(ThreadPool &Pool);
+  ~TaskGroup();
+
+  /// spawn - Schedule T to run on the pool as part of this group.  The group
+  /// takes ownership of T.
+  void spawn(Task *T);
+
+  /// spawn - Schedule a call of Fn(Arg) as part of this group.
+  void spawn(void (*Fn)(void*), void *Arg);
+
+  /// wait - Return once every task spawned into this group has finished or
+  /// has been cancelled.  The calling thread runs queued tasks while waiting.
+  void wait();
+
+  /// cancel - Drop the tasks of this group that have not started running yet.
+  /// Tasks that are already running are not interrupted, but can poll
+  /// isCancelled() to stop early.
+  void cancel();
+
+  /// isCancelled - Return true if cancel() has been called on this group.
+  bool isCancelled() const { return Cancelled != 0; }
+
+  /// getPool - Return the pool this group schedules its tasks on.
+  ThreadPool &getPool() const { return Pool; }
+};
+
+/// ThreadPool - A fixed set of worker threads with per-worker task deques and
+/// work stealing.
+class ThreadPool {
+  ThreadPoolImpl *Impl;
+
+  ThreadPool(const ThreadPool &);     // DO NOT IMPLEMENT
+  void operator=(const ThreadPool &); // DO NOT IMPLEMENT
+  friend class TaskGroup;
+public:
+  /// ThreadPool - Create a pool with NumThreads workers.  Zero means use the
+  /// value of the -threads option, see getDefaultNumThreads().
+  explicit ThreadPool(unsigned NumThreads = 0);
+
+  /// ~ThreadPool - Stop and join the workers.  All task groups using the pool
+  /// must have been destroyed already.
+  ~ThreadPool();
+
+  /// getNumThreads - Return the number of worker threads of the pool.  This
+  /// is zero if tasks are run synchronously when spawned.
+  unsigned getNumThreads() const;
+
+  /// getDefaultNumThreads - Return the number of threads requested with the
+  /// -threads option or, if that is zero, the number of hardware threads of
+  /// the host.
+  static unsigned getDefaultNumThreads();
+
+  /// getGlobalPool - Return a pool shared by all clients in the process.  It
+  /// is created on first use with getDefaultNumThreads() workers and
+  /// destroyed by llvm_shutdown().
+  static ThreadPool &getGlobalPool();
+};
+
+namespace detail {
+
+/// ForEachTask - The task used by parallel_for_each to process one chunk of
+/// the range.
+template<typename T, typename Function>
+class ForEachTask : public Task {
+  ArrayRef<T> Chunk;
+  Function Fn;
+public:
+  ForEachTask(ArrayRef<T> Chunk, Function Fn) : Chunk(Chunk), Fn(Fn) {}
+
+  virtual void run() {
+    for (typename ArrayRef<T>::iterator I = Chunk.begin(), E = Chunk.end();
+         I != E; ++I) {
+      if (getGroup()->isCancelled())
+        return;
+      Fn(*I);
+    }
+  }
+};
+
+} // end namespace detail
+
+/// parallel_for_each - Call Fn on every element of Range, distributing the
+/// calls over the workers of Pool.  Fn is copied into each chunk of work, so
+/// any state it shares must be thread safe.  Returns once all calls are done.
+template<typename T, typename Function>
+void parallel_for_each(ThreadPool &Pool, ArrayRef<T> Range, Function Fn) {
+  unsigned NumThreads = Pool.getNumThreads();
+  if (NumThreads == 0 || Range.size() < 2) {
+    for (typename ArrayRef<T>::iterator I = Range.begin(), E = Range.end();
+         I != E; ++I)
+      Fn(*I);
+    return;
+  }
+
+  // Split the range into a few chunks per worker, so that stealing can even
+  // out elements of uneven cost without paying a task per element.
+  size_t NumChunks = NumThreads * 4;
+  size_t ChunkSize = (Range.size() + NumChunks - 1) / NumChunks;
+  TaskGroup Group(Pool);
+  for (size_t Begin = 0, E = Range.size(); Begin < E; Begin += ChunkSize) {
+    size_t Size = ChunkSize < E - Begin ? ChunkSize : E - Begin;
+    Group.spawn(new detail::ForEachTask<T, Function>(Range.slice(Begin, Size),
+                                                     Fn));
+  }
+  Group.wait();
+}
+
+/// parallel_for_each - Call Fn on every element of Range using the global
+/// thread pool.
+template<typename T, typename Function>
+void parallel_for_each(ArrayRef<T> Range, Function Fn) {
+  parallel_for_each(ThreadPool::getGlobalPool(), Range, Fn);
+}
+
+} // end namespace llvm
+
+#endif
@@ -8,7 +8,8 @@
 //===----------------------------------------------------------------------===//
 //
 // This file defines three classes: Timer, TimeRegion, and TimerGroup,
-// documented below.
+// documented below, the HWCounterGroup behind -track-perf-counters, and the
+// TimeTraceRegion helper for -time-trace-file.
 //
 //===----------------------------------------------------------------------===//
 
@@ -24,22 +25,41 @@
 
 namespace llvm {
 
+class HWCounterGroup;
 class Timer;
 class TimerGroup;
 class raw_ostream;
 
 class TimeRecord {
+public:
+  /// HWCounter - The hardware events counted with -track-perf-counters.
+  enum HWCounter {
+    Cycles,
+    Instructions,
+    L1DMisses,           // Level 1 data cache read misses
+    LLCMisses,           // Last level cache read misses
+    BranchMisses,
+    NumHWCounters
+  };
+
+private:
   double WallTime;       // Wall clock time elapsed in seconds
   double UserTime;       // User time elapsed
   double SystemTime;     // System time elapsed
   ssize_t MemUsed;       // Memory allocated (in bytes)
+  int64_t Counters[NumHWCounters];  // Hardware events, or zero if not counted
+  friend class HWCounterGroup;
 public:
-  TimeRecord() : WallTime(0), UserTime(0), SystemTime(0), MemUsed(0) {}
+  TimeRecord() : WallTime(0), UserTime(0), SystemTime(0), MemUsed(0) {
+    for (unsigned i = 0; i != NumHWCounters; ++i)
+      Counters[i] = 0;
+  }
   
   /// getCurrentTime - Get the current time and memory usage.  If Start is true
   /// we get the memory usage before the time, otherwise we get time before
   /// memory usage.  This matters if the time to get the memory usage is
-  /// significant and shouldn't be counted as part of a duration.
+  /// significant and shouldn't be counted as part of a duration.  The
+  /// hardware counters, when tracked, are read closest to the duration.
   static TimeRecord getCurrentTime(bool Start = true);
   
   double getProcessTime() const { return UserTime+SystemTime; }
@@ -47,8 +67,15 @@ public:
   double getSystemTime() const { return SystemTime; }
   double getWallTime() const { return WallTime; }
   ssize_t getMemUsed() const { return MemUsed; }
-  
-  
+  int64_t getCounter(HWCounter C) const { return Counters[C]; }
+
+  /// getIPC - Return the number of instructions retired per cycle, or zero if
+  /// the hardware counters weren't read.
+  double getIPC() const {
+    return Counters[Cycles] ? double(Counters[Instructions]) / Counters[Cycles]
+                            : 0;
+  }
+
   // operator< - Allow sorting.
   bool operator<(const TimeRecord &T) const {
     // Sort by Wall Time elapsed, as it is the only thing really accurate
@@ -60,18 +87,61 @@ public:
     UserTime   += RHS.UserTime;
     SystemTime += RHS.SystemTime;
     MemUsed    += RHS.MemUsed;
+    for (unsigned i = 0; i != NumHWCounters; ++i)
+      Counters[i] += RHS.Counters[i];
   }
   void operator-=(const TimeRecord &RHS) {
     WallTime   -= RHS.WallTime;
     UserTime   -= RHS.UserTime;
     SystemTime -= RHS.SystemTime;
     MemUsed    -= RHS.MemUsed;
+    for (unsigned i = 0; i != NumHWCounters; ++i)
+      Counters[i] -= RHS.Counters[i];
   }
   
   /// print - Print the current timer to standard error, and reset the "Started"
-  /// flag.
+  /// flag.  The hardware events that Total has none of print as "-----".
   void print(const TimeRecord &Total, raw_ostream &OS) const;
 };
+
+/// HWCounterGroup - The hardware counters read for -track-perf-counters.  On
+/// Linux they are opened with perf_event_open as one group, so that one read()
+/// gets all of them.  They only count the user-space events of the thread
+/// that opened them: -track-perf-counters opens them in the thread that first
+/// starts a timer, and the events of other threads, such as the workers of
+/// -parallel-function-passes, are left out of every timer.  Where the system
+/// call is missing or not allowed, or the hardware lacks an event, a warning
+/// is printed and the counters concerned stay zero.
+///
+class HWCounterGroup {
+  int FDs[TimeRecord::NumHWCounters];
+  int Leader;
+  unsigned NumOpen;
+  HWCounterGroup(const HWCounterGroup &);  // DO NOT IMPLEMENT
+  void operator=(const HWCounterGroup &);  // DO NOT IMPLEMENT
+public:
+  /// OpenFn - Open the counter C in the group led by GroupFD, or as the
+  /// leader of a new group if GroupFD is -1, and return its file descriptor,
+  /// or -1 if it can't be counted.  Reading the leader gives the values of
+  /// the group as perf_event_open does for PERF_FORMAT_GROUP, after the times
+  /// the group was enabled and running.
+  typedef int (*OpenFn)(TimeRecord::HWCounter C, int GroupFD);
+
+  /// HWCounterGroup - Open the counters with Open, or with perf_event_open if
+  /// Open is null, and print a warning to Warnings for each one that can't be
+  /// counted.
+  explicit HWCounterGroup(raw_ostream &Warnings, OpenFn Open = 0);
+  ~HWCounterGroup();
+
+  bool isCounting(TimeRecord::HWCounter C) const { return FDs[C] >= 0; }
+
+  /// read - Add the current values of the counters to the counters of
+  /// Record.
+  void read(TimeRecord &Record) const;
+
+  /// getName - Return the name of counter C, as the warnings give it.
+  static const char *getName(TimeRecord::HWCounter C);
+};
   
 /// Timer - This class is used to track the amount of time spent between
 /// invocations of its startTimer()/stopTimer() methods.  Given appropriate OS
@@ -157,6 +227,41 @@ struct NamedRegionTimer : public TimeRegion {
 };
 
 
+/// TimeTraceRegion - When a trace file is given with -time-trace-file, the
+/// lifetime of each TimeTraceRegion is recorded as an event named Name, with
+/// Detail as its argument, and all events are written to the file in the
+/// Chrome trace-event format when llvm_shutdown is called.  The trace can be
+/// loaded into chrome://tracing or a compatible viewer to find the passes and
+/// the functions that take the time, which -time-passes adds up.  Events
+/// shorter than -time-trace-granularity microseconds are dropped.  This can
+/// be used from several threads; each gets its own track.
+///
+class TimeTraceRegion {
+  const char *Name;
+  std::string Detail;
+  uint64_t Start;        // In microseconds, or ~0 when tracing is disabled.
+  TimeTraceRegion(const TimeTraceRegion &); // DO NOT IMPLEMENT
+  void operator=(const TimeTraceRegion &);  // DO NOT IMPLEMENT
+public:
+  /// Name must outlive the program, as pass names do.
+  TimeTraceRegion(const char *Name, StringRef Detail);
+  ~TimeTraceRegion();
+
+  /// isEnabled - Return true if a trace file was given, or between
+  /// beginTrace and endTrace.
+  static bool isEnabled();
+
+  /// beginTrace - Record the events longer than Granularity microseconds
+  /// until endTrace, even if no trace file was given.  This must not be
+  /// called while events are recorded.
+  static void beginTrace(unsigned Granularity);
+
+  /// endTrace - Print the events recorded since beginTrace to OS, in the
+  /// format of the trace file, and forget them.
+  static void endTrace(raw_ostream &OS);
+};
+
+
 /// The TimerGroup class is used to group together related timers into a single
 /// report that is printed when the TimerGroup is destroyed.  It is illegal to
 /// destroy a TimerGroup object before all of the Timers in it are gone.  A
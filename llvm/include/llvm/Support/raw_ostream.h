@@ -198,6 +198,10 @@ public:
   /// anything that doesn't satisfy std::isprint into an escape sequence.
   raw_ostream &write_escaped(StringRef Str, bool UseHexEscapes = false);
 
+  /// write_json_string - Output \arg Str as a JSON string literal, quotes
+  /// included, escaping '\\', '"' and the control characters.
+  raw_ostream &write_json_string(StringRef Str);
+
   raw_ostream &write(unsigned char C);
   raw_ostream &write(const char *Ptr, size_t Size);
 
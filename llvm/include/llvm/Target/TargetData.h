@@ -152,6 +152,10 @@ public:
 
   ~TargetData();  // Not virtual, do not subclass this class
 
+  /// isParallelSafe - TargetData is read only once constructed, apart from
+  /// the struct layout cache, which is locked.
+  virtual bool isParallelSafe() const { return true; }
+
   /// Target endianness...
   bool isLittleEndian() const { return LittleEndian; }
   bool isBigEndian() const { return !LittleEndian; }
@@ -73,6 +73,15 @@ namespace llvm {
       return 0;
     }
 
+    /// patchFunctionStub - Redirect the stub at Stub, emitted by
+    /// emitFunctionStub, to NewTarget in a single atomic write, so that other
+    /// threads may keep calling the stub while it is patched.  Returns false if
+    /// the target cannot do that for this pair of addresses, in which case the
+    /// stub is left unchanged.
+    virtual bool patchFunctionStub(void *Stub, void *NewTarget) {
+      return false;
+    }
+
     /// getPICJumpTableEntry - Returns the value of the jumptable entry for the
     /// specific basic block.
     virtual uintptr_t getPICJumpTableEntry(uintptr_t BB, uintptr_t JTBase) {
@@ -231,6 +231,9 @@ public:
   TargetLibraryInfo();
   TargetLibraryInfo(const Triple &T);
   explicit TargetLibraryInfo(const TargetLibraryInfo &TLI);
+
+  /// isParallelSafe - The queries only read the tables set up at creation.
+  virtual bool isParallelSafe() const { return true; }
   
   /// has - This function is used by optimizations that want to match on or form
   /// a given library function.
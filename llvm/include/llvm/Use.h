@@ -69,9 +69,7 @@ private:
   Use(const Use &U);
 
   /// Destructor - Only for zap()
-  ~Use() {
-    if (Val) removeFromList();
-  }
+  inline ~Use();
 
   enum PrevPtrTag { zeroDigitTag
                   , oneDigitTag
@@ -42,6 +42,7 @@ class LLVMContext;
 class Twine;
 class MDNode;
 class Type;
+template<typename T> class ArrayRef;
 
 //===----------------------------------------------------------------------===//
 //                                 Value Class
@@ -178,7 +179,26 @@ public:
 
   /// addUse - This method should only be used by the Use class.
   ///
-  void addUse(Use &U) { U.addToList(&UseList); }
+  void addUse(Use &U) {
+    if (hasSharedUseList())
+      addSharedUse(U);
+    else
+      U.addToList(&UseList);
+  }
+
+  /// removeUse - This method should only be used by the Use class.
+  ///
+  void removeUse(Use &U) {
+    if (hasSharedUseList())
+      removeSharedUse(U);
+    else
+      U.removeFromList();
+  }
+
+  /// reorderUseList - Rearrange the use list of this value so that it holds
+  /// Uses in order.  Uses must contain every use of this value exactly once.
+  /// This must not be called while other threads may change the use list.
+  void reorderUseList(ArrayRef<Use*> Uses);
 
   /// An enumeration for keeping track of the concrete subclass of Value that
   /// is actually instantiated. Values of this enumeration are kept in the 
@@ -301,6 +321,17 @@ public:
 protected:
   unsigned short getSubclassDataFromValue() const { return SubclassData; }
   void setValueSubclassData(unsigned short D) { SubclassData = D; }
+
+private:
+  /// hasSharedUseList - Return true if this value can be used by more than
+  /// one function: constants, globals, metadata and inline asm.  When the
+  /// context has concurrent uniquing enabled, functions may be rewritten from
+  /// several threads at once, so edits to these use lists are locked.
+  bool hasSharedUseList() const {
+    return SubclassID >= ConstantFirstVal && SubclassID <= InlineAsmVal;
+  }
+  void addSharedUse(Use &U);
+  void removeSharedUse(Use &U);
 };
 
 inline raw_ostream &operator<<(raw_ostream &OS, const Value &V) {
@@ -309,11 +340,15 @@ inline raw_ostream &operator<<(raw_ostream &OS, const Value &V) {
 }
   
 void Use::set(Value *V) {
-  if (Val) removeFromList();
+  if (Val) Val->removeUse(*this);
   Val = V;
   if (V) V->addUse(*this);
 }
 
+Use::~Use() {
+  if (Val) Val->removeUse(*this);
+}
+
 
 // isa - Provide some specializations of isa so that we don't have to include
 // the subtype header files to test to see if the value is a subclass...
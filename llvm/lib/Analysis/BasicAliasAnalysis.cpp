@@ -35,6 +35,9 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/GetElementPtrTypeIterator.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/ThreadLocal.h"
 #include <algorithm>
 using namespace llvm;
 
@@ -453,16 +456,15 @@ namespace {
   /// BasicAliasAnalysis - This is the primary alias analysis implementation.
   struct BasicAliasAnalysis : public ImmutablePass, public AliasAnalysis {
     static char ID; // Class identification, replacement for typeinfo
-    BasicAliasAnalysis() : ImmutablePass(ID),
-                           // AliasCache rarely has more than 1 or 2 elements,
-                           // so start it off fairly small so that clear()
-                           // doesn't have to tromp through 64 (the default)
-                           // elements on each alias query. This really wants
-                           // something like a SmallDenseMap.
-                           AliasCache(8) {
+    BasicAliasAnalysis() : ImmutablePass(ID) {
       initializeBasicAliasAnalysisPass(*PassRegistry::getPassRegistry());
     }
 
+    ~BasicAliasAnalysis() {
+      for (unsigned i = 0, e = ThreadStates.size(); i != e; ++i)
+        delete ThreadStates[i];
+    }
+
     virtual void initializePass() {
       InitializeAliasAnalysis(this);
     }
@@ -472,8 +474,13 @@ namespace {
       AU.addRequired<TargetLibraryInfo>();
     }
 
+    /// isParallelSafe - This pass is shared by all the workers of a parallel
+    /// FPPassManager, so every thread runs its queries in its own QueryState.
+    virtual bool isParallelSafe() const { return true; }
+
     virtual AliasResult alias(const Location &LocA,
                               const Location &LocB) {
+      AliasCacheTy &AliasCache = getQueryState().AliasCache;
       assert(AliasCache.empty() && "AliasCache must be cleared after use!");
       assert(notDifferentParent(LocA.Ptr, LocB.Ptr) &&
              "BasicAliasAnalysis doesn't support interprocedural queries.");
@@ -515,13 +522,45 @@ namespace {
     }
     
   private:
-    // AliasCache - Track alias queries to guard against recursion.
     typedef std::pair<Location, Location> LocPair;
     typedef DenseMap<LocPair, AliasResult> AliasCacheTy;
-    AliasCacheTy AliasCache;
 
-    // Visited - Track instructions visited by pointsToConstantMemory.
-    SmallPtrSet<const Value*, 16> Visited;
+    // QueryState - The scratch state of the queries made by one thread.
+    struct QueryState {
+      // AliasCache - Track alias queries to guard against recursion.
+      AliasCacheTy AliasCache;
+
+      // Visited - Track instructions visited by pointsToConstantMemory.
+      SmallPtrSet<const Value*, 16> Visited;
+
+      // AliasCache rarely has more than 1 or 2 elements, so start it off
+      // fairly small so that clear() doesn't have to tromp through 64 (the
+      // default) elements on each alias query. This really wants something
+      // like a SmallDenseMap.
+      QueryState() : AliasCache(8) {}
+    };
+
+    // MainState - The state used until multithreading has been started.
+    QueryState MainState;
+
+    // ThreadState - The state of the calling thread once multithreading has
+    // been started.  The states are created on a thread's first query and
+    // recorded in ThreadStates, which StatesLock guards.
+    sys::ThreadLocal<const QueryState> ThreadState;
+    std::vector<QueryState*> ThreadStates;
+    sys::SmartMutex<true> StatesLock;
+
+    QueryState &getQueryState() {
+      if (!llvm_is_multithreaded())
+        return MainState;
+      if (const QueryState *QS = ThreadState.get())
+        return *const_cast<QueryState*>(QS);
+      QueryState *QS = new QueryState();
+      ThreadState.set(QS);
+      sys::SmartScopedLock<true> Guard(StatesLock);
+      ThreadStates.push_back(QS);
+      return *QS;
+    }
 
     // aliasGEP - Provide a bunch of ad-hoc rules to disambiguate a GEP
     // instruction against another.
@@ -570,6 +609,7 @@ ImmutablePass *llvm::createBasicAliasAnalysisPass() {
 /// considered local to all functions.
 bool
 BasicAliasAnalysis::pointsToConstantMemory(const Location &Loc, bool OrLocal) {
+  SmallPtrSet<const Value*, 16> &Visited = getQueryState().Visited;
   assert(Visited.empty() && "Visited must be cleared after use!");
 
   unsigned MaxLookup = 8;
@@ -1182,6 +1222,7 @@ BasicAliasAnalysis::aliasCheck(const Value *V1, uint64_t V1Size,
                Location(V2, V2Size, V2TBAAInfo));
   if (V1 > V2)
     std::swap(Locs.first, Locs.second);
+  AliasCacheTy &AliasCache = getQueryState().AliasCache;
   std::pair<AliasCacheTy::iterator, bool> Pair =
     AliasCache.insert(std::make_pair(Locs, MayAlias));
   if (!Pair.second)
@@ -120,6 +120,14 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
       TimeRegion PassTimer(getPassTimer(CGSP));
       Changed = CGSP->runOnSCC(CurSCC);
     }
+
+    // The pass may have changed the functions of the SCC in ways that their
+    // modification epochs do not see, like their call site attributes.
+    if (Changed)
+      for (CallGraphSCC::iterator I = CurSCC.begin(), E = CurSCC.end();
+           I != E; ++I)
+        if (Function *F = (*I)->getFunction())
+          F->markModified();
     
     // After the CGSCCPass is done, when assertions are enabled, use
     // RefreshCallGraph to verify that the callgraph was correctly updated.
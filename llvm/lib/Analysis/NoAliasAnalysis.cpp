@@ -33,6 +33,8 @@ namespace {
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
     }
 
+    virtual bool isParallelSafe() const { return true; }
+
     virtual void initializePass() {
       // Note: NoAA does not call InitializeAliasAnalysis because it's
       // special and does not support chaining.
@@ -126,6 +126,8 @@ namespace {
       InitializeAliasAnalysis(this);
     }
 
+    virtual bool isParallelSafe() const { return true; }
+
     /// getAdjustedAnalysisPointer - This method is used when a pass implements
     /// an analysis interface through multiple inheritance.  If needed, it
     /// should override this to adjust the this pointer as needed for the
@@ -18,6 +18,7 @@
 #include "llvm/DerivedTypes.h"
 #include "llvm/InlineAsm.h"
 #include "llvm/Instructions.h"
+#include "llvm/LLVMContext.h"
 #include "llvm/Module.h"
 #include "llvm/Operator.h"
 #include "llvm/ValueSymbolTable.h"
@@ -38,6 +39,11 @@ bool LLParser::Run() {
   // Prime the lexer.
   Lex.Lex();
 
+  // Local values are looked up by name, so they must keep their names.
+  if (Context.shouldDiscardValueNames())
+    return Error(Lex.getLoc(), "cannot parse textual IR into a context that "
+                 "discards value names");
+
   return ParseTopLevelEntities() ||
          ValidateEndOfModule();
 }
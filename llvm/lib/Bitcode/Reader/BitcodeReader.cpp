@@ -17,9 +17,11 @@
 #include "llvm/DerivedTypes.h"
 #include "llvm/InlineAsm.h"
 #include "llvm/IntrinsicInst.h"
+#include "llvm/LLVMContext.h"
 #include "llvm/Module.h"
 #include "llvm/Operator.h"
 #include "llvm/AutoUpgrade.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/MathExtras.h"
@@ -1364,9 +1366,83 @@ bool BitcodeReader::RememberAndSkipFunctionBody() {
   return false;
 }
 
+/// ReadFunctionIndex - Having reached the first function body, read where
+/// all of them are from the function index, and move the stream past the
+/// index, which follows the last body.  This saves skipping through each
+/// body in turn.
+bool BitcodeReader::ReadFunctionIndex() {
+  uint64_t StreamBits =
+    uint64_t(StreamFile.getLastChar()-StreamFile.getFirstChar())*CHAR_BIT;
+  if (FunctionIndexOffset >= StreamBits-ModuleStartBit)
+    return Error("Invalid function index offset");
+  Stream.JumpToBit(ModuleStartBit+FunctionIndexOffset);
+  unsigned ModuleAbbrevWidth = Stream.GetAbbrevIDWidth();
+  if (Stream.ReadCode() != bitc::ENTER_SUBBLOCK ||
+      Stream.ReadSubBlockID() != bitc::FUNCTION_INDEX_BLOCK_ID)
+    return Error("Invalid function index offset");
+  if (Stream.EnterSubBlock(bitc::FUNCTION_INDEX_BLOCK_ID))
+    return Error("Malformed block record");
+
+  // Every function declared with a body must be in the index, once.
+  SmallPtrSet<Function*, 16> Pending(FunctionsWithBodies.begin(),
+                                     FunctionsWithBodies.end());
+  SmallVector<uint64_t, 2> Record;
+
+  while (!Stream.AtEndOfStream()) {
+    unsigned Code = Stream.ReadCode();
+    if (Code == bitc::END_BLOCK) {
+      if (Stream.ReadBlockEnd())
+        return Error("Error at end of function index block");
+      if (!Pending.empty())
+        return Error("Too few function bodies found");
+      std::vector<Function*>().swap(FunctionsWithBodies);
+      return false;
+    }
+
+    if (Code == bitc::ENTER_SUBBLOCK) {
+      // No known subblocks, always skip them.
+      Stream.ReadSubBlockID();
+      if (Stream.SkipBlock())
+        return Error("Malformed block record");
+      continue;
+    }
+
+    if (Code == bitc::DEFINE_ABBREV) {
+      Stream.ReadAbbrevRecord();
+      continue;
+    }
+
+    // Read a record.
+    Record.clear();
+    switch (Stream.ReadRecord(Code, Record)) {
+    default: break;  // Default behavior, ignore unknown content.
+    case bitc::FNINDEX_CODE_ENTRY: { // ENTRY: [valueid, offset]
+      if (Record.size() < 2 || Record[0] >= ValueList.size())
+        return Error("Invalid FNINDEX_CODE_ENTRY record");
+      Function *F = dyn_cast_or_null<Function>(ValueList[Record[0]]);
+      if (!F || !Pending.erase(F))
+        return Error("Invalid FNINDEX_CODE_ENTRY record");
+
+      // The offset is of the ENTER_SUBBLOCK code.  Remember the position
+      // after the block ID, as RememberAndSkipFunctionBody does; the ID fits
+      // in a single VBR chunk.
+      if (Record[1] >= StreamBits-ModuleStartBit)
+        return Error("Invalid FNINDEX_CODE_ENTRY record");
+      DeferredFunctionInfo[F] =
+        ModuleStartBit+Record[1]+ModuleAbbrevWidth+bitc::BlockIDWidth;
+      break;
+    }
+    }
+  }
+
+  return Error("Premature end of bitstream");
+}
+
 bool BitcodeReader::ParseModule() {
   if (Stream.EnterSubBlock(bitc::MODULE_BLOCK_ID))
     return Error("Malformed block record");
+  ModuleStartBit = Stream.GetCurrentBitNo();
+  FunctionIndexOffset = 0;
 
   SmallVector<uint64_t, 64> Record;
   std::vector<std::string> SectionTable;
@@ -1439,6 +1515,14 @@ bool BitcodeReader::ParseModule() {
           return true;
         break;
       case bitc::FUNCTION_BLOCK_ID:
+        // If the bodies are indexed, find them all from the index, and carry
+        // on after it.
+        if (FunctionIndexOffset) {
+          if (ReadFunctionIndex())
+            return true;
+          break;
+        }
+
         // If this is the first function body we've seen, reverse the
         // FunctionsWithBodies list.
         if (!HasReversedFunctionsWithBodies) {
@@ -1629,6 +1713,12 @@ bool BitcodeReader::ParseModule() {
       AliasInits.push_back(std::make_pair(NewGA, Record[1]));
       break;
     }
+    // FNINDEX_OFFSET: [offset low 32 bits, offset high 32 bits]
+    case bitc::MODULE_CODE_FNINDEX_OFFSET:
+      if (Record.size() < 2)
+        return Error("Invalid MODULE_CODE_FNINDEX_OFFSET record");
+      FunctionIndexOffset = Record[0] | Record[1] << 32;
+      break;
     /// MODULE_CODE_PURGEVALS: [numvals]
     case bitc::MODULE_CODE_PURGEVALS:
       // Trim down the value list to the specified size.
@@ -1907,6 +1997,13 @@ bool BitcodeReader::ParseFunctionBody(Function *F) {
         NextValueNo = ValueList.size();
         break;
       case bitc::VALUE_SYMTAB_BLOCK_ID:
+        // The function's symbol table only names its arguments, blocks and
+        // instructions, so skip it whole if those aren't to be named.
+        if (Context.shouldDiscardValueNames()) {
+          if (Stream.SkipBlock())
+            return Error("Malformed block record");
+          break;
+        }
         if (ParseValueSymbolTable()) return true;
         break;
       case bitc::METADATA_ATTACHMENT_ID:
@@ -169,6 +169,14 @@ class BitcodeReader : public GVMaterializer {
   /// map contains info about where to find deferred function body in the
   /// stream.
   DenseMap<Function*, uint64_t> DeferredFunctionInfo;
+
+  /// ModuleStartBit - The start of the module block's contents, which the
+  /// function index offsets are relative to.
+  uint64_t ModuleStartBit;
+
+  /// FunctionIndexOffset - The offset of the function index block, or zero
+  /// if the module has none.
+  uint64_t FunctionIndexOffset;
   
   /// BlockAddrFwdRefs - These are blockaddr references to basic blocks.  These
   /// are resolved lazily when functions are loaded.
@@ -180,6 +188,7 @@ public:
     : Context(C), TheModule(0), Buffer(buffer), BufferOwned(false),
       ErrorString(0), ValueList(C), MDValueList(C) {
     HasReversedFunctionsWithBodies = false;
+    ModuleStartBit = FunctionIndexOffset = 0;
   }
   ~BitcodeReader() {
     FreeState();
@@ -266,6 +275,7 @@ private:
   bool ParseValueSymbolTable();
   bool ParseConstants();
   bool RememberAndSkipFunctionBody();
+  bool ReadFunctionIndex();
   bool ParseFunctionBody(Function *F);
   bool ResolveGlobalAndAliasInits();
   bool ParseMetadata();
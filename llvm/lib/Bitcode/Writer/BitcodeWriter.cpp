@@ -28,6 +28,8 @@
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Program.h"
+#include "llvm/Support/ThreadPool.h"
+#include <algorithm>
 #include <cctype>
 #include <map>
 using namespace llvm;
@@ -38,11 +40,26 @@ EnablePreserveUseListOrdering("enable-bc-uselist-preserve",
                                        "use-list order preservation."),
                               cl::init(false), cl::Hidden);
 
+static cl::opt<bool>
+EnableFunctionIndex("bitcode-function-index",
+                    cl::desc("Emit an index of the function bodies, so that "
+                             "lazy readers can go straight to them."),
+                    cl::init(true), cl::Hidden);
+
+static cl::opt<bool>
+ParallelBitcodeWriter("parallel-bitcode-writer",
+                      cl::desc("Encode function bodies on several threads of "
+                               "the global pool"),
+                      cl::init(false));
+
 /// These are manifest constants used by the bitcode writer. They do not need to
 /// be kept in sync with the reader, but need to be consistent within this file.
 enum {
   CurVersion = 0,
 
+  // Abbrev ID width of FUNCTION_BLOCKs.
+  FunctionBlockCodeSize = 4,
+
   // VALUE_SYMTAB_BLOCK abbrev id's.
   VST_ENTRY_8_ABBREV = bitc::FIRST_APPLICATION_ABBREV,
   VST_ENTRY_7_ABBREV,
@@ -1351,7 +1368,7 @@ static void WriteValueSymbolTable(const ValueSymbolTable &VST,
 /// WriteFunction - Emit a function body to the module stream.
 static void WriteFunction(const Function &F, ValueEnumerator &VE,
                           BitstreamWriter &Stream) {
-  Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
+  Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, FunctionBlockCodeSize);
   VE.incorporateFunction(F);
 
   SmallVector<unsigned, 64> Vals;
@@ -1678,9 +1695,159 @@ static void WriteModuleUseLists(const Module *M, ValueEnumerator &VE,
   Stream.ExitBlock();
 }
 
+/// FunctionOffsetList - The value ID of each function body written, and the
+/// bit it starts at relative to the start of the module block's contents.
+typedef std::vector<std::pair<unsigned, uint64_t> > FunctionOffsetList;
+
+namespace {
+
+/// FunctionEncoderTask - Encodes functions taken from a shared list, each
+/// into a buffer of its own, until the list is empty.  Every task has its
+/// own copy of the value enumerator.
+class FunctionEncoderTask : public Task {
+  const BitstreamWriter &Stream;
+  ValueEnumerator &VE;
+  ArrayRef<const Function *> Functions;
+  std::vector<unsigned char> *Buffers;
+  volatile sys::cas_flag *NextFunction;
+public:
+  FunctionEncoderTask(const BitstreamWriter &Stream, ValueEnumerator &VE,
+                      ArrayRef<const Function *> Functions,
+                      std::vector<unsigned char> *Buffers,
+                      volatile sys::cas_flag *NextFunction)
+    : Stream(Stream), VE(VE), Functions(Functions), Buffers(Buffers),
+      NextFunction(NextFunction) {}
+
+  virtual void run() {
+    while (true) {
+      sys::cas_flag Index = sys::AtomicIncrement(NextFunction) - 1;
+      if (Index >= Functions.size())
+        return;
+      BitstreamWriter FunctionStream(Buffers[Index]);
+      FunctionStream.CopyBlockInfo(Stream);
+      WriteFunction(*Functions[Index], VE, FunctionStream);
+    }
+  }
+};
+
+} // end anonymous namespace
+
+/// WriteFunctionBodies - Emit the bodies of the functions defined in M, and
+/// record where each one starts in FunctionOffsets.  With a pool of several
+/// workers, the bodies are encoded concurrently a window at a time, then
+/// appended in order; the output is the same as when they are written one
+/// after the other.
+static void WriteFunctionBodies(const Module *M, ValueEnumerator &VE,
+                                BitstreamWriter &Stream,
+                                uint64_t ModuleStartBit,
+                                FunctionOffsetList &FunctionOffsets,
+                                ThreadPool *Pool) {
+  std::vector<const Function *> Functions;
+  for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
+    if (!F->isDeclaration())
+      Functions.push_back(F);
+
+  unsigned NumWorkers = 0;
+  if (Pool)
+    NumWorkers = std::min(Pool->getNumThreads(), unsigned(Functions.size()));
+  if (NumWorkers < 2) {
+    for (unsigned i = 0, e = Functions.size(); i != e; ++i) {
+      uint64_t Offset = Stream.GetCurrentBitNo() - ModuleStartBit;
+      FunctionOffsets.push_back(std::make_pair(VE.getValueID(Functions[i]),
+                                               Offset));
+      WriteFunction(*Functions[i], VE, Stream);
+    }
+    return;
+  }
+
+  // Incorporating a function changes the value enumerator, so each worker
+  // needs a copy of its module-level state.
+  std::vector<ValueEnumerator *> Copies;
+  for (unsigned i = 0; i != NumWorkers; ++i)
+    Copies.push_back(new ValueEnumerator(VE));
+
+  // Bound the memory taken by bodies waiting to be appended, by encoding a
+  // window of a few functions per worker at a time.
+  const unsigned WindowSize = NumWorkers * 32;
+  std::vector<std::vector<unsigned char> > Buffers(WindowSize);
+  for (unsigned Begin = 0, E = Functions.size(); Begin < E;
+       Begin += WindowSize) {
+    ArrayRef<const Function *> Window =
+      makeArrayRef(Functions).slice(Begin, std::min(WindowSize, E - Begin));
+
+    volatile sys::cas_flag NextFunction = 0;
+    {
+      TaskGroup Group(*Pool);
+      for (unsigned i = 0; i != NumWorkers; ++i)
+        Group.spawn(new FunctionEncoderTask(Stream, *Copies[i], Window,
+                                            &Buffers[0], &NextFunction));
+      Group.wait();
+    }
+
+    for (unsigned i = 0, e = Window.size(); i != e; ++i) {
+      uint64_t Offset = Stream.GetCurrentBitNo() - ModuleStartBit;
+      FunctionOffsets.push_back(std::make_pair(VE.getValueID(Window[i]),
+                                               Offset));
+      Stream.AppendBlock(bitc::FUNCTION_BLOCK_ID, FunctionBlockCodeSize,
+                         Buffers[i]);
+      Buffers[i].clear();
+    }
+  }
+
+  for (unsigned i = 0; i != NumWorkers; ++i)
+    delete Copies[i];
+}
+
+/// WriteFunctionIndexOffset - Emit a placeholder for the offset of the
+/// function index, and return the bit it starts at.  The index is written
+/// after the function bodies, so the offset is patched in then.
+static uint64_t WriteFunctionIndexOffset(BitstreamWriter &Stream) {
+  // Fixed-width fields, so that they can be overwritten in place.
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::MODULE_CODE_FNINDEX_OFFSET));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+  unsigned OffsetAbbrev = Stream.EmitAbbrev(Abbv);
+
+  SmallVector<unsigned, 2> Vals(2);
+  Stream.EmitRecord(bitc::MODULE_CODE_FNINDEX_OFFSET, Vals, OffsetAbbrev);
+  return Stream.GetCurrentBitNo() - 64;
+}
+
+/// WriteFunctionIndex - Emit the bit offset of each function body, relative
+/// to the start of the module block's contents like the offsets themselves,
+/// and patch the offset of the index into the placeholder at OffsetBit.
+static void WriteFunctionIndex(const FunctionOffsetList &FunctionOffsets,
+                               uint64_t OffsetBit, uint64_t ModuleStartBit,
+                               BitstreamWriter &Stream) {
+  uint64_t IndexOffset = Stream.GetCurrentBitNo() - ModuleStartBit;
+  Stream.EnterSubblock(bitc::FUNCTION_INDEX_BLOCK_ID, 3);
+
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::FNINDEX_CODE_ENTRY));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));
+  unsigned EntryAbbrev = Stream.EmitAbbrev(Abbv);
+
+  SmallVector<uint64_t, 2> Vals;
+  for (unsigned i = 0, e = FunctionOffsets.size(); i != e; ++i) {
+    Vals.push_back(FunctionOffsets[i].first);
+    Vals.push_back(FunctionOffsets[i].second);
+    Stream.EmitRecord(bitc::FNINDEX_CODE_ENTRY, Vals, EntryAbbrev);
+    Vals.clear();
+  }
+
+  Stream.ExitBlock();
+
+  Stream.BackpatchBits(OffsetBit, uint32_t(IndexOffset));
+  Stream.BackpatchBits(OffsetBit + 32, uint32_t(IndexOffset >> 32));
+}
+
 /// WriteModule - Emit the specified module to the bitstream.
-static void WriteModule(const Module *M, BitstreamWriter &Stream) {
+static void WriteModule(const Module *M, BitstreamWriter &Stream,
+                        ThreadPool *Pool) {
   Stream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
+  uint64_t ModuleStartBit = Stream.GetCurrentBitNo();
 
   // Emit the version number if it is non-zero.
   if (CurVersion) {
@@ -1705,16 +1872,32 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream) {
   // descriptors for global variables, and function prototype info.
   WriteModuleInfo(M, VE, Stream);
 
+  // Make room for the offset of the function index, if there will be one.
+  bool HasFunctionIndex = false;
+  uint64_t FunctionIndexOffsetBit = 0;
+  if (EnableFunctionIndex)
+    for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
+      if (!F->isDeclaration()) {
+        HasFunctionIndex = true;
+        FunctionIndexOffsetBit = WriteFunctionIndexOffset(Stream);
+        break;
+      }
+
   // Emit constants.
   WriteModuleConstants(VE, Stream);
 
   // Emit metadata.
   WriteModuleMetadata(M, VE, Stream);
 
-  // Emit function bodies.
-  for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
-    if (!F->isDeclaration())
-      WriteFunction(*F, VE, Stream);
+  // Emit function bodies, remembering where each one starts.
+  FunctionOffsetList FunctionOffsets;
+  WriteFunctionBodies(M, VE, Stream, ModuleStartBit, FunctionOffsets, Pool);
+
+  // Emit the function index right after the bodies, where a reader that
+  // jumped to it carries on.
+  if (HasFunctionIndex)
+    WriteFunctionIndex(FunctionOffsets, FunctionIndexOffsetBit,
+                       ModuleStartBit, Stream);
 
   // Emit metadata.
   WriteModuleMetadataStore(M, Stream);
@@ -1799,13 +1982,14 @@ static void EmitDarwinBCTrailer(BitstreamWriter &Stream, unsigned BufferSize) {
 
 /// WriteBitcodeToFile - Write the specified module to the specified output
 /// stream.
-void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out) {
+void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
+                              ThreadPool *Pool) {
   std::vector<unsigned char> Buffer;
   BitstreamWriter Stream(Buffer);
 
   Buffer.reserve(256*1024);
 
-  WriteBitcodeToStream( M, Stream );
+  WriteBitcodeToStream(M, Stream, Pool);
 
   // Write the generated bitstream to "Out".
   Out.write((char*)&Buffer.front(), Buffer.size());
@@ -1813,7 +1997,11 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out) {
 
 /// WriteBitcodeToStream - Write the specified module to the specified output
 /// stream.
-void llvm::WriteBitcodeToStream(const Module *M, BitstreamWriter &Stream) {
+void llvm::WriteBitcodeToStream(const Module *M, BitstreamWriter &Stream,
+                                ThreadPool *Pool) {
+  if (!Pool && ParallelBitcodeWriter)
+    Pool = &ThreadPool::getGlobalPool();
+
   // If this is darwin or another generic macho target, emit a file header and
   // trailer if needed.
   Triple TT(M->getTargetTriple());
@@ -1829,7 +2017,7 @@ void llvm::WriteBitcodeToStream(const Module *M, BitstreamWriter &Stream) {
   Stream.Emit(0xD, 4);
 
   // Emit the module.
-  WriteModule(M, Stream);
+  WriteModule(M, Stream, Pool);
 
   if (TT.isOSDarwin())
     EmitDarwinBCTrailer(Stream, Stream.getBuffer().size());
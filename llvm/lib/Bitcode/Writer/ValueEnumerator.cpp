@@ -109,6 +109,18 @@ ValueEnumerator::ValueEnumerator(const Module *M) {
   OptimizeConstants(FirstConstant, Values.size());
 }
 
+ValueEnumerator::ValueEnumerator(const ValueEnumerator &Other)
+  : TypeMap(Other.TypeMap), Types(Other.Types), ValueMap(Other.ValueMap),
+    Values(Other.Values), MDValues(Other.MDValues),
+    MDValueMap(Other.MDValueMap), AttributeMap(Other.AttributeMap),
+    Attributes(Other.Attributes),
+    GlobalBasicBlockIDs(Other.GlobalBasicBlockIDs), InstructionCount(0),
+    NumModuleValues(0), NumModuleMDValues(0), FirstFuncConstantID(0),
+    FirstInstID(0) {
+  assert(Other.BasicBlocks.empty() && Other.FunctionLocalMDs.empty() &&
+         "Copying a ValueEnumerator with a function incorporated!");
+}
+
 unsigned ValueEnumerator::getInstructionID(const Instruction *Inst) const {
   InstructionMapType::const_iterator I = InstructionMap.find(Inst);
   assert(I != InstructionMap.end() && "Instruction is not mapped!");
@@ -79,11 +79,15 @@ private:
   unsigned FirstFuncConstantID;
   unsigned FirstInstID;
   
-  ValueEnumerator(const ValueEnumerator &);  // DO NOT IMPLEMENT
   void operator=(const ValueEnumerator &);   // DO NOT IMPLEMENT
 public:
   ValueEnumerator(const Module *M);
 
+  /// ValueEnumerator - Copy the module-level numbering of Other, so that the
+  /// copy can incorporate functions independently of it, e.g. on another
+  /// thread.  Other must not have a function incorporated.
+  ValueEnumerator(const ValueEnumerator &Other);
+
   void dump() const;
   void print(raw_ostream &OS, const ValueMapType &Map, const char *Name) const;
 
@@ -40,6 +40,8 @@ namespace {
      initializeDeadMachineInstructionElimPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual bool isParallelSafe() const { return true; }
+
   private:
     bool isDead(const MachineInstr *MI) const;
   };
@@ -59,6 +59,8 @@ namespace {
       AU.addPreserved<MachineDominatorTree>();
     }
 
+    virtual bool isParallelSafe() const { return true; }
+
     virtual void releaseMemory() {
       ScopeMap.clear();
       Exps.clear();
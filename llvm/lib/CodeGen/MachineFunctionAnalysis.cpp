@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/CodeGen/MachineFunctionAnalysis.h"
+#include "llvm/Module.h"
 #include "llvm/CodeGen/GCMetadata.h"
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/CodeGen/MachineModuleInfo.h"
@@ -38,14 +39,27 @@ bool MachineFunctionAnalysis::doInitialization(Module &M) {
   MachineModuleInfo *MMI = getAnalysisIfAvailable<MachineModuleInfo>();
   assert(MMI && "MMI not around yet??");
   MMI->setModule(&M);
+
+  // FPPassManager runs the passes on the defined functions in module order.
+  // Functions that are materialized or created later are numbered after them.
+  FunctionNumbers.clear();
   NextFnNum = 0;
+  for (Module::const_iterator I = M.begin(), E = M.end(); I != E; ++I)
+    if (!I->isDeclaration())
+      FunctionNumbers[I] = NextFnNum++;
   return false;
 }
 
+Pass *MachineFunctionAnalysis::createParallelInstance() const {
+  return new MachineFunctionAnalysis(TM);
+}
+
 
 bool MachineFunctionAnalysis::runOnFunction(Function &F) {
   assert(!MF && "MachineFunctionAnalysis already initialized!");
-  MF = new MachineFunction(&F, TM, NextFnNum++,
+  DenseMap<const Function*, unsigned>::iterator I = FunctionNumbers.find(&F);
+  unsigned FnNum = I != FunctionNumbers.end() ? I->second : NextFnNum++;
+  MF = new MachineFunction(&F, TM, FnNum,
                            getAnalysis<MachineModuleInfo>(),
                            getAnalysisIfAvailable<GCModuleInfo>());
   return false;
@@ -73,6 +73,8 @@ namespace {
       AU.addPreserved<MachineLoopInfo>();
     }
 
+    virtual bool isParallelSafe() const { return true; }
+
     virtual void releaseMemory() {
       CEBCandidates.clear();
     }
@@ -44,6 +44,8 @@ namespace {
       MachineFunctionPass::getAnalysisUsage(AU);
     }
 
+    virtual bool isParallelSafe() const { return true; }
+
   private:
     typedef SmallPtrSet<MachineInstr*, 16> InstrSet;
     typedef SmallPtrSetIterator<MachineInstr*> InstrSetIterator;
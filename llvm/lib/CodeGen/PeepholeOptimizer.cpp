@@ -94,6 +94,8 @@ namespace {
       }
     }
 
+    virtual bool isParallelSafe() const { return true; }
+
   private:
     bool OptimizeBitcastInstr(MachineInstr *MI, MachineBasicBlock *MBB);
     bool OptimizeCmpInstr(MachineInstr *MI, MachineBasicBlock *MBB);
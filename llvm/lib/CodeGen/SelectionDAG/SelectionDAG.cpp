@@ -843,7 +843,12 @@ unsigned SelectionDAG::getEVTAlignment(EVT VT) const {
 SelectionDAG::SelectionDAG(const TargetMachine &tm, CodeGenOpt::Level OL)
   : TM(tm), TLI(*tm.getTargetLowering()), TSI(*tm.getSelectionDAGInfo()),
     OptLevel(OL), EntryNode(ISD::EntryToken, DebugLoc(), getVTList(MVT::Other)),
-    Root(getEntryNode()), Ordering(0) {
+    Root(getEntryNode()), NodeAllocator(SlabPool::getShared()),
+    OperandAllocator(SlabPool::getShared()), Allocator(SlabPool::getShared()),
+    Ordering(0) {
+  NodeAllocator.getAllocator().setName("SelectionDAG");
+  OperandAllocator.setName("SelectionDAG");
+  Allocator.setName("SelectionDAG");
   AllNodes.push_back(&EntryNode);
   Ordering = new SDNodeOrdering();
   DbgInfo = new SDDbgInfo();
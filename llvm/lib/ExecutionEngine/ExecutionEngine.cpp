@@ -51,7 +51,8 @@ ExecutionEngine *(*ExecutionEngine::MCJITCtor)(
   bool GVsWithCode,
   TargetMachine *TM) = 0;
 ExecutionEngine *(*ExecutionEngine::InterpCtor)(Module *M,
-                                                std::string *ErrorStr) = 0;
+                                                std::string *ErrorStr,
+                                                bool UseBytecode) = 0;
 
 ExecutionEngine::ExecutionEngine(Module *M)
   : EEState(*this),
@@ -59,6 +60,8 @@ ExecutionEngine::ExecutionEngine(Module *M)
     ExceptionTableRegister(0),
     ExceptionTableDeregister(0) {
   CompilingLazily         = false;
+  CompilingInBackground   = false;
+  BackgroundPool          = 0;
   GVCompilationDisabled   = false;
   SymbolSearchingDisabled = false;
   Modules.push_back(M);
@@ -451,6 +454,9 @@ ExecutionEngine *EngineBuilder::create() {
   if (sys::DynamicLibrary::LoadLibraryPermanently(0, ErrorStr))
     return 0;
 
+  if (Tier1Threshold || Tier2Threshold)
+    return createTiered();
+
   // If the user specified a memory manager but didn't specify which engine to
   // create, we assume they only want the JIT, and we fail if they only want
   // the interpreter.
@@ -496,7 +502,7 @@ ExecutionEngine *EngineBuilder::create() {
   // an interpreter instead.
   if (WhichEngine & EngineKind::Interpreter) {
     if (ExecutionEngine::InterpCtor)
-      return ExecutionEngine::InterpCtor(M, ErrorStr);
+      return ExecutionEngine::InterpCtor(M, ErrorStr, InterpreterBytecode);
     if (ErrorStr)
       *ErrorStr = "Interpreter has not been linked in.";
     return 0;
@@ -510,6 +516,62 @@ ExecutionEngine *EngineBuilder::create() {
   return 0;
 }
 
+ExecutionEngine *EngineBuilder::createTiered() {
+  if (!ExecutionEngine::InterpCtor || !ExecutionEngine::JITCtor ||
+      JMM || UseMCJIT) {
+    if (ErrorStr)
+      *ErrorStr = "Tiered execution needs the interpreter and the JIT, with "
+                  "the default memory manager.";
+    return 0;
+  }
+
+  // The interpreter lays out memory as the module says and the JIT as the
+  // target says, which must agree as they share the global variables.
+  Triple TT(M->getTargetTriple());
+  TargetMachine *TM = EngineBuilder::selectTarget(TT, MArch, MCPU, MAttrs,
+                                                  Options, RelocModel, CMModel,
+                                                  CodeGenOpt::Less, ErrorStr);
+  if (!TM)
+    return 0;
+  std::string Layout = TM->getTargetData()->getStringRepresentation();
+  delete TM;
+  if (M->getDataLayout().empty())
+    M->setDataLayout(Layout);
+
+  ExecutionEngine *EE =
+    ExecutionEngine::InterpCtor(M, ErrorStr, InterpreterBytecode);
+  if (!EE)
+    return 0;
+
+  const unsigned Thresholds[] = { Tier1Threshold, Tier2Threshold };
+  const CodeGenOpt::Level Levels[] = { CodeGenOpt::Less,
+                                       CodeGenOpt::Aggressive };
+  for (unsigned i = 0; i != 2; ++i) {
+    if (!Thresholds[i])
+      continue;
+    ExecutionEngine *Tier = 0;
+    if (TargetMachine *TM = EngineBuilder::selectTarget(TT, MArch, MCPU,
+                                                        MAttrs, Options,
+                                                        RelocModel, CMModel,
+                                                        Levels[i], ErrorStr))
+      Tier = ExecutionEngine::JITCtor(M, ErrorStr, 0, AllocateGVsWithCode, TM);
+    if (Tier && !EE->addTier(Tier, Thresholds[i])) {
+      if (ErrorStr)
+        *ErrorStr = "The module's data layout does not match the JIT's.";
+      Tier->removeModule(M);
+      delete Tier;
+      Tier = 0;
+    }
+    if (!Tier) {
+      // Give the module back to the caller, as on any other failure.
+      EE->removeModule(M);
+      delete EE;
+      return 0;
+    }
+  }
+  return EE;
+}
+
 void *ExecutionEngine::getPointerToGlobal(const GlobalValue *GV) {
   if (Function *F = const_cast<Function*>(dyn_cast<Function>(GV)))
     return getPointerToFunction(F);
@@ -0,0 +1,781 @@
+//===-- Bytecode.cpp - Pre-decoded interpreter core -----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file implements the interpreter's pre-decoded core.  The first time a
+// function is called, it is translated to a compact register-based bytecode:
+// every constant, argument and instruction result gets a fixed slot in the
+// frame, PHI nodes become copies on the control flow edges, and the common
+// integer, floating point, memory and branch instructions get dedicated
+// opcodes.  The bytecode is run with threaded dispatch where the compiler
+// supports computed gotos.  Everything else is handed to the InstVisitor,
+// which finds its operands in the slots through getOperandValue.
+//
+// Intrinsics are run by executeIntrinsic rather than lowered in the IR, which
+// would invalidate the bytecode.  Functions using exception handling, or
+// intrinsics executeIntrinsic does not know, are left to the visitor entirely.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "interpreter"
+#include "Interpreter.h"
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Instructions.h"
+#include "llvm/IntrinsicInst.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/GetElementPtrTypeIterator.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+using namespace llvm;
+
+STATISTIC(NumDecodedFunctions, "Number of functions translated to bytecode");
+STATISTIC(NumDecodedInsts, "Number of instructions translated to bytecode");
+
+static cl::opt<bool>
+InterpreterBytecode("interpreter-bytecode",
+                    cl::desc("Translate functions to bytecode before "
+                             "interpreting them"),
+                    cl::init(false));
+
+//===----------------------------------------------------------------------===//
+//                              Translation
+//===----------------------------------------------------------------------===//
+
+/// hasSimpleType - Return true if the slots of values of type Ty can be
+/// handled by the dedicated opcodes.
+static bool hasSimpleType(Value *V) {
+  Type *Ty = V->getType();
+  return Ty->isIntegerTy() || Ty->isFloatTy() || Ty->isDoubleTy() ||
+         Ty->isPointerTy();
+}
+
+/// isPrecomputable - Return true if C can be evaluated once, when the function
+/// is translated.  Constant expressions are limited to the ones addressing
+/// globals, which getConstantExprValue is known to handle.
+static bool isPrecomputable(Constant *C) {
+  if (!hasSimpleType(C))
+    return false;
+  ConstantExpr *CE = dyn_cast<ConstantExpr>(C);
+  if (!CE)
+    return true;
+  if (!CE->isCast() && CE->getOpcode() != Instruction::GetElementPtr)
+    return false;
+  for (User::op_iterator I = CE->op_begin(), E = CE->op_end(); I != E; ++I)
+    if (!isPrecomputable(cast<Constant>(I->get())))
+      return false;
+  return true;
+}
+
+/// canExecuteIntrinsic - Return true if executeIntrinsic knows how to run II.
+static bool canExecuteIntrinsic(IntrinsicInst *II) {
+  Type *Ty = II->getType();
+  switch (II->getIntrinsicID()) {
+  default:
+    return false;
+  case Intrinsic::expect:
+  case Intrinsic::prefetch:
+  case Intrinsic::pcmarker:
+  case Intrinsic::dbg_declare:
+  case Intrinsic::dbg_value:
+  case Intrinsic::var_annotation:
+  case Intrinsic::memcpy:
+  case Intrinsic::memmove:
+  case Intrinsic::memset:
+  case Intrinsic::flt_rounds:
+  case Intrinsic::invariant_start:
+  case Intrinsic::invariant_end:
+  case Intrinsic::lifetime_start:
+  case Intrinsic::lifetime_end:
+    return true;
+  case Intrinsic::ctpop:
+  case Intrinsic::ctlz:
+  case Intrinsic::cttz:
+    return Ty->isIntegerTy();
+  case Intrinsic::bswap:
+    return Ty->isIntegerTy() && Ty->getPrimitiveSizeInBits() % 16 == 0;
+  case Intrinsic::sqrt:
+  case Intrinsic::log:
+  case Intrinsic::log10:
+  case Intrinsic::exp:
+  case Intrinsic::pow:
+    return Ty->isFloatTy() || Ty->isDoubleTy();
+  }
+}
+
+namespace {
+/// Decoder - Translates one function to bytecode.
+class Decoder {
+  DecodedFunction &DF;
+  const TargetData &TD;
+
+  bool getSlot(Value *V, unsigned &Slot) const {
+    DenseMap<const Value*, unsigned>::const_iterator I =
+      DF.SlotNumbers.find(V);
+    if (I == DF.SlotNumbers.end())
+      return false;
+    Slot = I->second;
+    return true;
+  }
+
+  bool getSlots(Instruction *I, unsigned NumOps, DecodedInst &D) const {
+    for (unsigned i = 0; i != NumOps; ++i)
+      if (!getSlot(I->getOperand(i), D.Ops[i]))
+        return false;
+    return true;
+  }
+
+  bool addEdge(BasicBlock *From, BasicBlock *To, unsigned &EdgeNo);
+  bool decodeGEP(GetElementPtrInst *GEP, DecodedInst &D);
+  void decodeInstruction(Instruction *I, DecodedInst &D);
+
+public:
+  Decoder(DecodedFunction &DF, const TargetData &TD) : DF(DF), TD(TD) {}
+
+  void decode(Function *F) {
+    for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+      for (BasicBlock::iterator I = BB->getFirstNonPHI(), E = BB->end();
+           I != E; ++I) {
+        DecodedInst D;
+        D.Opcode = DecodedFunction::Generic;
+        D.Dest = 0;
+        D.Ops[0] = D.Ops[1] = D.Ops[2] = 0;
+        D.Imm = 0;
+        D.I = I;
+        getSlot(I, D.Dest);
+        decodeInstruction(I, D);
+        DF.Insts.push_back(D);
+      }
+  }
+};
+}
+
+/// addEdge - Add the edge From -> To along with the copies for the PHI nodes
+/// of To.  Fails if an incoming value has no slot.
+bool Decoder::addEdge(BasicBlock *From, BasicBlock *To, unsigned &EdgeNo) {
+  DecodedFunction::Edge E;
+  E.Dest = To;
+  E.Target = DF.BlockStarts.lookup(To);
+  E.MovesBegin = DF.Moves.size();
+  E.NeedsTemporaries = false;
+  for (BasicBlock::iterator I = To->begin(); PHINode *PN = dyn_cast<PHINode>(I);
+       ++I) {
+    unsigned Dest, Src;
+    Value *Incoming = PN->getIncomingValueForBlock(From);
+    if (!getSlot(PN, Dest) || !getSlot(Incoming, Src)) {
+      DF.Moves.resize(E.MovesBegin);
+      return false;
+    }
+    if (isa<PHINode>(Incoming) && cast<PHINode>(Incoming)->getParent() == To)
+      E.NeedsTemporaries = true;
+    DF.Moves.push_back(std::make_pair(Dest, Src));
+  }
+  E.MovesEnd = DF.Moves.size();
+  EdgeNo = DF.Edges.size();
+  DF.Edges.push_back(E);
+  return true;
+}
+
+/// decodeGEP - Fold the constant indices of GEP into D.Imm and record the
+/// others with their scale.
+bool Decoder::decodeGEP(GetElementPtrInst *GEP, DecodedInst &D) {
+  if (!getSlot(GEP->getPointerOperand(), D.Ops[0]))
+    return false;
+  unsigned IndicesBegin = DF.GEPIndices.size();
+  int64_t Offset = 0;
+  for (gep_type_iterator I = gep_type_begin(GEP), E = gep_type_end(GEP);
+       I != E; ++I) {
+    if (StructType *STy = dyn_cast<StructType>(*I)) {
+      unsigned Index = cast<ConstantInt>(I.getOperand())->getZExtValue();
+      Offset += TD.getStructLayout(STy)->getElementOffset(Index);
+      continue;
+    }
+    int64_t Scale =
+      TD.getTypeAllocSize(cast<SequentialType>(*I)->getElementType());
+    if (ConstantInt *CI = dyn_cast<ConstantInt>(I.getOperand())) {
+      Offset += Scale * CI->getSExtValue();
+      continue;
+    }
+    unsigned Slot;
+    if (!getSlot(I.getOperand(), Slot)) {
+      DF.GEPIndices.resize(IndicesBegin);
+      return false;
+    }
+    DF.GEPIndices.push_back(std::make_pair(Slot, Scale));
+  }
+  D.Ops[1] = IndicesBegin;
+  D.Ops[2] = DF.GEPIndices.size();
+  D.Imm = Offset;
+  return true;
+}
+
+void Decoder::decodeInstruction(Instruction *I, DecodedInst &D) {
+  Type *Ty = I->getType();
+  switch (I->getOpcode()) {
+  default:
+    if (IntrinsicInst *II = dyn_cast<IntrinsicInst>(I)) {
+      // The va_* intrinsics are left to the visitor, which doesn't lower them.
+      switch (II->getIntrinsicID()) {
+      case Intrinsic::vastart:
+      case Intrinsic::vaend:
+      case Intrinsic::vacopy:
+        D.Opcode = DecodedFunction::Generic;
+        break;
+      default:
+        D.Opcode = DecodedFunction::Intrinsic;
+        break;
+      }
+    } else if (isa<CallInst>(I))
+      D.Opcode = DecodedFunction::GenericCall;
+    else if (isa<TerminatorInst>(I))
+      D.Opcode = DecodedFunction::GenericTerminator;
+    return;
+
+#define INTEGER_OPCODE(Name)                                                  \
+  case Instruction::Name:                                                     \
+    if (Ty->isIntegerTy() && getSlots(I, 2, D))                               \
+      D.Opcode = DecodedFunction::Name;                                       \
+    return;
+  INTEGER_OPCODE(Add)
+  INTEGER_OPCODE(Sub)
+  INTEGER_OPCODE(Mul)
+  INTEGER_OPCODE(UDiv)
+  INTEGER_OPCODE(SDiv)
+  INTEGER_OPCODE(URem)
+  INTEGER_OPCODE(SRem)
+  INTEGER_OPCODE(And)
+  INTEGER_OPCODE(Or)
+  INTEGER_OPCODE(Xor)
+  INTEGER_OPCODE(Shl)
+  INTEGER_OPCODE(LShr)
+  INTEGER_OPCODE(AShr)
+#undef INTEGER_OPCODE
+
+#define FP_OPCODE(Name)                                                       \
+  case Instruction::Name:                                                     \
+    if (getSlots(I, 2, D)) {                                                  \
+      if (Ty->isFloatTy())                                                    \
+        D.Opcode = DecodedFunction::Name##Float;                              \
+      else if (Ty->isDoubleTy())                                              \
+        D.Opcode = DecodedFunction::Name##Double;                             \
+    }                                                                         \
+    return;
+  FP_OPCODE(FAdd)
+  FP_OPCODE(FSub)
+  FP_OPCODE(FMul)
+  FP_OPCODE(FDiv)
+#undef FP_OPCODE
+
+  case Instruction::ICmp:
+    if (I->getOperand(0)->getType()->isIntegerTy() && getSlots(I, 2, D)) {
+      D.Opcode = DecodedFunction::ICmp;
+      D.Imm = cast<ICmpInst>(I)->getPredicate();
+    }
+    return;
+
+  case Instruction::Trunc:
+  case Instruction::ZExt:
+  case Instruction::SExt:
+    if (Ty->isIntegerTy() && getSlots(I, 1, D)) {
+      D.Opcode = I->getOpcode() == Instruction::Trunc ? DecodedFunction::Trunc :
+                 I->getOpcode() == Instruction::ZExt ? DecodedFunction::ZExt :
+                                                       DecodedFunction::SExt;
+      D.Imm = Ty->getPrimitiveSizeInBits();
+    }
+    return;
+
+  case Instruction::BitCast:
+    if (Ty->isPointerTy() && getSlots(I, 1, D))
+      D.Opcode = DecodedFunction::Move;
+    return;
+
+  case Instruction::Load:
+    if (!cast<LoadInst>(I)->isVolatile() && hasSimpleType(I) &&
+        getSlots(I, 1, D))
+      D.Opcode = DecodedFunction::Load;
+    return;
+
+  case Instruction::Store:
+    if (!cast<StoreInst>(I)->isVolatile() &&
+        hasSimpleType(I->getOperand(0)) && getSlots(I, 2, D))
+      D.Opcode = DecodedFunction::Store;
+    return;
+
+  case Instruction::GetElementPtr:
+    if (decodeGEP(cast<GetElementPtrInst>(I), D))
+      D.Opcode = DecodedFunction::GEP;
+    return;
+
+  case Instruction::Select:
+    if (!I->getOperand(0)->getType()->isVectorTy() && getSlots(I, 3, D))
+      D.Opcode = DecodedFunction::Select;
+    return;
+
+  case Instruction::Br: {
+    BranchInst *BI = cast<BranchInst>(I);
+    BasicBlock *BB = BI->getParent();
+    D.Opcode = DecodedFunction::GenericTerminator;
+    if (BI->isUnconditional()) {
+      if (addEdge(BB, BI->getSuccessor(0), D.Ops[0]))
+        D.Opcode = DecodedFunction::Br;
+    } else if (getSlot(BI->getCondition(), D.Ops[0]) &&
+               addEdge(BB, BI->getSuccessor(0), D.Ops[1]) &&
+               addEdge(BB, BI->getSuccessor(1), D.Ops[2])) {
+      D.Opcode = DecodedFunction::CondBr;
+    }
+    return;
+  }
+
+  case Instruction::Ret: {
+    ReturnInst *RI = cast<ReturnInst>(I);
+    D.Ops[0] = ~0U;
+    // The visitor leaves the frame on a return, like on a call.
+    if (!RI->getReturnValue() || getSlot(RI->getReturnValue(), D.Ops[0]))
+      D.Opcode = DecodedFunction::Ret;
+    else
+      D.Opcode = DecodedFunction::GenericCall;
+    return;
+  }
+  }
+}
+
+DecodedFunction *Interpreter::decodeFunction(Function *F) {
+  // The visitor lowers intrinsics in the IR as it meets them, which would
+  // invalidate the bytecode, so functions with intrinsics executeIntrinsic
+  // can't run, or with exception handling, are left to the visitor.
+  for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+    for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I) {
+      if (isa<InvokeInst>(I) || isa<UnwindInst>(I) || isa<ResumeInst>(I) ||
+          isa<LandingPadInst>(I))
+        return 0;
+      IntrinsicInst *II = dyn_cast<IntrinsicInst>(I);
+      if (!II)
+        continue;
+      switch (II->getIntrinsicID()) {
+      case Intrinsic::vastart:
+      case Intrinsic::vaend:
+      case Intrinsic::vacopy:
+        break;
+      default:
+        if (!canExecuteIntrinsic(II))
+          return 0;
+        break;
+      }
+    }
+
+  DecodedFunction *DF = new DecodedFunction();
+
+  // Constants come first, so that a frame only needs InitialSlots copied to
+  // the start of its slots.
+  ExecutionContext Empty;
+  Empty.Code = 0;
+  unsigned NumInsts = 0;
+  for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+    for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I)
+      for (User::op_iterator OI = I->op_begin(), OE = I->op_end(); OI != OE;
+           ++OI) {
+        Constant *C = dyn_cast<Constant>(OI->get());
+        if (!C || !isPrecomputable(C) || DF->SlotNumbers.count(C))
+          continue;
+        DF->SlotNumbers[C] = DF->InitialSlots.size();
+        DF->InitialSlots.push_back(getOperandValue(C, Empty));
+      }
+
+  unsigned NumSlots = DF->InitialSlots.size();
+  for (Function::arg_iterator AI = F->arg_begin(), E = F->arg_end(); AI != E;
+       ++AI)
+    DF->SlotNumbers[AI] = NumSlots++;
+  for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB) {
+    for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I) {
+      if (!I->getType()->isVoidTy())
+        DF->SlotNumbers[I] = NumSlots++;
+      if (&*I == BB->getFirstNonPHI())
+        DF->BlockStarts[BB] = NumInsts;
+      if (!isa<PHINode>(I))
+        ++NumInsts;
+    }
+  }
+  DF->NumSlots = NumSlots;
+
+  Decoder(*DF, TD).decode(F);
+  ++NumDecodedFunctions;
+  NumDecodedInsts += DF->Insts.size();
+  DEBUG(dbgs() << "Decoded " << F->getName() << ": " << DF->Insts.size()
+               << " instructions, " << NumSlots << " slots\n");
+  return DF;
+}
+
+DecodedFunction *Interpreter::getDecodedFunction(Function *F) {
+  if (!UseBytecode && !InterpreterBytecode)
+    return 0;
+  std::pair<DenseMap<Function*, DecodedFunction*>::iterator, bool> Entry =
+    DecodedFunctions.insert(std::make_pair(F, (DecodedFunction*)0));
+  if (Entry.second) {
+    DecodedFunction *DF = decodeFunction(F);
+    DecodedFunctions[F] = DF;
+    return DF;
+  }
+  return Entry.first->second;
+}
+
+void Interpreter::deleteDecodedFunctions() {
+  for (DenseMap<Function*, DecodedFunction*>::iterator
+       I = DecodedFunctions.begin(), E = DecodedFunctions.end(); I != E; ++I)
+    delete I->second;
+  DecodedFunctions.clear();
+}
+
+//===----------------------------------------------------------------------===//
+//                              Execution
+//===----------------------------------------------------------------------===//
+
+/// allocateFrameSlots - Return the slots of the new frame SF, which start at
+/// SF.SlotBase in FrameSlots, with the constants filled in.  The other slots
+/// keep whatever an earlier frame left in them, as the bytecode writes every
+/// argument and result before reading it.
+GenericValue *Interpreter::allocateFrameSlots(ExecutionContext &SF) {
+  const DecodedFunction &DF = *SF.Code;
+  unsigned End = SF.SlotBase + DF.NumSlots;
+  if (FrameSlots.size() < End) {
+    FrameSlots.resize(std::max(End, unsigned(FrameSlots.size() * 2)));
+    // The slots moved, so point the frames at their new place.
+    for (unsigned i = 0, e = ECStack.size(); i != e; ++i)
+      if (ECStack[i].Code)
+        ECStack[i].Slots = &FrameSlots[0] + ECStack[i].SlotBase;
+  }
+  GenericValue *Slots = FrameSlots.empty() ? 0 : &FrameSlots[0] + SF.SlotBase;
+  std::copy(DF.InitialSlots.begin(), DF.InitialSlots.end(), Slots);
+  return Slots;
+}
+
+/// executeIntrinsic - Run the call to an intrinsic II, which
+/// canExecuteIntrinsic accepted, and return its result.
+GenericValue Interpreter::executeIntrinsic(IntrinsicInst &II,
+                                           ExecutionContext &SF) {
+  GenericValue Result;
+  switch (II.getIntrinsicID()) {
+  default:
+    llvm_unreachable("Intrinsic not handled by the pre-decoded core!");
+  case Intrinsic::expect:
+    return getOperandValue(II.getArgOperand(0), SF);
+  case Intrinsic::prefetch:
+  case Intrinsic::pcmarker:
+  case Intrinsic::dbg_declare:
+  case Intrinsic::dbg_value:
+  case Intrinsic::var_annotation:
+  case Intrinsic::invariant_end:
+  case Intrinsic::lifetime_end:
+    return Result;
+  case Intrinsic::invariant_start:
+  case Intrinsic::lifetime_start:
+    // Discard region information, like IntrinsicLowering.
+    return PTOGV(0);
+  case Intrinsic::flt_rounds:
+    // Round to nearest.
+    Result.IntVal = APInt(32, 1);
+    return Result;
+
+  case Intrinsic::memcpy:
+  case Intrinsic::memmove: {
+    MemTransferInst &MI = cast<MemTransferInst>(II);
+    void *Dest = GVTOP(getOperandValue(MI.getRawDest(), SF));
+    void *Src = GVTOP(getOperandValue(MI.getRawSource(), SF));
+    size_t Len = getOperandValue(MI.getLength(), SF).IntVal.getZExtValue();
+    if (II.getIntrinsicID() == Intrinsic::memcpy)
+      memcpy(Dest, Src, Len);
+    else
+      memmove(Dest, Src, Len);
+    return Result;
+  }
+  case Intrinsic::memset: {
+    MemSetInst &MI = cast<MemSetInst>(II);
+    void *Dest = GVTOP(getOperandValue(MI.getRawDest(), SF));
+    int Val = getOperandValue(MI.getValue(), SF).IntVal.getZExtValue();
+    size_t Len = getOperandValue(MI.getLength(), SF).IntVal.getZExtValue();
+    memset(Dest, Val, Len);
+    return Result;
+  }
+
+  case Intrinsic::ctpop:
+  case Intrinsic::ctlz:
+  case Intrinsic::cttz:
+  case Intrinsic::bswap: {
+    const APInt &Src = getOperandValue(II.getArgOperand(0), SF).IntVal;
+    unsigned BitWidth = Src.getBitWidth();
+    switch (II.getIntrinsicID()) {
+    default: llvm_unreachable("Not a bit intrinsic!");
+    case Intrinsic::ctpop:
+      Result.IntVal = APInt(BitWidth, Src.countPopulation());
+      break;
+    case Intrinsic::ctlz:
+      Result.IntVal = APInt(BitWidth, Src.countLeadingZeros());
+      break;
+    case Intrinsic::cttz:
+      Result.IntVal = APInt(BitWidth, Src.countTrailingZeros());
+      break;
+    case Intrinsic::bswap:
+      Result.IntVal = Src.byteSwap();
+      break;
+    }
+    return Result;
+  }
+
+  case Intrinsic::sqrt:
+  case Intrinsic::log:
+  case Intrinsic::log10:
+  case Intrinsic::exp:
+  case Intrinsic::pow: {
+    // The same libm functions the lowered calls would reach.
+    bool IsFloat = II.getType()->isFloatTy();
+    GenericValue Op0 = getOperandValue(II.getArgOperand(0), SF);
+    double X = IsFloat ? Op0.FloatVal : Op0.DoubleVal;
+    double R;
+    switch (II.getIntrinsicID()) {
+    default: llvm_unreachable("Not a math intrinsic!");
+    case Intrinsic::sqrt:
+      R = IsFloat ? sqrtf(Op0.FloatVal) : sqrt(X);
+      break;
+    case Intrinsic::log:
+      R = IsFloat ? logf(Op0.FloatVal) : log(X);
+      break;
+    case Intrinsic::log10:
+      R = IsFloat ? log10f(Op0.FloatVal) : log10(X);
+      break;
+    case Intrinsic::exp:
+      R = IsFloat ? expf(Op0.FloatVal) : exp(X);
+      break;
+    case Intrinsic::pow: {
+      GenericValue Op1 = getOperandValue(II.getArgOperand(1), SF);
+      R = IsFloat ? powf(Op0.FloatVal, Op1.FloatVal) : pow(X, Op1.DoubleVal);
+      break;
+    }
+    }
+    if (IsFloat)
+      Result.FloatVal = float(R);
+    else
+      Result.DoubleVal = R;
+    return Result;
+  }
+  }
+}
+
+/// takeEdge - Copy the incoming values into the PHI nodes at the end of E and
+/// return the index of the next instruction.
+static unsigned takeEdge(const DecodedFunction &DF,
+                         const DecodedFunction::Edge &E, GenericValue *Slots,
+                         SmallVectorImpl<GenericValue> &Temporaries) {
+  if (!E.NeedsTemporaries) {
+    for (unsigned i = E.MovesBegin; i != E.MovesEnd; ++i)
+      Slots[DF.Moves[i].first] = Slots[DF.Moves[i].second];
+    return E.Target;
+  }
+
+  // The PHI nodes read each other, so read all of them before writing any.
+  Temporaries.clear();
+  for (unsigned i = E.MovesBegin; i != E.MovesEnd; ++i)
+    Temporaries.push_back(Slots[DF.Moves[i].second]);
+  for (unsigned i = E.MovesBegin; i != E.MovesEnd; ++i)
+    Slots[DF.Moves[i].first] = Temporaries[i - E.MovesBegin];
+  return E.Target;
+}
+
+/// runDecoded - Run the bytecode of the frame SF until it calls a function or
+/// returns.  SF must not be used after that, as the stack may have moved.
+void Interpreter::runDecoded(ExecutionContext &SF) {
+  const DecodedFunction &DF = *SF.Code;
+  const DecodedInst *Insts = &DF.Insts[0];
+  GenericValue *Slots = SF.Slots;
+  SmallVector<GenericValue, 8> Temporaries;
+  unsigned PC = SF.PC;
+  const DecodedInst *In;
+
+#if defined(__GNUC__)
+  // Threaded dispatch: every handler jumps straight to the next one.
+  static void *const Handlers[DecodedFunction::NumOpcodes] = {
+#define HANDLE_DECODED_OPCODE(Name) &&Do##Name,
+#include "DecodedOpcodes.def"
+  };
+#define DECODED_CASE(Name) Do##Name:
+#define DECODED_NEXT()                                                        \
+  do {                                                                        \
+    In = &Insts[PC++];                                                        \
+    goto *Handlers[In->Opcode];                                               \
+  } while (0)
+
+  DECODED_NEXT();
+  {
+#else
+#define DECODED_CASE(Name) case DecodedFunction::Name:
+#define DECODED_NEXT() goto Dispatch
+
+Dispatch:
+  In = &Insts[PC++];
+  switch (In->Opcode) {
+  default: llvm_unreachable("Unknown bytecode opcode!");
+#endif
+
+  DECODED_CASE(Generic)
+    visit(*In->I);
+    DECODED_NEXT();
+
+  DECODED_CASE(GenericCall)
+    SF.PC = PC;
+    visit(*In->I);
+    return;
+
+  DECODED_CASE(GenericTerminator)
+    visit(*In->I);
+    PC = DF.BlockStarts.lookup(SF.CurBB);
+    DECODED_NEXT();
+
+  DECODED_CASE(Intrinsic) {
+    GenericValue Result = executeIntrinsic(*cast<IntrinsicInst>(In->I), SF);
+    if (!In->I->getType()->isVoidTy())
+      Slots[In->Dest] = Result;
+    DECODED_NEXT();
+  }
+
+#define INTEGER_CASE(Name, Expr)                                              \
+  DECODED_CASE(Name) {                                                        \
+    const APInt &LHS = Slots[In->Ops[0]].IntVal;                              \
+    const APInt &RHS = Slots[In->Ops[1]].IntVal;                              \
+    Slots[In->Dest].IntVal = Expr;                                            \
+    DECODED_NEXT();                                                           \
+  }
+  INTEGER_CASE(Add, LHS + RHS)
+  INTEGER_CASE(Sub, LHS - RHS)
+  INTEGER_CASE(Mul, LHS * RHS)
+  INTEGER_CASE(UDiv, LHS.udiv(RHS))
+  INTEGER_CASE(SDiv, LHS.sdiv(RHS))
+  INTEGER_CASE(URem, LHS.urem(RHS))
+  INTEGER_CASE(SRem, LHS.srem(RHS))
+  INTEGER_CASE(And, LHS & RHS)
+  INTEGER_CASE(Or, LHS | RHS)
+  INTEGER_CASE(Xor, LHS ^ RHS)
+  // Like the visitor, leave the value alone when shifting out all bits.
+  INTEGER_CASE(Shl, RHS.getZExtValue() < LHS.getBitWidth() ?
+                    LHS.shl(RHS.getZExtValue()) : LHS)
+  INTEGER_CASE(LShr, RHS.getZExtValue() < LHS.getBitWidth() ?
+                     LHS.lshr(RHS.getZExtValue()) : LHS)
+  INTEGER_CASE(AShr, RHS.getZExtValue() < LHS.getBitWidth() ?
+                     LHS.ashr(RHS.getZExtValue()) : LHS)
+#undef INTEGER_CASE
+
+  DECODED_CASE(ICmp) {
+    const APInt &LHS = Slots[In->Ops[0]].IntVal;
+    const APInt &RHS = Slots[In->Ops[1]].IntVal;
+    bool Result;
+    switch (In->Imm) {
+    default: llvm_unreachable("Invalid icmp predicate!");
+    case ICmpInst::ICMP_EQ:  Result = LHS == RHS;   break;
+    case ICmpInst::ICMP_NE:  Result = LHS != RHS;   break;
+    case ICmpInst::ICMP_ULT: Result = LHS.ult(RHS); break;
+    case ICmpInst::ICMP_SLT: Result = LHS.slt(RHS); break;
+    case ICmpInst::ICMP_UGT: Result = LHS.ugt(RHS); break;
+    case ICmpInst::ICMP_SGT: Result = LHS.sgt(RHS); break;
+    case ICmpInst::ICMP_ULE: Result = LHS.ule(RHS); break;
+    case ICmpInst::ICMP_SLE: Result = LHS.sle(RHS); break;
+    case ICmpInst::ICMP_UGE: Result = LHS.uge(RHS); break;
+    case ICmpInst::ICMP_SGE: Result = LHS.sge(RHS); break;
+    }
+    Slots[In->Dest].IntVal = APInt(1, Result);
+    DECODED_NEXT();
+  }
+
+#define FP_CASE(Name, Field, OP)                                              \
+  DECODED_CASE(Name)                                                          \
+    Slots[In->Dest].Field =                                                   \
+      Slots[In->Ops[0]].Field OP Slots[In->Ops[1]].Field;                     \
+    DECODED_NEXT();
+  FP_CASE(FAddFloat, FloatVal, +)
+  FP_CASE(FSubFloat, FloatVal, -)
+  FP_CASE(FMulFloat, FloatVal, *)
+  FP_CASE(FDivFloat, FloatVal, /)
+  FP_CASE(FAddDouble, DoubleVal, +)
+  FP_CASE(FSubDouble, DoubleVal, -)
+  FP_CASE(FMulDouble, DoubleVal, *)
+  FP_CASE(FDivDouble, DoubleVal, /)
+#undef FP_CASE
+
+  DECODED_CASE(Trunc)
+    Slots[In->Dest].IntVal = Slots[In->Ops[0]].IntVal.trunc(In->Imm);
+    DECODED_NEXT();
+
+  DECODED_CASE(ZExt)
+    Slots[In->Dest].IntVal = Slots[In->Ops[0]].IntVal.zext(In->Imm);
+    DECODED_NEXT();
+
+  DECODED_CASE(SExt)
+    Slots[In->Dest].IntVal = Slots[In->Ops[0]].IntVal.sext(In->Imm);
+    DECODED_NEXT();
+
+  DECODED_CASE(Move)
+    Slots[In->Dest] = Slots[In->Ops[0]];
+    DECODED_NEXT();
+
+  DECODED_CASE(Load)
+    LoadValueFromMemory(Slots[In->Dest],
+                        (GenericValue*)GVTOP(Slots[In->Ops[0]]),
+                        In->I->getType());
+    DECODED_NEXT();
+
+  DECODED_CASE(Store)
+    StoreValueToMemory(Slots[In->Ops[0]],
+                       (GenericValue*)GVTOP(Slots[In->Ops[1]]),
+                       In->I->getOperand(0)->getType());
+    DECODED_NEXT();
+
+  DECODED_CASE(GEP) {
+    char *Ptr = (char*)Slots[In->Ops[0]].PointerVal + In->Imm;
+    for (unsigned i = In->Ops[1], e = In->Ops[2]; i != e; ++i) {
+      const std::pair<unsigned, int64_t> &Index = DF.GEPIndices[i];
+      Ptr += Index.second * Slots[Index.first].IntVal.getSExtValue();
+    }
+    Slots[In->Dest].PointerVal = Ptr;
+    DECODED_NEXT();
+  }
+
+  DECODED_CASE(Select)
+    Slots[In->Dest] = Slots[Slots[In->Ops[0]].IntVal.getBoolValue() ?
+                            In->Ops[1] : In->Ops[2]];
+    DECODED_NEXT();
+
+  DECODED_CASE(Br) {
+    const DecodedFunction::Edge &E = DF.Edges[In->Ops[0]];
+    PC = takeEdge(DF, E, Slots, Temporaries);
+    SF.CurBB = E.Dest;
+    noteBackEdge(SF, E.Dest);
+    DECODED_NEXT();
+  }
+
+  DECODED_CASE(CondBr) {
+    unsigned EdgeNo =
+      Slots[In->Ops[0]].IntVal.getBoolValue() ? In->Ops[1] : In->Ops[2];
+    const DecodedFunction::Edge &E = DF.Edges[EdgeNo];
+    PC = takeEdge(DF, E, Slots, Temporaries);
+    SF.CurBB = E.Dest;
+    noteBackEdge(SF, E.Dest);
+    DECODED_NEXT();
+  }
+
+  DECODED_CASE(Ret) {
+    ReturnInst *RI = cast<ReturnInst>(In->I);
+    if (In->Ops[0] == ~0U)
+      popStackAndReturnValueToCaller(Type::getVoidTy(RI->getContext()),
+                                     GenericValue());
+    else
+      popStackAndReturnValueToCaller(RI->getReturnValue()->getType(),
+                                     Slots[In->Ops[0]]);
+    return;
+  }
+  }
+
+#undef DECODED_CASE
+#undef DECODED_NEXT
+}
@@ -38,7 +38,14 @@ static cl::opt<bool> PrintVolatile("interpreter-print-volatile", cl::Hidden,
 //===----------------------------------------------------------------------===//
 
 static void SetValue(Value *V, GenericValue Val, ExecutionContext &SF) {
-  SF.Values[V] = Val;
+  if (SF.Code) {
+    DenseMap<const Value*, unsigned>::const_iterator I =
+      SF.Code->SlotNumbers.find(V);
+    assert(I != SF.Code->SlotNumbers.end() && "Value has no slot!");
+    SF.Slots[I->second] = Val;
+  } else {
+    SF.Values[V] = Val;
+  }
 }
 
 //===----------------------------------------------------------------------===//
@@ -699,6 +706,8 @@ void Interpreter::visitIndirectBrInst(IndirectBrInst &I) {
 // results can happen.  Thus we use a two phase approach.
 //
 void Interpreter::SwitchToNewBasicBlock(BasicBlock *Dest, ExecutionContext &SF){
+  noteBackEdge(SF, Dest);
+
   BasicBlock *PrevBB = SF.CurBB;      // Remember where we came from...
   SF.CurBB   = Dest;                  // Update CurBB to branch destination
   SF.CurInst = SF.CurBB->begin();     // Update new instruction ptr...
@@ -1260,6 +1269,12 @@ GenericValue Interpreter::getConstantExprValue (ConstantExpr *CE,
 }
 
 GenericValue Interpreter::getOperandValue(Value *V, ExecutionContext &SF) {
+  if (SF.Code) {
+    DenseMap<const Value*, unsigned>::iterator I = SF.Code->SlotNumbers.find(V);
+    if (I != SF.Code->SlotNumbers.end())
+      return SF.Slots[I->second];
+  }
+
   if (ConstantExpr *CE = dyn_cast<ConstantExpr>(V)) {
     return getConstantExprValue(CE, SF);
   } else if (Constant *CPV = dyn_cast<Constant>(V)) {
@@ -1287,6 +1302,17 @@ void Interpreter::callFunction(Function *F,
   ECStack.push_back(ExecutionContext());
   ExecutionContext &StackFrame = ECStack.back();
   StackFrame.CurFunction = F;
+  StackFrame.Tier = 0;
+  StackFrame.Code = 0;
+  StackFrame.Slots = 0;
+  StackFrame.SlotBase = 0;
+  if (ECStack.size() > 1) {
+    // Stack the slots of this frame on top of the caller's, if any.
+    const ExecutionContext &CallerSF = ECStack[ECStack.size() - 2];
+    StackFrame.SlotBase = CallerSF.SlotBase;
+    if (CallerSF.Code)
+      StackFrame.SlotBase += CallerSF.Code->NumSlots;
+  }
 
   // Special handling for external functions.
   if (F->isDeclaration()) {
@@ -1296,10 +1322,25 @@ void Interpreter::callFunction(Function *F,
     return;
   }
 
+  // Hot functions run as native code in one of the tiers.
+  if (!Tiers.empty()) {
+    FunctionTierState *TS = getTierState(F);
+    if (callInTier(TS, F, ArgVals))
+      return;
+    StackFrame.Tier = TS;
+  }
+
   // Get pointers to first LLVM BB & Instruction in function.
   StackFrame.CurBB     = F->begin();
   StackFrame.CurInst   = StackFrame.CurBB->begin();
 
+  // Run the function as bytecode if the pre-decoded core is enabled.
+  if (DecodedFunction *Code = getDecodedFunction(F)) {
+    StackFrame.Code = Code;
+    StackFrame.Slots = allocateFrameSlots(StackFrame);
+    StackFrame.PC = 0;
+  }
+
   // Run through the function arguments and initialize their values...
   assert((ArgVals.size() == F->arg_size() ||
          (ArgVals.size() > F->arg_size() && F->getFunctionType()->isVarArg()))&&
@@ -1320,6 +1361,10 @@ void Interpreter::run() {
   while (!ECStack.empty()) {
     // Interpret a single instruction & increment the "PC".
     ExecutionContext &SF = ECStack.back();  // Current stack frame
+    if (SF.Code) {
+      runDecoded(SF);
+      continue;
+    }
     Instruction &I = *SF.CurInst++;         // Increment before execute
 
     // Track the number of dynamic instructions executed.
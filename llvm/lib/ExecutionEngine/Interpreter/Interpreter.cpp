@@ -32,20 +32,21 @@ extern "C" void LLVMLinkInInterpreter() { }
 
 /// create - Create a new interpreter object.  This can never fail.
 ///
-ExecutionEngine *Interpreter::create(Module *M, std::string* ErrStr) {
+ExecutionEngine *Interpreter::create(Module *M, std::string* ErrStr,
+                                     bool UseBytecode) {
   // Tell this Module to materialize everything and release the GVMaterializer.
   if (M->MaterializeAllPermanently(ErrStr))
     // We got an error, just return 0
     return 0;
 
-  return new Interpreter(M);
+  return new Interpreter(M, UseBytecode);
 }
 
 //===----------------------------------------------------------------------===//
 // Interpreter ctor - Initialize stuff
 //
-Interpreter::Interpreter(Module *M)
-  : ExecutionEngine(M), TD(M) {
+Interpreter::Interpreter(Module *M, bool useBytecode)
+  : ExecutionEngine(M), TD(M), ThunkModule(0), UseBytecode(useBytecode) {
       
   memset(&ExitValue.Untyped, 0, sizeof(ExitValue.Untyped));
   setTargetData(&TD);
@@ -58,6 +59,8 @@ Interpreter::Interpreter(Module *M)
 }
 
 Interpreter::~Interpreter() {
+  deleteTiers();
+  deleteDecodedFunctions();
   delete IL;
 }
 
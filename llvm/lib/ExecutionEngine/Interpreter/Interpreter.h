@@ -15,6 +15,8 @@
 #define LLI_INTERPRETER_H
 
 #include "llvm/Function.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/Target/TargetData.h"
@@ -25,8 +27,10 @@
 #include "llvm/Support/raw_ostream.h"
 namespace llvm {
 
+class IntrinsicInst;
 class IntrinsicLowering;
 struct FunctionInfo;
+class StructType;
 template<typename T> class generic_gep_type_iterator;
 class ConstantExpr;
 typedef generic_gep_type_iterator<User::const_op_iterator> gep_type_iterator;
@@ -64,6 +68,64 @@ public:
 
 typedef std::vector<GenericValue> ValuePlaneTy;
 
+// FunctionTierState - Tracks how hot a function is and, once it has moved to
+// one of the interpreter's tiers, how to call the native code.
+//
+struct FunctionTierState {
+  unsigned Count;            // Number of calls plus loop iterations
+  unsigned NextTier;         // Index of the next tier to move to
+  Function *ThunkFn;         // Calls the function with the args in a frame
+  Function *Callee;          // The function as declared next to ThunkFn
+  StructType *FrameTy;       // Arguments followed by the return value
+  void (*Thunk)(void *);     // ThunkFn in the current tier, or null
+  SmallPtrSet<const BasicBlock*, 4> LoopHeaders;
+
+  FunctionTierState()
+    : Count(0), NextTier(0), ThunkFn(0), Callee(0), FrameTy(0), Thunk(0) {}
+};
+
+// DecodedInst - One instruction of the register-based bytecode run by the
+// pre-decoded core.  Operands are slot numbers in the frame, except for
+// branches, which refer to DecodedFunction::Edges.
+//
+struct DecodedInst {
+  unsigned Opcode;           // One of DecodedFunction::Opcode
+  unsigned Dest;             // Slot of the result
+  unsigned Ops[3];           // Slots of the operands, or edge numbers
+  int64_t Imm;               // Predicate, result width or constant offset
+  Instruction *I;            // The instruction, for the generic handlers
+};
+
+// DecodedFunction - A function translated to bytecode, see Bytecode.cpp.
+// Frames hold one slot for every constant, argument and instruction, so
+// values are found by index instead of by looking them up in a map.
+//
+struct DecodedFunction {
+  enum Opcode {
+#define HANDLE_DECODED_OPCODE(Name) Name,
+#include "DecodedOpcodes.def"
+    NumOpcodes
+  };
+
+  // Edge - A control flow edge, with the copies implementing the PHI nodes
+  // at its destination.
+  struct Edge {
+    BasicBlock *Dest;
+    unsigned Target;               // Index of the first non-PHI of Dest
+    unsigned MovesBegin, MovesEnd; // Range of Moves
+    bool NeedsTemporaries;         // A PHI reads another PHI of Dest
+  };
+
+  std::vector<DecodedInst> Insts;
+  std::vector<GenericValue> InitialSlots;  // The constants, in the first slots
+  unsigned NumSlots;                       // Constants, arguments and results
+  DenseMap<const Value*, unsigned> SlotNumbers;
+  DenseMap<const BasicBlock*, unsigned> BlockStarts;
+  std::vector<Edge> Edges;
+  std::vector<std::pair<unsigned, unsigned> > Moves;  // (Dest, Src) slots
+  std::vector<std::pair<unsigned, int64_t> > GEPIndices; // (Slot, Scale)
+};
+
 // ExecutionContext struct - This struct represents one stack frame currently
 // executing.
 //
@@ -76,6 +138,11 @@ struct ExecutionContext {
   CallSite             Caller;     // Holds the call that called subframes.
                                    // NULL if main func or debugger invoked fn
   AllocaHolderHandle    Allocas;    // Track memory allocated by alloca
+  FunctionTierState    *Tier;       // Hotness of CurFunction, if tiering
+  DecodedFunction      *Code;       // Bytecode for CurFunction, or null
+  GenericValue         *Slots;      // Values, when running Code
+  unsigned              SlotBase;   // Index of Slots in FrameSlots
+  unsigned              PC;         // Next instruction of Code to execute
 };
 
 // Interpreter - This class represents the entirety of the interpreter.
@@ -93,8 +160,32 @@ class Interpreter : public ExecutionEngine, public InstVisitor<Interpreter> {
   // registered with the atexit() library function.
   std::vector<Function*> AtExitHandlers;
 
+  // Tiers - The engines hot functions move to, by increasing threshold.
+  struct Tier {
+    ExecutionEngine *EE;
+    unsigned Threshold;
+  };
+  std::vector<Tier> Tiers;
+  std::vector<Module*> SharedModules; // Modules the tiers were created with
+  Module *ThunkModule;                // Holds the thunks, owned by us
+
+  // TierStates - Hotness of every function called since tiering was enabled.
+  DenseMap<Function*, FunctionTierState*> TierStates;
+
+  // UseBytecode - Whether to run functions as bytecode even without
+  // -interpreter-bytecode.
+  bool UseBytecode;
+
+  // DecodedFunctions - Bytecode of the functions run by the pre-decoded core,
+  // or null for the functions it leaves to the visitor.
+  DenseMap<Function*, DecodedFunction*> DecodedFunctions;
+
+  // FrameSlots - The slots of the frames running bytecode, stacked like
+  // ECStack.  It only grows, so that calls don't allocate.
+  std::vector<GenericValue> FrameSlots;
+
 public:
-  explicit Interpreter(Module *M);
+  explicit Interpreter(Module *M, bool UseBytecode = false);
   ~Interpreter();
 
   /// runAtExitHandlers - Run any functions registered by the program's calls to
@@ -107,8 +198,11 @@ public:
   }
   
   /// create - Create an interpreter ExecutionEngine. This can never fail.
+  /// With UseBytecode, functions are translated to bytecode before they are
+  /// run, as with -interpreter-bytecode.
   ///
-  static ExecutionEngine *create(Module *M, std::string *ErrorStr = 0);
+  static ExecutionEngine *create(Module *M, std::string *ErrorStr = 0,
+                                 bool UseBytecode = false);
 
   /// run - Start execution with the specified function and arguments.
   ///
@@ -126,6 +220,11 @@ public:
   ///
   void freeMachineCodeForFunction(Function *F) { }
 
+  /// addTier - Run functions with EE once they are hot.  Fails if EE lays
+  /// out memory differently from the interpreter.
+  ///
+  virtual bool addTier(ExecutionEngine *EE, unsigned Threshold);
+
   // Methods used to execute code:
   // Place a call on the stack
   void callFunction(Function *F, const std::vector<GenericValue> &ArgVals);
@@ -200,6 +299,25 @@ private:  // Helper functions
   //
   void SwitchToNewBasicBlock(BasicBlock *Dest, ExecutionContext &SF);
 
+  // Pre-decoded core, see Bytecode.cpp.
+  DecodedFunction *getDecodedFunction(Function *F);
+  DecodedFunction *decodeFunction(Function *F);
+  void deleteDecodedFunctions();
+  GenericValue *allocateFrameSlots(ExecutionContext &SF);
+  GenericValue executeIntrinsic(IntrinsicInst &II, ExecutionContext &SF);
+  void runDecoded(ExecutionContext &SF);
+
+  // Tiering support, see Tiering.cpp.
+  void deleteTiers();
+  FunctionTierState *getTierState(Function *F);
+  bool callInTier(FunctionTierState *TS, Function *F,
+                  const std::vector<GenericValue> &ArgVals);
+  void moveToNextTier(FunctionTierState *TS, Function *F);
+  void noteBackEdge(ExecutionContext &SF, BasicBlock *Dest) {
+    if (SF.Tier && SF.Tier->LoopHeaders.count(Dest))
+      ++SF.Tier->Count;
+  }
+
   void *getPointerToFunction(Function *F) { return (void*)F; }
   void *getPointerToBasicBlock(BasicBlock *BB) { return (void*)BB; }
 
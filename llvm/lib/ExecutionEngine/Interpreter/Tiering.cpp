@@ -0,0 +1,280 @@
+//===-- Tiering.cpp - Move hot functions out of the interpreter -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements tiered execution: every function starts out in the
+// interpreter, which counts how often it is called and how many loop
+// iterations it runs.  Once a function crosses the threshold of a tier, the
+// next call runs it as native code generated by that tier's engine, and once
+// it crosses the threshold of a later tier the code of the earlier one is
+// redirected to the new code.  A function that is in the middle of being
+// interpreted keeps being interpreted; only its next call moves.
+//
+// The interpreter represents a pointer to a function as the Function* itself,
+// so only functions that never call through a pointer and never take the
+// address of a function, and whose callees do the same, can be moved.  Those
+// can share the global variables and the heap with the interpreter freely.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "interpreter"
+#include "Interpreter.h"
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Instructions.h"
+#include "llvm/Intrinsics.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/IRBuilder.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetData.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+using namespace llvm;
+
+STATISTIC(NumTierMoves, "Number of times a function moved to a higher tier");
+STATISTIC(NumNativeCalls, "Number of calls run as native code");
+
+bool Interpreter::addTier(ExecutionEngine *EE, unsigned Threshold) {
+  // Native code and the interpreter access the same memory, so they must
+  // agree on where everything is.
+  if (EE->getTargetData()->getStringRepresentation() !=
+      TD.getStringRepresentation())
+    return false;
+
+  if (SharedModules.empty()) {
+    SharedModules.assign(Modules.begin(), Modules.end());
+    // The thunks go in a module of their own rather than in the user's.
+    Module *M = SharedModules[0];
+    ThunkModule = new Module("tiering thunks", M->getContext());
+    ThunkModule->setDataLayout(M->getDataLayout());
+    ThunkModule->setTargetTriple(M->getTargetTriple());
+  }
+  for (unsigned i = 0, e = SharedModules.size(); i != e; ++i) {
+    Module *M = SharedModules[i];
+    for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+         I != E; ++I)
+      if (void *Addr = getPointerToGlobalIfAvailable(I))
+        EE->addGlobalMapping(I, Addr);
+  }
+
+  EE->addModule(ThunkModule);
+
+  Tier T;
+  T.EE = EE;
+  T.Threshold = Threshold;
+  std::vector<Tier>::iterator I = Tiers.begin();
+  while (I != Tiers.end() && I->Threshold <= Threshold)
+    ++I;
+  Tiers.insert(I, T);
+  return true;
+}
+
+/// deleteTiers - Delete the tiers, which share the modules of the interpreter,
+/// and the thunks.
+void Interpreter::deleteTiers() {
+  for (unsigned i = 0, e = Tiers.size(); i != e; ++i) {
+    for (unsigned m = 0, me = SharedModules.size(); m != me; ++m)
+      Tiers[i].EE->removeModule(SharedModules[m]);
+    Tiers[i].EE->removeModule(ThunkModule);
+    delete Tiers[i].EE;
+  }
+  Tiers.clear();
+  delete ThunkModule;
+  ThunkModule = 0;
+
+  for (DenseMap<Function*, FunctionTierState*>::iterator I = TierStates.begin(),
+       E = TierStates.end(); I != E; ++I)
+    delete I->second;
+  TierStates.clear();
+}
+
+FunctionTierState *Interpreter::getTierState(Function *F) {
+  FunctionTierState *&TS = TierStates[F];
+  if (!TS) {
+    TS = new FunctionTierState();
+    SmallVector<std::pair<const BasicBlock*, const BasicBlock*>, 8> Edges;
+    FindFunctionBackedges(*F, Edges);
+    for (unsigned i = 0, e = Edges.size(); i != e; ++i)
+      TS->LoopHeaders.insert(Edges[i].second);
+  }
+  return TS;
+}
+
+/// referencesFunction - Return true if the value of C depends on the address
+/// of a function or a basic block.
+static bool referencesFunction(Constant *C) {
+  if (isa<Function>(C) || isa<BlockAddress>(C))
+    return true;
+  if (isa<GlobalValue>(C))
+    return false;
+  for (User::op_iterator I = C->op_begin(), E = C->op_end(); I != E; ++I)
+    if (referencesFunction(cast<Constant>(I->get())))
+      return true;
+  return false;
+}
+
+/// canRunNatively - Return true if F and everything it calls can run as
+/// native code next to the interpreter.
+static bool canRunNatively(Function *F) {
+  // The frame only knows how to pass these.
+  FunctionType *FTy = F->getFunctionType();
+  for (unsigned i = 0, e = FTy->getNumParams() + 1; i != e; ++i) {
+    Type *Ty = i == 0 ? FTy->getReturnType() : FTy->getParamType(i - 1);
+    if (!Ty->isIntegerTy() && !Ty->isFloatTy() && !Ty->isDoubleTy() &&
+        !Ty->isPointerTy() && !(i == 0 && Ty->isVoidTy()))
+      return false;
+  }
+
+  SmallPtrSet<Function*, 16> Visited;
+  SmallVector<Function*, 16> Worklist;
+  Visited.insert(F);
+  Worklist.push_back(F);
+  while (!Worklist.empty()) {
+    Function *Fn = Worklist.pop_back_val();
+    if (Fn->isDeclaration()) {
+      // The interpreter has to see these to run the atexit handlers and to
+      // implement the variable argument intrinsics.
+      StringRef Name = Fn->getName();
+      if (Name == "exit" || Name == "_exit" || Name == "abort" ||
+          Name == "atexit")
+        return false;
+      switch (Fn->getIntrinsicID()) {
+      case Intrinsic::vastart:
+      case Intrinsic::vaend:
+      case Intrinsic::vacopy:
+        return false;
+      default:
+        break;
+      }
+      continue;
+    }
+    if (Fn->isVarArg())
+      return false;
+
+    for (Function::iterator BB = Fn->begin(), BE = Fn->end(); BB != BE; ++BB)
+      for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I) {
+        if (isa<InvokeInst>(I) || isa<UnwindInst>(I) || isa<VAArgInst>(I) ||
+            isa<IndirectBrInst>(I))
+          return false;
+
+        unsigned NumOperands = I->getNumOperands();
+        if (CallInst *CI = dyn_cast<CallInst>(I)) {
+          Function *Callee = CI->getCalledFunction();
+          if (!Callee)
+            return false;
+          if (Visited.insert(Callee))
+            Worklist.push_back(Callee);
+          NumOperands = CI->getNumArgOperands();
+        }
+        for (unsigned i = 0; i != NumOperands; ++i)
+          if (Constant *C = dyn_cast<Constant>(I->getOperand(i)))
+            if (referencesFunction(C))
+              return false;
+      }
+  }
+  return true;
+}
+
+/// createThunk - Create "void F.native(i8* Frame)" in ThunkModule, which
+/// calls F with the arguments stored in Frame and stores the result after
+/// them.  It calls F through the declaration Callee, which is added to
+/// ThunkModule along with it.
+static Function *createThunk(Function *F, Module *ThunkModule,
+                             StructType *&FrameTy, Function *&Callee) {
+  LLVMContext &Context = F->getContext();
+  FunctionType *FTy = F->getFunctionType();
+  std::vector<Type*> Fields(FTy->param_begin(), FTy->param_end());
+  if (!FTy->getReturnType()->isVoidTy())
+    Fields.push_back(FTy->getReturnType());
+  FrameTy = StructType::get(Context, Fields);
+
+  Callee = Function::Create(FTy, GlobalValue::ExternalLinkage, F->getName(),
+                            ThunkModule);
+  Callee->setCallingConv(F->getCallingConv());
+  Callee->setAttributes(F->getAttributes());
+
+  FunctionType *ThunkTy = FunctionType::get(Type::getVoidTy(Context),
+                                            Type::getInt8PtrTy(Context),
+                                            false);
+  Function *Thunk = Function::Create(ThunkTy, GlobalValue::InternalLinkage,
+                                     F->getName() + ".native", ThunkModule);
+  IRBuilder<> Builder(BasicBlock::Create(Context, "entry", Thunk));
+  Value *Frame = Builder.CreateBitCast(Thunk->arg_begin(),
+                                       PointerType::getUnqual(FrameTy));
+  SmallVector<Value*, 8> Args;
+  for (unsigned i = 0, e = FTy->getNumParams(); i != e; ++i)
+    Args.push_back(Builder.CreateLoad(Builder.CreateStructGEP(Frame, i)));
+  CallInst *Call = Builder.CreateCall(Callee, Args);
+  Call->setCallingConv(F->getCallingConv());
+  if (!FTy->getReturnType()->isVoidTy())
+    Builder.CreateStore(Call,
+                        Builder.CreateStructGEP(Frame, FTy->getNumParams()));
+  Builder.CreateRetVoid();
+  return Thunk;
+}
+
+void Interpreter::moveToNextTier(FunctionTierState *TS, Function *F) {
+  if (!TS->ThunkFn) {
+    if (!canRunNatively(F)) {
+      DEBUG(dbgs() << "Keeping " << F->getName() << " in the interpreter\n");
+      TS->NextTier = Tiers.size();
+      return;
+    }
+    TS->ThunkFn = createThunk(F, ThunkModule, TS->FrameTy, TS->Callee);
+  }
+
+  DEBUG(dbgs() << "Moving " << F->getName() << " to tier "
+               << TS->NextTier + 1 << '\n');
+  ExecutionEngine *EE = Tiers[TS->NextTier].EE;
+  void *Code = EE->getPointerToFunction(F);
+  if (TS->NextTier != 0)
+    Tiers[TS->NextTier - 1].EE->redirectFunction(F, Code);
+  // Only this engine knows where it put F, so tell it what the thunk calls.
+  EE->addGlobalMapping(TS->Callee, Code);
+  TS->Thunk = (void(*)(void*))(intptr_t)EE->getPointerToFunction(TS->ThunkFn);
+  ++TS->NextTier;
+  ++NumTierMoves;
+}
+
+/// callInTier - Count a call to F, and run it as native code if it is hot
+/// enough.  Returns false if F should be interpreted.
+bool Interpreter::callInTier(FunctionTierState *TS, Function *F,
+                             const std::vector<GenericValue> &ArgVals) {
+  ++TS->Count;
+  if (TS->NextTier != Tiers.size() &&
+      TS->Count >= Tiers[TS->NextTier].Threshold)
+    moveToNextTier(TS, F);
+  if (!TS->Thunk)
+    return false;
+
+  // Lay out the arguments as the thunk expects them.  Doubles are the most
+  // strictly aligned fields a frame can have.
+  const StructLayout *SL = TD.getStructLayout(TS->FrameTy);
+  SmallVector<double, 8> Storage((SL->getSizeInBytes() + 7) / 8 + 1);
+  char *Frame = reinterpret_cast<char*>(&Storage[0]);
+  FunctionType *FTy = F->getFunctionType();
+  unsigned NumParams = FTy->getNumParams();
+  for (unsigned i = 0; i != NumParams; ++i)
+    StoreValueToMemory(ArgVals[i],
+                       (GenericValue*)(Frame + SL->getElementOffset(i)),
+                       FTy->getParamType(i));
+
+  ++NumNativeCalls;
+  TS->Thunk(Frame);
+
+  GenericValue Result;
+  Type *RetTy = FTy->getReturnType();
+  if (!RetTy->isVoidTy()) {
+    char *ResultPtr = Frame + SL->getElementOffset(NumParams);
+    LoadValueFromMemory(Result, (GenericValue*)ResultPtr, RetTy);
+  }
+  popStackAndReturnValueToCaller(RetTy, Result);
+  return true;
+}
@@ -30,6 +30,7 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Config/config.h"
 
@@ -269,7 +270,8 @@ extern "C" {
 JIT::JIT(Module *M, TargetMachine &tm, TargetJITInfo &tji,
          JITMemoryManager *JMM, bool GVsWithCode)
   : ExecutionEngine(M), TM(tm), TJI(tji), AllocateGVsWithCode(GVsWithCode),
-    isAlreadyCodeGenerating(false) {
+    isAlreadyCodeGenerating(false), BackgroundCompiles(0),
+    BackgroundCompileScheduled(false) {
   setTargetData(TM.getTargetData());
 
   jitstate = new JITState(M);
@@ -316,6 +318,11 @@ JIT::JIT(Module *M, TargetMachine &tm, TargetJITInfo &tji,
 }
 
 JIT::~JIT() {
+  // Stop the background compiler before tearing down what it uses.
+  if (BackgroundCompiles) {
+    BackgroundCompiles->cancel();
+    delete BackgroundCompiles;
+  }
   // Unregister all exception tables registered by this JIT.
   DeregisterAllTables();
   // Cleanup.
@@ -816,5 +823,63 @@ void JIT::addPendingFunction(Function *F) {
   jitstate->getPendingFunctions(locked).push_back(F);
 }
 
+void JIT::addBackgroundFunction(Function *F) {
+  MutexGuard locked(lock);
+  if (!BackgroundCompiles) {
+    // A pool without worker threads would run the compile as soon as it is
+    // spawned, in the middle of compiling the caller.  Compile lazily then.
+    ThreadPool *Pool = getBackgroundThreadPool();
+    if (!Pool)
+      Pool = &ThreadPool::getGlobalPool();
+    if (Pool->getNumThreads() == 0) {
+      EnableBackgroundCompilation(false);
+      return;
+    }
+    BackgroundCompiles = new TaskGroup(*Pool);
+  }
+
+  jitstate->getBackgroundFunctions(locked).push_back(F);
+  if (!BackgroundCompileScheduled) {
+    BackgroundCompileScheduled = true;
+    BackgroundCompiles->spawn(runBackgroundCompiles, this);
+  }
+}
+
+void JIT::waitForBackgroundCompilation() {
+  TaskGroup *Group;
+  {
+    MutexGuard locked(lock);
+    Group = BackgroundCompiles;
+  }
+  // The background task takes the lock for every function, so wait without
+  // holding it.
+  if (Group)
+    Group->wait();
+}
+
+/// runBackgroundCompiles - Compile the queued functions one at a time.  The
+/// JIT lock is released in between so that other threads get to compile the
+/// functions they need right away.
+void JIT::runBackgroundCompiles(void *TheJIT) {
+  JIT *J = static_cast<JIT*>(TheJIT);
+  while (!J->BackgroundCompiles->isCancelled()) {
+    MutexGuard locked(J->lock);
+    if (!J->jitstate || J->jitstate->getBackgroundFunctions(locked).empty()) {
+      J->BackgroundCompileScheduled = false;
+      return;
+    }
+
+    std::deque<AssertingVH<Function> > &Queue =
+      J->jitstate->getBackgroundFunctions(locked);
+    Function *F = Queue.front();
+    Queue.pop_front();
+
+    // This does nothing if another thread called the stub and compiled F in
+    // the meantime.
+    J->getPointerToFunction(F);
+    J->redirectFunctionStub(F);
+  }
+}
+
 
 JITEventListener::~JITEventListener() {}
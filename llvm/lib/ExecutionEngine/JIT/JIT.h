@@ -17,6 +17,7 @@
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/PassManager.h"
 #include "llvm/Support/ValueHandle.h"
+#include <deque>
 
 namespace llvm {
 
@@ -26,6 +27,7 @@ class MachineCodeEmitter;
 class MachineCodeInfo;
 class TargetJITInfo;
 class TargetMachine;
+class TaskGroup;
 
 class JITState {
 private:
@@ -36,6 +38,10 @@ private:
   /// were called from a function being code generated.
   std::vector<AssertingVH<Function> > PendingFunctions;
 
+  /// BackgroundFunctions - Functions with a lazy stub waiting to be compiled
+  /// by the background compiler, in the order their stubs were created.
+  std::deque<AssertingVH<Function> > BackgroundFunctions;
+
 public:
   explicit JITState(Module *M) : PM(M), M(M) {}
 
@@ -47,6 +53,10 @@ public:
   std::vector<AssertingVH<Function> > &getPendingFunctions(const MutexGuard &L){
     return PendingFunctions;
   }
+  std::deque<AssertingVH<Function> > &
+  getBackgroundFunctions(const MutexGuard &L) {
+    return BackgroundFunctions;
+  }
 };
 
 
@@ -76,6 +86,14 @@ class JIT : public ExecutionEngine {
   /// taken.
   BasicBlockAddressMapTy BasicBlockAddressMap;
 
+  /// BackgroundCompiles - The task compiling the functions queued with
+  /// addBackgroundFunction on the background thread pool, created on first
+  /// use.
+  /// At most one task, which drains the queue, is scheduled at a time, so
+  /// background compilation occupies a single worker.
+  TaskGroup *BackgroundCompiles;
+  bool BackgroundCompileScheduled;
+
 
   JIT(Module *M, TargetMachine &tm, TargetJITInfo &tji,
       JITMemoryManager *JMM, bool AllocateGVsWithCode);
@@ -171,12 +189,25 @@ public:
   ///
   void freeMachineCodeForFunction(Function *F);
 
+  /// redirectFunction - Make calls to F go to NewAddr.  Fails if F has a lazy
+  /// stub the target cannot patch atomically.
+  ///
+  virtual bool redirectFunction(Function *F, void *NewAddr);
+
   /// addPendingFunction - while jitting non-lazily, a called but non-codegen'd
   /// function was encountered.  Add it to a pending list to be processed after
   /// the current function.
   ///
   void addPendingFunction(Function *F);
 
+  /// addBackgroundFunction - while jitting lazily with background compilation
+  /// enabled, a lazy stub was created for F.  Queue F to be compiled on the
+  /// background thread, which redirects the stub once it is done.
+  ///
+  void addBackgroundFunction(Function *F);
+
+  virtual void waitForBackgroundCompilation();
+
   /// getCodeEmitter - Return the code emitter this JIT is emitting into.
   ///
   JITCodeEmitter *getCodeEmitter() const { return JCE; }
@@ -211,7 +242,9 @@ private:
                                        TargetMachine &tm);
   void runJITOnFunctionUnlocked(Function *F, const MutexGuard &locked);
   void updateFunctionStub(Function *F);
+  void redirectFunctionStub(Function *F);
   void jitTheFunction(Function *F, const MutexGuard &locked);
+  static void runBackgroundCompiles(void *TheJIT);
 
 protected:
 
@@ -575,6 +575,12 @@ void *JITResolver::getLazyFunctionStub(Function *F) {
     // Finally, keep track of the stub-to-Function mapping so that the
     // JITCompilerFn knows which function to compile!
     state.AddCallSite(locked, Stub, F);
+
+    // Start compiling the function right away if asked to, so that its code
+    // is likely ready by the time it is first called.
+    if (TheJIT->isCompilingInBackground() &&
+        Actual == (void*)(intptr_t)LazyResolverFn)
+      TheJIT->addBackgroundFunction(F);
   } else if (!Actual) {
     // If we are JIT'ing non-lazily but need to call a function that does not
     // exist yet, add it to the JIT's work list so that we can fill in the
@@ -1302,9 +1308,50 @@ void JIT::updateFunctionStub(Function *F) {
   JE->finishGVStub();
 }
 
+/// redirectFunctionStub - Point the lazy stub of F, if there is one, at the
+/// compiled code of F, so that callers stop entering the JIT.  Other threads
+/// may be calling the stub, so this only happens if the target can patch it
+/// atomically.  Otherwise the stub keeps going through JITCompilerFn, which
+/// finds the code ready.
+void JIT::redirectFunctionStub(Function *F) {
+  assert(isa<JITEmitter>(JCE) && "Unexpected MCE?");
+  JITEmitter *JE = cast<JITEmitter>(getCodeEmitter());
+  void *Stub = JE->getJITResolver().getLazyFunctionStubIfAvailable(F);
+  void *Addr = getPointerToGlobalIfAvailable(F);
+  if (Stub && Addr && Stub != Addr)
+    getJITInfo().patchFunctionStub(Stub, Addr);
+}
+
+/// redirectFunction - Send calls to F, through its lazy stub or into code
+/// already generated for it, to NewAddr instead.
+bool JIT::redirectFunction(Function *F, void *NewAddr) {
+  MutexGuard locked(lock);
+  assert(isa<JITEmitter>(JCE) && "Unexpected MCE?");
+  JITEmitter *JE = cast<JITEmitter>(getCodeEmitter());
+  void *Stub = JE->getJITResolver().getLazyFunctionStubIfAvailable(F);
+  void *OldAddr = getPointerToGlobalIfAvailable(F);
+  if (Stub && !getJITInfo().patchFunctionStub(Stub, NewAddr))
+    return false;
+  if (OldAddr && OldAddr != Stub)
+    getJITInfo().replaceMachineCodeForFunction(OldAddr, NewAddr);
+  updateGlobalMapping(F, NewAddr);
+  return true;
+}
+
 /// freeMachineCodeForFunction - release machine code memory for given Function.
 ///
 void JIT::freeMachineCodeForFunction(Function *F) {
+  // Don't let the background compiler bring the code back, nor hold on to F
+  // after it is deleted.
+  {
+    MutexGuard locked(lock);
+    if (jitstate) {
+      std::deque<AssertingVH<Function> > &Queue =
+        jitstate->getBackgroundFunctions(locked);
+      Queue.erase(std::remove(Queue.begin(), Queue.end(), F), Queue.end());
+    }
+  }
+
   // Delete translation for this from the ExecutionEngine, so it will get
   // retranslated next time it is used.
   updateGlobalMapping(F, 0);
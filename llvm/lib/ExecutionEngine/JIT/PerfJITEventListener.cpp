@@ -0,0 +1,261 @@
+//===-- PerfJITEventListener.cpp - Tell Linux perf about JITted code ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a JITEventListener object that describes JITted functions
+// to the Linux perf tool.  Every function gets a line in /tmp/perf-<pid>.map,
+// which "perf report" uses to name samples in anonymous memory.  Optionally,
+// the functions are also written to a jitdump file, together with their code
+// and line tables, which "perf inject --jit" turns into ELF images that can be
+// annotated.
+//
+// See tools/perf/Documentation/jit-interface.txt and jitdump-specification.txt
+// in the Linux sources for the definition of the formats.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "perf-jit-event-listener"
+#include "llvm/Function.h"
+#include "llvm/Metadata.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Analysis/DebugInfo.h"
+#include "llvm/ExecutionEngine/JITEventListener.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/ELF.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/raw_ostream.h"
+using namespace llvm;
+
+#if defined(__linux__)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+// Record types and sizes of the jitdump format.
+enum {
+  JITDumpMagic = 0x4A695444,   // "JiTD"
+  JITDumpVersion = 1,
+  JITDumpHeaderSize = 40,
+  JITDumpRecordHeaderSize = 16,
+
+  JIT_CODE_LOAD = 0,
+  JIT_CODE_DEBUG_INFO = 2,
+  JIT_CODE_CLOSE = 3
+};
+
+class PerfJITEventListener : public JITEventListener {
+  sys::Mutex Lock;
+  OwningPtr<raw_fd_ostream> PerfMap;
+  OwningPtr<raw_fd_ostream> JITDump;
+  void *JITDumpMarker;
+  uint64_t CodeIndex;
+
+  void openJITDump(StringRef Dir);
+  void writeDebugInfo(const Function &F, void *FnStart,
+                      const EmittedFunctionDetails &Details);
+  void writeCodeLoad(StringRef Name, void *FnStart, size_t FnSize);
+  void writeRecordHeader(uint32_t Id, uint32_t Size);
+  void write32(uint32_t V) { JITDump->write((const char*)&V, sizeof(V)); }
+  void write64(uint64_t V) { JITDump->write((const char*)&V, sizeof(V)); }
+  void writeString(StringRef S) { *JITDump << S << '\0'; }
+
+public:
+  explicit PerfJITEventListener(StringRef JITDumpDir);
+  ~PerfJITEventListener();
+
+  virtual void NotifyFunctionEmitted(const Function &F,
+                                     void *FnStart, size_t FnSize,
+                                     const EmittedFunctionDetails &Details);
+};
+
+/// getTimestamp - Return the time in nanoseconds on the clock perf uses for
+/// jitdump files recorded with "perf record -k mono".
+static uint64_t getTimestamp() {
+  struct timespec TS;
+  if (clock_gettime(CLOCK_MONOTONIC, &TS))
+    return 0;
+  return uint64_t(TS.tv_sec) * 1000000000 + TS.tv_nsec;
+}
+
+/// getHostELFMachine - Return the e_machine of the code the JIT emits.
+static uint32_t getHostELFMachine() {
+#if defined(__x86_64__)
+  return ELF::EM_X86_64;
+#elif defined(__i386__)
+  return ELF::EM_386;
+#elif defined(__arm__)
+  return ELF::EM_ARM;
+#elif defined(__powerpc64__)
+  return ELF::EM_PPC64;
+#elif defined(__powerpc__)
+  return ELF::EM_PPC;
+#else
+  return ELF::EM_NONE;
+#endif
+}
+
+PerfJITEventListener::PerfJITEventListener(StringRef JITDumpDir)
+    : JITDumpMarker(0), CodeIndex(0) {
+  SmallString<32> MapName;
+  raw_svector_ostream(MapName) << "/tmp/perf-" << getpid() << ".map";
+  // Append, so that several listeners in one process, or other runtimes
+  // writing their own symbols, don't wipe out each other's entries.
+  std::string ErrorInfo;
+  PerfMap.reset(new raw_fd_ostream(MapName.c_str(), ErrorInfo,
+                                   raw_fd_ostream::F_Append));
+  if (!ErrorInfo.empty()) {
+    DEBUG(dbgs() << "Failed to open " << MapName << ": " << ErrorInfo << "\n");
+    PerfMap.reset();
+  }
+
+  if (!JITDumpDir.empty())
+    openJITDump(JITDumpDir);
+}
+
+void PerfJITEventListener::openJITDump(StringRef Dir) {
+  SmallString<128> DumpName(Dir);
+  raw_svector_ostream(DumpName) << "/jit-" << getpid() << ".dump";
+  int FD = open(DumpName.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0666);
+  if (FD < 0) {
+    DEBUG(dbgs() << "Failed to open " << DumpName << "\n");
+    return;
+  }
+
+  // perf finds the jitdump file through this mapping of it, which shows up as
+  // an executable mmap event in the recording.
+  void *Marker = mmap(0, sysconf(_SC_PAGESIZE), PROT_READ | PROT_EXEC,
+                      MAP_PRIVATE, FD, 0);
+  if (Marker == MAP_FAILED) {
+    DEBUG(dbgs() << "Failed to map " << DumpName << "\n");
+    close(FD);
+    return;
+  }
+  JITDumpMarker = Marker;
+  JITDump.reset(new raw_fd_ostream(FD, /*shouldClose=*/true));
+
+  write32(JITDumpMagic);
+  write32(JITDumpVersion);
+  write32(JITDumpHeaderSize);
+  write32(getHostELFMachine());
+  write32(0);                           // Padding
+  write32(getpid());
+  write64(getTimestamp());
+  write64(0);                           // Flags
+  JITDump->flush();
+}
+
+PerfJITEventListener::~PerfJITEventListener() {
+  if (JITDump) {
+    writeRecordHeader(JIT_CODE_CLOSE, JITDumpRecordHeaderSize);
+    JITDump.reset();
+    munmap(JITDumpMarker, sysconf(_SC_PAGESIZE));
+  }
+}
+
+void PerfJITEventListener::writeRecordHeader(uint32_t Id, uint32_t Size) {
+  write32(Id);
+  write32(Size);
+  write64(getTimestamp());
+}
+
+void PerfJITEventListener::writeCodeLoad(StringRef Name, void *FnStart,
+                                         size_t FnSize) {
+  uint32_t Size = JITDumpRecordHeaderSize + 2 * 4 + 4 * 8 + Name.size() + 1 +
+                  FnSize;
+  writeRecordHeader(JIT_CODE_LOAD, Size);
+  write32(getpid());
+  write32(syscall(SYS_gettid));
+  write64((uintptr_t)FnStart);          // Virtual address
+  write64((uintptr_t)FnStart);          // Code address
+  write64(FnSize);
+  write64(CodeIndex++);
+  writeString(Name);
+  JITDump->write((const char*)FnStart, FnSize);
+}
+
+void PerfJITEventListener::writeDebugInfo(
+    const Function &F, void *FnStart, const EmittedFunctionDetails &Details) {
+  typedef std::vector<EmittedFunctionDetails::LineStart> LineStartsTy;
+  const LineStartsTy &Lines = Details.LineStarts;
+
+  // Filenames are cached per scope, as most line starts share a few scopes.
+  DenseMap<MDNode*, std::string> Filenames;
+  uint32_t Size = JITDumpRecordHeaderSize + 2 * 8;
+  for (LineStartsTy::const_iterator I = Lines.begin(), E = Lines.end();
+       I != E; ++I) {
+    std::string &Filename = Filenames[I->Loc.getScope(F.getContext())];
+    if (Filename.empty())
+      Filename = DIScope(I->Loc.getScope(F.getContext())).getFilename();
+    Size += 8 + 2 * 4 + Filename.size() + 1;
+  }
+
+  writeRecordHeader(JIT_CODE_DEBUG_INFO, Size);
+  write64((uintptr_t)FnStart);
+  write64(Lines.size());
+  for (LineStartsTy::const_iterator I = Lines.begin(), E = Lines.end();
+       I != E; ++I) {
+    write64(I->Address);
+    write32(I->Loc.getLine());
+    write32(0);                         // Discriminator
+    writeString(Filenames[I->Loc.getScope(F.getContext())]);
+  }
+}
+
+// Describes the just-emitted function to perf.
+void PerfJITEventListener::NotifyFunctionEmitted(
+    const Function &F, void *FnStart, size_t FnSize,
+    const EmittedFunctionDetails &Details) {
+  assert(F.hasName() && FnStart != 0 && "Bad symbol to add");
+  StringRef Name = F.getName();
+  if (Name[0] == '\1')
+    Name = Name.substr(1);
+
+  MutexGuard locked(Lock);
+  if (PerfMap) {
+    *PerfMap << format("%lx %lx ", (unsigned long)(uintptr_t)FnStart,
+                       (unsigned long)FnSize)
+             << Name << '\n';
+    PerfMap->flush();
+  }
+
+  if (JITDump) {
+    // The line table has to precede the code it describes.
+    if (!Details.LineStarts.empty())
+      writeDebugInfo(F, FnStart, Details);
+    writeCodeLoad(Name, FnStart, FnSize);
+    JITDump->flush();
+  }
+}
+
+}  // anonymous namespace.
+
+namespace llvm {
+JITEventListener *createPerfJITEventListener(StringRef JITDumpDir) {
+  return new PerfJITEventListener(JITDumpDir);
+}
+}
+
+#else  // defined(__linux__)
+
+namespace llvm {
+// perf only runs on Linux; let clients call this unconditionally elsewhere.
+JITEventListener *createPerfJITEventListener(StringRef JITDumpDir) {
+  return NULL;
+}
+}  // namespace llvm
+
+#endif  // defined(__linux__)
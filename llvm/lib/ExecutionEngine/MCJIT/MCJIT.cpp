@@ -11,14 +11,22 @@
 #include "MCJITMemoryManager.h"
 #include "llvm/DerivedTypes.h"
 #include "llvm/Function.h"
+#include "llvm/Module.h"
+#include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/JITMemoryManager.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/ADT/OwningPtr.h"
 #include "llvm/MC/MCAsmInfo.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/SHA256.h"
 #include "llvm/Target/TargetData.h"
+#include <algorithm>
 
 using namespace llvm;
 
@@ -45,7 +53,9 @@ ExecutionEngine *MCJIT::createJIT(Module *M,
 
   // If the target supports JIT code generation, create the JIT.
   if (TargetJITInfo *TJ = TM->getJITInfo())
-    return new MCJIT(M, TM, *TJ, new MCJITMemoryManager(JMM, M), GVsWithCode);
+    return new MCJIT(M, TM, *TJ,
+                     JMM ? JMM : JITMemoryManager::CreateDefaultMemManager(),
+                     GVsWithCode);
 
   if (ErrorStr)
     *ErrorStr = "target does not support JIT code generation";
@@ -53,8 +63,9 @@ ExecutionEngine *MCJIT::createJIT(Module *M,
 }
 
 MCJIT::MCJIT(Module *m, TargetMachine *tm, TargetJITInfo &tji,
-             RTDyldMemoryManager *MM, bool AllocateGVsWithCode)
-  : ExecutionEngine(m), TM(tm), MemMgr(MM), M(m), OS(Buffer), Dyld(MM) {
+             JITMemoryManager *JMM, bool AllocateGVsWithCode)
+  : ExecutionEngine(m), TM(tm), MemMgr(new MCJITMemoryManager(JMM, m, this)),
+    M(m), OS(Buffer), Dyld(MemMgr), ObjCache(0), IsLoaded(false) {
 
   setTargetData(TM->getTargetData());
   PM.add(new TargetData(*TM->getTargetData()));
@@ -65,22 +76,116 @@ MCJIT::MCJIT(Module *m, TargetMachine *tm, TargetJITInfo &tji,
     report_fatal_error("Target does not support MC emission!");
   }
 
-  // Initialize passes.
-  // FIXME: When we support multiple modules, we'll want to move the code
-  // gen and finalization out of the constructor here and do it more
-  // on-demand as part of getPointerToFunction().
+  // Code generation is deferred to the first getPointerToFunction() call, so
+  // that clients get a chance to set an object cache first.
+}
+
+MemoryBuffer *MCJIT::emitObject(Module *M) {
+  Buffer.clear();
   PM.run(*M);
   // Flush the output buffer so the SmallVector gets its data.
   OS.flush();
 
-  // Load the object into the dynamic linker.
   // FIXME: It would be nice to avoid making yet another copy.
-  MemoryBuffer *MB = MemoryBuffer::getMemBufferCopy(StringRef(Buffer.data(),
-                                                              Buffer.size()));
+  return MemoryBuffer::getMemBufferCopy(StringRef(Buffer.data(),
+                                                  Buffer.size()));
+}
+
+std::string MCJIT::getCacheKey(Module *M) const {
+  // The key covers the module itself and everything about the target that
+  // changes the code generated for it.
+  SmallVector<char, 4096> Bytes;
+  raw_svector_ostream Out(Bytes);
+  WriteBitcodeToFile(M, Out);
+  Out << '\0' << TM->getTargetTriple()
+      << '\0' << TM->getTargetCPU()
+      << '\0' << TM->getTargetFeatureString()
+      << '\0' << unsigned(TM->getRelocationModel())
+      << '\0' << unsigned(TM->getCodeModel())
+      << '\0' << unsigned(TM->getOptLevel());
+
+  // Objects are loaded and run on the strength of the key alone, so it is a
+  // cryptographic digest rather than a hash two modules could end up sharing.
+  return SHA256::hashToHex(Out.str());
+}
+
+void MCJIT::loadModule() {
+  MutexGuard locked(lock);
+  if (IsLoaded)
+    return;
+  IsLoaded = true;
+
+  // Code generation and the cache key both need the whole module.
+  std::string ErrMsg;
+  if (M->MaterializeAll(&ErrMsg))
+    report_fatal_error("Error reading module: " + ErrMsg);
+
+  std::string Key;
+  MemoryBuffer *MB = 0;
+  if (ObjCache) {
+    Key = getCacheKey(M);
+    MB = ObjCache->getObject(Key);
+  }
+  if (!MB) {
+    MB = emitObject(M);
+    if (ObjCache)
+      ObjCache->notifyObjectCompiled(Key, MB);
+  }
+
+  // Load the object into the dynamic linker, which takes ownership of it.
   if (Dyld.loadObject(MB))
     report_fatal_error(Dyld.getErrorString());
   // Resolve any relocations.
   Dyld.resolveRelocations();
+  if (Dyld.hasError())
+    report_fatal_error(Dyld.getErrorString());
+
+  notifyFunctionsLoaded();
+}
+
+std::string MCJIT::getSymbolName(const Function *F) const {
+  // FIXME: Should we be using the mangler for this? Probably.
+  StringRef BaseName = F->getName();
+  if (BaseName[0] == '\1')
+    return BaseName.substr(1);
+  return (TM->getMCAsmInfo()->getGlobalPrefix() + BaseName).str();
+}
+
+void MCJIT::notifyFunctionsLoaded() {
+  if (EventListeners.empty())
+    return;
+
+  // The object file has neither MachineFunctions nor line tables to offer.
+  JITEvent_EmittedFunctionDetails Details;
+  Details.MF = 0;
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I) {
+    if (I->isDeclaration())
+      continue;
+    std::string Name = getSymbolName(I);
+    void *Addr = Dyld.getSymbolAddress(Name);
+    uint64_t Size = Dyld.getFunctionSize(Name);
+    if (!Addr || !Size)
+      continue;
+    for (unsigned i = 0, e = EventListeners.size(); i != e; ++i)
+      EventListeners[i]->NotifyFunctionEmitted(*I, Addr, Size, Details);
+  }
+}
+
+void MCJIT::RegisterJITEventListener(JITEventListener *L) {
+  if (L == NULL)
+    return;
+  MutexGuard locked(lock);
+  EventListeners.push_back(L);
+}
+
+void MCJIT::UnregisterJITEventListener(JITEventListener *L) {
+  if (L == NULL)
+    return;
+  MutexGuard locked(lock);
+  std::vector<JITEventListener*>::iterator I =
+    std::find(EventListeners.begin(), EventListeners.end(), L);
+  if (I != EventListeners.end())
+    EventListeners.erase(I);
 }
 
 MCJIT::~MCJIT() {
@@ -100,12 +205,9 @@ void *MCJIT::getPointerToFunction(Function *F) {
     return Addr;
   }
 
-  // FIXME: Should we be using the mangler for this? Probably.
-  StringRef BaseName = F->getName();
-  if (BaseName[0] == '\1')
-    return (void*)Dyld.getSymbolAddress(BaseName.substr(1));
-  return (void*)Dyld.getSymbolAddress((TM->getMCAsmInfo()->getGlobalPrefix()
-                                       + BaseName).str());
+  loadModule();
+
+  return Dyld.getSymbolAddress(getSymbolName(F));
 }
 
 void *MCJIT::recompileAndRelinkFunction(Function *F) {
@@ -22,13 +22,16 @@ namespace llvm {
 // like only having one module, not needing to worry about multi-threading,
 // blah blah. Purely in get-it-up-and-limping mode for now.
 
+class MCJITMemoryManager;
+class MemoryBuffer;
+
 class MCJIT : public ExecutionEngine {
   MCJIT(Module *M, TargetMachine *tm, TargetJITInfo &tji,
-        RTDyldMemoryManager *MemMgr, bool AllocateGVsWithCode);
+        JITMemoryManager *JMM, bool AllocateGVsWithCode);
 
   TargetMachine *TM;
   MCContext *Ctx;
-  RTDyldMemoryManager *MemMgr;
+  MCJITMemoryManager *MemMgr;
 
   // FIXME: These may need moved to a separate 'jitstate' member like the
   // non-MC JIT does for multithreading and such. Just keep them here for now.
@@ -40,6 +43,25 @@ class MCJIT : public ExecutionEngine {
 
   RuntimeDyld Dyld;
 
+  ObjectCache *ObjCache;
+  bool IsLoaded;
+
+  std::vector<JITEventListener*> EventListeners;
+
+  /// loadModule - Generate code for the module, or fetch it from the object
+  /// cache, and link it into memory.  Does nothing if that already happened.
+  void loadModule();
+
+  /// getCacheKey - Return the key the object file for M is cached under.
+  std::string getCacheKey(Module *M) const;
+
+  /// getSymbolName - Return the name of F in the object file.
+  std::string getSymbolName(const Function *F) const;
+
+  /// notifyFunctionsLoaded - Tell the event listeners where the functions
+  /// of the loaded module are.
+  void notifyFunctionsLoaded();
+
 public:
   ~MCJIT();
 
@@ -67,7 +89,18 @@ public:
   ///
   void *getPointerToNamedFunction(const std::string &Name,
                                   bool AbortOnFailure = true);
+
+  virtual void setObjectCache(ObjectCache *Cache) { ObjCache = Cache; }
+
+  virtual void RegisterJITEventListener(JITEventListener *L);
+  virtual void UnregisterJITEventListener(JITEventListener *L);
+
   /// @}
+
+  /// emitObject - Run code generation for M and return the resulting object
+  /// file.  The caller takes ownership of the buffer.
+  MemoryBuffer *emitObject(Module *M);
+
   /// @name (Private) Registration Interfaces
   /// @{
 
@@ -8,7 +8,13 @@
 //===----------------------------------------------------------------------===//
 
 #include "MCJITMemoryManager.h"
+#include "MCJIT.h"
 
 using namespace llvm;
 
 void MCJITMemoryManager::anchor() { }
+
+void *MCJITMemoryManager::getPointerToNamedFunction(const std::string &Name,
+                                                    bool AbortOnFailure) {
+  return Parent->getPointerToNamedFunction(Name, AbortOnFailure);
+}
@@ -17,6 +17,8 @@
 
 namespace llvm {
 
+class MCJIT;
+
 // The MCJIT memory manager is a layer between the standard JITMemoryManager
 // and the RuntimeDyld interface that maps objects, by name, onto their
 // matching LLVM IR counterparts in the module(s) being compiled.
@@ -26,8 +28,12 @@ class MCJITMemoryManager : public RTDyldMemoryManager {
 
   // FIXME: Multiple modules.
   Module *M;
+
+  // The JIT that external symbols are looked up through.
+  MCJIT *Parent;
 public:
-  MCJITMemoryManager(JITMemoryManager *jmm, Module *m) : JMM(jmm), M(m) {}
+  MCJITMemoryManager(JITMemoryManager *jmm, Module *m, MCJIT *parent)
+    : JMM(jmm), M(m), Parent(parent) {}
   // We own the JMM, so make sure to delete it.
   ~MCJITMemoryManager() { delete JMM; }
 
@@ -65,6 +71,22 @@ public:
     JMM->endFunctionBody(F, FunctionStart, FunctionEnd);
   }
 
+  // Sections are placed in the code and global memory of the JIT, which the
+  // default JITMemoryManager allocates close together.
+  uint8_t *allocateCodeSection(uintptr_t Size, unsigned Alignment,
+                               unsigned SectionID) {
+    return JMM->allocateSpace(Size, Alignment);
+  }
+
+  uint8_t *allocateDataSection(uintptr_t Size, unsigned Alignment,
+                               unsigned SectionID) {
+    return JMM->allocateGlobal(Size, Alignment);
+  }
+
+  // Resolve external symbols the way the JIT does, so that calls to exit
+  // and atexit are intercepted.
+  void *getPointerToNamedFunction(const std::string &Name,
+                                  bool AbortOnFailure = true);
 };
 
 } // End llvm namespace
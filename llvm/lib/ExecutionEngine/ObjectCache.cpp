@@ -0,0 +1,139 @@
+//===-- ObjectCache.cpp - Cache of JIT-compiled object files --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the on-disk object cache used by the MCJIT.  The cache
+// is purely an optimization, so failing to read or write it is never an error:
+// the JIT simply generates the code again.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <vector>
+using namespace llvm;
+
+ObjectCache::~ObjectCache() {}
+
+DiskObjectCache::DiskObjectCache(StringRef Dir, uint64_t MaxSize,
+                                 unsigned MaxObjects)
+  : Dir(Dir), MaxSize(MaxSize), MaxObjects(MaxObjects) {}
+
+std::string DiskObjectCache::getPathForKey(StringRef Key) const {
+  return Dir + "/" + Key.str() + ".o";
+}
+
+/// touchFile - Set the modification time of Path to now, which is what the
+/// least recently used eviction goes by.
+static void touchFile(StringRef Path) {
+  sys::PathWithStatus P(Path);
+  const sys::FileStatus *Status = P.getFileStatus();
+  if (!Status)
+    return;
+  sys::FileStatus NewStatus = *Status;
+  NewStatus.modTime = sys::TimeValue::now();
+  P.setStatusInfoOnDisk(NewStatus);
+}
+
+MemoryBuffer *DiskObjectCache::getObject(StringRef Key) {
+  std::string Path = getPathForKey(Key);
+  OwningPtr<MemoryBuffer> Obj;
+  if (MemoryBuffer::getFile(Path, Obj))
+    return 0;
+  touchFile(Path);
+  return Obj.take();
+}
+
+void DiskObjectCache::notifyObjectCompiled(StringRef Key,
+                                           const MemoryBuffer *Obj) {
+  bool Existed;
+  if (sys::fs::create_directories(Dir, Existed))
+    return;
+
+  // Write to a temporary file first and rename it into place, so that other
+  // processes sharing the directory never see a partially written object.
+  int FD;
+  SmallString<128> TempPath;
+  if (sys::fs::unique_file(Dir + "/" + Key + "-%%%%%%.tmp", FD, TempPath,
+                           /*makeAbsolute=*/false))
+    return;
+  bool Failed;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS.write(Obj->getBufferStart(), Obj->getBufferSize());
+    OS.close();
+    Failed = OS.has_error();
+    OS.clear_error();
+  }
+  if (Failed || sys::fs::rename(TempPath.str(), getPathForKey(Key))) {
+    sys::fs::remove(TempPath.str(), Existed);
+    return;
+  }
+
+  prune();
+}
+
+namespace {
+/// CacheEntry - A cached object found while pruning the directory.
+struct CacheEntry {
+  std::string Path;
+  uint64_t Size;
+  sys::TimeValue LastUsed;
+
+  CacheEntry(const std::string &Path, uint64_t Size, sys::TimeValue LastUsed)
+    : Path(Path), Size(Size), LastUsed(LastUsed) {}
+
+  bool operator<(const CacheEntry &RHS) const {
+    return LastUsed < RHS.LastUsed;
+  }
+};
+}
+
+void DiskObjectCache::prune() {
+  if (MaxSize == 0 && MaxObjects == 0)
+    return;
+
+  std::vector<CacheEntry> Entries;
+  uint64_t TotalSize = 0;
+  error_code EC;
+  for (sys::fs::directory_iterator I(Dir, EC), E; I != E && !EC;
+       I.increment(EC)) {
+    const std::string &Path = I->path();
+    if (!StringRef(Path).endswith(".o"))
+      continue;
+    sys::PathWithStatus P(Path);
+    const sys::FileStatus *Status = P.getFileStatus();
+    if (!Status || Status->isDir)
+      continue;
+    Entries.push_back(CacheEntry(Path, Status->getSize(),
+                                 Status->getTimestamp()));
+    TotalSize += Status->getSize();
+  }
+
+  // Evict the least recently used objects first.
+  std::sort(Entries.begin(), Entries.end());
+  unsigned NumObjects = Entries.size();
+  for (std::vector<CacheEntry>::iterator I = Entries.begin(),
+       E = Entries.end(); I != E; ++I) {
+    bool TooBig = MaxSize != 0 && TotalSize > MaxSize;
+    bool TooMany = MaxObjects != 0 && NumObjects > MaxObjects;
+    if (!TooBig && !TooMany)
+      break;
+    bool Existed;
+    if (sys::fs::remove(I->Path, Existed))
+      continue;
+    TotalSize -= I->Size;
+    --NumObjects;
+  }
+}
@@ -13,6 +13,9 @@
 
 #define DEBUG_TYPE "dyld"
 #include "RuntimeDyldImpl.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/MathExtras.h"
 using namespace llvm;
 using namespace llvm::object;
 
@@ -20,6 +23,39 @@ using namespace llvm::object;
 RTDyldMemoryManager::~RTDyldMemoryManager() {}
 RuntimeDyldImpl::~RuntimeDyldImpl() {}
 
+// Memory managers written before sections were loaded only hand out memory
+// for function bodies, so get each section from them as one, with room to
+// align it.
+uint8_t *RTDyldMemoryManager::allocateCodeSection(uintptr_t Size,
+                                                  unsigned Alignment,
+                                                  unsigned SectionID) {
+  if (Alignment == 0)
+    Alignment = 1;
+  std::string Name = "section." + utostr(SectionID);
+  uintptr_t AllocSize = Size + Alignment - 1;
+  uint8_t *Mem = startFunctionBody(Name.c_str(), AllocSize);
+  if (!Mem || AllocSize < Size + Alignment - 1)
+    return 0;
+  uint8_t *Addr = (uint8_t*)RoundUpToAlignment((uintptr_t)Mem, Alignment);
+  endFunctionBody(Name.c_str(), Mem, Addr + Size);
+  return Addr;
+}
+
+uint8_t *RTDyldMemoryManager::allocateDataSection(uintptr_t Size,
+                                                  unsigned Alignment,
+                                                  unsigned SectionID) {
+  return RTDyldMemoryManager::allocateCodeSection(Size, Alignment, SectionID);
+}
+
+void *RTDyldMemoryManager::getPointerToNamedFunction(const std::string &Name,
+                                                     bool AbortOnFailure) {
+  void *Ptr = sys::DynamicLibrary::SearchForAddressOfSymbol(Name);
+  if (!Ptr && AbortOnFailure)
+    report_fatal_error("Program used external function '" + Name +
+                       "' which could not be resolved!");
+  return Ptr;
+}
+
 namespace llvm {
 
 void RuntimeDyldImpl::extractFunction(StringRef Name, uint8_t *StartAddress,
@@ -66,6 +102,8 @@ bool RuntimeDyld::loadObject(MemoryBuffer *InputBuffer) {
   if (!Dyld) {
     if (RuntimeDyldMachO::isKnownFormat(InputBuffer))
       Dyld = new RuntimeDyldMachO(MM);
+    else if (RuntimeDyldELF::isKnownFormat(InputBuffer))
+      Dyld = new RuntimeDyldELF(MM);
     else
       report_fatal_error("Unknown object format!");
   } else {
@@ -80,6 +118,10 @@ void *RuntimeDyld::getSymbolAddress(StringRef Name) {
   return Dyld->getSymbolAddress(Name);
 }
 
+uint64_t RuntimeDyld::getFunctionSize(StringRef Name) {
+  return Dyld->getFunctionSize(Name);
+}
+
 void RuntimeDyld::resolveRelocations() {
   Dyld->resolveRelocations();
 }
@@ -88,6 +130,10 @@ void RuntimeDyld::reassignSymbolAddress(StringRef Name, uint8_t *Addr) {
   Dyld->reassignSymbolAddress(Name, Addr);
 }
 
+bool RuntimeDyld::hasError() {
+  return Dyld && Dyld->hasError();
+}
+
 StringRef RuntimeDyld::getErrorString() {
   return Dyld->getErrorString();
 }
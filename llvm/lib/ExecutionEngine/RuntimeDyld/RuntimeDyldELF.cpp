@@ -0,0 +1,460 @@
+//===-- RuntimeDyldELF.cpp - Run-time dynamic linker for MC-JIT -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Implementation of the MC-JIT runtime dynamic linker for ELF objects.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "dyld"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Support/ELF.h"
+#include "llvm/Support/MathExtras.h"
+#include "RuntimeDyldImpl.h"
+using namespace llvm;
+using namespace llvm::object;
+
+namespace llvm {
+
+// Every stub or GOT entry takes a slot of this size in the stub area of a
+// code section. A stub is an indirect jump through the address stored right
+// after it, and a GOT entry is just the address.
+static const unsigned StubSize = 16;
+
+bool RuntimeDyldELF::checkError(error_code Err) {
+  if (!Err)
+    return false;
+  return Error("unable to read object: " + Err.message());
+}
+
+bool RuntimeDyldELF::loadSection(const SectionRef &Section, bool IsCode,
+                                 bool IsBSS, unsigned &SectionID) {
+  uint64_t Size, Alignment;
+  if (checkError(Section.getSize(Size)) ||
+      checkError(Section.getAlignment(Alignment)))
+    return true;
+  if (Alignment == 0)
+    Alignment = 1;
+
+  // Reserve a stub or GOT entry for each relocation that may need one. This
+  // is an upper bound, as references to the same symbol share their entry.
+  uint64_t StubAreaOffset = Size, StubAreaSize = 0;
+  if (IsCode) {
+    error_code Err;
+    for (relocation_iterator RI = Section.begin_relocations(),
+           RE = Section.end_relocations(); RI != RE; RI.increment(Err)) {
+      if (checkError(Err))
+        return true;
+      uint64_t Type;
+      if (checkError(RI->getType(Type)))
+        return true;
+      if (Type == ELF::R_X86_64_PLT32 || Type == ELF::R_X86_64_GOTPCREL)
+        StubAreaSize += StubSize;
+    }
+    if (StubAreaSize) {
+      StubAreaOffset = RoundUpToAlignment(Size, StubSize);
+      if (Alignment < StubSize)
+        Alignment = StubSize;
+    }
+  }
+
+  SectionID = Sections.size();
+  uint64_t AllocSize = StubAreaOffset + StubAreaSize;
+  uint8_t *Addr = IsCode ?
+    MemMgr->allocateCodeSection(AllocSize, Alignment, SectionID) :
+    MemMgr->allocateDataSection(AllocSize, Alignment, SectionID);
+  if (!Addr)
+    return Error("unable to allocate memory for section");
+
+  if (IsBSS) {
+    memset(Addr, 0, Size);
+  } else {
+    StringRef Contents;
+    if (checkError(Section.getContents(Contents)))
+      return true;
+    memcpy(Addr, Contents.data(), Size);
+  }
+  Sections.push_back(SectionEntry(Addr, StubAreaOffset,
+                                  StubAreaOffset + StubAreaSize));
+
+  DEBUG(StringRef Name; Section.getName(Name);
+        dbgs() << "Section '" << Name << "' (ID " << SectionID
+               << ") loaded at " << format("%p", Addr) << ", size " << Size
+               << ", stubs " << StubAreaSize / StubSize << "\n");
+  return false;
+}
+
+bool RuntimeDyldELF::loadCommonSymbols(ArrayRef<CommonSymbol> Commons) {
+  // The alignment of a common symbol is stored in place of its address,
+  // which the object file interface doesn't expose. 16 bytes is enough for
+  // any type on x86-64.
+  const uint64_t CommonAlign = 16;
+  uint64_t TotalSize = 0;
+  for (unsigned i = 0, e = Commons.size(); i != e; ++i)
+    TotalSize += RoundUpToAlignment(Commons[i].second, CommonAlign);
+
+  unsigned SectionID = Sections.size();
+  uint8_t *Addr = MemMgr->allocateDataSection(TotalSize, CommonAlign,
+                                              SectionID);
+  if (!Addr)
+    return Error("unable to allocate memory for common symbols");
+  memset(Addr, 0, TotalSize);
+  Sections.push_back(SectionEntry(Addr, 0, 0));
+
+  for (unsigned i = 0, e = Commons.size(); i != e; ++i) {
+    SymbolTable[Commons[i].first] = Addr;
+    DEBUG(dbgs() << "Common symbol '" << Commons[i].first << "' at "
+                 << format("%p", Addr) << "\n");
+    Addr += RoundUpToAlignment(Commons[i].second, CommonAlign);
+  }
+  return false;
+}
+
+uint64_t RuntimeDyldELF::allocateStubSlot(unsigned SectionID) {
+  SectionEntry &Section = Sections[SectionID];
+  assert(Section.StubOffset + StubSize <= Section.StubEnd &&
+         "Not enough room reserved for stubs!");
+  uint64_t Slot = Section.StubOffset;
+  Section.StubOffset += StubSize;
+  return Slot;
+}
+
+uint64_t RuntimeDyldELF::getStub(unsigned SectionID, StringRef Name) {
+  std::pair<unsigned, std::string> Key(SectionID, Name.str());
+  StubMap::iterator It = Stubs.find(Key);
+  if (It != Stubs.end())
+    return It->second;
+
+  uint64_t Slot = allocateStubSlot(SectionID);
+  // jmpq *0(%rip), which jumps to the address stored right after it.
+  static const uint8_t Jump[] = { 0xFF, 0x25, 0x00, 0x00, 0x00, 0x00 };
+  memcpy(Sections[SectionID].Address + Slot, Jump, sizeof(Jump));
+  Relocations[Name].push_back(RelocationEntry(SectionID, Slot + sizeof(Jump),
+                                              ELF::R_X86_64_64, 0));
+  Stubs[Key] = Slot;
+  return Slot;
+}
+
+uint64_t RuntimeDyldELF::getGOTEntry(unsigned SectionID, StringRef Name) {
+  std::pair<unsigned, std::string> Key(SectionID, Name.str());
+  StubMap::iterator It = GOTEntries.find(Key);
+  if (It != GOTEntries.end())
+    return It->second;
+
+  uint64_t Slot = allocateStubSlot(SectionID);
+  Relocations[Name].push_back(RelocationEntry(SectionID, Slot,
+                                              ELF::R_X86_64_64, 0));
+  GOTEntries[Key] = Slot;
+  return Slot;
+}
+
+uint64_t RuntimeDyldELF::getLocalGOTEntry(unsigned SectionID,
+                                          uint64_t Value) {
+  std::pair<unsigned, uint64_t> Key(SectionID, Value);
+  std::map<std::pair<unsigned, uint64_t>, uint64_t>::iterator It =
+    LocalGOTEntries.find(Key);
+  if (It != LocalGOTEntries.end())
+    return It->second;
+
+  uint64_t Slot = allocateStubSlot(SectionID);
+  memcpy(Sections[SectionID].Address + Slot, &Value, sizeof(Value));
+  LocalGOTEntries[Key] = Slot;
+  return Slot;
+}
+
+bool RuntimeDyldELF::processRelocation(unsigned SectionID,
+                                       const RelocationRef &Rel,
+                                       const ObjectFile *Obj,
+                                       const ObjSectionMap &LocalSections) {
+  uint64_t Type, Offset;
+  int64_t Addend;
+  SymbolRef Symbol;
+  if (checkError(Rel.getType(Type)) || checkError(Rel.getOffset(Offset)) ||
+      checkError(Rel.getAdditionalInfo(Addend)) ||
+      checkError(Rel.getSymbol(Symbol)))
+    return true;
+
+  switch (Type) {
+  case ELF::R_X86_64_NONE:
+    return false;
+  case ELF::R_X86_64_64:
+  case ELF::R_X86_64_32:
+  case ELF::R_X86_64_32S:
+  case ELF::R_X86_64_PC32:
+  case ELF::R_X86_64_PC64:
+  case ELF::R_X86_64_PLT32:
+  case ELF::R_X86_64_GOTPCREL:
+    break;
+  default:
+    return Error("Relocation type not implemented yet: " + Twine(Type));
+  }
+
+  StringRef Name;
+  SymbolRef::Type SymType;
+  bool IsGlobal, IsWeak;
+  section_iterator SymSection = Obj->end_sections();
+  if (checkError(Symbol.getName(Name)) ||
+      checkError(Symbol.getType(SymType)) ||
+      checkError(Symbol.isGlobal(IsGlobal)) ||
+      checkError(Symbol.isWeak(IsWeak)) ||
+      checkError(Symbol.getSection(SymSection)))
+    return true;
+
+  RelocationEntry RE(SectionID, Offset, Type, Addend);
+  bool IsUndefined = SymType == SymbolRef::ST_External;
+
+  DEBUG(dbgs() << "Relocation type " << Type << " at section " << SectionID
+               << " + " << Offset << " against '" << Name << "' + "
+               << Addend << "\n");
+
+  // References to local symbols and to sections of this object are applied
+  // right away, as nothing can move their targets any more.
+  if (!IsUndefined && !IsGlobal && !IsWeak) {
+    ObjSectionMap::const_iterator It = LocalSections.end();
+    if (SymSection != Obj->end_sections())
+      It = LocalSections.find(*SymSection);
+    if (It == LocalSections.end())
+      return Error("relocation against a section that was not loaded");
+    uint64_t SymOffset;
+    if (checkError(Symbol.getAddress(SymOffset)))
+      return true;
+    uint64_t Value = (uintptr_t)Sections[It->second].Address + SymOffset;
+
+    if (Type == ELF::R_X86_64_GOTPCREL) {
+      if (Sections[SectionID].StubEnd == 0)
+        return Error("GOT relocation outside of a code section");
+      uint64_t Slot = getLocalGOTEntry(SectionID, Value);
+      RE.Type = ELF::R_X86_64_PC32;
+      Value = (uintptr_t)Sections[SectionID].Address + Slot;
+    }
+    return resolveRelocationEntry(RE, Value);
+  }
+
+  // A relocation without a symbol is relative to address zero.
+  if (Name.empty())
+    return resolveRelocationEntry(RE, 0);
+
+  if (IsUndefined) {
+    // The symbol may be missing only if every reference to it is weak.
+    StringMap<bool>::iterator It = UndefinedSymbols.find(Name);
+    if (It == UndefinedSymbols.end())
+      UndefinedSymbols[Name] = IsWeak;
+    else
+      It->second = It->second && IsWeak;
+  }
+
+  // Calls through the PLT and loads from the GOT go to an entry in the stub
+  // area of the section, which a 32-bit displacement can always reach. The
+  // entry holds the full address of the symbol, wherever that ends up.
+  if ((Type == ELF::R_X86_64_PLT32 || Type == ELF::R_X86_64_GOTPCREL) &&
+      Sections[SectionID].StubEnd != 0) {
+    uint64_t Slot = Type == ELF::R_X86_64_PLT32 ? getStub(SectionID, Name)
+                                               : getGOTEntry(SectionID, Name);
+    RE.Type = ELF::R_X86_64_PC32;
+    uint64_t SlotAddress = (uintptr_t)Sections[SectionID].Address + Slot;
+    return resolveRelocationEntry(RE, SlotAddress);
+  }
+  if (Type == ELF::R_X86_64_GOTPCREL)
+    return Error("GOT relocation outside of a code section");
+
+  Relocations[Name].push_back(RE);
+  return false;
+}
+
+bool RuntimeDyldELF::resolveRelocationEntry(const RelocationEntry &RE,
+                                            uint64_t Value) {
+  return resolveX86_64Relocation(Sections[RE.SectionID].Address + RE.Offset,
+                                 Value, RE.Type, RE.Addend);
+}
+
+bool RuntimeDyldELF::resolveX86_64Relocation(uint8_t *LocalAddress,
+                                             uint64_t Value, uint32_t Type,
+                                             int64_t Addend) {
+  // x86-64 is little endian, as are the objects for it, so the fields can be
+  // copied over directly. There is no alignment guarantee for them though.
+  uint64_t FinalAddress = (uintptr_t)LocalAddress;
+  switch (Type) {
+  default:
+    llvm_unreachable("Relocation type not implemented yet!");
+  case ELF::R_X86_64_64: {
+    uint64_t Result = Value + Addend;
+    memcpy(LocalAddress, &Result, sizeof(Result));
+    return false;
+  }
+  case ELF::R_X86_64_32:
+  case ELF::R_X86_64_32S: {
+    uint64_t Result = Value + Addend;
+    if (Type == ELF::R_X86_64_32 ? !isUInt<32>(Result)
+                                 : !isInt<32>((int64_t)Result))
+      return Error("relocation target out of 32-bit range");
+    uint32_t Truncated = (uint32_t)Result;
+    memcpy(LocalAddress, &Truncated, sizeof(Truncated));
+    return false;
+  }
+  case ELF::R_X86_64_PC32:
+  case ELF::R_X86_64_PLT32: {
+    int64_t Result = (int64_t)(Value + Addend - FinalAddress);
+    if (!isInt<32>(Result))
+      return Error("PC-relative relocation target out of range");
+    int32_t Truncated = (int32_t)Result;
+    memcpy(LocalAddress, &Truncated, sizeof(Truncated));
+    return false;
+  }
+  case ELF::R_X86_64_PC64: {
+    uint64_t Result = Value + Addend - FinalAddress;
+    memcpy(LocalAddress, &Result, sizeof(Result));
+    return false;
+  }
+  }
+}
+
+bool RuntimeDyldELF::loadObject(MemoryBuffer *InputBuffer) {
+  // If the linker is in an error state, don't do anything.
+  if (hasError())
+    return true;
+  // The object file takes ownership of the buffer.
+  OwningPtr<ObjectFile> Obj(ObjectFile::createELFObjectFile(InputBuffer));
+  if (!Obj)
+    return Error("unable to load object");
+  if (Obj->getArch() != Triple::x86_64)
+    return Error("unsupported ELF machine, only x86-64 is implemented");
+
+  error_code Err;
+  ObjSectionMap LocalSections;
+
+  // Load the sections that make up the program image: code, data and zero
+  // initialized data. Debug info and the like are left alone.
+  for (section_iterator SI = Obj->begin_sections(), SE = Obj->end_sections();
+       SI != SE; SI.increment(Err)) {
+    if (checkError(Err))
+      return true;
+    bool IsText, IsData, IsBSS;
+    uint64_t Size;
+    if (checkError(SI->isText(IsText)) || checkError(SI->isData(IsData)) ||
+        checkError(SI->isBSS(IsBSS)) || checkError(SI->getSize(Size)))
+      return true;
+    if ((!IsText && !IsData && !IsBSS) || Size == 0)
+      continue;
+    unsigned SectionID;
+    if (loadSection(*SI, IsText, IsBSS, SectionID))
+      return true;
+    LocalSections[*SI] = SectionID;
+  }
+
+  // Register the symbols defined by the object.
+  SmallVector<CommonSymbol, 8> Commons;
+  for (symbol_iterator SI = Obj->begin_symbols(), SE = Obj->end_symbols();
+       SI != SE; SI.increment(Err)) {
+    if (checkError(Err))
+      return true;
+    SymbolRef::Type Type;
+    StringRef Name;
+    bool IsGlobal, IsWeak;
+    section_iterator Section = Obj->end_sections();
+    if (checkError(SI->getType(Type)) || checkError(SI->getName(Name)) ||
+        checkError(SI->isGlobal(IsGlobal)) || checkError(SI->isWeak(IsWeak)) ||
+        checkError(SI->getSection(Section)))
+      return true;
+    if (Name.empty() || Type == SymbolRef::ST_External ||
+        Type == SymbolRef::ST_Debug || Type == SymbolRef::ST_File)
+      continue;
+    // Local symbols are only registered for lookup by name, and must not
+    // hide a global symbol of the same name.
+    if (!IsGlobal && !IsWeak && SymbolTable.count(Name))
+      continue;
+
+    uint64_t Value;
+    if (checkError(SI->getAddress(Value)))
+      return true;
+    if (Section == Obj->end_sections()) {
+      bool IsAbsolute;
+      if (checkError(SI->isAbsolute(IsAbsolute)))
+        return true;
+      if (IsAbsolute) {
+        SymbolTable[Name] = (uint8_t*)(uintptr_t)Value;
+      } else if (!SymbolTable.count(Name)) {
+        uint64_t Size;
+        if (checkError(SI->getSize(Size)))
+          return true;
+        Commons.push_back(CommonSymbol(Name, Size));
+      }
+      continue;
+    }
+
+    ObjSectionMap::iterator It = LocalSections.find(*Section);
+    if (It == LocalSections.end())
+      continue;
+    SymbolTable[Name] = Sections[It->second].Address + Value;
+    if (Type == SymbolRef::ST_Function) {
+      uint64_t Size;
+      if (checkError(SI->getSize(Size)))
+        return true;
+      Functions[Name] = sys::MemoryBlock(SymbolTable[Name], Size);
+    }
+    DEBUG(dbgs() << "Symbol '" << Name << "' at section " << It->second
+                 << " + " << Value << "\n");
+  }
+  if (!Commons.empty() && loadCommonSymbols(Commons))
+    return true;
+
+  // Now process the relocations of the loaded sections. Those against
+  // symbols local to the object are applied here, the others are recorded
+  // until the symbols are resolved.
+  for (ObjSectionMap::iterator I = LocalSections.begin(),
+         E = LocalSections.end(); I != E; ++I) {
+    for (relocation_iterator RI = I->first.begin_relocations(),
+           RE = I->first.end_relocations(); RI != RE; RI.increment(Err)) {
+      if (checkError(Err))
+        return true;
+      if (processRelocation(I->second, *RI, Obj.get(), LocalSections))
+        return true;
+    }
+  }
+  return false;
+}
+
+void RuntimeDyldELF::resolveRelocations() {
+  // Look up the symbols that none of the objects define, so that the
+  // relocations against them are resolved along with the others.
+  for (StringMap<bool>::iterator I = UndefinedSymbols.begin(),
+         E = UndefinedSymbols.end(); I != E; ++I) {
+    if (SymbolTable.count(I->getKey()))
+      continue;
+    void *Addr = MemMgr->getPointerToNamedFunction(I->getKey(),
+                                                   !I->getValue());
+    SymbolTable[I->getKey()] = (uint8_t*)Addr;
+  }
+
+  RuntimeDyldImpl::resolveRelocations();
+}
+
+// Assign an address to a symbol name and resolve all the relocations
+// associated with it.
+void RuntimeDyldELF::reassignSymbolAddress(StringRef Name, uint8_t *Addr) {
+  // Assign the address in our symbol table.
+  SymbolTable[Name] = Addr;
+
+  StringMap<RelocationList>::iterator It = Relocations.find(Name);
+  if (It == Relocations.end())
+    return;
+  RelocationList &Relocs = It->second;
+  for (unsigned i = 0, e = Relocs.size(); i != e; ++i) {
+    DEBUG(dbgs() << "Resolving relocation at section " << Relocs[i].SectionID
+                 << " + " << Relocs[i].Offset << " to '" << Name << "' ("
+                 << format("%p", Addr) << ")\n");
+    resolveRelocationEntry(Relocs[i], (uintptr_t)Addr);
+  }
+}
+
+bool RuntimeDyldELF::isKnownFormat(const MemoryBuffer *InputBuffer) {
+  return InputBuffer->getBuffer().startswith(ELF::ElfMagic);
+}
+
+} // end namespace llvm
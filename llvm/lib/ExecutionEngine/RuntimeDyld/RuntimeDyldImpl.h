@@ -16,6 +16,8 @@
 
 #include "llvm/ExecutionEngine/RuntimeDyld.h"
 #include "llvm/Object/MachOObject.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/ADT/SmallVector.h"
@@ -27,6 +29,7 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include <map>
 
 using namespace llvm;
 using namespace llvm::object;
@@ -78,7 +81,12 @@ public:
     return SymbolTable.lookup(Name);
   }
 
-  void resolveRelocations();
+  // Return the size of the code of the named function, or 0 if unknown.
+  uint64_t getFunctionSize(StringRef Name) {
+    return Functions.lookup(Name).size();
+  }
+
+  virtual void resolveRelocations();
 
   virtual void reassignSymbolAddress(StringRef Name, uint8_t *Addr) = 0;
 
@@ -146,6 +154,87 @@ public:
   }
 };
 
+class RuntimeDyldELF : public RuntimeDyldImpl {
+  // A section of a loaded object. Code sections are followed by an area
+  // for the stubs and GOT entries that their relocations need.
+  struct SectionEntry {
+    uint8_t *Address;    // Where the section was loaded.
+    uint64_t StubOffset; // Offset of the next free stub slot.
+    uint64_t StubEnd;    // Offset of the end of the stub area.
+
+    SectionEntry(uint8_t *address, uint64_t stubOffset, uint64_t stubEnd)
+      : Address(address), StubOffset(stubOffset), StubEnd(stubEnd) {}
+  };
+  // Indexed by section ID. IDs are not reused across objects.
+  SmallVector<SectionEntry, 16> Sections;
+
+  // Maps the sections of the object being loaded to their IDs.
+  typedef std::map<SectionRef, unsigned> ObjSectionMap;
+
+  // A relocation against a symbol that can be reassigned, or that is
+  // defined outside of the loaded objects.
+  struct RelocationEntry {
+    unsigned SectionID; // Section the relocation applies to.
+    uint64_t Offset;    // Offset into that section.
+    uint32_t Type;      // ELF relocation type.
+    int64_t  Addend;    // Explicit addend of the RELA entry.
+
+    RelocationEntry(unsigned id, uint64_t offset, uint32_t type,
+                    int64_t addend)
+      : SectionID(id), Offset(offset), Type(type), Addend(addend) {}
+  };
+  typedef SmallVector<RelocationEntry, 4> RelocationList;
+  // Relocations, keyed by the name of the symbol they refer to.
+  StringMap<RelocationList> Relocations;
+
+  // Symbols referenced but not defined by the loaded objects, and whether
+  // the references are weak.
+  StringMap<bool> UndefinedSymbols;
+
+  // The stubs and GOT entries already created, keyed by section ID and
+  // symbol name, so that references from one section share them.
+  typedef std::map<std::pair<unsigned, std::string>, uint64_t> StubMap;
+  StubMap Stubs;
+  StubMap GOTEntries;
+  // The GOT entries holding addresses within the loaded objects, keyed by
+  // section ID and address.
+  std::map<std::pair<unsigned, uint64_t>, uint64_t> LocalGOTEntries;
+
+  bool checkError(error_code Err);
+
+  bool loadSection(const SectionRef &Section, bool IsCode, bool IsBSS,
+                   unsigned &SectionID);
+  typedef std::pair<StringRef, uint64_t> CommonSymbol; // Name and size.
+  bool loadCommonSymbols(ArrayRef<CommonSymbol> Commons);
+  bool processRelocation(unsigned SectionID, const RelocationRef &Rel,
+                         const ObjectFile *Obj,
+                         const ObjSectionMap &LocalSections);
+
+  uint64_t allocateStubSlot(unsigned SectionID);
+  uint64_t getStub(unsigned SectionID, StringRef Name);
+  uint64_t getGOTEntry(unsigned SectionID, StringRef Name);
+  uint64_t getLocalGOTEntry(unsigned SectionID, uint64_t Value);
+
+  bool resolveRelocationEntry(const RelocationEntry &RE, uint64_t Value);
+  bool resolveX86_64Relocation(uint8_t *LocalAddress, uint64_t Value,
+                               uint32_t Type, int64_t Addend);
+
+public:
+  RuntimeDyldELF(RTDyldMemoryManager *mm) : RuntimeDyldImpl(mm) {}
+
+  bool loadObject(MemoryBuffer *InputBuffer);
+
+  void resolveRelocations();
+
+  void reassignSymbolAddress(StringRef Name, uint8_t *Addr);
+
+  static bool isKnownFormat(const MemoryBuffer *InputBuffer);
+
+  bool isCompatibleFormat(const MemoryBuffer *InputBuffer) const {
+    return isKnownFormat(InputBuffer);
+  }
+};
+
 } // end namespace llvm
 
 
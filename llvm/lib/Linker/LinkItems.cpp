@@ -31,6 +31,14 @@ Linker::LinkInItems(const ItemList& Items, ItemList& NativeItems) {
   // Clear the NativeItems just in case
   NativeItems.clear();
 
+  // Have the system start reading the files while the first ones are linked.
+  std::vector<std::string> Files;
+  for (ItemList::const_iterator I = Items.begin(), E = Items.end();
+       I != E; ++I)
+    if (!I->second)
+      Files.push_back(I->first);
+  MemoryBuffer::prefetchFiles(Files);
+
   // For each linkage item ...
   for (ItemList::const_iterator I = Items.begin(), E = Items.end();
        I != E; ++I) {
@@ -233,6 +241,12 @@ bool Linker::LinkInFile(const sys::Path &File, bool &is_native) {
 ///  TRUE  - Some error occurred.
 ///
 bool Linker::LinkInFiles(const std::vector<sys::Path> &Files) {
+  // Have the system start reading the files while the first ones are linked.
+  std::vector<std::string> Names;
+  for (unsigned i = 0; i < Files.size(); ++i)
+    Names.push_back(Files[i].str());
+  MemoryBuffer::prefetchFiles(Names);
+
   bool is_native;
   for (unsigned i = 0; i < Files.size(); ++i)
     if (LinkInFile(Files[i], is_native))
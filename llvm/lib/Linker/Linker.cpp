@@ -98,8 +98,11 @@ Linker::LoadObject(const sys::Path &FN) {
   std::string ParseErrorMessage;
   Module *Result = 0;
 
+  // The whole file is parsed, mostly front to back.
+  unsigned Hints = MemoryBuffer::AH_Sequential | MemoryBuffer::AH_WillNeed;
   OwningPtr<MemoryBuffer> Buffer;
-  if (error_code ec = MemoryBuffer::getFileOrSTDIN(FN.c_str(), Buffer))
+  if (error_code ec =
+        MemoryBuffer::getFileOrSTDIN(FN.c_str(), Buffer, -1, Hints))
     ParseErrorMessage = "Error reading file '" + FN.str() + "'" + ": "
                       + ec.message();
   else
@@ -7,26 +7,120 @@
 //
 //===----------------------------------------------------------------------===//
 //
-// This file implements the BumpPtrAllocator interface.
+// This file implements the BumpPtrAllocator and SlabPool interfaces.
 //
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/Allocator.h"
+#include "llvm/Config/config.h"
 #include "llvm/Support/DataTypes.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/Recycler.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Memory.h"
+#include "llvm/Support/MutexGuard.h"
 #include <cstring>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 
 namespace llvm {
 
+//===----------------------------------------------------------------------===//
+// Named allocator counters.
+//===----------------------------------------------------------------------===//
+
+// The counters are never freed, as allocators may be destroyed after
+// llvm_shutdown.  CounterLock guards all of them.
+static AllocatorCounters *CounterList = 0;
+static ManagedStatic<sys::SmartMutex<true> > CounterLock;
+
+/// countSlab - Add Slab to Counters, or take it away if Delta is -1.
+static void countSlab(AllocatorCounters *Counters, MemSlab *Slab, int Delta) {
+  sys::SmartScopedLock<true> Guard(*CounterLock);
+  Counters->NumSlabs += Delta;
+  if (Delta > 0) {
+    Counters->SlabBytes += Slab->Size;
+    Counters->PeakSlabBytes = std::max(Counters->PeakSlabBytes,
+                                       Counters->SlabBytes);
+  } else {
+    Counters->SlabBytes -= Slab->Size;
+  }
+}
+
+AllocatorCounters getAllocatorCounters(const char *Name) {
+  sys::SmartScopedLock<true> Guard(*CounterLock);
+  for (AllocatorCounters *C = CounterList; C; C = C->Next)
+    if (std::strcmp(C->Name, Name) == 0)
+      return *C;
+  AllocatorCounters None = { Name, 0, 0, 0, 0, 0 };
+  return None;
+}
+
+void PrintAllocatorStatistics(raw_ostream &OS) {
+  sys::SmartScopedLock<true> Guard(*CounterLock);
+  if (!CounterList)
+    return;
+
+  OS << "===" << std::string(73, '-') << "===\n"
+     << "                          ... Allocator Memory ...\n"
+     << "===" << std::string(73, '-') << "===\n\n"
+     << "  Peak bytes   Bytes held  Slabs  Allocators  Name\n";
+  for (AllocatorCounters *C = CounterList; C; C = C->Next)
+    OS << format("%12lu %12lu %6u %11u  %s\n",
+                 (unsigned long)C->PeakSlabBytes, (unsigned long)C->SlabBytes,
+                 C->NumSlabs, C->NumAllocators, C->Name);
+  OS << '\n';
+  OS.flush();
+}
+
+//===----------------------------------------------------------------------===//
+// BumpPtrAllocator implementation.
+//===----------------------------------------------------------------------===//
+
 BumpPtrAllocator::BumpPtrAllocator(size_t size, size_t threshold,
                                    SlabAllocator &allocator)
     : SlabSize(size), SizeThreshold(threshold), Allocator(allocator),
-      CurSlab(0), BytesAllocated(0) { }
+      CurSlab(0), BytesAllocated(0), Counters(0) { }
+
+BumpPtrAllocator::BumpPtrAllocator(SlabAllocator &allocator)
+    : SlabSize(4096), SizeThreshold(4096), Allocator(allocator),
+      CurSlab(0), BytesAllocated(0), Counters(0) { }
 
 BumpPtrAllocator::~BumpPtrAllocator() {
   DeallocateSlabs(CurSlab);
+  if (Counters) {
+    sys::SmartScopedLock<true> Guard(*CounterLock);
+    --Counters->NumAllocators;
+  }
+}
+
+void BumpPtrAllocator::setName(const char *Name) {
+  sys::SmartScopedLock<true> Guard(*CounterLock);
+  AllocatorCounters **Link = &CounterList;
+  while (*Link && std::strcmp((*Link)->Name, Name) != 0)
+    Link = &(*Link)->Next;
+  if (!*Link) {
+    AllocatorCounters New = { Name, 0, 0, 0, 0, 0 };
+    *Link = new AllocatorCounters(New);
+  }
+
+  // Move the slabs we already have over to the new name.
+  unsigned NumSlabs = GetNumSlabs();
+  size_t TotalMemory = getTotalMemory();
+  if (Counters) {
+    --Counters->NumAllocators;
+    Counters->NumSlabs -= NumSlabs;
+    Counters->SlabBytes -= TotalMemory;
+  }
+  Counters = *Link;
+  ++Counters->NumAllocators;
+  Counters->NumSlabs += NumSlabs;
+  Counters->SlabBytes += TotalMemory;
+  Counters->PeakSlabBytes = std::max(Counters->PeakSlabBytes,
+                                     Counters->SlabBytes);
 }
 
 /// AlignPtr - Align Ptr to Alignment bytes, rounding up.  Alignment should
@@ -50,18 +144,28 @@ void BumpPtrAllocator::StartNewSlab() {
   if (BytesAllocated >= SlabSize * 128)
     SlabSize *= 2;
 
-  MemSlab *NewSlab = Allocator.Allocate(SlabSize);
+  MemSlab *NewSlab = AllocateSlab(SlabSize);
   NewSlab->NextPtr = CurSlab;
   CurSlab = NewSlab;
   CurPtr = (char*)(CurSlab + 1);
   End = ((char*)CurSlab) + CurSlab->Size;
 }
 
+/// AllocateSlab - Get a slab of Size bytes from Allocator, and count it.
+MemSlab *BumpPtrAllocator::AllocateSlab(size_t Size) {
+  MemSlab *Slab = Allocator.Allocate(Size);
+  if (Counters)
+    countSlab(Counters, Slab, 1);
+  return Slab;
+}
+
 /// DeallocateSlabs - Deallocate all memory slabs after and including this
 /// one.
 void BumpPtrAllocator::DeallocateSlabs(MemSlab *Slab) {
   while (Slab) {
     MemSlab *NextSlab = Slab->NextPtr;
+    if (Counters)
+      countSlab(Counters, Slab, -1);
 #ifndef NDEBUG
     // Poison the memory so stale pointers crash sooner.  Note we must
     // preserve the Size and NextPtr fields at the beginning.
@@ -82,6 +186,7 @@ void BumpPtrAllocator::Reset() {
   CurSlab->NextPtr = 0;
   CurPtr = (char*)(CurSlab + 1);
   End = ((char*)CurSlab) + CurSlab->Size;
+  Allocator.ReleasePages(CurSlab);
 }
 
 /// Allocate - Allocate space at the specified alignment.
@@ -108,7 +213,7 @@ void *BumpPtrAllocator::Allocate(size_t Size, size_t Alignment) {
   // If Size is really big, allocate a separate slab for it.
   size_t PaddedSize = Size + sizeof(MemSlab) + Alignment - 1;
   if (PaddedSize > SizeThreshold) {
-    MemSlab *NewSlab = Allocator.Allocate(PaddedSize);
+    MemSlab *NewSlab = AllocateSlab(PaddedSize);
 
     // Put the new slab after the current slab, since we are not allocating
     // into it.
@@ -164,6 +269,8 @@ MallocSlabAllocator BumpPtrAllocator::DefaultSlabAllocator =
 
 SlabAllocator::~SlabAllocator() { }
 
+void SlabAllocator::ReleasePages(MemSlab *) { }
+
 MallocSlabAllocator::~MallocSlabAllocator() { }
 
 MemSlab *MallocSlabAllocator::Allocate(size_t Size) {
@@ -177,6 +284,99 @@ void MallocSlabAllocator::Deallocate(MemSlab *Slab) {
   Allocator.Deallocate(Slab);
 }
 
+//===----------------------------------------------------------------------===//
+// SlabPool implementation.
+//===----------------------------------------------------------------------===//
+
+SlabPool::SlabPool(size_t MaxRetained)
+    : FreeSlabs(0), RetainedBytes(0), MaxRetainedBytes(MaxRetained) { }
+
+SlabPool::~SlabPool() {
+  releaseMemory();
+}
+
+MemSlab *SlabPool::Allocate(size_t Size) {
+  {
+    MutexGuard Guard(Lock);
+    // Don't hand out a much bigger slab than asked for: the bump allocator
+    // would use all of it, and the peak memory would only grow.
+    for (MemSlab **Link = &FreeSlabs; *Link; Link = &(*Link)->NextPtr) {
+      MemSlab *Slab = *Link;
+      if (Slab->Size >= Size && Slab->Size / 2 <= Size) {
+        *Link = Slab->NextPtr;
+        RetainedBytes -= Slab->Size;
+        Slab->NextPtr = 0;
+        return Slab;
+      }
+    }
+  }
+
+  MemSlab *Slab = (MemSlab*)malloc(Size);
+  Slab->Size = Size;
+  Slab->NextPtr = 0;
+  return Slab;
+}
+
+void SlabPool::Deallocate(MemSlab *Slab) {
+  bool Keep;
+  {
+    MutexGuard Guard(Lock);
+    Keep = RetainedBytes + Slab->Size <= MaxRetainedBytes;
+    if (Keep)
+      RetainedBytes += Slab->Size;
+  }
+  if (!Keep) {
+    free(Slab);
+    return;
+  }
+
+  // Give the pages back outside of the lock, madvise isn't cheap.
+  ReleasePages(Slab);
+  MutexGuard Guard(Lock);
+  Slab->NextPtr = FreeSlabs;
+  FreeSlabs = Slab;
+}
+
+void SlabPool::ReleasePages(MemSlab *Slab) {
+#if defined(HAVE_SYS_MMAN_H) && defined(MADV_DONTNEED)
+  // Only the whole pages after the slab header can go; the system gives them
+  // back zero-filled on the next touch.
+  uintptr_t PageSize = sys::Process::GetPageSize();
+  uintptr_t Start = RoundUpToAlignment((uintptr_t)(Slab + 1), PageSize);
+  uintptr_t End = ((uintptr_t)Slab + Slab->Size) & ~(PageSize - 1);
+  if (Start < End)
+    ::madvise((void*)Start, End - Start, MADV_DONTNEED);
+#endif
+}
+
+size_t SlabPool::getRetainedMemory() {
+  MutexGuard Guard(Lock);
+  return RetainedBytes;
+}
+
+void SlabPool::releaseMemory() {
+  MemSlab *Slab;
+  {
+    MutexGuard Guard(Lock);
+    Slab = FreeSlabs;
+    FreeSlabs = 0;
+    for (MemSlab *S = Slab; S; S = S->NextPtr)
+      RetainedBytes -= S->Size;
+  }
+  while (Slab) {
+    MemSlab *NextSlab = Slab->NextPtr;
+    free(Slab);
+    Slab = NextSlab;
+  }
+}
+
+SlabPool &SlabPool::getShared() {
+  // The pool is never freed: the allocators that use it keep a reference to
+  // it, and may be destroyed after llvm_shutdown.
+  static SlabPool *SharedPool = new SlabPool();
+  return *SharedPool;
+}
+
 void PrintRecyclerStats(size_t Size,
                         size_t Align,
                         size_t FreeListSize) {
@@ -0,0 +1,51 @@
+//===-- Hashing.cpp - Hash functions for in-memory tables -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the hash_value function for strings.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/Hashing.h"
+#include "llvm/Support/DataTypes.h"
+#include <cstring>
+using namespace llvm;
+
+unsigned llvm::hash_value(StringRef S) {
+  // This is adapted from MurmurHash64A by Austin Appleby.
+  const uint64_t M = 0xc6a4a7935bd1e995ULL;
+  const unsigned R = 47;
+  const char *P = S.data();
+  size_t Len = S.size();
+  uint64_t Hash = 0x9ae16a3b2f90404fULL ^ (Len * M);
+
+  for (; Len >= 8; P += 8, Len -= 8) {
+    // memcpy compiles to a single load, aligned or not.
+    uint64_t K;
+    memcpy(&K, P, sizeof(K));
+    K *= M;
+    K ^= K >> R;
+    K *= M;
+    Hash ^= K;
+    Hash *= M;
+  }
+
+  if (Len) {
+    uint64_t K = 0;
+    memcpy(&K, P, Len);
+    Hash ^= K;
+    Hash *= M;
+  }
+
+  Hash ^= Hash >> R;
+  Hash *= M;
+  Hash ^= Hash >> R;
+  // Fold the high half in, so that masking the result with a power of two
+  // minus one still sees all of the bits.
+  return unsigned(Hash ^ (Hash >> 32));
+}
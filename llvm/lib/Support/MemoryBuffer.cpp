@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/Config/config.h"
@@ -26,6 +27,7 @@
 #include <cstring>
 #include <cerrno>
 #include <new>
+#include <vector>
 #include <sys/types.h>
 #include <sys/stat.h>
 #if !defined(_MSC_VER) && !defined(__MINGW32__)
@@ -34,6 +36,9 @@
 #include <io.h>
 #endif
 #include <fcntl.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 using namespace llvm;
 
 namespace { const llvm::error_code success; }
@@ -157,18 +162,18 @@ MemoryBuffer *MemoryBuffer::getNewMemBuffer(size_t Size, StringRef BufferName) {
 /// returns an empty buffer.
 error_code MemoryBuffer::getFileOrSTDIN(StringRef Filename,
                                         OwningPtr<MemoryBuffer> &result,
-                                        int64_t FileSize) {
+                                        int64_t FileSize, unsigned Hints) {
   if (Filename == "-")
     return getSTDIN(result);
-  return getFile(Filename, result, FileSize);
+  return getFile(Filename, result, FileSize, true, Hints);
 }
 
 error_code MemoryBuffer::getFileOrSTDIN(const char *Filename,
                                         OwningPtr<MemoryBuffer> &result,
-                                        int64_t FileSize) {
+                                        int64_t FileSize, unsigned Hints) {
   if (strcmp(Filename, "-") == 0)
     return getSTDIN(result);
-  return getFile(Filename, result, FileSize);
+  return getFile(Filename, result, FileSize, true, Hints);
 }
 
 //===----------------------------------------------------------------------===//
@@ -205,17 +210,19 @@ public:
 error_code MemoryBuffer::getFile(StringRef Filename,
                                  OwningPtr<MemoryBuffer> &result,
                                  int64_t FileSize,
-                                 bool RequiresNullTerminator) {
+                                 bool RequiresNullTerminator,
+                                 unsigned Hints) {
   // Ensure the path is null terminated.
   SmallString<256> PathBuf(Filename.begin(), Filename.end());
   return MemoryBuffer::getFile(PathBuf.c_str(), result, FileSize,
-                               RequiresNullTerminator);
+                               RequiresNullTerminator, Hints);
 }
 
 error_code MemoryBuffer::getFile(const char *Filename,
                                  OwningPtr<MemoryBuffer> &result,
                                  int64_t FileSize,
-                                 bool RequiresNullTerminator) {
+                                 bool RequiresNullTerminator,
+                                 unsigned Hints) {
   int OpenFlags = O_RDONLY;
 #ifdef O_BINARY
   OpenFlags |= O_BINARY;  // Open input file in binary mode on win32.
@@ -225,11 +232,62 @@ error_code MemoryBuffer::getFile(const char *Filename,
     return error_code(errno, posix_category());
 
   error_code ret = getOpenFile(FD, Filename, result, FileSize, FileSize,
-                               0, RequiresNullTerminator);
+                               0, RequiresNullTerminator, Hints);
   close(FD);
   return ret;
 }
 
+/// prefetchFiles - Ask the operating system to start reading the specified
+/// files into memory, without waiting for it.
+void MemoryBuffer::prefetchFiles(ArrayRef<std::string> Filenames) {
+#ifdef POSIX_FADV_WILLNEED
+  for (unsigned i = 0, e = Filenames.size(); i != e; ++i) {
+    int FD = ::open(Filenames[i].c_str(), O_RDONLY);
+    if (FD == -1)
+      continue;
+    // The kernel starts the readahead and returns; the pages stay in the page
+    // cache after the file is closed.
+    ::posix_fadvise(FD, 0, 0, POSIX_FADV_WILLNEED);
+    close(FD);
+  }
+#endif
+}
+
+/// adviseMapping - Pass the hints for a file mapped at Pages on to the
+/// kernel.
+static void adviseMapping(const char *Pages, size_t Size, unsigned Hints,
+                          int PageSize) {
+#ifdef HAVE_SYS_MMAN_H
+  void *Addr = const_cast<char*>(Pages);
+#ifdef MADV_SEQUENTIAL
+  if (Hints & MemoryBuffer::AH_Sequential)
+    ::madvise(Addr, Size, MADV_SEQUENTIAL);
+#endif
+  // Ask for huge pages before anything reads the file in.
+#ifdef MADV_HUGEPAGE
+  if (Hints & MemoryBuffer::AH_HugePages)
+    ::madvise(Addr, Size, MADV_HUGEPAGE);
+#endif
+#ifdef MADV_WILLNEED
+  if (Hints & MemoryBuffer::AH_WillNeed)
+    ::madvise(Addr, Size, MADV_WILLNEED);
+#endif
+#ifdef MADV_POPULATE_READ
+  if ((Hints & MemoryBuffer::AH_Populate) &&
+      ::madvise(Addr, Size, MADV_POPULATE_READ) == 0)
+    return;
+#endif
+#endif
+
+  // Without a way to have the kernel do it, read a byte of every page.
+  if (Hints & MemoryBuffer::AH_Populate) {
+    volatile char Sink = 0;
+    for (size_t Offset = 0; Offset < Size; Offset += PageSize)
+      Sink = Pages[Offset];
+    (void)Sink;
+  }
+}
+
 static bool shouldUseMmap(int FD,
                           size_t FileSize,
                           size_t MapSize,
@@ -277,7 +335,8 @@ error_code MemoryBuffer::getOpenFile(int FD, const char *Filename,
                                      OwningPtr<MemoryBuffer> &result,
                                      uint64_t FileSize, uint64_t MapSize,
                                      int64_t Offset,
-                                     bool RequiresNullTerminator) {
+                                     bool RequiresNullTerminator,
+                                     unsigned Hints) {
   static int PageSize = sys::Process::GetPageSize();
 
   // Default is to map the full file.
@@ -304,6 +363,7 @@ error_code MemoryBuffer::getOpenFile(int FD, const char *Filename,
     if (const char *Pages = sys::Path::MapInFilePages(FD,
                                                       RealMapSize,
                                                       RealMapOffset)) {
+      adviseMapping(Pages, RealMapSize, Hints, PageSize);
       result.reset(GetNamedBuffer<MemoryBufferMMapFile>(
           StringRef(Pages + Delta, MapSize), Filename, RequiresNullTerminator));
       return success;
@@ -320,6 +380,11 @@ error_code MemoryBuffer::getOpenFile(int FD, const char *Filename,
   OwningPtr<MemoryBuffer> SB(Buf);
   char *BufPtr = const_cast<char*>(SB->getBufferStart());
 
+#ifdef POSIX_FADV_SEQUENTIAL
+  if (Hints & AH_Sequential)
+    ::posix_fadvise(FD, Offset, MapSize, POSIX_FADV_SEQUENTIAL);
+#endif
+
   size_t BytesLeft = MapSize;
 #ifndef HAVE_PREAD
   if (lseek(FD, Offset, SEEK_SET) == -1)
@@ -347,6 +412,45 @@ error_code MemoryBuffer::getOpenFile(int FD, const char *Filename,
   return success;
 }
 
+/// getResidentSize - Return how many bytes of the buffer are in memory.
+size_t MemoryBuffer::getResidentSize() const {
+#ifdef HAVE_SYS_MMAN_H
+  if (getBufferKind() != MemoryBuffer_MMap)
+    return getBufferSize();
+
+  static int PageSize = sys::Process::GetPageSize();
+  uintptr_t Start = reinterpret_cast<uintptr_t>(getBufferStart());
+  uintptr_t RealStart = Start & ~uintptr_t(PageSize - 1);
+  size_t RealSize = getBufferSize() + (Start - RealStart);
+  size_t NumPages = (RealSize + PageSize - 1) / PageSize;
+  if (NumPages == 0)
+    return 0;
+
+  // mincore takes unsigned chars on Linux and chars elsewhere.
+#ifdef __linux__
+  std::vector<unsigned char> InCore(NumPages);
+#else
+  std::vector<char> InCore(NumPages);
+#endif
+  if (::mincore(reinterpret_cast<void*>(RealStart), RealSize, &InCore[0]))
+    return getBufferSize();
+
+  // Count whole pages, then take off the parts of the first and last page
+  // that are outside the buffer.
+  size_t Resident = 0;
+  for (size_t i = 0; i != NumPages; ++i)
+    if (InCore[i] & 1)
+      Resident += PageSize;
+  if (InCore[0] & 1)
+    Resident -= Start - RealStart;
+  if (InCore[NumPages - 1] & 1)
+    Resident -= NumPages * PageSize - RealSize;
+  return Resident;
+#else
+  return getBufferSize();
+#endif
+}
+
 //===----------------------------------------------------------------------===//
 // MemoryBuffer::getSTDIN implementation.
 //===----------------------------------------------------------------------===//
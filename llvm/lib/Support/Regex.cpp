@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/Regex.h"
+#include "RegexAutomaton.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/ADT/SmallVector.h"
@@ -19,7 +20,7 @@
 #include <string>
 using namespace llvm;
 
-Regex::Regex(StringRef regex, unsigned Flags) {
+Regex::Regex(StringRef regex, unsigned Flags) : Automaton(0) {
   unsigned flags = 0;
   preg = new llvm_regex();
   preg->re_endp = regex.end();
@@ -28,9 +29,15 @@ Regex::Regex(StringRef regex, unsigned Flags) {
   if (Flags & Newline)
     flags |= REG_NEWLINE;
   error = llvm_regcomp(preg, regex.data(), flags|REG_EXTENDED|REG_PEND);
+
+  // regcomp still checks the pattern and counts the subexpressions, and
+  // regexec matches the patterns the automaton can't handle.
+  if (!error && !(Flags & NoAutomaton))
+    Automaton = RegexAutomaton::compile(regex, Flags, preg->re_nsub);
 }
 
 Regex::~Regex() {
+  delete Automaton;
   llvm_regfree(preg);
   delete preg;
 }
@@ -60,8 +67,26 @@ bool Regex::match(StringRef String, SmallVectorImpl<StringRef> *Matches){
   pm.resize(nmatch > 0 ? nmatch : 1);
   pm[0].rm_so = 0;
   pm[0].rm_eo = String.size();
+  int eflags = REG_STARTEND;
+
+  if (Automaton) {
+    if (!Automaton->match(String, Matches))
+      return false;
+    if (!Matches || !Automaton->hasAmbiguousSubmatches())
+      return true;
+
+    // The automaton found the match, but how an ambiguous pattern divides it
+    // among the subexpressions is up to regexec.  Let it look at just the
+    // match, telling it whether ^ and $ hold at its ends.
+    pm[0].rm_so = (*Matches)[0].data() - String.data();
+    pm[0].rm_eo = pm[0].rm_so + (*Matches)[0].size();
+    if (!Automaton->isLineStart(String, pm[0].rm_so))
+      eflags |= REG_NOTBOL;
+    if (!Automaton->isLineEnd(String, pm[0].rm_eo))
+      eflags |= REG_NOTEOL;
+  }
 
-  int rc = llvm_regexec(preg, String.data(), nmatch, pm.data(), REG_STARTEND);
+  int rc = llvm_regexec(preg, String.data(), nmatch, pm.data(), eflags);
 
   if (rc == REG_NOMATCH)
     return false;
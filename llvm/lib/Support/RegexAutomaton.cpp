@@ -0,0 +1,855 @@
+//===-- RegexAutomaton.cpp - Linear time regular expression matcher -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the automaton Regex matches with when it can.  The
+// parser follows p_ere in regcomp.c, so that the automaton gives patterns the
+// meaning regcomp gives them; anything it doesn't handle makes Regex fall back
+// to regexec.
+//
+//===----------------------------------------------------------------------===//
+
+#include "RegexAutomaton.h"
+#include "llvm/Support/Regex.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallVector.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include "regcclass.h"
+using namespace llvm;
+
+/// MaxInsts - Give up on patterns that take more instructions than this, as
+/// large bounded repetitions do.
+static const unsigned MaxInsts = 4096;
+
+/// MaxCacheSize - Start over with an empty DFA once the states built so far
+/// take up this many words.
+static const size_t MaxCacheSize = 1 << 20;
+
+namespace llvm {
+
+/// RegexParser - Parse an extended regular expression into a tree, then emit
+/// the NFA for it into a RegexAutomaton.
+class RegexParser {
+  struct Node {
+    enum NodeKind { Empty, Set, Concat, Alt, Repeat, Group, BOL, EOL };
+    NodeKind Kind;
+    unsigned Arg;                       // Set index or group number.
+    unsigned Min, Max;                  // Max == ~0U is unbounded.
+    std::vector<unsigned> Kids;
+  };
+
+  RegexAutomaton &A;
+  const char *Cur, *End;
+  std::vector<Node> Nodes;
+  bool Failed;
+
+  unsigned newNode(Node::NodeKind Kind, unsigned Arg = 0) {
+    Nodes.push_back(Node());
+    Nodes.back().Kind = Kind;
+    Nodes.back().Arg = Arg;
+    Nodes.back().Min = Nodes.back().Max = 0;
+    return Nodes.size() - 1;
+  }
+  unsigned fail() {
+    Failed = true;
+    return newNode(Node::Empty);
+  }
+  bool eat(char C) {
+    if (Cur == End || *Cur != C)
+      return false;
+    ++Cur;
+    return true;
+  }
+  bool seeDigit(const char *P) const {
+    return P != End && isdigit((unsigned char)*P);
+  }
+
+  unsigned addSet(const std::bitset<256> &Set) {
+    A.Sets.push_back(Set);
+    return newNode(Node::Set, A.Sets.size() - 1);
+  }
+  unsigned parseAlternation(bool InGroup);
+  unsigned parseBranch(bool InGroup);
+  unsigned parseExpression();
+  unsigned parseCount();
+  unsigned parseBracket();
+  void parseBracketTerm(std::bitset<256> &Set);
+  unsigned ordinary(unsigned char C);
+
+  unsigned push(RegexAutomaton::Opcode Op, unsigned Arg = 0) {
+    RegexAutomaton::Inst I;
+    I.Op = Op;
+    I.Arg = Arg;
+    I.X = A.Prog.size() + 1;
+    I.Y = 0;
+    A.Prog.push_back(I);
+    return A.Prog.size() - 1;
+  }
+  bool canBeEmpty(unsigned N) const;
+  bool isAmbiguous(unsigned N, bool InRepeat) const;
+  void emit(unsigned N);
+
+public:
+  unsigned NumGroups;
+
+  RegexParser(RegexAutomaton &A, StringRef Pattern)
+    : A(A), Cur(Pattern.begin()), End(Pattern.end()), Failed(false),
+      NumGroups(0) {}
+
+  /// parse - Parse the whole pattern and emit its program.  Return false if
+  /// the pattern can't be handled.
+  bool parse();
+};
+
+}
+
+bool RegexParser::parse() {
+  unsigned Root = parseAlternation(false);
+  if (Failed || Cur != End)
+    return false;
+  A.Ambiguous = NumGroups != 0 && isAmbiguous(Root, false);
+  push(RegexAutomaton::Save, 0);
+  emit(Root);
+  push(RegexAutomaton::Save, 1);
+  push(RegexAutomaton::Match);
+  return !Failed && A.Prog.size() <= MaxInsts;
+}
+
+unsigned RegexParser::parseAlternation(bool InGroup) {
+  std::vector<unsigned> Branches;
+  do
+    Branches.push_back(parseBranch(InGroup));
+  while (!Failed && eat('|'));
+  if (Branches.size() == 1)
+    return Branches[0];
+  unsigned N = newNode(Node::Alt);
+  Nodes[N].Kids.swap(Branches);
+  return N;
+}
+
+unsigned RegexParser::parseBranch(bool InGroup) {
+  std::vector<unsigned> Pieces;
+  while (!Failed && Cur != End && *Cur != '|' && !(InGroup && *Cur == ')'))
+    Pieces.push_back(parseExpression());
+  // regcomp rejects empty branches.
+  if (Pieces.empty())
+    return fail();
+  if (Pieces.size() == 1)
+    return Pieces[0];
+  unsigned N = newNode(Node::Concat);
+  Nodes[N].Kids.swap(Pieces);
+  return N;
+}
+
+/// parseExpression - Parse an atom and the repetition operator after it, if
+/// any, like p_ere_exp.
+unsigned RegexParser::parseExpression() {
+  unsigned Atom;
+  bool WasCaret = false;
+  char C = *Cur++;
+  switch (C) {
+  case '(': {
+    unsigned Group = ++NumGroups;
+    unsigned Body = Cur != End && *Cur == ')' ? newNode(Node::Empty)
+                                              : parseAlternation(true);
+    if (!eat(')'))
+      return fail();
+    Atom = newNode(Node::Group, Group);
+    Nodes[Atom].Kids.push_back(Body);
+    break;
+  }
+  case '^':
+    Atom = newNode(Node::BOL);
+    WasCaret = true;
+    break;
+  case '$':
+    Atom = newNode(Node::EOL);
+    break;
+  case '.': {
+    std::bitset<256> Set;
+    Set.set();
+    if (A.Flags & Regex::Newline)
+      Set.reset('\n');
+    Atom = addSet(Set);
+    break;
+  }
+  case '[':
+    Atom = parseBracket();
+    break;
+  case '\\':
+    if (Cur == End)
+      return fail();
+    Atom = ordinary(*Cur++);
+    break;
+  case ')': case '|': case '*': case '+': case '?':
+    return fail();
+  case '{':
+    // An opening brace is an ordinary character unless a digit follows.
+    if (seeDigit(Cur))
+      return fail();
+    // FALLTHROUGH
+  default:
+    Atom = ordinary(C);
+    break;
+  }
+  if (Failed || Cur == End)
+    return Atom;
+
+  unsigned Min, Max;
+  switch (*Cur) {
+  case '*': Min = 0; Max = ~0U; ++Cur; break;
+  case '+': Min = 1; Max = ~0U; ++Cur; break;
+  case '?': Min = 0; Max = 1; ++Cur; break;
+  case '{':
+    // A brace starts a bound only if a digit follows.
+    if (!seeDigit(Cur + 1))
+      return Atom;
+    ++Cur;
+    Min = Max = parseCount();
+    if (eat(','))
+      Max = seeDigit(Cur) ? parseCount() : ~0U;
+    if (!eat('}') || Min > Max)
+      return fail();
+    break;
+  default:
+    return Atom;
+  }
+  if (WasCaret)
+    return fail();
+
+  unsigned N = newNode(Node::Repeat);
+  Nodes[N].Min = Min;
+  Nodes[N].Max = Max;
+  Nodes[N].Kids.push_back(Atom);
+  return N;
+}
+
+unsigned RegexParser::parseCount() {
+  unsigned Count = 0;
+  while (seeDigit(Cur) && Count <= 255)
+    Count = Count * 10 + (*Cur++ - '0');
+  if (Count > 255)
+    fail();
+  return Count;
+}
+
+unsigned RegexParser::ordinary(unsigned char C) {
+  std::bitset<256> Set;
+  Set.set(C);
+  if ((A.Flags & Regex::IgnoreCase) && isalpha(C)) {
+    Set.set(tolower(C));
+    Set.set(toupper(C));
+  }
+  return addSet(Set);
+}
+
+/// parseBracket - Parse a bracket expression, like p_bracket.
+unsigned RegexParser::parseBracket() {
+  // Word boundaries.
+  if (End - Cur >= 6 && (memcmp(Cur, "[:<:]]", 6) == 0 ||
+                         memcmp(Cur, "[:>:]]", 6) == 0))
+    return fail();
+
+  std::bitset<256> Set;
+  bool Invert = eat('^');
+  if (eat(']'))
+    Set.set(']');
+  else if (eat('-'))
+    Set.set('-');
+  while (!Failed && Cur != End && *Cur != ']' &&
+         !(*Cur == '-' && Cur + 1 != End && Cur[1] == ']'))
+    parseBracketTerm(Set);
+  if (eat('-'))
+    Set.set('-');
+  if (Failed || !eat(']'))
+    return fail();
+
+  if (A.Flags & Regex::IgnoreCase)
+    for (unsigned C = 0; C != 128; ++C)
+      if (Set[C] && isalpha(C)) {
+        Set.set(tolower(C));
+        Set.set(toupper(C));
+      }
+  if (Invert) {
+    Set.flip();
+    if (A.Flags & Regex::Newline)
+      Set.reset('\n');
+  }
+  return addSet(Set);
+}
+
+void RegexParser::parseBracketTerm(std::bitset<256> &Set) {
+  if (*Cur == '-') {
+    fail();
+    return;
+  }
+  if (*Cur == '[' && Cur + 1 != End) {
+    // Equivalence classes and collating elements.
+    if (Cur[1] == '=' || Cur[1] == '.') {
+      fail();
+      return;
+    }
+    if (Cur[1] == ':') {
+      Cur += 2;
+      const char *Name = Cur;
+      while (Cur != End && isalpha((unsigned char)*Cur))
+        ++Cur;
+      size_t Len = Cur - Name;
+      const struct cclass *Class = cclasses;
+      while (Class->name &&
+             (strncmp(Class->name, Name, Len) != 0 || Class->name[Len]))
+        ++Class;
+      if (!Class->name || !eat(':') || !eat(']')) {
+        fail();
+        return;
+      }
+      for (const char *C = Class->chars; *C; ++C)
+        Set.set((unsigned char)*C);
+      return;
+    }
+  }
+
+  unsigned char Start = *Cur++, Finish = Start;
+  if (Cur != End && *Cur == '-' && Cur + 1 != End && Cur[1] != ']') {
+    ++Cur;
+    if (*Cur == '[' && Cur + 1 != End && Cur[1] == '.') {
+      fail();
+      return;
+    }
+    Finish = *Cur++;
+  }
+  if (Start > Finish) {
+    fail();
+    return;
+  }
+  for (unsigned C = Start; C <= Finish; ++C)
+    Set.set(C);
+}
+
+/// canBeEmpty - Return true if node N matches the empty string.
+bool RegexParser::canBeEmpty(unsigned N) const {
+  const Node &Nd = Nodes[N];
+  switch (Nd.Kind) {
+  case Node::Set:
+    return false;
+  case Node::Concat:
+  case Node::Group:
+    for (unsigned i = 0, e = Nd.Kids.size(); i != e; ++i)
+      if (!canBeEmpty(Nd.Kids[i]))
+        return false;
+    return true;
+  case Node::Alt:
+    for (unsigned i = 0, e = Nd.Kids.size(); i != e; ++i)
+      if (canBeEmpty(Nd.Kids[i]))
+        return true;
+    return false;
+  case Node::Repeat:
+    return Nd.Min == 0 || canBeEmpty(Nd.Kids[0]);
+  default:
+    return true;
+  }
+}
+
+/// isAmbiguous - Return true if node N can match a string in more than one
+/// way: if it contains an alternation or a repetition within a repetition.
+/// InRepeat says whether N itself is within one.
+bool RegexParser::isAmbiguous(unsigned N, bool InRepeat) const {
+  const Node &Nd = Nodes[N];
+  switch (Nd.Kind) {
+  case Node::Alt:
+    return true;
+  case Node::Concat:
+  case Node::Group:
+    for (unsigned i = 0, e = Nd.Kids.size(); i != e; ++i)
+      if (isAmbiguous(Nd.Kids[i], InRepeat))
+        return true;
+    return false;
+  case Node::Repeat:
+    return InRepeat || isAmbiguous(Nd.Kids[0], true);
+  default:
+    return false;
+  }
+}
+
+/// emit - Append the instructions for node N to the program.  Alternatives
+/// and repetitions put the branch that matches more first, which the Pike VM
+/// prefers.
+void RegexParser::emit(unsigned N) {
+  if (Failed || A.Prog.size() > MaxInsts) {
+    Failed = true;
+    return;
+  }
+  const Node &Nd = Nodes[N];
+  switch (Nd.Kind) {
+  case Node::Empty:
+    break;
+  case Node::Set:
+    push(RegexAutomaton::Byte, Nd.Arg);
+    break;
+  case Node::BOL:
+    push(RegexAutomaton::AssertBOL);
+    break;
+  case Node::EOL:
+    push(RegexAutomaton::AssertEOL);
+    break;
+  case Node::Concat:
+    for (unsigned i = 0, e = Nd.Kids.size(); i != e; ++i)
+      emit(Nd.Kids[i]);
+    break;
+  case Node::Group:
+    push(RegexAutomaton::Save, 2 * Nd.Arg);
+    emit(Nd.Kids[0]);
+    push(RegexAutomaton::Save, 2 * Nd.Arg + 1);
+    break;
+  case Node::Alt: {
+    SmallVector<unsigned, 8> Jumps;
+    for (unsigned i = 0, e = Nd.Kids.size(); i != e; ++i) {
+      if (i + 1 == e) {
+        emit(Nd.Kids[i]);
+        break;
+      }
+      unsigned Split = push(RegexAutomaton::Split);
+      emit(Nd.Kids[i]);
+      Jumps.push_back(push(RegexAutomaton::Jmp));
+      A.Prog[Split].Y = A.Prog.size();
+    }
+    for (unsigned i = 0, e = Jumps.size(); i != e; ++i)
+      A.Prog[Jumps[i]].X = A.Prog.size();
+    break;
+  }
+  case Node::Repeat: {
+    // Like regexec, only let the first iteration match the empty string.
+    // Later ones that could record where they start in a slot of their own,
+    // and die if they get nowhere.
+    unsigned Kid = Nd.Kids[0], Min = Nd.Min, Max = Nd.Max;
+    unsigned Slot = canBeEmpty(Kid) ? A.NumSlots++ : ~0U;
+    if (Max == ~0U) {
+      // Emit x{m,} as x{m-1}x+, and x* as (x+)?.
+      for (unsigned i = 1; i < Min && !Failed; ++i)
+        emit(Kid);
+      unsigned Skip = Min ? ~0U : push(RegexAutomaton::Split);
+      if (Slot != ~0U)
+        push(RegexAutomaton::Clear, Slot);
+      unsigned Body = A.Prog.size();
+      emit(Kid);
+      if (Slot != ~0U)
+        push(RegexAutomaton::Progress, Slot);
+      unsigned Again = push(RegexAutomaton::Split);
+      if (Slot != ~0U)
+        push(RegexAutomaton::Save, Slot);
+      A.Prog[push(RegexAutomaton::Jmp)].X = Body;
+      A.Prog[Again].Y = A.Prog.size();
+      if (Skip != ~0U)
+        A.Prog[Skip].Y = A.Prog.size();
+      break;
+    }
+    for (unsigned i = 0; i != Min && !Failed; ++i)
+      emit(Kid);
+    SmallVector<unsigned, 8> Splits;
+    for (unsigned i = Min; i != Max && !Failed; ++i) {
+      bool Guard = Slot != ~0U && i != 0;
+      Splits.push_back(push(RegexAutomaton::Split));
+      if (Guard)
+        push(RegexAutomaton::Save, Slot);
+      emit(Kid);
+      if (Guard)
+        push(RegexAutomaton::Progress, Slot);
+    }
+    for (unsigned i = 0, e = Splits.size(); i != e; ++i)
+      A.Prog[Splits[i]].Y = A.Prog.size();
+    break;
+  }
+  }
+}
+
+RegexAutomaton *RegexAutomaton::compile(StringRef Pattern, unsigned Flags,
+                                        unsigned NumSubs) {
+  // Ranges and case folding of non-ASCII characters depend on the signedness
+  // of char and on the locale in regcomp; leave them to it.
+  for (StringRef::iterator I = Pattern.begin(), E = Pattern.end(); I != E; ++I)
+    if ((unsigned char)*I >= 128)
+      return 0;
+
+  OwningPtr<RegexAutomaton> A(new RegexAutomaton());
+  A->Flags = Flags;
+  A->NumSlots = A->NumMatchSlots = 2 * (NumSubs + 1);
+  RegexParser Parser(*A, Pattern);
+  if (!Parser.parse() || Parser.NumGroups != NumSubs)
+    return 0;
+  A->computeClasses();
+  A->Marks.resize(A->Prog.size());
+
+  // If every match starts with the same character, the search can skip to
+  // the next one with memchr.
+  std::vector<unsigned> ByteInsts;
+  if (!A->closure(std::vector<unsigned>(1, 0), true, true, &ByteInsts)) {
+    std::bitset<256> First;
+    for (unsigned i = 0, e = ByteInsts.size(); i != e; ++i)
+      First |= A->Sets[A->Prog[ByteInsts[i]].Arg];
+    if (First.count() == 1)
+      for (unsigned C = 0; C != 256; ++C)
+        if (First[C])
+          A->FirstByte = C;
+  }
+  return A.take();
+}
+
+void RegexAutomaton::computeClasses() {
+  // Characters belong to the same class if they are in the same sets.  The
+  // newline gets a class of its own, since it ends lines.  Start from those
+  // two classes and split every class that a set only has part of.
+  std::fill(ByteClass, ByteClass + 256, 0);
+  ByteClass['\n'] = 1;
+  std::vector<unsigned> Size(2), InSet;
+  Size[0] = 255;
+  Size[1] = 1;
+  std::vector<int> Split;
+  for (unsigned i = 0, e = Sets.size(); i != e; ++i) {
+    const std::bitset<256> &Set = Sets[i];
+    InSet.assign(Size.size(), 0);
+    for (unsigned C = 0; C != 256; ++C)
+      if (Set[C])
+        ++InSet[ByteClass[C]];
+    Split.assign(Size.size(), -1);
+    for (unsigned C = 0; C != 256; ++C) {
+      unsigned Class = ByteClass[C];
+      if (!Set[C] || InSet[Class] == Size[Class])
+        continue;
+      if (Split[Class] < 0) {
+        Split[Class] = Size.size();
+        Size.push_back(0);
+      }
+      ByteClass[C] = Split[Class];
+      ++Size[Split[Class]];
+    }
+    for (unsigned Class = 0, e = Split.size(); Class != e; ++Class)
+      if (Split[Class] >= 0)
+        Size[Class] -= Size[Split[Class]];
+  }
+
+  ClassRep.resize(Size.size());
+  for (unsigned C = 256; C-- != 0; )
+    ClassRep[ByteClass[C]] = C;
+}
+
+bool RegexAutomaton::isLineStart(StringRef String, size_t Pos) const {
+  return Pos == 0 || ((Flags & Regex::Newline) && String[Pos - 1] == '\n');
+}
+
+bool RegexAutomaton::isLineEnd(StringRef String, size_t Pos) const {
+  return Pos == String.size() ||
+         ((Flags & Regex::Newline) && String[Pos] == '\n');
+}
+
+void RegexAutomaton::nextGeneration() {
+  if (++Generation == 0) {
+    std::fill(Marks.begin(), Marks.end(), 0);
+    Generation = 1;
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// DFA
+//===----------------------------------------------------------------------===//
+
+unsigned RegexAutomaton::getState(const std::vector<unsigned> &Kernel,
+                                  bool AtLineStart) {
+  std::vector<unsigned> Key(Kernel);
+  Key.push_back(AtLineStart);
+  std::pair<std::map<std::vector<unsigned>, unsigned>::iterator, bool> Entry =
+    StateMap.insert(std::make_pair(Key, unsigned(States.size())));
+  if (!Entry.second)
+    return Entry.first->second;
+
+  States.push_back(DFAState());
+  DFAState &S = States.back();
+  S.Kernel = Kernel;
+  S.AtLineStart = AtLineStart;
+  S.AtEnd = -1;
+  Transitions.resize(Transitions.size() + ClassRep.size(), -1);
+  CacheSize += 2 * Key.size() + ClassRep.size();
+  // Instruction 0 begins every kernel, so a kernel of one is just the thread
+  // starting at the current position.
+  if (Kernel.size() == 1)
+    InitialStates[AtLineStart] = States.size() - 1;
+  return States.size() - 1;
+}
+
+/// closure - Follow the epsilon transitions from Kernel, with BOL and EOL
+/// telling whether the assertions hold.  Collect the Byte instructions
+/// reached in ByteInsts, and return true if Match is reached.
+bool RegexAutomaton::closure(const std::vector<unsigned> &Kernel, bool BOL,
+                             bool EOL, std::vector<unsigned> *ByteInsts) {
+  nextGeneration();
+  std::vector<unsigned> Stack(Kernel.rbegin(), Kernel.rend());
+  bool Matched = false;
+  while (!Stack.empty()) {
+    unsigned PC = Stack.back();
+    Stack.pop_back();
+    if (Marks[PC] == Generation)
+      continue;
+    Marks[PC] = Generation;
+    const Inst &I = Prog[PC];
+    switch (I.Op) {
+    case Byte:
+      if (ByteInsts)
+        ByteInsts->push_back(PC);
+      break;
+    case Split:
+      Stack.push_back(I.Y);
+      Stack.push_back(I.X);
+      break;
+    case Jmp:
+    case Save:
+    case Clear:
+    case Progress:
+      Stack.push_back(I.X);
+      break;
+    case AssertBOL:
+      if (BOL)
+        Stack.push_back(I.X);
+      break;
+    case AssertEOL:
+      if (EOL)
+        Stack.push_back(I.X);
+      break;
+    case Match:
+      Matched = true;
+      break;
+    }
+  }
+  return Matched;
+}
+
+/// computeTransition - Compute and cache the transition from State on C.
+/// State is updated if the cache had to be flushed to make room.
+int RegexAutomaton::computeTransition(unsigned &State, unsigned char C) {
+  bool EndsLine = (Flags & Regex::Newline) && C == '\n';
+  std::vector<unsigned> ByteInsts;
+  bool Matched = closure(States[State].Kernel, States[State].AtLineStart,
+                         EndsLine, &ByteInsts);
+
+  // The search is unanchored, so a new thread starts at every position.
+  std::vector<unsigned> Kernel(1, 0);
+  for (unsigned i = 0, e = ByteInsts.size(); i != e; ++i)
+    if (Sets[Prog[ByteInsts[i]].Arg][C])
+      Kernel.push_back(Prog[ByteInsts[i]].X);
+  std::sort(Kernel.begin(), Kernel.end());
+  Kernel.erase(std::unique(Kernel.begin(), Kernel.end()), Kernel.end());
+
+  if (CacheSize > MaxCacheSize) {
+    std::vector<unsigned> OldKernel;
+    OldKernel.swap(States[State].Kernel);
+    bool OldAtLineStart = States[State].AtLineStart;
+    States.clear();
+    StateMap.clear();
+    Transitions.clear();
+    InitialStates[0] = InitialStates[1] = -1;
+    CacheSize = 0;
+    State = getState(OldKernel, OldAtLineStart);
+  }
+  int Next = (getState(Kernel, EndsLine) << 1) | Matched;
+  Transitions[State * ClassRep.size() + ByteClass[C]] = Next;
+  return Next;
+}
+
+bool RegexAutomaton::matchesAtEnd(unsigned State) {
+  DFAState &S = States[State];
+  if (S.AtEnd < 0)
+    S.AtEnd = closure(S.Kernel, S.AtLineStart, true, 0);
+  return S.AtEnd;
+}
+
+/// search - Run the DFA over String and return true if a match ends anywhere
+/// in it.  WindowStart is set to the last position before the first match
+/// end where no thread started earlier was alive; no match starts before it.
+bool RegexAutomaton::search(StringRef String, size_t &WindowStart) {
+  unsigned State = getState(std::vector<unsigned>(1, 0), true);
+  const char *Data = String.data();
+  size_t Pos = 0, End = String.size();
+  WindowStart = 0;
+  while (Pos != End) {
+    if (int(State) == InitialStates[0] || int(State) == InitialStates[1]) {
+      // Nothing happens until the thread starting here gets past its first
+      // character.
+      if (FirstByte >= 0 && (unsigned char)Data[Pos] != FirstByte) {
+        const char *P = (const char*)memchr(Data + Pos, FirstByte, End - Pos);
+        if (!P)
+          return false;
+        Pos = P - Data;
+        bool AtLineStart = isLineStart(String, Pos);
+        State = InitialStates[AtLineStart] >= 0 ?
+          InitialStates[AtLineStart] :
+          getState(std::vector<unsigned>(1, 0), AtLineStart);
+      }
+      WindowStart = Pos;
+    }
+    unsigned char C = Data[Pos];
+    int Next = Transitions[State * ClassRep.size() + ByteClass[C]];
+    if (Next < 0)
+      Next = computeTransition(State, C);
+    if (Next & 1)
+      return true;
+    State = Next >> 1;
+    ++Pos;
+  }
+  if (int(State) == InitialStates[0] || int(State) == InitialStates[1])
+    WindowStart = End;
+  return matchesAtEnd(State);
+}
+
+//===----------------------------------------------------------------------===//
+// Pike VM
+//===----------------------------------------------------------------------===//
+
+/// Frame - An instruction addThread has still to visit, or, if Slot is not
+/// -1, a slot to restore once the threads through a Save have been added.
+struct RegexAutomaton::Frame {
+  unsigned PC;
+  int Slot;
+  ptrdiff_t Value;
+  Frame(unsigned PC, int Slot = -1, ptrdiff_t Value = 0)
+    : PC(PC), Slot(Slot), Value(Value) {}
+};
+
+/// ThreadList - The threads at a position, from the highest priority to the
+/// lowest, with NumSlots slots each.
+struct RegexAutomaton::ThreadList {
+  std::vector<unsigned> PCs;
+  std::vector<ptrdiff_t> Slots;
+};
+
+/// addThread - Add the threads that reach a Byte or Match instruction from PC
+/// at Pos to List, in priority order.  Slots holds the slots of the thread,
+/// and is restored on return.
+void RegexAutomaton::addThread(ThreadList &List, unsigned PC,
+                               StringRef String, size_t Pos,
+                               std::vector<ptrdiff_t> &Slots,
+                               std::vector<Frame> &Stack) {
+  bool BOL = isLineStart(String, Pos), EOL = isLineEnd(String, Pos);
+  Stack.push_back(Frame(PC));
+  while (!Stack.empty()) {
+    Frame F = Stack.back();
+    Stack.pop_back();
+    if (F.Slot >= 0) {
+      Slots[F.Slot] = F.Value;
+      continue;
+    }
+    if (Marks[F.PC] == Generation)
+      continue;
+    const Inst &I = Prog[F.PC];
+    // A thread killed here leaves the way free for lower priority ones.
+    if (I.Op == Progress && Slots[I.Arg] == ptrdiff_t(Pos))
+      continue;
+    Marks[F.PC] = Generation;
+    switch (I.Op) {
+    case Byte:
+    case Match:
+      List.PCs.push_back(F.PC);
+      List.Slots.insert(List.Slots.end(), Slots.begin(), Slots.end());
+      break;
+    case Split:
+      Stack.push_back(Frame(I.Y));
+      Stack.push_back(Frame(I.X));
+      break;
+    case Save:
+    case Clear:
+      Stack.push_back(Frame(0, I.Arg, Slots[I.Arg]));
+      Slots[I.Arg] = I.Op == Save ? ptrdiff_t(Pos) : -1;
+      Stack.push_back(Frame(I.X));
+      break;
+    case Jmp:
+    case Progress:
+      Stack.push_back(Frame(I.X));
+      break;
+    case AssertBOL:
+      if (BOL)
+        Stack.push_back(Frame(I.X));
+      break;
+    case AssertEOL:
+      if (EOL)
+        Stack.push_back(Frame(I.X));
+      break;
+    }
+  }
+}
+
+/// runPikeVM - Find the leftmost-longest match starting at or after Start and
+/// fill in Best with its slots.  Threads started earlier have priority over
+/// later ones, so the leftmost match wins; among threads with the same start,
+/// a longer match replaces a shorter one.
+void RegexAutomaton::runPikeVM(StringRef String, size_t Start,
+                               std::vector<ptrdiff_t> &Best) {
+  ThreadList Lists[2];
+  ThreadList *Cur = &Lists[0], *Next = &Lists[1];
+  std::vector<ptrdiff_t> Slots(NumSlots);
+  std::vector<Frame> Stack;
+  bool Matched = false;
+
+  nextGeneration();
+  for (size_t Pos = Start; ; ++Pos) {
+    if (!Matched) {
+      std::fill(Slots.begin(), Slots.end(), -1);
+      addThread(*Cur, 0, String, Pos, Slots, Stack);
+    }
+    if (Cur->PCs.empty())
+      break;
+
+    nextGeneration();
+    Next->PCs.clear();
+    Next->Slots.clear();
+    for (unsigned T = 0, E = Cur->PCs.size(); T != E; ++T) {
+      const ptrdiff_t *ThreadSlots = &Cur->Slots[T * NumSlots];
+      // Threads that started after the match can't beat it.
+      if (Matched && ThreadSlots[0] > Best[0])
+        continue;
+      const Inst &I = Prog[Cur->PCs[T]];
+      if (I.Op == Match) {
+        if (!Matched || ThreadSlots[0] < Best[0] || ThreadSlots[1] > Best[1])
+          Best.assign(ThreadSlots, ThreadSlots + NumSlots);
+        Matched = true;
+        continue;
+      }
+      if (Pos != String.size() && Sets[I.Arg][(unsigned char)String[Pos]]) {
+        Slots.assign(ThreadSlots, ThreadSlots + NumSlots);
+        addThread(*Next, I.X, String, Pos + 1, Slots, Stack);
+      }
+    }
+    if (Pos == String.size())
+      break;
+    std::swap(Cur, Next);
+  }
+}
+
+bool RegexAutomaton::match(StringRef String,
+                           SmallVectorImpl<StringRef> *Matches) {
+  sys::ScopedLock Guard(Lock);
+  size_t WindowStart;
+  if (!search(String, WindowStart))
+    return false;
+  if (!Matches)
+    return true;
+
+  std::vector<ptrdiff_t> Best(NumSlots, -1);
+  runPikeVM(String, WindowStart, Best);
+  assert(Best[0] >= 0 && "The DFA and the Pike VM disagree");
+
+  Matches->clear();
+  for (unsigned i = 0; i != NumMatchSlots; i += 2) {
+    if (Best[i] < 0 || Best[i + 1] < 0) {
+      // This group didn't match.
+      Matches->push_back(StringRef());
+      continue;
+    }
+    Matches->push_back(StringRef(String.data() + Best[i],
+                                 Best[i + 1] - Best[i]));
+  }
+  return true;
+}
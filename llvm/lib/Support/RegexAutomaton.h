@@ -0,0 +1,157 @@
+//===-- RegexAutomaton.h - Linear time regular expression matcher -*- C++ -*-=//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the automaton Regex matches with when it can.  The
+// pattern is compiled to a Thompson NFA; a DFA built lazily from it finds out
+// whether and where a match ends, and a Pike VM simulating the NFA over just
+// the region around the match fills in the submatches.  Both take time linear
+// in the length of the string, unlike the backtracking in regexec.  Where the
+// submatches of a pattern are ambiguous, Regex has regexec place them within
+// the match the automaton found.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_REGEXAUTOMATON_H
+#define LLVM_SUPPORT_REGEXAUTOMATON_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Mutex.h"
+#include <bitset>
+#include <cstddef>
+#include <map>
+#include <vector>
+
+namespace llvm {
+  template<typename T> class SmallVectorImpl;
+
+  class RegexAutomaton {
+  public:
+    /// compile - Compile \arg Pattern, which regcomp has accepted with the
+    /// given Regex flags and found \arg NumSubs subexpressions in.  Return
+    /// null if the pattern uses something the automaton doesn't implement
+    /// (collating elements, equivalence classes, word boundaries, non-ASCII
+    /// characters) or would need too many states to represent.
+    static RegexAutomaton *compile(StringRef Pattern, unsigned Flags,
+                                   unsigned NumSubs);
+
+    /// match - Match the pattern against \arg String like Regex::match.  The
+    /// whole match is the leftmost-longest one, as POSIX requires.  Within
+    /// it, earlier subexpressions and iterations match as much as they can,
+    /// which agrees with regexec for all but ambiguous patterns.  Several
+    /// threads may match with the same automaton; they take turns.
+    bool match(StringRef String, SmallVectorImpl<StringRef> *Matches);
+
+    /// hasAmbiguousSubmatches - Whether the pattern has subexpressions and an
+    /// alternation or a repetition within a repetition, so that regexec may
+    /// divide a match among the subexpressions differently than match does.
+    bool hasAmbiguousSubmatches() const { return Ambiguous; }
+
+    /// isLineStart, isLineEnd - Whether ^ and $ match at Pos in String.
+    bool isLineStart(StringRef String, size_t Pos) const;
+    bool isLineEnd(StringRef String, size_t Pos) const;
+
+  private:
+    enum Opcode {
+      Byte,        // Consume a character in Sets[Arg], go to X.
+      Split,       // Go to X and, with lower priority, to Y.
+      Jmp,         // Go to X.
+      Save,        // Record the position in slot Arg, go to X.
+      Clear,       // Forget the position in slot Arg, go to X.
+      Progress,    // Go to X unless slot Arg holds the position.
+      AssertBOL,   // Go to X at the start of a line.
+      AssertEOL,   // Go to X at the end of a line.
+      Match        // Match found.
+    };
+
+    struct Inst {
+      Opcode Op;
+      unsigned Arg, X, Y;
+    };
+
+    struct Frame;
+    struct ThreadList;
+
+    /// DFAState - A state of the DFA: the set of instructions to continue the
+    /// threads from before taking their epsilon closure, and whether the
+    /// previous character ended a line.
+    struct DFAState {
+      std::vector<unsigned> Kernel;
+      bool AtLineStart;
+
+      /// AtEnd - Whether a match ends at the end of the string, or -1.
+      int AtEnd;
+    };
+
+    unsigned Flags;
+    bool Ambiguous;
+
+    /// NumMatchSlots, NumSlots - The slots holding the bounds of the match
+    /// and of its subexpressions come first, then those of the loops.
+    unsigned NumMatchSlots, NumSlots;
+    std::vector<Inst> Prog;
+    std::vector<std::bitset<256> > Sets;
+
+    /// ByteClass - Characters that no set tells apart share a class, and the
+    /// DFA transitions are per class.  ClassRep has one character of each.
+    unsigned ByteClass[256];
+    std::vector<unsigned char> ClassRep;
+
+    /// States, StateMap - The DFA states built so far, and their indices by
+    /// kernel, which take up CacheSize words.  They are thrown away when that
+    /// grows too big.
+    std::vector<DFAState> States;
+    std::map<std::vector<unsigned>, unsigned> StateMap;
+    size_t CacheSize;
+
+    /// Transitions - The transition from each state on each character class:
+    /// the next state shifted left by one, with bit 0 set if a match ends
+    /// before the character, or -1 if it hasn't been computed yet.
+    std::vector<int> Transitions;
+
+    /// InitialStates - The states in which only the thread starting at the
+    /// current position is alive, after a character that doesn't end a line
+    /// and after one that does, or -1 if they haven't been built yet.
+    int InitialStates[2];
+
+    /// FirstByte - The character every match starts with, if there is one,
+    /// or -1.
+    int FirstByte;
+
+    /// Marks, Generation - Instructions already visited by the current
+    /// closure are marked with its generation.
+    std::vector<unsigned> Marks;
+    unsigned Generation;
+
+    /// Lock - Held by match, which builds the DFA and uses Marks.
+    sys::Mutex Lock;
+
+    RegexAutomaton()
+      : Ambiguous(false), CacheSize(0), FirstByte(-1), Generation(0) {
+      InitialStates[0] = InitialStates[1] = -1;
+    }
+
+    void computeClasses();
+    unsigned getState(const std::vector<unsigned> &Kernel, bool AtLineStart);
+    bool closure(const std::vector<unsigned> &Kernel, bool BOL, bool EOL,
+                 std::vector<unsigned> *ByteInsts);
+    int computeTransition(unsigned &State, unsigned char C);
+    bool matchesAtEnd(unsigned State);
+    bool search(StringRef String, size_t &WindowStart);
+    void nextGeneration();
+    void addThread(ThreadList &List, unsigned PC, StringRef String,
+                   size_t Pos, std::vector<ptrdiff_t> &Slots,
+                   std::vector<Frame> &Stack);
+    void runPikeVM(StringRef String, size_t Start,
+                   std::vector<ptrdiff_t> &Best);
+
+    friend class RegexParser;
+  };
+}
+
+#endif // LLVM_SUPPORT_REGEXAUTOMATON_H
@@ -0,0 +1,143 @@
+//===-- SHA256.cpp - SHA-256 message digest -------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the SHA-256 digest, following FIPS 180-4.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/SHA256.h"
+#include <cstring>
+using namespace llvm;
+
+/// RoundConstants - The first 32 bits of the fractional parts of the cube
+/// roots of the first 64 primes.
+static const uint32_t RoundConstants[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+  0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+  0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+  0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+  0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+  0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t rotr(uint32_t X, unsigned N) {
+  return (X >> N) | (X << (32 - N));
+}
+
+void SHA256::init() {
+  // The first 32 bits of the fractional parts of the square roots of the
+  // first 8 primes.
+  State[0] = 0x6a09e667;
+  State[1] = 0xbb67ae85;
+  State[2] = 0x3c6ef372;
+  State[3] = 0xa54ff53a;
+  State[4] = 0x510e527f;
+  State[5] = 0x9b05688c;
+  State[6] = 0x1f83d9ab;
+  State[7] = 0x5be0cd19;
+  Length = 0;
+}
+
+void SHA256::processBlock(const uint8_t *Block) {
+  uint32_t W[64];
+  for (unsigned i = 0; i != 16; ++i)
+    W[i] = (uint32_t(Block[4 * i]) << 24) | (uint32_t(Block[4 * i + 1]) << 16) |
+           (uint32_t(Block[4 * i + 2]) << 8) | uint32_t(Block[4 * i + 3]);
+  for (unsigned i = 16; i != 64; ++i) {
+    uint32_t S0 = rotr(W[i - 15], 7) ^ rotr(W[i - 15], 18) ^ (W[i - 15] >> 3);
+    uint32_t S1 = rotr(W[i - 2], 17) ^ rotr(W[i - 2], 19) ^ (W[i - 2] >> 10);
+    W[i] = W[i - 16] + S0 + W[i - 7] + S1;
+  }
+
+  uint32_t A = State[0], B = State[1], C = State[2], D = State[3];
+  uint32_t E = State[4], F = State[5], G = State[6], H = State[7];
+  for (unsigned i = 0; i != 64; ++i) {
+    uint32_t S1 = rotr(E, 6) ^ rotr(E, 11) ^ rotr(E, 25);
+    uint32_t Ch = (E & F) ^ (~E & G);
+    uint32_t T1 = H + S1 + Ch + RoundConstants[i] + W[i];
+    uint32_t S0 = rotr(A, 2) ^ rotr(A, 13) ^ rotr(A, 22);
+    uint32_t Maj = (A & B) ^ (A & C) ^ (B & C);
+    uint32_t T2 = S0 + Maj;
+    H = G;
+    G = F;
+    F = E;
+    E = D + T1;
+    D = C;
+    C = B;
+    B = A;
+    A = T1 + T2;
+  }
+  State[0] += A;
+  State[1] += B;
+  State[2] += C;
+  State[3] += D;
+  State[4] += E;
+  State[5] += F;
+  State[6] += G;
+  State[7] += H;
+}
+
+void SHA256::update(StringRef Data) {
+  const uint8_t *P = (const uint8_t*)Data.data();
+  size_t Size = Data.size();
+  unsigned Buffered = Length % 64;
+  Length += Size;
+
+  // Complete the block started by earlier data first.
+  if (Buffered) {
+    size_t N = 64 - Buffered < Size ? 64 - Buffered : Size;
+    memcpy(Buffer + Buffered, P, N);
+    P += N;
+    Size -= N;
+    if (Buffered + N != 64)
+      return;
+    processBlock(Buffer);
+  }
+  for (; Size >= 64; P += 64, Size -= 64)
+    processBlock(P);
+  memcpy(Buffer, P, Size);
+}
+
+void SHA256::final(uint8_t Result[DigestSize]) {
+  // Append a one bit, zeros up to 8 bytes before the end of a block, and the
+  // length of the data in bits.
+  uint64_t BitLength = Length * 8;
+  static const uint8_t Padding[64] = { 0x80 };
+  unsigned Buffered = Length % 64;
+  update(StringRef((const char*)Padding,
+                   Buffered < 56 ? 56 - Buffered : 120 - Buffered));
+  uint8_t LengthBytes[8];
+  for (unsigned i = 0; i != 8; ++i)
+    LengthBytes[i] = uint8_t(BitLength >> (56 - 8 * i));
+  update(StringRef((const char*)LengthBytes, 8));
+
+  for (unsigned i = 0; i != 8; ++i)
+    for (unsigned j = 0; j != 4; ++j)
+      Result[4 * i + j] = uint8_t(State[i] >> (24 - 8 * j));
+}
+
+std::string SHA256::hashToHex(StringRef Data) {
+  SHA256 Hash;
+  Hash.update(Data);
+  uint8_t Digest[DigestSize];
+  Hash.final(Digest);
+
+  static const char Hex[] = "0123456789abcdef";
+  std::string Result;
+  for (unsigned i = 0; i != DigestSize; ++i) {
+    Result += Hex[Digest[i] >> 4];
+    Result += Hex[Digest[i] & 15];
+  }
+  return Result;
+}
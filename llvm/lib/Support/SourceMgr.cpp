@@ -18,29 +18,18 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/system_error.h"
+#include <algorithm>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 using namespace llvm;
 
-namespace {
-  struct LineNoCacheTy {
-    int LastQueryBufferID;
-    const char *LastQuery;
-    unsigned LineNoOfQuery;
-  };
-}
-
-static LineNoCacheTy *getCache(void *Ptr) {
-  return (LineNoCacheTy*)Ptr;
-}
-
-
 SourceMgr::~SourceMgr() {
-  // Delete the line # cache if allocated.
-  if (LineNoCacheTy *Cache = getCache(LineNoCache))
-    delete Cache;
-
   while (!Buffers.empty()) {
     delete Buffers.back().Buffer;
+    delete Buffers.back().LineOffsets;
     Buffers.pop_back();
   }
 }
@@ -79,46 +68,57 @@ int SourceMgr::FindBufferContainingLoc(SMLoc Loc) const {
   return -1;
 }
 
-/// FindLineNumber - Find the line number for the specified location in the
-/// specified file.  This is not a fast method.
-unsigned SourceMgr::FindLineNumber(SMLoc Loc, int BufferID) const {
-  if (BufferID == -1) BufferID = FindBufferContainingLoc(Loc);
-  assert(BufferID != -1 && "Invalid Location!");
-
-  MemoryBuffer *Buff = getBufferInfo(BufferID).Buffer;
-
-  // Count the number of \n's between the start of the file and the specified
-  // location.
-  unsigned LineNo = 1;
-
-  const char *Ptr = Buff->getBufferStart();
-
-  // If we have a line number cache, and if the query is to a later point in the
-  // same file, start searching from the last query location.  This optimizes
-  // for the case when multiple diagnostics come out of one file in order.
-  if (LineNoCacheTy *Cache = getCache(LineNoCache))
-    if (Cache->LastQueryBufferID == BufferID &&
-        Cache->LastQuery <= Loc.getPointer()) {
-      Ptr = Cache->LastQuery;
-      LineNo = Cache->LineNoOfQuery;
-    }
+/// findNewlines - Append the offsets from Start of the newlines between Start
+/// and End to Offsets.
+static void findNewlines(const char *Start, const char *End,
+                         std::vector<unsigned> &Offsets) {
+  const char *Ptr = Start;
+#if defined(__SSE2__)
+  // Compare 16 characters at a time against '\n', and visit the bits set in
+  // the resulting mask.
+  const __m128i Newline = _mm_set1_epi8('\n');
+  for (; End - Ptr >= 16; Ptr += 16) {
+    __m128i Chunk = _mm_loadu_si128((const __m128i*)Ptr);
+    unsigned Mask = _mm_movemask_epi8(_mm_cmpeq_epi8(Chunk, Newline));
+    for (; Mask; Mask &= Mask - 1)
+      Offsets.push_back(Ptr - Start + CountTrailingZeros_32(Mask));
+  }
+#endif
+  for (; Ptr != End; ++Ptr)
+    if (*Ptr == '\n')
+      Offsets.push_back(Ptr - Start);
+}
 
-  // Scan for the location being queried, keeping track of the number of lines
-  // we see.
-  for (; SMLoc::getFromPointer(Ptr) != Loc; ++Ptr)
-    if (*Ptr == '\n') ++LineNo;
+/// getLineOffsets - Return the offsets of the newlines in the specified
+/// buffer, finding them if this is the first time they are needed.
+const std::vector<unsigned> &
+SourceMgr::getLineOffsets(unsigned BufferID) const {
+  const SrcBuffer &SB = getBufferInfo(BufferID);
+  if (!SB.LineOffsets) {
+    SB.LineOffsets = new std::vector<unsigned>();
+    findNewlines(SB.Buffer->getBufferStart(), SB.Buffer->getBufferEnd(),
+                 *SB.LineOffsets);
+  }
+  return *SB.LineOffsets;
+}
 
+/// getLineAndColumn - Find the line and column numbers, both counted from
+/// one, for the specified location in the specified file.
+std::pair<unsigned, unsigned>
+SourceMgr::getLineAndColumn(SMLoc Loc, int BufferID) const {
+  if (BufferID == -1) BufferID = FindBufferContainingLoc(Loc);
+  assert(BufferID != -1 && "Invalid Location!");
 
-  // Allocate the line number cache if it doesn't exist.
-  if (LineNoCache == 0)
-    LineNoCache = new LineNoCacheTy();
+  const std::vector<unsigned> &Offsets = getLineOffsets(BufferID);
+  unsigned Offset =
+    Loc.getPointer() - getBufferInfo(BufferID).Buffer->getBufferStart();
 
-  // Update the line # cache.
-  LineNoCacheTy &Cache = *getCache(LineNoCache);
-  Cache.LastQueryBufferID = BufferID;
-  Cache.LastQuery = Ptr;
-  Cache.LineNoOfQuery = LineNo;
-  return LineNo;
+  // Every newline before the location ends a line before the one it is on.
+  std::vector<unsigned>::const_iterator I =
+    std::lower_bound(Offsets.begin(), Offsets.end(), Offset);
+  unsigned LineNo = I - Offsets.begin() + 1;
+  unsigned LineStart = I == Offsets.begin() ? 0 : I[-1] + 1;
+  return std::make_pair(LineNo, Offset - LineStart + 1);
 }
 
 void SourceMgr::PrintIncludeStack(SMLoc IncludeLoc, raw_ostream &OS) const {
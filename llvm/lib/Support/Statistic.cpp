@@ -19,18 +19,30 @@
 //
 // Later, in the code: ++NumInstEliminated;
 //
+// Each thread bumps its own copy of the counters, in a shard that is summed up
+// with the other threads' when the value is read, so that passes running on
+// several threads don't fight over the cache lines of the counters.
+//
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Config/config.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/Valgrind.h"
 #include "llvm/ADT/StringExtras.h"
 #include <algorithm>
 #include <cstring>
+#include <vector>
+#if LLVM_ENABLE_THREADS != 0 && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#endif
 using namespace llvm;
 
 // CreateInfoOutputFile - Return a file stream to print our output on.
@@ -42,6 +54,13 @@ namespace llvm { extern raw_ostream *CreateInfoOutputFile(); }
 static cl::opt<bool>
 Enabled("stats", cl::desc("Enable statistics output from program"));
 
+/// -stats-json - Command line option to write the statistics to a file as
+/// JSON, see PrintStatisticsJSON.
+///
+static cl::opt<std::string>
+JSONFile("stats-json", cl::value_desc("filename"),
+         cl::desc("Write the statistics to a file as JSON"));
+
 
 namespace {
 /// StatisticInfo - This class is used in a ManagedStatic so that it is created
@@ -51,6 +70,7 @@ class StatisticInfo {
   std::vector<const Statistic*> Stats;
   friend void llvm::PrintStatistics();
   friend void llvm::PrintStatistics(raw_ostream &OS);
+  friend void llvm::PrintStatisticsJSON(raw_ostream &OS);
 public:
   ~StatisticInfo();
 
@@ -63,23 +83,170 @@ public:
 static ManagedStatic<StatisticInfo> StatInfo;
 static ManagedStatic<sys::SmartMutex<true> > StatLock;
 
+namespace {
+/// StatisticShard - The counters of the statistics bumped by one thread, by
+/// statistic ID.  They are split into chunks that are allocated when one of
+/// their statistics is first bumped, and are never moved, so that the other
+/// threads can read them at any time.
+struct StatisticShard {
+  enum { ChunkSize = Statistic::CounterChunkSize, MaxChunks = 64 };
+  volatile sys::cas_flag *Chunks[MaxChunks];
+  StatisticShard *Next;
+  bool InUse;
+};
+}
+
+// The shards and the statistics by ID are guarded by StatLock, and never
+// freed: threads may exit, and statistics be bumped, after llvm_shutdown.
+// Shards are only written without the lock by the threads that own them.
+static StatisticShard *ShardList = 0;
+static std::vector<Statistic*> *StatsByID = 0;
+
+#ifdef LLVM_THREAD_LOCAL
+LLVM_THREAD_LOCAL volatile sys::cas_flag **Statistic::ThreadChunks = 0;
+#endif
+
+/// setThreadChunks - Let the inline fast path of the calling thread find the
+/// counters of S, or send it back to getThreadCounter if S is null.
+static void setThreadChunks(StatisticShard *S) {
+#ifdef LLVM_THREAD_LOCAL
+  Statistic::ThreadChunks = S ? S->Chunks : 0;
+#endif
+}
+
+/// acquireShard - Return an unused shard for the calling thread.
+static StatisticShard *acquireShard() {
+  sys::SmartScopedLock<true> Writer(*StatLock);
+  for (StatisticShard *S = ShardList; S; S = S->Next)
+    if (!S->InUse) {
+      S->InUse = true;
+      return S;
+    }
+
+  StatisticShard *S = new StatisticShard();
+  S->InUse = true;
+  S->Next = ShardList;
+  ShardList = S;
+  return S;
+}
+
+#if LLVM_ENABLE_THREADS != 0 && defined(HAVE_PTHREAD_H)
+
+static pthread_key_t ShardKey;
+static pthread_once_t ShardKeyOnce = PTHREAD_ONCE_INIT;
+
+/// releaseShard - Called when a thread exits: fold the counts of its shard
+/// into the statistics, and let another thread have the shard.
+static void releaseShard(void *Shard) {
+  StatisticShard *S = static_cast<StatisticShard*>(Shard);
+  // This runs on the exiting thread.  Should it bump a statistic afterwards,
+  // it has to come back for a shard of its own.
+  setThreadChunks(0);
+  sys::SmartScopedLock<true> Writer(*StatLock);
+  for (unsigned i = 0, e = StatsByID ? StatsByID->size() : 0; i != e; ++i) {
+    volatile sys::cas_flag *Chunk = S->Chunks[i / StatisticShard::ChunkSize];
+    if (!Chunk)
+      continue;
+    volatile sys::cas_flag &Count = Chunk[i % StatisticShard::ChunkSize];
+    if (Count) {
+      sys::AtomicAdd(&(*StatsByID)[i]->Value, Count);
+      Count = 0;
+    }
+  }
+  S->InUse = false;
+}
+
+static void createShardKey() {
+  pthread_key_create(&ShardKey, releaseShard);
+}
+
+static StatisticShard *getThreadShard() {
+  pthread_once(&ShardKeyOnce, createShardKey);
+  StatisticShard *S =
+    static_cast<StatisticShard*>(pthread_getspecific(ShardKey));
+  if (!S) {
+    S = acquireShard();
+    pthread_setspecific(ShardKey, S);
+    setThreadChunks(S);
+  }
+  return S;
+}
+
+#else
+
+static StatisticShard *getThreadShard() {
+  static StatisticShard *S = acquireShard();
+  setThreadChunks(S);
+  return S;
+}
+
+#endif
+
+/// getThreadCounter - Return the calling thread's counter of the statistic
+/// with the given ID.
+volatile sys::cas_flag &Statistic::getThreadCounter(unsigned ID) {
+  StatisticShard *S = getThreadShard();
+  unsigned Index = ID - 1;
+  unsigned ChunkNo = Index / StatisticShard::ChunkSize;
+  if (!S->Chunks[ChunkNo]) {
+    volatile sys::cas_flag *Chunk =
+      new sys::cas_flag[StatisticShard::ChunkSize]();
+    // Publish the zeroed chunk to the readers.
+    sys::SmartScopedLock<true> Writer(*StatLock);
+    S->Chunks[ChunkNo] = Chunk;
+  }
+  return S->Chunks[ChunkNo][Index % StatisticShard::ChunkSize];
+}
+
+sys::cas_flag Statistic::getValue() const {
+  unsigned I = ID;
+  if (!I)
+    return Value;
+
+  unsigned Index = I - 1;
+  sys::SmartScopedLock<true> Reader(*StatLock);
+  sys::cas_flag Sum = Value;
+  for (StatisticShard *S = ShardList; S; S = S->Next)
+    if (volatile sys::cas_flag *Chunk =
+          S->Chunks[Index / StatisticShard::ChunkSize])
+      Sum += Chunk[Index % StatisticShard::ChunkSize];
+  return Sum;
+}
+
+void Statistic::setValue(unsigned Val) {
+  if (!ID)
+    RegisterStatistic();
+  // The counters keep counting from where they are, so move Value to make up
+  // the difference.
+  sys::AtomicAdd(&Value, Val - getValue());
+}
+
 /// RegisterStatistic - The first time a statistic is bumped, this method is
-/// called.
-void Statistic::RegisterStatistic() {
+/// called.  It returns the ID of the statistic.
+unsigned Statistic::RegisterStatistic() {
   // If stats are enabled, inform StatInfo that this statistic should be
   // printed.
   sys::SmartScopedLock<true> Writer(*StatLock);
-  if (!Initialized) {
-    if (Enabled)
+  if (!ID) {
+    if (AreStatisticsEnabled())
       StatInfo->addStatistic(this);
 
+    if (!StatsByID)
+      StatsByID = new std::vector<Statistic*>();
+    // The fast path in getCounter relies on every ID having a chunk.
+    if (StatsByID->size() ==
+        StatisticShard::ChunkSize * StatisticShard::MaxChunks)
+      report_fatal_error("Too many statistics!");
+    StatsByID->push_back(this);
+
     TsanHappensBefore(this);
     sys::MemoryFence();
     // Remember we have been registered.
     TsanIgnoreWritesBegin();
-    Initialized = true;
+    ID = StatsByID->size();
     TsanIgnoreWritesEnd();
   }
+  return ID;
 }
 
 namespace {
@@ -89,6 +256,9 @@ struct NameCompare {
     int Cmp = std::strcmp(LHS->getName(), RHS->getName());
     if (Cmp != 0) return Cmp < 0;
 
+    Cmp = std::strcmp(LHS->getVarName(), RHS->getVarName());
+    if (Cmp != 0) return Cmp < 0;
+
     // Secondary key is the description.
     return std::strcmp(LHS->getDesc(), RHS->getDesc()) < 0;
   }
@@ -106,7 +276,7 @@ void llvm::EnableStatistics() {
 }
 
 bool llvm::AreStatisticsEnabled() {
-  return Enabled;
+  return Enabled || !JSONFile.empty();
 }
 
 void llvm::PrintStatistics(raw_ostream &OS) {
@@ -139,6 +309,26 @@ void llvm::PrintStatistics(raw_ostream &OS) {
   OS << '\n';  // Flush the output stream.
   OS.flush();
 
+  // Show which subsystems the memory went to, if any allocators are named.
+  PrintAllocatorStatistics(OS);
+}
+
+void llvm::PrintStatisticsJSON(raw_ostream &OS) {
+  StatisticInfo &Stats = *StatInfo;
+
+  std::stable_sort(Stats.Stats.begin(), Stats.Stats.end(), NameCompare());
+
+  OS << "{\n  \"version\": 1,\n  \"statistics\": [";
+  for (size_t i = 0, e = Stats.Stats.size(); i != e; ++i) {
+    const Statistic *S = Stats.Stats[i];
+    OS << (i ? ",\n" : "\n") << "    { \"group\": ";
+    OS.write_json_string(S->getName()) << ", \"name\": ";
+    OS.write_json_string(S->getVarName()) << ", \"desc\": ";
+    OS.write_json_string(S->getDesc()) << ", \"value\": "
+      << (uint64_t)S->getValue() << " }";
+  }
+  OS << "\n  ]\n}\n";
+  OS.flush();
 }
 
 void llvm::PrintStatistics() {
@@ -147,8 +337,22 @@ void llvm::PrintStatistics() {
   // Statistics not enabled?
   if (Stats.Stats.empty()) return;
 
-  // Get the stream to write to.
-  raw_ostream &OutStream = *CreateInfoOutputFile();
-  PrintStatistics(OutStream);
-  delete &OutStream;   // Close the file.
+  if (Enabled) {
+    // Get the stream to write to.
+    raw_ostream &OutStream = *CreateInfoOutputFile();
+    PrintStatistics(OutStream);
+    delete &OutStream;   // Close the file.
+  }
+
+  if (!JSONFile.empty()) {
+    // The file is rewritten each time, so the last call wins.
+    std::string Error;
+    raw_fd_ostream OS(JSONFile.c_str(), Error);
+    if (!Error.empty()) {
+      errs() << "Error opening statistics file '" << JSONFile << "': "
+             << Error << '\n';
+      return;
+    }
+    PrintStatisticsJSON(OS);
+  }
 }
@@ -0,0 +1,387 @@
+//===-- ThreadPool.cpp - Work-stealing thread pool ------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the ThreadPool and TaskGroup classes.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Config/config.h"
+#include <cassert>
+#include <deque>
+#include <vector>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+using namespace llvm;
+
+/// -threads - The number of threads used by parallel algorithms.
+static cl::opt<unsigned>
+NumThreadsOpt("threads",
+              cl::desc("Number of threads used by parallel algorithms "
+                       "(0 = one per hardware thread)"),
+              cl::init(0));
+
+Task::~Task() {}
+
+namespace {
+/// FunctionTask - Adapts a plain function and its argument to a Task.
+class FunctionTask : public Task {
+  void (*Fn)(void*);
+  void *Arg;
+public:
+  FunctionTask(void (*Fn)(void*), void *Arg) : Fn(Fn), Arg(Arg) {}
+  virtual void run() { Fn(Arg); }
+};
+}
+
+#if LLVM_ENABLE_THREADS != 0 && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#include <sched.h>
+
+namespace llvm {
+/// ThreadPoolImpl - The worker threads and task deques of a ThreadPool.
+///
+/// NumQueued counts the tasks sitting in the deques and NumSleeping the
+/// workers that are about to block.  Both are updated with full barriers
+/// before the other one is read, so a worker can't go to sleep while a task
+/// it could run is being pushed without somebody signalling it.
+class ThreadPoolImpl {
+  struct Worker {
+    ThreadPoolImpl *Pool;
+    unsigned Index;
+    pthread_t Thread;
+    pthread_mutex_t Lock;       // Guards Tasks.
+    std::deque<Task*> Tasks;
+  };
+
+  std::vector<Worker*> Workers;
+
+  /// WorkerKey - Maps a worker thread to its Worker, so that tasks spawned
+  /// from a task go to the deque of the thread running it.
+  pthread_key_t WorkerKey;
+
+  /// SleepLock - Guards the condition variables below.
+  pthread_mutex_t SleepLock;
+  pthread_cond_t WorkAvailable;
+  pthread_cond_t TaskDone;
+
+  volatile sys::cas_flag NumQueued;
+  volatile sys::cas_flag NumSleeping;
+  volatile sys::cas_flag NextWorker;
+  volatile bool Stopping;
+
+  static void *WorkerMain(void *Arg);
+  Worker *getCurrentWorker() {
+    return static_cast<Worker*>(pthread_getspecific(WorkerKey));
+  }
+  bool takeFrom(Worker *W, bool Back, Task *&T);
+  Task *pop();
+  bool sleep();
+  void stopWorkers(unsigned NumStarted);
+
+public:
+  explicit ThreadPoolImpl(unsigned NumThreads);
+  ~ThreadPoolImpl();
+
+  unsigned getNumThreads() const { return Workers.size(); }
+
+  void push(Task *T);
+  void execute(Task *T);
+  void wait(TaskGroup &Group);
+};
+}
+
+ThreadPoolImpl::ThreadPoolImpl(unsigned NumThreads)
+  : NumQueued(0), NumSleeping(0), NextWorker(0), Stopping(false) {
+  pthread_key_create(&WorkerKey, 0);
+  pthread_mutex_init(&SleepLock, 0);
+  pthread_cond_init(&WorkAvailable, 0);
+  pthread_cond_init(&TaskDone, 0);
+
+  // A pool of a single thread runs everything on the spawning thread.
+  if (NumThreads < 2)
+    return;
+
+  // Set up all the deques before starting any thread, as workers steal from
+  // each other as soon as they are running.
+  Workers.resize(NumThreads);
+  for (unsigned i = 0; i != NumThreads; ++i) {
+    Worker *W = new Worker();
+    W->Pool = this;
+    W->Index = i;
+    pthread_mutex_init(&W->Lock, 0);
+    Workers[i] = W;
+  }
+
+  for (unsigned i = 0; i != NumThreads; ++i) {
+    if (::pthread_create(&Workers[i]->Thread, 0, WorkerMain, Workers[i]) != 0) {
+      // If we could not start all the threads, stop the ones that are running
+      // and run tasks synchronously instead.
+      stopWorkers(i);
+      break;
+    }
+  }
+}
+
+ThreadPoolImpl::~ThreadPoolImpl() {
+  assert(NumQueued == 0 && "Destroying a thread pool with pending tasks!");
+  stopWorkers(Workers.size());
+
+  pthread_cond_destroy(&TaskDone);
+  pthread_cond_destroy(&WorkAvailable);
+  pthread_mutex_destroy(&SleepLock);
+  pthread_key_delete(WorkerKey);
+}
+
+/// stopWorkers - Wake up and join the first NumStarted workers, then free all
+/// of the workers.
+void ThreadPoolImpl::stopWorkers(unsigned NumStarted) {
+  pthread_mutex_lock(&SleepLock);
+  Stopping = true;
+  pthread_cond_broadcast(&WorkAvailable);
+  pthread_mutex_unlock(&SleepLock);
+
+  for (unsigned i = 0; i != NumStarted; ++i)
+    pthread_join(Workers[i]->Thread, 0);
+
+  for (unsigned i = 0, e = Workers.size(); i != e; ++i) {
+    pthread_mutex_destroy(&Workers[i]->Lock);
+    delete Workers[i];
+  }
+  Workers.clear();
+}
+
+void *ThreadPoolImpl::WorkerMain(void *Arg) {
+  Worker *W = static_cast<Worker*>(Arg);
+  ThreadPoolImpl *Pool = W->Pool;
+  pthread_setspecific(Pool->WorkerKey, W);
+
+  unsigned NumFailedPops = 0;
+  while (true) {
+    if (Task *T = Pool->pop()) {
+      Pool->execute(T);
+      NumFailedPops = 0;
+      continue;
+    }
+
+    // Spin for a little while before going to sleep.  Tasks tend to be spawned
+    // in bursts, and waking a sleeping worker costs far more than a short task.
+    if (++NumFailedPops < 64) {
+      sched_yield();
+      continue;
+    }
+    if (!Pool->sleep())
+      break;
+    NumFailedPops = 0;
+  }
+  return 0;
+}
+
+/// takeFrom - Remove a task from the back (owner side) or front (thief side)
+/// of the deque of W.
+bool ThreadPoolImpl::takeFrom(Worker *W, bool Back, Task *&T) {
+  pthread_mutex_lock(&W->Lock);
+  bool Found = !W->Tasks.empty();
+  if (Found) {
+    if (Back) {
+      T = W->Tasks.back();
+      W->Tasks.pop_back();
+    } else {
+      T = W->Tasks.front();
+      W->Tasks.pop_front();
+    }
+  }
+  pthread_mutex_unlock(&W->Lock);
+  return Found;
+}
+
+/// pop - Find a task for the current thread to run: the most recently pushed
+/// task of its own deque, or else the oldest task of another worker.
+Task *ThreadPoolImpl::pop() {
+  if (NumQueued == 0)
+    return 0;
+
+  Worker *Self = getCurrentWorker();
+  Task *T = 0;
+  if (Self && takeFrom(Self, /*Back=*/true, T)) {
+    sys::AtomicDecrement(&NumQueued);
+    return T;
+  }
+
+  unsigned NumWorkers = Workers.size();
+  unsigned Start = Self ? Self->Index + 1 : 0;
+  for (unsigned i = 0; i != NumWorkers; ++i) {
+    Worker *Victim = Workers[(Start + i) % NumWorkers];
+    if (Victim != Self && takeFrom(Victim, /*Back=*/false, T)) {
+      sys::AtomicDecrement(&NumQueued);
+      return T;
+    }
+  }
+  return 0;
+}
+
+/// sleep - Block the current worker until there is work to do.  Returns false
+/// if the pool is shutting down.
+bool ThreadPoolImpl::sleep() {
+  sys::AtomicIncrement(&NumSleeping);
+  pthread_mutex_lock(&SleepLock);
+  while (NumQueued == 0 && !Stopping)
+    pthread_cond_wait(&WorkAvailable, &SleepLock);
+  bool KeepRunning = NumQueued != 0 || !Stopping;
+  pthread_mutex_unlock(&SleepLock);
+  sys::AtomicDecrement(&NumSleeping);
+  return KeepRunning;
+}
+
+void ThreadPoolImpl::push(Task *T) {
+  // Tasks spawned by a worker go to its own deque.  Others are distributed
+  // over the workers round-robin.
+  Worker *W = getCurrentWorker();
+  if (!W)
+    W = Workers[sys::AtomicIncrement(&NextWorker) % Workers.size()];
+
+  pthread_mutex_lock(&W->Lock);
+  W->Tasks.push_back(T);
+  pthread_mutex_unlock(&W->Lock);
+
+  sys::AtomicIncrement(&NumQueued);
+  if (NumSleeping != 0) {
+    pthread_mutex_lock(&SleepLock);
+    pthread_cond_signal(&WorkAvailable);
+    pthread_mutex_unlock(&SleepLock);
+  }
+}
+
+void ThreadPoolImpl::execute(Task *T) {
+  TaskGroup *Group = T->Group;
+  if (!Group->isCancelled())
+    T->run();
+  delete T;
+
+  if (sys::AtomicDecrement(&Group->NumPending) == 0) {
+    pthread_mutex_lock(&SleepLock);
+    pthread_cond_broadcast(&TaskDone);
+    pthread_mutex_unlock(&SleepLock);
+  }
+}
+
+void ThreadPoolImpl::wait(TaskGroup &Group) {
+  while (Group.NumPending != 0) {
+    // Help out rather than block.  This keeps nested groups from deadlocking
+    // a pool whose workers are all waiting.
+    if (Task *T = pop()) {
+      execute(T);
+      continue;
+    }
+
+    // Everything left in the group is running on other threads.
+    pthread_mutex_lock(&SleepLock);
+    while (Group.NumPending != 0 && NumQueued == 0)
+      pthread_cond_wait(&TaskDone, &SleepLock);
+    pthread_mutex_unlock(&SleepLock);
+  }
+}
+
+#else
+
+namespace llvm {
+/// ThreadPoolImpl - Without thread support there are no workers, and every
+/// task is run by TaskGroup::spawn directly.
+class ThreadPoolImpl {
+public:
+  explicit ThreadPoolImpl(unsigned) {}
+  unsigned getNumThreads() const { return 0; }
+  void push(Task *) { assert(0 && "No workers to run the task!"); }
+  void execute(Task *T);
+  void wait(TaskGroup &) {}
+};
+}
+
+void ThreadPoolImpl::execute(Task *T) {
+  TaskGroup *Group = T->Group;
+  if (!Group->isCancelled())
+    T->run();
+  delete T;
+  --Group->NumPending;
+}
+
+#endif
+
+//===----------------------------------------------------------------------===//
+// TaskGroup Implementation
+//===----------------------------------------------------------------------===//
+
+TaskGroup::TaskGroup(ThreadPool &Pool)
+  : Pool(Pool), NumPending(0), Cancelled(0) {}
+
+TaskGroup::~TaskGroup() {
+  wait();
+}
+
+void TaskGroup::spawn(Task *T) {
+  assert(T->Group == 0 && "Task spawned twice!");
+  T->Group = this;
+
+  sys::AtomicIncrement(&NumPending);
+  ThreadPoolImpl *Impl = Pool.Impl;
+  if (Impl->getNumThreads() == 0)
+    Impl->execute(T);
+  else
+    Impl->push(T);
+}
+
+void TaskGroup::spawn(void (*Fn)(void*), void *Arg) {
+  spawn(new FunctionTask(Fn, Arg));
+}
+
+void TaskGroup::wait() {
+  Pool.Impl->wait(*this);
+}
+
+void TaskGroup::cancel() {
+  Cancelled = 1;
+  sys::MemoryFence();
+}
+
+//===----------------------------------------------------------------------===//
+// ThreadPool Implementation
+//===----------------------------------------------------------------------===//
+
+ThreadPool::ThreadPool(unsigned NumThreads)
+  : Impl(new ThreadPoolImpl(NumThreads ? NumThreads : getDefaultNumThreads())) {
+}
+
+ThreadPool::~ThreadPool() {
+  delete Impl;
+}
+
+unsigned ThreadPool::getNumThreads() const {
+  return Impl->getNumThreads();
+}
+
+unsigned ThreadPool::getDefaultNumThreads() {
+  if (NumThreadsOpt != 0)
+    return NumThreadsOpt;
+
+#if defined(HAVE_UNISTD_H) && defined(_SC_NPROCESSORS_ONLN)
+  long NumCPUs = ::sysconf(_SC_NPROCESSORS_ONLN);
+  if (NumCPUs > 0)
+    return unsigned(NumCPUs);
+#endif
+  return 1;
+}
+
+static ManagedStatic<ThreadPool> GlobalPool;
+
+ThreadPool &ThreadPool::getGlobalPool() {
+  return *GlobalPool;
+}
@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/Timer.h"
+#include "llvm/Config/config.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ManagedStatic.h"
@@ -19,8 +20,19 @@
 #include "llvm/Support/Format.h"
 #include "llvm/Support/Mutex.h"
 #include "llvm/Support/Process.h"
+#include "llvm/Support/ThreadLocal.h"
 #include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringMap.h"
+#include <cstring>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 using namespace llvm;
 
 // CreateInfoOutputFile - Return a file stream to print our output on.
@@ -47,6 +59,24 @@ namespace {
                                       "tracking (this may be slow)"),
              cl::Hidden);
 
+  static cl::opt<bool>
+  TrackPerfCounters("track-perf-counters",
+                    cl::desc("Enable -time-passes hardware performance "
+                             "counters (IPC, cache and branch misses)"),
+                    cl::Hidden);
+
+  static cl::opt<std::string>
+  TimeTraceFile("time-trace-file", cl::value_desc("filename"),
+                cl::desc("File to write a Chrome trace of the pass "
+                         "executions to"),
+                cl::Hidden);
+
+  static cl::opt<unsigned>
+  TimeTraceGranularity("time-trace-granularity",
+                       cl::desc("Minimum duration in microseconds of the "
+                                "events in -time-trace-file"),
+                       cl::init(500), cl::Hidden);
+
   static cl::opt<std::string, true>
   InfoOutputFilename("info-output-file", cl::value_desc("filename"),
                      cl::desc("File to append -stats and -timer output to"),
@@ -126,6 +156,135 @@ static inline size_t getMemUsage() {
   return sys::Process::GetMallocUsage();
 }
 
+//===----------------------------------------------------------------------===//
+// Hardware performance counters
+//===----------------------------------------------------------------------===//
+
+const char *HWCounterGroup::getName(TimeRecord::HWCounter C) {
+  static const char *const Names[TimeRecord::NumHWCounters] = {
+    "cycles", "instructions", "L1D read misses", "LLC read misses",
+    "branch misses"
+  };
+  return Names[C];
+}
+
+#if defined(__linux__)
+
+/// openPerfEvent - Open C with perf_event_open, for the user-space events of
+/// the calling thread.  The leader starts disabled, so that the group can be
+/// reset and enabled once it is complete.
+static int openPerfEvent(TimeRecord::HWCounter C, int GroupFD) {
+  static const struct {
+    uint32_t Type;
+    uint64_t Config;
+  } Events[TimeRecord::NumHWCounters] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                          (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL |
+                          (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+  };
+
+  struct perf_event_attr Attr;
+  memset(&Attr, 0, sizeof(Attr));
+  Attr.size = sizeof(Attr);
+  Attr.type = Events[C].Type;
+  Attr.config = Events[C].Config;
+  Attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+  Attr.disabled = GroupFD < 0;
+  Attr.exclude_kernel = 1;
+  Attr.exclude_hv = 1;
+  return syscall(__NR_perf_event_open, &Attr, 0, -1, GroupFD, 0);
+}
+
+#endif
+
+HWCounterGroup::HWCounterGroup(raw_ostream &Warnings, OpenFn Open)
+  : Leader(-1), NumOpen(0) {
+  for (unsigned i = 0; i != TimeRecord::NumHWCounters; ++i)
+    FDs[i] = -1;
+  if (!Open) {
+#if defined(__linux__)
+    Open = openPerfEvent;
+#else
+    Warnings << "warning: hardware performance counters are only supported "
+                "on Linux, ignoring -track-perf-counters\n";
+    return;
+#endif
+  }
+
+  for (unsigned i = 0; i != TimeRecord::NumHWCounters; ++i) {
+    FDs[i] = Open(TimeRecord::HWCounter(i), Leader);
+    if (FDs[i] < 0)
+      continue;
+    ++NumOpen;
+    if (Leader < 0)
+      Leader = FDs[i];
+  }
+
+  if (Leader < 0) {
+    Warnings << "warning: hardware performance counters are not available, "
+                "ignoring -track-perf-counters\n";
+    return;
+  }
+  for (unsigned i = 0; i != TimeRecord::NumHWCounters; ++i)
+    if (FDs[i] < 0)
+      Warnings << "warning: cannot count "
+               << getName(TimeRecord::HWCounter(i))
+               << ", leaving them out of -track-perf-counters\n";
+#if defined(__linux__)
+  ioctl(Leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(Leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+HWCounterGroup::~HWCounterGroup() {
+#ifdef HAVE_UNISTD_H
+  for (unsigned i = 0; i != TimeRecord::NumHWCounters; ++i)
+    if (FDs[i] >= 0)
+      close(FDs[i]);
+#endif
+}
+
+void HWCounterGroup::read(TimeRecord &Record) const {
+#ifdef HAVE_UNISTD_H
+  if (Leader < 0)
+    return;
+
+  // The group's values come in the order the events were opened, after the
+  // number of events and the times the group was enabled and running.
+  uint64_t Buf[3 + TimeRecord::NumHWCounters];
+  if (::read(Leader, Buf, sizeof(Buf)) < ssize_t((3 + NumOpen) * 8))
+    return;
+
+  // Scale the values up if the kernel had to multiplex the counters.
+  double Scale = 1;
+  if (Buf[2] && Buf[2] < Buf[1])
+    Scale = double(Buf[1]) / Buf[2];
+  const uint64_t *Value = &Buf[3];
+  for (unsigned i = 0; i != TimeRecord::NumHWCounters; ++i)
+    if (FDs[i] >= 0)
+      Record.Counters[i] += int64_t(*Value++ * Scale);
+#endif
+}
+
+namespace {
+
+/// TrackedHWCounters - The counters of -track-perf-counters, which warn on
+/// standard error.
+struct TrackedHWCounters : public HWCounterGroup {
+  TrackedHWCounters() : HWCounterGroup(errs()) {}
+};
+
+}
+
+static ManagedStatic<TrackedHWCounters> HWCounters;
+
 TimeRecord TimeRecord::getCurrentTime(bool Start) {
   TimeRecord Result;
   sys::TimeValue now(0,0), user(0,0), sys(0,0);
@@ -133,7 +292,11 @@ TimeRecord TimeRecord::getCurrentTime(bool Start) {
   if (Start) {
     Result.MemUsed = getMemUsage();
     sys::Process::GetTimeUsage(now, user, sys);
+    if (TrackPerfCounters)
+      HWCounters->read(Result);
   } else {
+    if (TrackPerfCounters)
+      HWCounters->read(Result);
     sys::Process::GetTimeUsage(now, user, sys);
     Result.MemUsed = getMemUsage();
   }
@@ -185,6 +348,21 @@ void TimeRecord::print(const TimeRecord &Total, raw_ostream &OS) const {
   
   if (Total.getMemUsed())
     OS << format("%9" PRId64 "  ", (int64_t)getMemUsed());
+
+  if (Total.getCounter(Cycles)) {
+    OS << format("%5.2f  ", getIPC());
+    // Misses are given per thousand instructions.
+    static const HWCounter Misses[] = { L1DMisses, LLCMisses, BranchMisses };
+    for (unsigned i = 0; i != array_lengthof(Misses); ++i) {
+      if (!Total.getCounter(Misses[i]))
+        OS << "   -----  ";
+      else if (!getCounter(Instructions))
+        OS << format("%8.2f  ", 0.0);
+      else
+        OS << format("%8.2f  ", getCounter(Misses[i]) * 1000.0 /
+                                getCounter(Instructions));
+    }
+  }
 }
 
 
@@ -242,6 +420,152 @@ NamedRegionTimer::NamedRegionTimer(StringRef Name, StringRef GroupName,
                                    bool Enabled)
   : TimeRegion(!Enabled ? 0 : &NamedGroupedTimers->get(Name, GroupName)) {}
 
+//===----------------------------------------------------------------------===//
+//   TimeTraceRegion Implementation
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+struct TraceEvent {
+  const char *Name;
+  std::string Detail;
+  uint64_t Start, Duration;
+  unsigned Thread;
+};
+
+/// TimeTrace - The events recorded for -time-trace-file.  This is used in a
+/// ManagedStatic, so that the trace is written when llvm_shutdown is called.
+class TimeTrace {
+  sys::SmartMutex<true> Lock;
+  std::vector<TraceEvent> Events;
+  sys::ThreadLocal<const void> ThreadID;
+  unsigned NumThreads;
+
+public:
+  /// Origin - The time of the first event, in microseconds.  All times in
+  /// the trace are relative to it.
+  const uint64_t Origin;
+
+  TimeTrace() : NumThreads(0), Origin(getTraceTime()) {}
+  ~TimeTrace();
+
+  static uint64_t getTraceTime() {
+    sys::TimeValue Now = sys::TimeValue::now();
+    return uint64_t(Now.seconds()) * 1000000 + Now.microseconds();
+  }
+
+  void addEvent(const char *Name, const std::string &Detail, uint64_t Start,
+                uint64_t End);
+
+  /// print - Print the events in the Chrome trace-event format.
+  void print(raw_ostream &OS);
+
+  /// clear - Forget the events recorded so far.
+  void clear() {
+    sys::SmartScopedLock<true> L(Lock);
+    Events.clear();
+  }
+};
+
+}
+
+static ManagedStatic<TimeTrace> Trace;
+
+/// ExplicitTrace, ExplicitGranularity - Set by TimeTraceRegion::beginTrace,
+/// which records events without -time-trace-file.
+static bool ExplicitTrace = false;
+static unsigned ExplicitGranularity = 0;
+
+void TimeTrace::addEvent(const char *Name, const std::string &Detail,
+                         uint64_t Start, uint64_t End) {
+  sys::SmartScopedLock<true> L(Lock);
+  // Number the threads in the order they record their first event; the
+  // stored value is the number plus one, as null means no number yet.
+  uintptr_t Thread = (uintptr_t)ThreadID.get();
+  if (!Thread) {
+    Thread = ++NumThreads;
+    ThreadID.set((const void*)Thread);
+  }
+
+  TraceEvent E;
+  E.Name = Name;
+  E.Detail = Detail;
+  E.Start = Start - Origin;
+  E.Duration = End - Start;
+  E.Thread = Thread - 1;
+  Events.push_back(E);
+}
+
+TimeTrace::~TimeTrace() {
+  if (TimeTraceFile.empty())
+    return;
+  std::string Error;
+  raw_fd_ostream OS(TimeTraceFile.c_str(), Error);
+  if (!Error.empty()) {
+    errs() << "Error opening time trace file '" << TimeTraceFile << "': "
+           << Error << '\n';
+    return;
+  }
+  print(OS);
+}
+
+void TimeTrace::print(raw_ostream &OS) {
+  sys::SmartScopedLock<true> L(Lock);
+
+  // "X" events are complete events: they give a start and a duration, which
+  // takes half the space of matching "B" and "E" events.
+  OS << "{\"traceEvents\":[\n";
+  for (unsigned i = 0, e = Events.size(); i != e; ++i) {
+    const TraceEvent &E = Events[i];
+    OS << "{\"pid\":1,\"tid\":" << E.Thread << ",\"ph\":\"X\",\"ts\":"
+       << E.Start << ",\"dur\":" << E.Duration << ",\"name\":";
+    OS.write_json_string(E.Name);
+    OS << ",\"args\":{\"detail\":";
+    OS.write_json_string(E.Detail);
+    OS << "}},\n";
+  }
+  // Name the process track, which also keeps the list free of a trailing
+  // comma.
+  OS << "{\"pid\":1,\"tid\":0,\"ph\":\"M\",\"name\":\"process_name\","
+     << "\"args\":{\"name\":\"LLVM\"}}\n"
+     << "],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+bool TimeTraceRegion::isEnabled() {
+  return ExplicitTrace || !TimeTraceFile.empty();
+}
+
+void TimeTraceRegion::beginTrace(unsigned Granularity) {
+  ExplicitGranularity = Granularity;
+  ExplicitTrace = true;
+}
+
+void TimeTraceRegion::endTrace(raw_ostream &OS) {
+  Trace->print(OS);
+  Trace->clear();
+  ExplicitTrace = false;
+}
+
+TimeTraceRegion::TimeTraceRegion(const char *N, StringRef D) : Start(~0ULL) {
+  if (!isEnabled())
+    return;
+  Name = N;
+  Detail = D;
+  // Make sure the trace starts before this event.
+  (void)Trace->Origin;
+  Start = TimeTrace::getTraceTime();
+}
+
+TimeTraceRegion::~TimeTraceRegion() {
+  if (Start == ~0ULL)
+    return;
+  uint64_t End = TimeTrace::getTraceTime();
+  unsigned Granularity =
+    ExplicitTrace ? ExplicitGranularity : unsigned(TimeTraceGranularity);
+  if (End - Start >= Granularity)
+    Trace->addEvent(Name, Detail, Start, End);
+}
+
 //===----------------------------------------------------------------------===//
 //   TimerGroup Implementation
 //===----------------------------------------------------------------------===//
@@ -344,6 +668,8 @@ void TimerGroup::PrintQueuedTimers(raw_ostream &OS) {
   OS << "   ---Wall Time---";
   if (Total.getMemUsed())
     OS << "  ---Mem---";
+  if (Total.getCounter(TimeRecord::Cycles))
+    OS << "  -IPC-  L1D MPKI  LLC MPKI   BR MPKI";
   OS << "  --- Name ---\n";
   
   // Loop through all of the timing data, printing it out.
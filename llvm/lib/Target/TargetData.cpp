@@ -413,7 +413,12 @@ TargetData::~TargetData() {
   delete static_cast<StructLayoutMap*>(LayoutMap);
 }
 
+/// LayoutLock - Guards the lazily built layout maps of all TargetData
+/// instances, which function passes running in parallel query together.
+static ManagedStatic<sys::SmartMutex<true> > LayoutLock;
+
 const StructLayout *TargetData::getStructLayout(StructType *Ty) const {
+  sys::SmartScopedLock<true> Guard(*LayoutLock);
   if (!LayoutMap)
     LayoutMap = new StructLayoutMap();
 
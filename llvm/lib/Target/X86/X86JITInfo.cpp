@@ -334,6 +334,38 @@ extern "C" {
 #endif
 }
 
+/// patchStubWithJump - Overwrite the start of the stub at Stub with a jump to
+/// Target.  Stubs are 8 byte aligned, so the jump is written with a single
+/// 8 byte compare-and-swap, and a thread entering the stub concurrently sees
+/// either the old instructions or the jump, never a mix of both.  Returns false
+/// if Target is out of range of the jump or the host has no such operation.
+static bool patchStubWithJump(unsigned char *Stub, intptr_t Target) {
+  intptr_t Disp = Target - ((intptr_t)Stub + 5);
+  if (Disp != (int32_t)Disp || ((uintptr_t)Stub & 7) != 0)
+    return false;
+#if defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_8)
+  volatile uint64_t *Word = (volatile uint64_t *)Stub;
+  uint64_t Old, New;
+  do {
+    Old = *Word;
+    unsigned char Bytes[8];
+    memcpy(Bytes, &Old, 8);
+    Bytes[0] = 0xE9;   // jmp rel32
+    int32_t Rel = (int32_t)Disp;
+    memcpy(Bytes + 1, &Rel, 4);
+    memcpy(&New, Bytes, 8);
+  } while (!__sync_bool_compare_and_swap(Word, Old, New));
+  sys::ValgrindDiscardTranslations(Stub, 8);
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool X86JITInfo::patchFunctionStub(void *Stub, void *NewTarget) {
+  return patchStubWithJump((unsigned char*)Stub, (intptr_t)NewTarget);
+}
+
 /// X86CompilationCallback2 - This is the target-specific function invoked by the
 /// function stub when we did not know the real target of a call.  This function
 /// must locate the start of the stub or call site and pass it into the JIT
@@ -368,50 +400,48 @@ X86CompilationCallback2(intptr_t *StackPtr, intptr_t RetAddr) {
                << TheVM->getFunctionReferencedName((void*)RetAddr) << "\n");
 #endif
 
-  // Sanity check to make sure this really is a call instruction.
+  // Sanity check to make sure this really is a call instruction.  Another
+  // thread may have turned the stub into a jump since we entered it.
 #if defined (X86_64_JIT)
   assert(((unsigned char*)RetAddr)[-2] == 0x41 &&"Not a call instr!");
   assert(((unsigned char*)RetAddr)[-1] == 0xFF &&"Not a call instr!");
 #else
-  assert(((unsigned char*)RetAddr)[-1] == 0xE8 &&"Not a call instr!");
+  assert((((unsigned char*)RetAddr)[-1] == 0xE8 ||
+          (isStub && ((unsigned char*)RetAddr)[-1] == 0xE9)) &&
+         "Not a call instr!");
 #endif
 
   intptr_t NewVal = (intptr_t)JITCompilerFunction((void*)RetAddr);
 
   // Rewrite the call target... so that we don't end up here every time we
   // execute the call.
+  //
+  // If this is a stub, rewrite the call into an unconditional branch
+  // instruction so that two return addresses are not pushed onto the stack
+  // when the requested function finally gets called.  This also makes the
+  // 0xCE byte (interrupt) dead, so the marker doesn't effect anything.  Other
+  // threads may be executing the stub, so use a PC-relative branch written
+  // atomically whenever the target is within 32-bit range of the stub.
 #if defined (X86_64_JIT)
   assert(isStub &&
          "X86-64 doesn't support rewriting non-stub lazy compilation calls:"
          " the call instruction varies too much.");
-#else
-  *(intptr_t *)RetAddr = (intptr_t)(NewVal-RetAddr-4);
-#endif
-
-  if (isStub) {
-    // If this is a stub, rewrite the call into an unconditional branch
-    // instruction so that two return addresses are not pushed onto the stack
-    // when the requested function finally gets called.  This also makes the
-    // 0xCE byte (interrupt) dead, so the marker doesn't effect anything.
-#if defined (X86_64_JIT)
-    // If the target address is within 32-bit range of the stub, use a
-    // PC-relative branch instead of loading the actual address.  (This is
-    // considerably shorter than the 64-bit immediate load already there.)
-    // We assume here intptr_t is 64 bits.
-    intptr_t diff = NewVal-RetAddr+7;
-    if (diff >= -2147483648LL && diff <= 2147483647LL) {
-      *(unsigned char*)(RetAddr-0xc) = 0xE9;
-      *(intptr_t *)(RetAddr-0xb) = diff & 0xffffffff;
-    } else {
-      *(intptr_t *)(RetAddr - 0xa) = NewVal;
-      ((unsigned char*)RetAddr)[0] = (2 | (4 << 3) | (3 << 6));
-    }
+  if (!patchStubWithJump((unsigned char*)(RetAddr-0xc), NewVal)) {
+    // Otherwise load the actual address with the 64-bit immediate load
+    // already there, and jump through the register.
+    *(intptr_t *)(RetAddr - 0xa) = NewVal;
+    ((unsigned char*)RetAddr)[0] = (2 | (4 << 3) | (3 << 6));
     sys::ValgrindDiscardTranslations((void*)(RetAddr-0xc), 0xd);
+  }
 #else
-    ((unsigned char*)RetAddr)[-1] = 0xE9;
-    sys::ValgrindDiscardTranslations((void*)(RetAddr-1), 5);
-#endif
+  if (!isStub || !patchStubWithJump((unsigned char*)(RetAddr-1), NewVal)) {
+    *(intptr_t *)RetAddr = (intptr_t)(NewVal-RetAddr-4);
+    if (isStub) {
+      ((unsigned char*)RetAddr)[-1] = 0xE9;
+      sys::ValgrindDiscardTranslations((void*)(RetAddr-1), 5);
+    }
   }
+#endif
 
   // Change the return address to reexecute the call instruction...
 #if defined (X86_64_JIT)
@@ -465,8 +495,9 @@ TargetJITInfo::StubLayout X86JITInfo::getStubLayout() {
   //   call|jmp *r10  # 3 bytes
   // The 32-bit stub contains a 5-byte call|jmp.
   // If the stub is a call to the compilation callback, an extra byte is added
-  // to mark it as a stub.
-  StubLayout Result = {14, 4};
+  // to mark it as a stub.  Stubs are 8 byte aligned so that they can be
+  // patched atomically, see patchStubWithJump.
+  StubLayout Result = {14, 8};
   return Result;
 }
 
@@ -480,7 +511,7 @@ void *X86JITInfo::emitFunctionStub(const Function* F, void *Target,
 #else
   bool NotCC = Target != (void*)(intptr_t)X86CompilationCallback;
 #endif
-  JCE.emitAlignment(4);
+  JCE.emitAlignment(8);
   void *Result = (void*)JCE.getCurrentPCValue();
   if (NotCC) {
 #if defined (X86_64_JIT)
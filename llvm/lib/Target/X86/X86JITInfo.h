@@ -53,6 +53,10 @@ namespace llvm {
     virtual void *emitFunctionStub(const Function* F, void *Target,
                                    JITCodeEmitter &JCE);
 
+    /// patchFunctionStub - Turn the stub into a direct jump to NewTarget.
+    /// Fails if NewTarget is out of range of a 32-bit displacement.
+    virtual bool patchFunctionStub(void *Stub, void *NewTarget);
+
     /// getPICJumpTableEntry - Returns the value of the jumptable entry for the
     /// specific basic block.
     virtual uintptr_t getPICJumpTableEntry(uintptr_t BB, uintptr_t JTBase);
@@ -95,6 +95,8 @@ public:
 
   virtual void getAnalysisUsage(AnalysisUsage &AU) const;
 
+  virtual bool isParallelSafe() const { return true; }
+
   TargetData *getTargetData() const { return TD; }
 
   TargetLibraryInfo *getTargetLibraryInfo() const { return TLI; }
@@ -42,6 +42,8 @@ namespace {
     virtual void getAnalysisUsage(AnalysisUsage& AU) const {
       AU.setPreservesCFG();
     }
+
+    virtual bool isParallelSafe() const { return true; }
     
   };
 }
@@ -53,6 +53,8 @@ namespace {
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
       AU.setPreservesCFG();
     }
+
+    virtual bool isParallelSafe() const { return true; }
   };
 }
 
@@ -80,6 +82,8 @@ namespace {
      virtual void getAnalysisUsage(AnalysisUsage &AU) const {
       AU.setPreservesCFG();
     }
+
+    virtual bool isParallelSafe() const { return true; }
  };
 }
 
@@ -268,6 +268,8 @@ private:
     AU.addRequired<TargetLibraryInfo>();
     AU.setPreservesCFG();
   }
+
+  virtual bool isParallelSafe() const { return true; }
 };
 }
 
@@ -529,6 +529,10 @@ namespace {
     // List of critical edges to be split between iterations.
     SmallVector<std::pair<TerminatorInst*, unsigned>, 4> toSplit;
 
+    // A copy made for another thread is default constructed, so it would
+    // lose NoLoads.
+    virtual bool isParallelSafe() const { return !NoLoads; }
+
     // This transformation requires dominator postdominator info
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
       AU.addRequired<DominatorTree>();
@@ -47,6 +47,8 @@ namespace {
     }
 
     virtual bool runOnFunction(Function &F);
+
+    virtual bool isParallelSafe() const { return true; }
   };
 }
 
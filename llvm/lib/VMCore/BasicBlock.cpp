@@ -83,14 +83,18 @@ BasicBlock::~BasicBlock() {
 }
 
 void BasicBlock::setParent(Function *parent) {
-  if (getParent())
+  if (getParent()) {
     LeakDetector::addGarbageObject(this);
+    getParent()->markModified();
+  }
 
   // Set Parent=parent, updating instruction symtab entries as appropriate.
   InstList.setSymTabObject(&Parent, parent);
 
-  if (getParent())
+  if (getParent()) {
     LeakDetector::removeGarbageObject(this);
+    getParent()->markModified();
+  }
 }
 
 void BasicBlock::removeFromParent() {
@@ -104,6 +108,7 @@ void BasicBlock::eraseFromParent() {
 /// moveBefore - Unlink this basic block from its current function and
 /// insert it into the function that MovePos lives in, right before MovePos.
 void BasicBlock::moveBefore(BasicBlock *MovePos) {
+  getParent()->markModified();
   MovePos->getParent()->getBasicBlockList().splice(MovePos,
                        getParent()->getBasicBlockList(), this);
 }
@@ -111,6 +116,7 @@ void BasicBlock::moveBefore(BasicBlock *MovePos) {
 /// moveAfter - Unlink this basic block from its current function and
 /// insert it into the function that MovePos lives in, right after MovePos.
 void BasicBlock::moveAfter(BasicBlock *MovePos) {
+  getParent()->markModified();
   Function::iterator I = MovePos;
   MovePos->getParent()->getBasicBlockList().splice(++I,
                                        getParent()->getBasicBlockList(), this);
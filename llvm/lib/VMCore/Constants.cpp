@@ -423,7 +423,10 @@ ConstantInt *ConstantInt::get(LLVMContext &Context, const APInt &V) {
   IntegerType *ITy = IntegerType::get(Context, V.getBitWidth());
   // get an existing value or the insertion position
   DenseMapAPIntKeyInfo::KeyTy Key(V, ITy);
-  ConstantInt *&Slot = Context.pImpl->IntConstants[Key]; 
+  LLVMContextImpl *pImpl = Context.pImpl;
+  unsigned Shard = LLVMContextImpl::getIntConstantShard(Key);
+  UniquingLock Lock(pImpl, pImpl->IntConstantsLock[Shard]);
+  ConstantInt *&Slot = pImpl->IntConstants[Shard][Key]; 
   if (!Slot) Slot = new ConstantInt(ITy, V);
   return Slot;
 }
@@ -556,6 +559,7 @@ ConstantFP* ConstantFP::get(LLVMContext &Context, const APFloat& V) {
   DenseMapAPFloatKeyInfo::KeyTy Key(V);
   
   LLVMContextImpl* pImpl = Context.pImpl;
+  UniquingLock Lock(pImpl, pImpl->FPConstantsLock);
   
   ConstantFP *&Slot = pImpl->FPConstants[Key];
     
@@ -623,6 +627,7 @@ Constant *ConstantArray::get(ArrayType *Ty, ArrayRef<Constant*> V) {
   LLVMContextImpl *pImpl = Ty->getContext().pImpl;
   // If this is an all-zero array, return a ConstantAggregateZero object
   if (!V.empty()) {
+    UniquingLock Lock(pImpl, pImpl->ConstantsLock);
     Constant *C = V[0];
     if (!C->isNullValue())
       return pImpl->ArrayConstants.getOrCreate(Ty, V);
@@ -694,8 +699,11 @@ ConstantStruct::ConstantStruct(StructType *T, ArrayRef<Constant *> V)
 Constant *ConstantStruct::get(StructType *ST, ArrayRef<Constant*> V) {
   // Create a ConstantAggregateZero value if all elements are zeros.
   for (unsigned i = 0, e = V.size(); i != e; ++i)
-    if (!V[i]->isNullValue())
-      return ST->getContext().pImpl->StructConstants.getOrCreate(ST, V);
+    if (!V[i]->isNullValue()) {
+      LLVMContextImpl *pImpl = ST->getContext().pImpl;
+      UniquingLock Lock(pImpl, pImpl->ConstantsLock);
+      return pImpl->StructConstants.getOrCreate(ST, V);
+    }
 
   assert((ST->isOpaque() || ST->getNumElements() == V.size()) &&
          "Incorrect # elements specified to ConstantStruct::get");
@@ -747,6 +755,7 @@ Constant *ConstantVector::get(ArrayRef<Constant*> V) {
   if (isUndef)
     return UndefValue::get(T);
     
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
   return pImpl->VectorConstants.getOrCreate(T, V);
 }
 
@@ -998,20 +1007,25 @@ ConstantAggregateZero* ConstantAggregateZero::get(Type* Ty) {
          "Cannot create an aggregate zero of non-aggregate type!");
   
   LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
   return pImpl->AggZeroConstants.getOrCreate(Ty, 0);
 }
 
 /// destroyConstant - Remove the constant from the constant table...
 ///
 void ConstantAggregateZero::destroyConstant() {
-  getType()->getContext().pImpl->AggZeroConstants.remove(this);
+  LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
+  pImpl->AggZeroConstants.remove(this);
   destroyConstantImpl();
 }
 
 /// destroyConstant - Remove the constant from the constant table...
 ///
 void ConstantArray::destroyConstant() {
-  getType()->getContext().pImpl->ArrayConstants.remove(this);
+  LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
+  pImpl->ArrayConstants.remove(this);
   destroyConstantImpl();
 }
 
@@ -1085,14 +1099,18 @@ std::string ConstantArray::getAsCString() const {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantStruct::destroyConstant() {
-  getType()->getContext().pImpl->StructConstants.remove(this);
+  LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
+  pImpl->StructConstants.remove(this);
   destroyConstantImpl();
 }
 
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantVector::destroyConstant() {
-  getType()->getContext().pImpl->VectorConstants.remove(this);
+  LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
+  pImpl->VectorConstants.remove(this);
   destroyConstantImpl();
 }
 
@@ -1112,13 +1130,17 @@ Constant *ConstantVector::getSplatValue() const {
 //
 
 ConstantPointerNull *ConstantPointerNull::get(PointerType *Ty) {
-  return Ty->getContext().pImpl->NullPtrConstants.getOrCreate(Ty, 0);
+  LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
+  return pImpl->NullPtrConstants.getOrCreate(Ty, 0);
 }
 
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantPointerNull::destroyConstant() {
-  getType()->getContext().pImpl->NullPtrConstants.remove(this);
+  LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
+  pImpl->NullPtrConstants.remove(this);
   destroyConstantImpl();
 }
 
@@ -1127,13 +1149,17 @@ void ConstantPointerNull::destroyConstant() {
 //
 
 UndefValue *UndefValue::get(Type *Ty) {
-  return Ty->getContext().pImpl->UndefValueConstants.getOrCreate(Ty, 0);
+  LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
+  return pImpl->UndefValueConstants.getOrCreate(Ty, 0);
 }
 
 // destroyConstant - Remove the constant from the constant table.
 //
 void UndefValue::destroyConstant() {
-  getType()->getContext().pImpl->UndefValueConstants.remove(this);
+  LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
+  pImpl->UndefValueConstants.remove(this);
   destroyConstantImpl();
 }
 
@@ -1146,8 +1172,9 @@ BlockAddress *BlockAddress::get(BasicBlock *BB) {
 }
 
 BlockAddress *BlockAddress::get(Function *F, BasicBlock *BB) {
-  BlockAddress *&BA =
-    F->getContext().pImpl->BlockAddresses[std::make_pair(F, BB)];
+  LLVMContextImpl *pImpl = F->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
+  BlockAddress *&BA = pImpl->BlockAddresses[std::make_pair(F, BB)];
   if (BA == 0)
     BA = new BlockAddress(F, BB);
   
@@ -1167,8 +1194,9 @@ BlockAddress::BlockAddress(Function *F, BasicBlock *BB)
 // destroyConstant - Remove the constant from the constant table.
 //
 void BlockAddress::destroyConstant() {
-  getFunction()->getType()->getContext().pImpl
-    ->BlockAddresses.erase(std::make_pair(getFunction(), getBasicBlock()));
+  LLVMContextImpl *pImpl = getFunction()->getType()->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
+  pImpl->BlockAddresses.erase(std::make_pair(getFunction(), getBasicBlock()));
   getBasicBlock()->AdjustBlockAddressRefCount(-1);
   destroyConstantImpl();
 }
@@ -1186,15 +1214,16 @@ void BlockAddress::replaceUsesOfWithOnConstant(Value *From, Value *To, Use *U) {
   
   // See if the 'new' entry already exists, if not, just update this in place
   // and return early.
-  BlockAddress *&NewBA =
-    getContext().pImpl->BlockAddresses[std::make_pair(NewF, NewBB)];
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
+  BlockAddress *&NewBA = pImpl->BlockAddresses[std::make_pair(NewF, NewBB)];
   if (NewBA == 0) {
     getBasicBlock()->AdjustBlockAddressRefCount(-1);
     
     // Remove the old entry, this can't cause the map to rehash (just a
     // tombstone will get added).
-    getContext().pImpl->BlockAddresses.erase(std::make_pair(getFunction(),
-                                                            getBasicBlock()));
+    pImpl->BlockAddresses.erase(std::make_pair(getFunction(),
+                                               getBasicBlock()));
     NewBA = this;
     setOperand(0, NewF);
     setOperand(1, NewBB);
@@ -1229,6 +1258,7 @@ static inline Constant *getFoldedCast(
   std::vector<Constant*> argVec(1, C);
   ExprMapKeyType Key(opc, argVec);
   
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(Ty, Key);
 }
  
@@ -1526,6 +1556,7 @@ Constant *ConstantExpr::get(unsigned Opcode, Constant *C1, Constant *C2,
   ExprMapKeyType Key(Opcode, argVec, 0, Flags);
   
   LLVMContextImpl *pImpl = C1->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(C1->getType(), Key);
 }
 
@@ -1605,6 +1636,7 @@ Constant *ConstantExpr::getSelect(Constant *C, Constant *V1, Constant *V2) {
   ExprMapKeyType Key(Instruction::Select, argVec);
   
   LLVMContextImpl *pImpl = C->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(V1->getType(), Key);
 }
 
@@ -1631,6 +1663,7 @@ Constant *ConstantExpr::getGetElementPtr(Constant *C, ArrayRef<Value *> Idxs,
                            InBounds ? GEPOperator::IsInBounds : 0);
   
   LLVMContextImpl *pImpl = C->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -1655,6 +1688,7 @@ ConstantExpr::getICmp(unsigned short pred, Constant *LHS, Constant *RHS) {
     ResultTy = VectorType::get(ResultTy, VT->getNumElements());
 
   LLVMContextImpl *pImpl = LHS->getType()->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(ResultTy, Key);
 }
 
@@ -1678,6 +1712,7 @@ ConstantExpr::getFCmp(unsigned short pred, Constant *LHS, Constant *RHS) {
     ResultTy = VectorType::get(ResultTy, VT->getNumElements());
 
   LLVMContextImpl *pImpl = LHS->getType()->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(ResultTy, Key);
 }
 
@@ -1697,6 +1732,7 @@ Constant *ConstantExpr::getExtractElement(Constant *Val, Constant *Idx) {
   
   LLVMContextImpl *pImpl = Val->getContext().pImpl;
   Type *ReqTy = cast<VectorType>(Val->getType())->getElementType();
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -1718,6 +1754,7 @@ Constant *ConstantExpr::getInsertElement(Constant *Val, Constant *Elt,
   const ExprMapKeyType Key(Instruction::InsertElement,ArgVec);
   
   LLVMContextImpl *pImpl = Val->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(Val->getType(), Key);
 }
 
@@ -1740,6 +1777,7 @@ Constant *ConstantExpr::getShuffleVector(Constant *V1, Constant *V2,
   const ExprMapKeyType Key(Instruction::ShuffleVector,ArgVec);
   
   LLVMContextImpl *pImpl = ShufTy->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
   return pImpl->ExprConstants.getOrCreate(ShufTy, Key);
 }
 
@@ -1881,7 +1919,9 @@ Constant *ConstantExpr::getAShr(Constant *C1, Constant *C2, bool isExact) {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantExpr::destroyConstant() {
-  getType()->getContext().pImpl->ExprConstants.remove(this);
+  LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
+  pImpl->ExprConstants.remove(this);
   destroyConstantImpl();
 }
 
@@ -1923,6 +1963,7 @@ void ConstantArray::replaceUsesOfWithOnConstant(Value *From, Value *To,
   Constant *ToC = cast<Constant>(To);
 
   LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
 
   std::pair<LLVMContextImpl::ArrayConstantsTy::MapKey, ConstantArray*> Lookup;
   Lookup.first.first = cast<ArrayType>(getType());
@@ -2033,6 +2074,7 @@ void ConstantStruct::replaceUsesOfWithOnConstant(Value *From, Value *To,
   Values[OperandToUpdate] = ToC;
   
   LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
   
   Constant *Replacement = 0;
   if (isAllZeros) {
@@ -223,3 +223,8 @@ void DebugInfoProbeInfo::finalize(Pass *P, Function &F) {
   assert (Probe && "DebugInfoProbe is not initialized!");
   Probe->finalize(F);
 }
+
+/// isEnabled - Return true if -enable-debug-info-probe is set.
+bool DebugInfoProbeInfo::isEnabled() {
+  return EnableDebugInfoProbe;
+}
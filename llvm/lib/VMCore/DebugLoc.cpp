@@ -19,6 +19,7 @@ using namespace llvm;
 MDNode *DebugLoc::getScope(const LLVMContext &Ctx) const {
   if (ScopeIdx == 0) return 0;
   
+  UniquingLock Lock(Ctx.pImpl, Ctx.pImpl->ScopeRecordsLock);
   if (ScopeIdx > 0) {
     // Positive ScopeIdx is an index into ScopeRecords, which has no inlined-at
     // position specified.
@@ -38,6 +39,7 @@ MDNode *DebugLoc::getInlinedAt(const LLVMContext &Ctx) const {
   // position specified.  Zero is invalid.
   if (ScopeIdx >= 0) return 0;
   
+  UniquingLock Lock(Ctx.pImpl, Ctx.pImpl->ScopeRecordsLock);
   // Otherwise, the index is in the ScopeInlinedAtRecords array.
   assert(unsigned(-ScopeIdx) <= Ctx.pImpl->ScopeInlinedAtRecords.size() &&
          "Invalid ScopeIdx");
@@ -52,6 +54,7 @@ void DebugLoc::getScopeAndInlinedAt(MDNode *&Scope, MDNode *&IA,
     return;
   }
   
+  UniquingLock Lock(Ctx.pImpl, Ctx.pImpl->ScopeRecordsLock);
   if (ScopeIdx > 0) {
     // Positive ScopeIdx is an index into ScopeRecords, which has no inlined-at
     // position specified.
@@ -189,6 +192,8 @@ bool DenseMapInfo<DebugLoc>::isEqual(const DebugLoc &LHS, const DebugLoc &RHS) {
 
 int LLVMContextImpl::getOrAddScopeRecordIdxEntry(MDNode *Scope,
                                                  int ExistingIdx) {
+  UniquingLock Lock(this, ScopeRecordsLock);
+
   // If we already have an entry for this scope, return it.
   int &Idx = ScopeRecordIdx[Scope];
   if (Idx) return Idx;
@@ -212,6 +217,8 @@ int LLVMContextImpl::getOrAddScopeRecordIdxEntry(MDNode *Scope,
 
 int LLVMContextImpl::getOrAddScopeInlinedAtIdxEntry(MDNode *Scope, MDNode *IA,
                                                     int ExistingIdx) {
+  UniquingLock Lock(this, ScopeRecordsLock);
+
   // If we already have an entry, return it.
   int &Idx = ScopeInlinedAtIdx[std::make_pair(Scope, IA)];
   if (Idx) return Idx;
@@ -247,6 +254,7 @@ void DebugRecVH::deleted() {
     return;
   }
     
+  UniquingLock Lock(Ctx, Ctx->ScopeRecordsLock);
   MDNode *Cur = get();
   
   // If the index is positive, it is an entry in ScopeRecords.
@@ -295,6 +303,7 @@ void DebugRecVH::allUsesReplacedWith(Value *NewVa) {
     return;
   }
   
+  UniquingLock Lock(Ctx, Ctx->ScopeRecordsLock);
   MDNode *OldVal = get();
   assert(OldVal != NewVa && "Node replaced with self?");
   
@@ -30,6 +30,7 @@ InlineAsm *InlineAsm::get(FunctionType *Ty, StringRef AsmString,
                           bool isAlignStack) {
   InlineAsmKeyType Key(AsmString, Constraints, hasSideEffects, isAlignStack);
   LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ConstantsLock);
   return pImpl->InlineAsms.getOrCreate(PointerType::getUnqual(Ty), Key);
 }
 
@@ -47,7 +48,11 @@ InlineAsm::InlineAsm(PointerType *Ty, const std::string &asmString,
 }
 
 void InlineAsm::destroyConstant() {
-  getType()->getContext().pImpl->InlineAsms.remove(this);
+  LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+  {
+    UniquingLock Lock(pImpl, pImpl->ConstantsLock);
+    pImpl->InlineAsms.remove(this);
+  }
   delete this;
 }
 
@@ -57,11 +57,16 @@ Instruction::~Instruction() {
 void Instruction::setParent(BasicBlock *P) {
   if (getParent()) {
     if (!P) LeakDetector::addGarbageObject(this);
+    if (Function *F = getParent()->getParent())
+      F->markModified();
   } else {
     if (P) LeakDetector::removeGarbageObject(this);
   }
 
   Parent = P;
+  if (P)
+    if (Function *F = P->getParent())
+      F->markModified();
 }
 
 void Instruction::removeFromParent() {
@@ -88,6 +93,9 @@ void Instruction::insertAfter(Instruction *InsertPos) {
 /// insert it into the basic block that MovePos lives in, right before
 /// MovePos.
 void Instruction::moveBefore(Instruction *MovePos) {
+  // A move within one block does not go through setParent.
+  if (Function *F = getParent()->getParent())
+    F->markModified();
   MovePos->getParent()->getInstList().splice(MovePos,getParent()->getInstList(),
                                              this);
 }
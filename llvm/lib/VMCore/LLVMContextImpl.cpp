@@ -18,7 +18,8 @@
 using namespace llvm;
 
 LLVMContextImpl::LLVMContextImpl(LLVMContext &C)
-  : TheTrueVal(0), TheFalseVal(0),
+  : ConcurrentUniquing(false), DiscardValueNames(false),
+    TheTrueVal(0), TheFalseVal(0),
     VoidTy(C, Type::VoidTyID),
     LabelTy(C, Type::LabelTyID),
     HalfTy(C, Type::HalfTyID),
@@ -74,7 +75,8 @@ LLVMContextImpl::~LLVMContextImpl() {
   NullPtrConstants.freeConstants();
   UndefValueConstants.freeConstants();
   InlineAsms.freeConstants();
-  DeleteContainerSeconds(IntConstants);
+  for (unsigned i = 0; i != NumIntConstantShards; ++i)
+    DeleteContainerSeconds(IntConstants[i]);
   DeleteContainerSeconds(FPConstants);
   
   // Destroy MDNodes.  ~MDNode can move and remove nodes between the MDNodeSet
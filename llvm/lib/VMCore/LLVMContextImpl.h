@@ -21,11 +21,13 @@
 #include "llvm/Constants.h"
 #include "llvm/DerivedTypes.h"
 #include "llvm/Metadata.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/ValueHandle.h"
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/FlatHashMap.h"
 #include "llvm/ADT/FoldingSet.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/StringMap.h"
@@ -121,15 +123,44 @@ public:
   LLVMContext::InlineAsmDiagHandlerTy InlineAsmDiagHandler;
   void *InlineAsmDiagContext;
   
-  typedef DenseMap<DenseMapAPIntKeyInfo::KeyTy, ConstantInt*, 
-                         DenseMapAPIntKeyInfo> IntMapTy;
-  IntMapTy IntConstants;
+  /// ConcurrentUniquing - True if the uniquing tables below may be accessed
+  /// from several threads at once.  The locks that follow each table are only
+  /// taken in this mode; see UniquingLock.
+  bool ConcurrentUniquing;
+
+  /// DiscardValueNames - True if values other than globals are left unnamed;
+  /// see LLVMContext::setDiscardValueNames.
+  bool DiscardValueNames;
+
+  /// ConstantInt is by far the most frequently uniqued object, so its table is
+  /// split into independently locked shards to keep threads that are creating
+  /// different integers from contending.  The number of shards is a power of
+  /// two, so that a shard is picked with a shift.
+  enum {
+    IntConstantShardBits = 3,
+    NumIntConstantShards = 1 << IntConstantShardBits
+  };
+
+  typedef FlatHashMap<DenseMapAPIntKeyInfo::KeyTy, ConstantInt*,
+                      DenseMapAPIntKeyInfo> IntMapTy;
+  IntMapTy IntConstants[NumIntConstantShards];
+  sys::Mutex IntConstantsLock[NumIntConstantShards];
+
+  /// getIntConstantShard - Return the shard of IntConstants that holds Key.
+  /// The shard is picked from the high bits of a scrambled hash, so that the
+  /// keys of a shard still spread over all the buckets of its map.
+  static unsigned getIntConstantShard(const DenseMapAPIntKeyInfo::KeyTy &Key) {
+    unsigned Hash = DenseMapAPIntKeyInfo::getHashValue(Key) * 0x9E3779B9U;
+    return Hash >> (32 - IntConstantShardBits);
+  }
   
-  typedef DenseMap<DenseMapAPFloatKeyInfo::KeyTy, ConstantFP*, 
-                         DenseMapAPFloatKeyInfo> FPMapTy;
+  typedef FlatHashMap<DenseMapAPFloatKeyInfo::KeyTy, ConstantFP*,
+                      DenseMapAPFloatKeyInfo> FPMapTy;
   FPMapTy FPConstants;
+  sys::Mutex FPConstantsLock;
   
   StringMap<MDString*> MDStringCache;
+  sys::Mutex MDStringLock;
   
   FoldingSet<MDNode> MDNodeSet;
   // MDNodes may be uniqued or not uniqued.  When they're not uniqued, they
@@ -137,6 +168,10 @@ public:
   // one object can destroy them.  This set allows us to at least destroy them
   // on Context destruction.
   SmallPtrSet<MDNode*, 1> NonUniquedMDNodes;
+  /// MDNodeLock - Guards MDNodeSet and NonUniquedMDNodes.  It is recursive
+  /// because replacing an operand can destroy a now-redundant node, which
+  /// removes it from the set again.
+  sys::Mutex MDNodeLock;
   
   ConstantUniqueMap<char, char, Type, ConstantAggregateZero> AggZeroConstants;
 
@@ -162,6 +197,27 @@ public:
 
   ConstantUniqueMap<InlineAsmKeyType, const InlineAsmKeyType&, PointerType,
                     InlineAsm> InlineAsms;
+
+  /// ConstantsLock - Guards the ConstantUniqueMaps above and BlockAddresses.
+  /// It is recursive because replacing an operand of a constant can destroy
+  /// the constant, which removes it from its map again.
+  sys::Mutex ConstantsLock;
+
+  /// Use lists of values shared between functions are edited by every
+  /// function that starts or stops using them, so in concurrent mode they
+  /// are guarded by a set of locks picked by the address of the value.
+  enum {
+    UseListShardBits = 4,
+    NumUseListShards = 1 << UseListShardBits
+  };
+  sys::Mutex UseListLock[NumUseListShards];
+
+  /// getUseListShard - Return the lock in UseListLock that guards the use
+  /// list of V.
+  static unsigned getUseListShard(const Value *V) {
+    unsigned Hash = unsigned(uintptr_t(V) >> 4) * 0x9E3779B9U;
+    return Hash >> (32 - UseListShardBits);
+  }
   
   ConstantInt *TheTrueVal;
   ConstantInt *TheFalseVal;
@@ -191,15 +247,26 @@ public:
   DenseMap<Type*, PointerType*> PointerTypes;  // Pointers in AddrSpace = 0
   DenseMap<std::pair<Type*, unsigned>, PointerType*> ASPointerTypes;
 
+  /// TypesLock - Guards TypeAllocator and all of the type tables above.  It is
+  /// recursive because creating a literal struct sets its body, which
+  /// allocates from TypeAllocator again.
+  sys::Mutex TypesLock;
+
 
   /// ValueHandles - This map keeps track of all of the value handles that are
   /// watching a Value*.  The Value::HasValueHandle bit is used to know
   // whether or not a value has an entry in this map.
-  typedef DenseMap<Value*, ValueHandleBase*> ValueHandlesTy;
+  typedef FlatHashMap<Value*, ValueHandleBase*> ValueHandlesTy;
   ValueHandlesTy ValueHandles;
+  /// ValueHandlesLock - Guards ValueHandles and the handle lists hanging off
+  /// it.  MDNode operands are value handles, so concurrent MDNode creation
+  /// needs this as well.  It is not held while the callbacks of a deleted or
+  /// RAUW'd value run.
+  sys::Mutex ValueHandlesLock;
   
   /// CustomMDKindNames - Map to hold the metadata string to ID mapping.
   StringMap<unsigned> CustomMDKindNames;
+  sys::Mutex CustomMDKindNamesLock;
   
   typedef std::pair<unsigned, TrackingVH<MDNode> > MDPairTy;
   typedef SmallVector<MDPairTy, 2> MDMapTy;
@@ -207,6 +274,7 @@ public:
   /// MetadataStore - Collection of per-instruction metadata used in this
   /// context.
   DenseMap<const Instruction *, MDMapTy> MetadataStore;
+  sys::Mutex MetadataStoreLock;
   
   /// ScopeRecordIdx - This is the index in ScopeRecords for an MDNode scope
   /// entry with no "inlined at" element.
@@ -226,6 +294,14 @@ public:
   /// to date.
   std::vector<std::pair<DebugRecVH, DebugRecVH> > ScopeInlinedAtRecords;
   
+  /// ScopeRecordsLock - Guards the four scope tables above.
+  sys::Mutex ScopeRecordsLock;
+
+  /// ModuleSymbolsLock - Guards the function lists and symbol tables of the
+  /// modules of this context against function passes running in parallel,
+  /// which may all add declarations of intrinsics to the same module.
+  sys::Mutex ModuleSymbolsLock;
+
   int getOrAddScopeRecordIdxEntry(MDNode *N, int ExistingIdx);
   int getOrAddScopeInlinedAtIdxEntry(MDNode *Scope, MDNode *IA,int ExistingIdx);
   
@@ -233,6 +309,23 @@ public:
   ~LLVMContextImpl();
 };
 
+/// UniquingLock - Scoped lock over one of the uniquing tables of a context.
+/// The mutex is only acquired when the context is in concurrent mode, so the
+/// usual one-context-per-thread clients pay for a single predictable branch.
+class UniquingLock {
+  sys::Mutex *M;
+  UniquingLock(const UniquingLock &);   // DO NOT IMPLEMENT
+  void operator=(const UniquingLock &); // DO NOT IMPLEMENT
+public:
+  UniquingLock(const LLVMContextImpl *pImpl, sys::Mutex &Lock)
+    : M(pImpl->ConcurrentUniquing ? &Lock : 0) {
+    if (M) M->acquire();
+  }
+  ~UniquingLock() {
+    if (M) M->release();
+  }
+};
+
 }
 
 #endif
@@ -36,6 +36,7 @@ MDString::MDString(LLVMContext &C, StringRef S)
 
 MDString *MDString::get(LLVMContext &Context, StringRef Str) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  UniquingLock Lock(pImpl, pImpl->MDStringLock);
   StringMapEntry<MDString *> &Entry =
     pImpl->MDStringCache.GetOrCreateValue(Str);
   MDString *&S = Entry.getValue();
@@ -107,6 +108,7 @@ MDNode::~MDNode() {
   assert((getSubclassDataFromValue() & DestroyFlag) != 0 &&
          "Not being destroyed through destroy()?");
   LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->MDNodeLock);
   if (isNotUniqued()) {
     pImpl->NonUniquedMDNodes.erase(this);
   } else {
@@ -201,6 +203,7 @@ MDNode *MDNode::getMDNode(LLVMContext &Context, ArrayRef<Value*> Vals,
   void *InsertPoint;
   MDNode *N = NULL;
   
+  UniquingLock Lock(pImpl, pImpl->MDNodeLock);
   if ((N = pImpl->MDNodeSet.FindNodeOrInsertPos(ID, InsertPoint)))
     return N;
     
@@ -289,6 +292,7 @@ void MDNode::Profile(FoldingSetNodeID &ID) const {
 void MDNode::setIsNotUniqued() {
   setValueSubclassData(getSubclassDataFromValue() | NotUniquedBit);
   LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->MDNodeLock);
   pImpl->NonUniquedMDNodes.insert(this);
 }
 
@@ -325,6 +329,7 @@ void MDNode::replaceOperand(MDNodeOperand *Op, Value *To) {
   if (isNotUniqued()) return;
 
   LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->MDNodeLock);
 
   // Remove "this" from the context map.  FoldingSet doesn't have to reprofile
   // this node to remove it, so we don't care what state the operands are in.
@@ -448,9 +453,12 @@ void Instruction::setMetadata(unsigned KindID, MDNode *Node) {
     return;
   }
   
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->MetadataStoreLock);
+
   // Handle the case when we're adding/updating metadata on an instruction.
   if (Node) {
-    LLVMContextImpl::MDMapTy &Info = getContext().pImpl->MetadataStore[this];
+    LLVMContextImpl::MDMapTy &Info = pImpl->MetadataStore[this];
     assert(!Info.empty() == hasMetadataHashEntry() &&
            "HasMetadata bit is wonked");
     if (Info.empty()) {
@@ -471,15 +479,15 @@ void Instruction::setMetadata(unsigned KindID, MDNode *Node) {
 
   // Otherwise, we're removing metadata from an instruction.
   assert((hasMetadataHashEntry() ==
-          getContext().pImpl->MetadataStore.count(this)) &&
+          pImpl->MetadataStore.count(this)) &&
          "HasMetadata bit out of date!");
   if (!hasMetadataHashEntry())
     return;  // Nothing to remove!
-  LLVMContextImpl::MDMapTy &Info = getContext().pImpl->MetadataStore[this];
+  LLVMContextImpl::MDMapTy &Info = pImpl->MetadataStore[this];
 
   // Common case is removing the only entry.
   if (Info.size() == 1 && Info[0].first == KindID) {
-    getContext().pImpl->MetadataStore.erase(this);
+    pImpl->MetadataStore.erase(this);
     setHasMetadataHashEntry(false);
     return;
   }
@@ -502,7 +510,9 @@ MDNode *Instruction::getMetadataImpl(unsigned KindID) const {
   
   if (!hasMetadataHashEntry()) return 0;
   
-  LLVMContextImpl::MDMapTy &Info = getContext().pImpl->MetadataStore[this];
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->MetadataStoreLock);
+  LLVMContextImpl::MDMapTy &Info = pImpl->MetadataStore[this];
   assert(!Info.empty() && "bit out of sync with hash table");
 
   for (LLVMContextImpl::MDMapTy::iterator I = Info.begin(), E = Info.end();
@@ -523,11 +533,13 @@ void Instruction::getAllMetadataImpl(SmallVectorImpl<std::pair<unsigned,
     if (!hasMetadataHashEntry()) return;
   }
   
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->MetadataStoreLock);
   assert(hasMetadataHashEntry() &&
-         getContext().pImpl->MetadataStore.count(this) &&
+         pImpl->MetadataStore.count(this) &&
          "Shouldn't have called this");
   const LLVMContextImpl::MDMapTy &Info =
-    getContext().pImpl->MetadataStore.find(this)->second;
+    pImpl->MetadataStore.find(this)->second;
   assert(!Info.empty() && "Shouldn't have called this");
 
   Result.append(Info.begin(), Info.end());
@@ -541,11 +553,13 @@ void Instruction::
 getAllMetadataOtherThanDebugLocImpl(SmallVectorImpl<std::pair<unsigned,
                                     MDNode*> > &Result) const {
   Result.clear();
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->MetadataStoreLock);
   assert(hasMetadataHashEntry() &&
-         getContext().pImpl->MetadataStore.count(this) &&
+         pImpl->MetadataStore.count(this) &&
          "Shouldn't have called this");
   const LLVMContextImpl::MDMapTy &Info =
-  getContext().pImpl->MetadataStore.find(this)->second;
+  pImpl->MetadataStore.find(this)->second;
   assert(!Info.empty() && "Shouldn't have called this");
   
   Result.append(Info.begin(), Info.end());
@@ -560,7 +574,9 @@ getAllMetadataOtherThanDebugLocImpl(SmallVectorImpl<std::pair<unsigned,
 /// this instruction.
 void Instruction::clearMetadataHashEntries() {
   assert(hasMetadataHashEntry() && "Caller should check");
-  getContext().pImpl->MetadataStore.erase(this);
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->MetadataStoreLock);
+  pImpl->MetadataStore.erase(this);
   setHasMetadataHashEntry(false);
 }
 
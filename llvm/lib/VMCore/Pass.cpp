@@ -88,6 +88,18 @@ void *Pass::getAdjustedAnalysisPointer(AnalysisID AID) {
   return this;
 }
 
+bool Pass::isParallelSafe() const {
+  // By default, assume the pass keeps state shared between functions.
+  return false;
+}
+
+Pass *Pass::createParallelInstance() const {
+  const PassInfo *PI = PassRegistry::getPassRegistry()->getPassInfo(PassID);
+  if (PI == 0 || PI->getNormalCtor() == 0)
+    return 0;
+  return PI->createPass();
+}
+
 ImmutablePass *Pass::getAsImmutablePass() {
   return 0;
 }
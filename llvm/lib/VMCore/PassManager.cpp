@@ -17,15 +17,24 @@
 #include "llvm/DebugInfoProbe.h"
 #include "llvm/Assembly/PrintModulePass.h"
 #include "llvm/Assembly/Writer.h"
+#include "llvm/LLVMContext.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Module.h"
+#include "llvm/Constants.h"
+#include "llvm/InlineAsm.h"
+#include "llvm/Metadata.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/PassNameParser.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringMap.h"
 #include <algorithm>
 #include <map>
@@ -81,6 +90,13 @@ PrintAfterAll("print-after-all",
               llvm::cl::desc("Print IR after each pass"),
               cl::init(false));
 
+bool ParallelFunctionPassesEnabled = false;
+static cl::opt<bool, true>
+ParallelFunctionPasses("parallel-function-passes",
+                       cl::location(ParallelFunctionPassesEnabled),
+                       cl::desc("Run function passes on several functions at "
+                                "once when all of them are parallel safe"));
+
 /// This is a helper to determine whether to print IR before or
 /// after a pass.
 
@@ -513,12 +529,16 @@ static TimingInfo *TheTimeInfo;
 // PMTopLevelManager implementation
 
 /// Initialize top level manager. Create first pass manager.
-PMTopLevelManager::PMTopLevelManager(PMDataManager *PMDM) {
+PMTopLevelManager::PMTopLevelManager(PMDataManager *PMDM) : Pool(0) {
   PMDM->setTopLevelManager(this);
   addPassManager(PMDM);
   activeStack.push(PMDM);
 }
 
+ThreadPool &PMTopLevelManager::getThreadPool() const {
+  return Pool ? *Pool : ThreadPool::getGlobalPool();
+}
+
 /// Set pass P as the last user of the given analysis passes.
 void
 PMTopLevelManager::setLastUser(const SmallVectorImpl<Pass *> &AnalysisPasses,
@@ -603,6 +623,33 @@ AnalysisUsage *PMTopLevelManager::findAnalysisUsage(Pass *P) {
   return AnUsage;
 }
 
+/// Register Copy, an instance of the scheduled pass Original made to run on
+/// another thread.
+void PMTopLevelManager::addPassCopy(Pass *Copy, Pass *Original,
+                                    const DenseMap<Pass *, Pass *> &Copies) {
+  // The copy behaves like the original, so it can share its analysis usage.
+  AnUsageMap[Copy] = findAnalysisUsage(Original);
+
+  // Copy is the last user of the copies of the passes Original is the last
+  // user of.  Passes outside of the pipeline are freed by their own manager.
+  SmallVector<Pass *, 12> LastUses;
+  collectLastUses(LastUses, Original);
+  SmallPtrSet<Pass *, 8> &CopyLastUses = InversedLastUser[Copy];
+  for (SmallVectorImpl<Pass *>::iterator I = LastUses.begin(),
+         E = LastUses.end(); I != E; ++I) {
+    DenseMap<Pass *, Pass *>::const_iterator CI = Copies.find(*I);
+    if (CI != Copies.end())
+      CopyLastUses.insert(CI->second);
+  }
+}
+
+/// Forget a pass registered with addPassCopy.  Its analysis usage belongs to
+/// the original pass.
+void PMTopLevelManager::removePassCopy(Pass *Copy) {
+  AnUsageMap.erase(Copy);
+  InversedLastUser.erase(Copy);
+}
+
 /// Schedule pass P for execution. Make sure that passes required by
 /// P are run before P is run. Update analysis info maintained by
 /// the manager. Remove dead passes. This is a recursive function.
@@ -1279,6 +1326,7 @@ bool BBPassManager::runOnFunction(Function &F) {
         // If the pass crashes, remember this.
         PassManagerPrettyStackEntry X(BP, *I);
         TimeRegion PassTimer(getPassTimer(BP));
+        TimeTraceRegion PassTrace(BP->getPassName(), F.getName());
 
         LocalChanged |= BP->runOnBasicBlock(*I);
       }
@@ -1498,8 +1546,11 @@ bool FPPassManager::runOnFunction(Function &F) {
 
   bool Changed = false;
 
-  // Collect inherited analysis from Module level pass manager.
-  populateInheritedAnalysis(TPM->activeStack);
+  // Collect inherited analysis from Module level pass manager.  Worker copies
+  // must leave the analyses of the enclosing managers alone, as other threads
+  // are using them; see runOnFunctionsInParallel.
+  if (!IsWorkerCopy)
+    populateInheritedAnalysis(TPM->activeStack);
 
   for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index) {
     FunctionPass *FP = getContainedPass(Index);
@@ -1514,6 +1565,7 @@ bool FPPassManager::runOnFunction(Function &F) {
     {
       PassManagerPrettyStackEntry X(FP, F);
       TimeRegion PassTimer(getPassTimer(FP));
+      TimeTraceRegion PassTrace(FP->getPassName(), F.getName());
 
       LocalChanged |= FP->runOnFunction(F);
     }
@@ -1521,8 +1573,13 @@ bool FPPassManager::runOnFunction(Function &F) {
       TheDebugProbe->finalize(FP, F);
 
     Changed |= LocalChanged;
-    if (LocalChanged)
+    if (LocalChanged) {
+      // Not every change to a function advances its modification epoch on
+      // its own, e.g. setting an operand or an instruction's alignment does
+      // not; see Function::getModificationEpoch.
+      F.markModified();
       dumpPassInfo(FP, MODIFICATION_MSG, ON_FUNCTION_MSG, F.getName());
+    }
     dumpPreservedSet(FP);
 
     verifyPreservedAnalysis(FP);
@@ -1536,12 +1593,323 @@ bool FPPassManager::runOnFunction(Function &F) {
 bool FPPassManager::runOnModule(Module &M) {
   bool Changed = doInitialization(M);
 
-  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
-    Changed |= runOnFunction(*I);
+  if (canRunInParallel(M))
+    Changed |= runOnFunctionsInParallel(M);
+  else
+    for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+      Changed |= runOnFunction(*I);
 
   return doFinalization(M) || Changed;
 }
 
+/// Return true if the passes of this manager can be run on the functions of
+/// M from several threads.
+bool FPPassManager::canRunInParallel(Module &M) {
+  if (!ParallelFunctionPasses || IsWorkerCopy)
+    return false;
+
+  // The pass registry and the statistics only guard their state once
+  // multithreading is started, and the parts of the IR that are shared by all
+  // functions can only be updated concurrently with concurrent uniquing.
+  if (!llvm_is_multithreaded() || !M.getContext().hasConcurrentUniquing())
+    return false;
+
+  // Pass timers, the pass debugging output and the debug info probes are
+  // per pass instance and not meant to be used from several threads.  The
+  // probes are always created, but only collect anything when enabled.
+  if (TimePassesIsEnabled || PassDebugging >= Executions ||
+      DebugInfoProbeInfo::isEnabled())
+    return false;
+
+  if (TPM->getThreadPool().getNumThreads() < 2)
+    return false;
+
+  // Materializing a function modifies the module, so all of the bodies must
+  // be there up front.  It is not worth going parallel for a single body.
+  unsigned NumDefinitions = 0;
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
+    if (I->isMaterializable())
+      return false;
+    if (!I->isDeclaration())
+      ++NumDefinitions;
+  }
+  if (NumDefinitions < 2)
+    return false;
+
+  // Each thread gets its own instance of every pass of the pipeline, which
+  // includes the function analyses it computes.  The other analyses are
+  // shared by all of the threads: the immutable passes, any of which can be
+  // reached with getAnalysisIfAvailable, and the module level analyses that
+  // passes of the pipeline require.
+  SmallPtrSet<AnalysisID, 16> ProvidedHere;
+  for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index) {
+    FunctionPass *FP = getContainedPass(Index);
+    if (!FP->isParallelSafe())
+      return false;
+
+    ProvidedHere.insert(FP->getPassID());
+    const PassInfo *PI =
+      PassRegistry::getPassRegistry()->getPassInfo(FP->getPassID());
+    if (PI == 0)
+      continue;
+    const std::vector<const PassInfo*> &II = PI->getInterfacesImplemented();
+    for (unsigned i = 0, e = II.size(); i != e; ++i)
+      ProvidedHere.insert(II[i]->getTypeInfo());
+  }
+
+  SmallVectorImpl<ImmutablePass *> &IPs = TPM->getImmutablePasses();
+  for (unsigned i = 0, e = IPs.size(); i != e; ++i)
+    if (!IPs[i]->isParallelSafe())
+      return false;
+
+  for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index) {
+    AnalysisUsage *AnUsage = TPM->findAnalysisUsage(getContainedPass(Index));
+    const AnalysisUsage::VectorType *Sets[] = {
+      &AnUsage->getRequiredSet(), &AnUsage->getRequiredTransitiveSet()
+    };
+    for (unsigned s = 0; s != 2; ++s)
+      for (AnalysisUsage::VectorType::const_iterator I = Sets[s]->begin(),
+             E = Sets[s]->end(); I != E; ++I) {
+        if (ProvidedHere.count(*I))
+          continue;
+        Pass *Shared = TPM->findAnalysisPass(*I);
+        if (Shared && !Shared->isParallelSafe())
+          return false;
+      }
+  }
+
+  return true;
+}
+
+/// Return a copy of this manager with its own instance of every pass, set up
+/// to free its analyses at the same points as this manager does.
+FPPassManager *FPPassManager::createWorkerCopy() {
+  FPPassManager *Copy = new FPPassManager();
+  Copy->IsWorkerCopy = true;
+  Copy->setTopLevelManager(TPM);
+  Copy->setDepth(getDepth());
+
+  DenseMap<Pass *, Pass *> Copies;
+  for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index) {
+    FunctionPass *FP = getContainedPass(Index);
+    Pass *P = FP->createParallelInstance();
+    if (P == 0 || P->getPassID() != FP->getPassID() ||
+        P->getPassKind() != PT_Function) {
+      delete P;
+      delete Copy;
+      return 0;
+    }
+    // The pipeline has already been scheduled, so the copy just mirrors it.
+    Copy->add(P, false);
+    Copies[FP] = P;
+  }
+
+  for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index)
+    TPM->addPassCopy(Copy->getContainedPass(Index), getContainedPass(Index),
+                     Copies);
+  return Copy;
+}
+
+void FPPassManager::destroyWorkerCopy(FPPassManager *Copy) {
+  for (unsigned Index = 0; Index < Copy->getNumContainedPasses(); ++Index)
+    TPM->removePassCopy(Copy->getContainedPass(Index));
+  delete Copy;
+}
+
+namespace {
+
+/// FunctionWorkerTask - Runs the passes of one copy of a function pass
+/// manager on functions taken from a shared list until the list is empty.
+class FunctionWorkerTask : public Task {
+  FPPassManager *FPPM;
+  ArrayRef<Function *> Functions;
+  volatile sys::cas_flag *NextFunction;
+  volatile sys::cas_flag *Changed;
+public:
+  FunctionWorkerTask(FPPassManager *FPPM, ArrayRef<Function *> Functions,
+                     volatile sys::cas_flag *NextFunction,
+                     volatile sys::cas_flag *Changed)
+    : FPPM(FPPM), Functions(Functions), NextFunction(NextFunction),
+      Changed(Changed) {}
+
+  virtual void run() {
+    while (true) {
+      sys::cas_flag Index = sys::AtomicIncrement(NextFunction) - 1;
+      if (Index >= Functions.size())
+        return;
+      if (FPPM->runOnFunction(*Functions[Index]))
+        sys::CompareAndSwap(Changed, 1, 0);
+    }
+  }
+};
+
+/// NameOrder - Orders global values by name.
+struct NameOrder {
+  bool operator()(const GlobalValue *A, const GlobalValue *B) const {
+    return A->getName() < B->getName();
+  }
+};
+
+/// UseOrder - Orders uses by the number numberUses gave them.  Uses without
+/// a number, from other modules of the context, go last.
+class UseOrder {
+  const DenseMap<const Use*, unsigned> &Order;
+  unsigned getNumber(const Use *U) const {
+    DenseMap<const Use*, unsigned>::const_iterator I = Order.find(U);
+    return I == Order.end() ? ~0U : I->second;
+  }
+public:
+  explicit UseOrder(const DenseMap<const Use*, unsigned> &Order)
+    : Order(Order) {}
+  bool operator()(const Use *A, const Use *B) const {
+    return getNumber(A) < getNumber(B);
+  }
+};
+
+} // End of anon namespace
+
+/// sortAddedGlobals - Sort the globals that follow Last in List, which were
+/// added by the passes in whatever order the threads got to them, by name.
+template<typename ListTy>
+static void sortAddedGlobals(ListTy &List,
+                             typename ListTy::value_type *Last) {
+  typename ListTy::iterator I = List.begin();
+  if (Last)
+    I = llvm::next(typename ListTy::iterator(Last));
+  SmallVector<typename ListTy::value_type *, 8> Added;
+  for (; I != List.end(); ++I)
+    Added.push_back(I);
+  std::stable_sort(Added.begin(), Added.end(), NameOrder());
+  for (unsigned i = 0, e = Added.size(); i != e; ++i)
+    List.splice(List.end(), List, Added[i]);
+}
+
+/// numberUses - Number the operands of U in order and, the first time each
+/// constant operand is reached, the operands of that constant.  Collect the
+/// values whose use lists are shared between functions in Shared.
+static void numberUses(User *U, DenseMap<const Use*, unsigned> &Order,
+                       SmallPtrSet<const Constant*, 32> &Visited,
+                       SetVector<Value*> &Shared) {
+  for (User::op_iterator I = U->op_begin(), E = U->op_end(); I != E; ++I) {
+    unsigned Number = Order.size();
+    Order[I] = Number;
+    Value *V = *I;
+    if (!isa<Constant>(V) && !isa<InlineAsm>(V) && !isa<MDNode>(V) &&
+        !isa<MDString>(V))
+      continue;
+    Shared.insert(V);
+    Constant *C = dyn_cast<Constant>(V);
+    if (C && !isa<GlobalValue>(C) && Visited.insert(C))
+      numberUses(C, Order, Visited, Shared);
+  }
+}
+
+/// canonicalizeSharedIR - The workers of a parallel run add declarations to
+/// M and uses to the constants and globals of M in an order that depends on
+/// how the threads were scheduled.  Put both in an order that only depends
+/// on the module, so that the result is the same from one run to the next:
+/// the module level values added after LastFunction and LastGlobal are
+/// sorted by name, and the use lists of shared values follow a walk of the
+/// module.
+static void canonicalizeSharedIR(Module &M, Function *LastFunction,
+                                 GlobalVariable *LastGlobal) {
+  sortAddedGlobals(M.getFunctionList(), LastFunction);
+  sortAddedGlobals(M.getGlobalList(), LastGlobal);
+
+  DenseMap<const Use*, unsigned> Order;
+  SmallPtrSet<const Constant*, 32> Visited;
+  SetVector<Value*> Shared;
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I)
+    numberUses(I, Order, Visited, Shared);
+  for (Module::alias_iterator I = M.alias_begin(), E = M.alias_end(); I != E;
+       ++I)
+    numberUses(I, Order, Visited, Shared);
+  for (Module::iterator F = M.begin(), FE = M.end(); F != FE; ++F)
+    for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+      for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I)
+        numberUses(I, Order, Visited, Shared);
+
+  SmallVector<Use*, 16> Uses;
+  for (SetVector<Value*>::iterator I = Shared.begin(), E = Shared.end();
+       I != E; ++I) {
+    Value *V = *I;
+    // Constants that a pass created and then stopped using are left over in
+    // no particular order; drop them.
+    if (Constant *C = dyn_cast<Constant>(V))
+      C->removeDeadConstantUsers();
+    Uses.clear();
+    for (Value::use_iterator UI = V->use_begin(), UE = V->use_end();
+         UI != UE; ++UI)
+      Uses.push_back(&UI.getUse());
+    std::stable_sort(Uses.begin(), Uses.end(), UseOrder(Order));
+    V->reorderUseList(Uses);
+  }
+}
+
+/// Run the passes on every function of M, with one copy of this manager per
+/// worker thread.  The functions are handed out one at a time, so that a few
+/// large functions do not hold up the rest.
+bool FPPassManager::runOnFunctionsInParallel(Module &M) {
+  ThreadPool &Pool = TPM->getThreadPool();
+
+  SmallVector<Function *, 64> Functions;
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+    if (!I->isDeclaration())
+      Functions.push_back(I);
+
+  unsigned NumCopies = std::min(Pool.getNumThreads(),
+                                unsigned(Functions.size()));
+  SmallVector<FPPassManager *, 8> Copies;
+  for (unsigned i = 0; i != NumCopies; ++i) {
+    FPPassManager *Copy = createWorkerCopy();
+    if (Copy == 0)
+      break;
+    Copies.push_back(Copy);
+  }
+
+  bool Changed = false;
+  if (Copies.size() != NumCopies) {
+    // Some pass can not be copied after all; fall back to the serial loop.
+    for (unsigned i = 0, e = Copies.size(); i != e; ++i)
+      destroyWorkerCopy(Copies[i]);
+    for (unsigned i = 0, e = Functions.size(); i != e; ++i)
+      Changed |= runOnFunction(*Functions[i]);
+    return Changed;
+  }
+
+  for (unsigned i = 0; i != NumCopies; ++i)
+    Changed |= Copies[i]->doInitialization(M);
+
+  Function *LastFunction = M.empty() ? 0 : &M.getFunctionList().back();
+  GlobalVariable *LastGlobal =
+    M.global_empty() ? 0 : &M.getGlobalList().back();
+  volatile sys::cas_flag NextFunction = 0;
+  volatile sys::cas_flag FunctionChanged = 0;
+  {
+    TaskGroup Group(Pool);
+    for (unsigned i = 0; i != NumCopies; ++i)
+      Group.spawn(new FunctionWorkerTask(Copies[i], Functions, &NextFunction,
+                                         &FunctionChanged));
+    Group.wait();
+  }
+  Changed |= FunctionChanged != 0;
+  canonicalizeSharedIR(M, LastFunction, LastGlobal);
+
+  for (unsigned i = 0; i != NumCopies; ++i) {
+    Changed |= Copies[i]->doFinalization(M);
+    destroyWorkerCopy(Copies[i]);
+  }
+
+  // The copies did not drop the analyses of the enclosing managers that the
+  // pipeline fails to preserve.  Do it now, as a serial run would have.
+  populateInheritedAnalysis(TPM->activeStack);
+  for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index)
+    removeNotPreservedAnalysis(getContainedPass(Index));
+
+  return Changed;
+}
+
 bool FPPassManager::doInitialization(Module &M) {
   bool Changed = false;
 
@@ -1590,14 +1958,21 @@ MPPassManager::runOnModule(Module &M) {
     {
       PassManagerPrettyStackEntry X(MP, M);
       TimeRegion PassTimer(getPassTimer(MP));
+      TimeTraceRegion PassTrace(MP->getPassName(), M.getModuleIdentifier());
 
       LocalChanged |= MP->runOnModule(M);
     }
 
     Changed |= LocalChanged;
-    if (LocalChanged)
+    if (LocalChanged) {
+      // There is no telling which functions a module pass changed.  Nested
+      // managers have marked the functions their passes changed already.
+      if (MP->getAsPMDataManager() == 0)
+        for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+          I->markModified();
       dumpPassInfo(MP, MODIFICATION_MSG, ON_MODULE_MSG,
                    M.getModuleIdentifier());
+    }
     dumpPreservedSet(MP);
 
     verifyPreservedAnalysis(MP);
@@ -1722,6 +2097,10 @@ bool PassManager::run(Module &M) {
   return PM->run(M);
 }
 
+void PassManager::setThreadPool(ThreadPool *Pool) {
+  PM->setThreadPool(Pool);
+}
+
 //===----------------------------------------------------------------------===//
 // TimingInfo Class - This class is used to calculate information about the
 // amount of time each pass takes to execute.  This only happens with
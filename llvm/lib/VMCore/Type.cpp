@@ -302,6 +302,7 @@ IntegerType *IntegerType::get(LLVMContext &C, unsigned NumBits) {
     break;
   }
   
+  UniquingLock Lock(C.pImpl, C.pImpl->TypesLock);
   IntegerType *&Entry = C.pImpl->IntegerTypes[NumBits];
   
   if (Entry == 0)
@@ -355,6 +356,7 @@ FunctionType *FunctionType::get(Type *ReturnType,
     Key.push_back(0);
   
   LLVMContextImpl *pImpl = ReturnType->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->TypesLock);
   FunctionType *&FT = pImpl->FunctionTypes[Key];
   
   if (FT == 0) {
@@ -404,6 +406,7 @@ StructType *StructType::get(LLVMContext &Context, ArrayRef<Type*> ETypes,
   if (isPacked)
     Key.push_back(0);
   
+  UniquingLock Lock(Context.pImpl, Context.pImpl->TypesLock);
   StructType *&ST = Context.pImpl->AnonStructTypes[Key];
   if (ST) return ST;
   
@@ -421,8 +424,9 @@ void StructType::setBody(ArrayRef<Type*> Elements, bool isPacked) {
   if (isPacked)
     setSubclassData(getSubclassData() | SCDB_Packed);
   
-  Type **Elts = getContext().pImpl->
-    TypeAllocator.Allocate<Type*>(Elements.size());
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->TypesLock);
+  Type **Elts = pImpl->TypeAllocator.Allocate<Type*>(Elements.size());
   memcpy(Elts, Elements.data(), sizeof(Elements[0])*Elements.size());
   
   ContainedTys = Elts;
@@ -432,6 +436,8 @@ void StructType::setBody(ArrayRef<Type*> Elements, bool isPacked) {
 void StructType::setName(StringRef Name) {
   if (Name == getName()) return;
 
+  UniquingLock Lock(getContext().pImpl, getContext().pImpl->TypesLock);
+
   // If this struct already had a name, remove its symbol table entry.
   if (SymbolTableEntry) {
     getContext().pImpl->NamedStructTypes.erase(getName());
@@ -472,6 +478,7 @@ void StructType::setName(StringRef Name) {
 // StructType Helper functions.
 
 StructType *StructType::create(LLVMContext &Context, StringRef Name) {
+  UniquingLock Lock(Context.pImpl, Context.pImpl->TypesLock);
   StructType *ST = new (Context.pImpl->TypeAllocator) StructType(Context);
   if (!Name.empty())
     ST->setName(Name);
@@ -578,6 +585,7 @@ bool StructType::isLayoutIdentical(StructType *Other) const {
 /// getTypeByName - Return the type with the specified name, or null if there
 /// is none by that name.
 StructType *Module::getTypeByName(StringRef Name) const {
+  UniquingLock Lock(getContext().pImpl, getContext().pImpl->TypesLock);
   StringMap<StructType*>::iterator I =
     getContext().pImpl->NamedStructTypes.find(Name);
   if (I != getContext().pImpl->NamedStructTypes.end())
@@ -643,6 +651,7 @@ ArrayType *ArrayType::get(Type *elementType, uint64_t NumElements) {
   assert(isValidElementType(ElementType) && "Invalid type for array element!");
     
   LLVMContextImpl *pImpl = ElementType->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->TypesLock);
   ArrayType *&Entry = 
     pImpl->ArrayTypes[std::make_pair(ElementType, NumElements)];
   
@@ -672,6 +681,7 @@ VectorType *VectorType::get(Type *elementType, unsigned NumElements) {
          "Elements of a VectorType must be a primitive type");
   
   LLVMContextImpl *pImpl = ElementType->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->TypesLock);
   VectorType *&Entry = ElementType->getContext().pImpl
     ->VectorTypes[std::make_pair(ElementType, NumElements)];
   
@@ -695,6 +705,7 @@ PointerType *PointerType::get(Type *EltTy, unsigned AddressSpace) {
   assert(isValidElementType(EltTy) && "Invalid type for pointer element!");
   
   LLVMContextImpl *CImpl = EltTy->getContext().pImpl;
+  UniquingLock Lock(CImpl, CImpl->TypesLock);
   
   // Since AddressSpace #0 is the common case, we special case it.
   PointerType *&Entry = AddressSpace == 0 ? CImpl->PointerTypes[EltTy]
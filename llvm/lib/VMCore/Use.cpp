@@ -24,11 +24,11 @@ void Use::swap(Use &RHS) {
   Value *V2(RHS.Val);
   if (V1 != V2) {
     if (V1) {
-      removeFromList();
+      V1->removeUse(*this);
     }
 
     if (V2) {
-      RHS.removeFromList();
+      V2->removeUse(RHS);
       Val = V2;
       V2->addUse(*this);
     } else {
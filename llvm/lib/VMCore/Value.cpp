@@ -174,8 +174,15 @@ void Value::setName(const Twine &NewName) {
   if (NewName.isTriviallyEmpty() && !hasName())
     return;
 
+  // If the context discards the names of values other than globals, this
+  // value only ever has its name removed, and the new one isn't even built.
+  bool Discard = getContext().pImpl->DiscardValueNames &&
+                 !isa<GlobalValue>(this);
+  if (Discard && !hasName())
+    return;
+
   SmallString<256> NameData;
-  StringRef NameRef = NewName.toStringRef(NameData);
+  StringRef NameRef = Discard ? StringRef() : NewName.toStringRef(NameData);
 
   // Name isn't changing?
   if (getName() == NameRef)
@@ -301,13 +308,18 @@ void Value::replaceAllUsesWith(Value *New) {
   
   while (!use_empty()) {
     Use &U = *UseList;
+    User *Usr = U.getUser();
     // Must handle Constants specially, we cannot call replaceUsesOfWith on a
     // constant because they are uniqued.
-    if (Constant *C = dyn_cast<Constant>(U.getUser())) {
+    if (Constant *C = dyn_cast<Constant>(Usr)) {
       if (!isa<GlobalValue>(C)) {
         C->replaceUsesOfWithOnConstant(this, New, &U);
         continue;
       }
+    } else if (Instruction *I = dyn_cast<Instruction>(Usr)) {
+      if (BasicBlock *BB = I->getParent())
+        if (Function *F = BB->getParent())
+          F->markModified();
     }
     
     U.set(New);
@@ -419,6 +431,30 @@ Value *Value::DoPHITranslation(const BasicBlock *CurBB,
 
 LLVMContext &Value::getContext() const { return VTy->getContext(); }
 
+void Value::addSharedUse(Use &U) {
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingLock Lock(pImpl,
+                    pImpl->UseListLock[LLVMContextImpl::getUseListShard(this)]);
+  U.addToList(&UseList);
+}
+
+void Value::removeSharedUse(Use &U) {
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  UniquingLock Lock(pImpl,
+                    pImpl->UseListLock[LLVMContextImpl::getUseListShard(this)]);
+  U.removeFromList();
+}
+
+void Value::reorderUseList(ArrayRef<Use*> Uses) {
+  assert(Uses.size() == getNumUses() && "Not a permutation of the uses!");
+  // Each use is pushed on the front of the list, so go backwards.
+  UseList = 0;
+  for (unsigned i = Uses.size(); i != 0; --i) {
+    assert(Uses[i - 1]->get() == this && "Not a use of this value!");
+    Uses[i - 1]->addToList(&UseList);
+  }
+}
+
 //===----------------------------------------------------------------------===//
 //                             ValueHandleBase Class
 //===----------------------------------------------------------------------===//
@@ -427,6 +463,8 @@ LLVMContext &Value::getContext() const { return VTy->getContext(); }
 /// List is known to point into the existing use list.
 void ValueHandleBase::AddToExistingUseList(ValueHandleBase **List) {
   assert(List && "Handle list is null?");
+  LLVMContextImpl *pImpl = VP->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ValueHandlesLock);
 
   // Splice ourselves into the list.
   Next = *List;
@@ -440,6 +478,8 @@ void ValueHandleBase::AddToExistingUseList(ValueHandleBase **List) {
 
 void ValueHandleBase::AddToExistingUseListAfter(ValueHandleBase *List) {
   assert(List && "Must insert after existing node");
+  LLVMContextImpl *pImpl = VP->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ValueHandlesLock);
 
   Next = List->Next;
   setPrevPtr(&List->Next);
@@ -453,6 +493,7 @@ void ValueHandleBase::AddToUseList() {
   assert(VP && "Null pointer doesn't have a use list!");
 
   LLVMContextImpl *pImpl = VP->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ValueHandlesLock);
 
   if (VP->HasValueHandle) {
     // If this value already has a ValueHandle, then it must be in the
@@ -464,11 +505,11 @@ void ValueHandleBase::AddToUseList() {
   }
 
   // Ok, it doesn't have any handles yet, so we must insert it into the
-  // DenseMap.  However, doing this insertion could cause the DenseMap to
+  // map.  However, doing this insertion could cause the map to
   // reallocate itself, which would invalidate all of the PrevP pointers that
   // point into the old table.  Handle this by checking for reallocation and
   // updating the stale pointers only if needed.
-  DenseMap<Value*, ValueHandleBase*> &Handles = pImpl->ValueHandles;
+  LLVMContextImpl::ValueHandlesTy &Handles = pImpl->ValueHandles;
   const void *OldBucketPtr = Handles.getPointerIntoBucketsArray();
 
   ValueHandleBase *&Entry = Handles[VP];
@@ -484,7 +525,7 @@ void ValueHandleBase::AddToUseList() {
   }
 
   // Okay, reallocation did happen.  Fix the Prev Pointers.
-  for (DenseMap<Value*, ValueHandleBase*>::iterator I = Handles.begin(),
+  for (LLVMContextImpl::ValueHandlesTy::iterator I = Handles.begin(),
        E = Handles.end(); I != E; ++I) {
     assert(I->second && I->first == I->second->VP && "List invariant broken!");
     I->second->setPrevPtr(&I->second);
@@ -494,6 +535,8 @@ void ValueHandleBase::AddToUseList() {
 /// RemoveFromUseList - Remove this ValueHandle from its current use list.
 void ValueHandleBase::RemoveFromUseList() {
   assert(VP && VP->HasValueHandle && "Pointer doesn't have a use list!");
+  LLVMContextImpl *pImpl = VP->getContext().pImpl;
+  UniquingLock Lock(pImpl, pImpl->ValueHandlesLock);
 
   // Unlink this from its use list.
   ValueHandleBase **PrevPtr = getPrevPtr();
@@ -509,8 +552,7 @@ void ValueHandleBase::RemoveFromUseList() {
   // If the Next pointer was null, then it is possible that this was the last
   // ValueHandle watching VP.  If so, delete its entry from the ValueHandles
   // map.
-  LLVMContextImpl *pImpl = VP->getContext().pImpl;
-  DenseMap<Value*, ValueHandleBase*> &Handles = pImpl->ValueHandles;
+  LLVMContextImpl::ValueHandlesTy &Handles = pImpl->ValueHandles;
   if (Handles.isPointerIntoBucketsArray(PrevPtr)) {
     Handles.erase(VP);
     VP->HasValueHandle = false;
@@ -524,7 +566,11 @@ void ValueHandleBase::ValueIsDeleted(Value *V) {
   // Get the linked list base, which is guaranteed to exist since the
   // HasValueHandle flag is set.
   LLVMContextImpl *pImpl = V->getContext().pImpl;
-  ValueHandleBase *Entry = pImpl->ValueHandles[V];
+  ValueHandleBase *Entry;
+  {
+    UniquingLock Lock(pImpl, pImpl->ValueHandlesLock);
+    Entry = pImpl->ValueHandles[V];
+  }
   assert(Entry && "Value bit set but no entries exist");
 
   // We use a local ValueHandleBase as an iterator so that ValueHandles can add
@@ -582,7 +628,11 @@ void ValueHandleBase::ValueIsRAUWd(Value *Old, Value *New) {
   // Get the linked list base, which is guaranteed to exist since the
   // HasValueHandle flag is set.
   LLVMContextImpl *pImpl = Old->getContext().pImpl;
-  ValueHandleBase *Entry = pImpl->ValueHandles[Old];
+  ValueHandleBase *Entry;
+  {
+    UniquingLock Lock(pImpl, pImpl->ValueHandlesLock);
+    Entry = pImpl->ValueHandles[Old];
+  }
 
   assert(Entry && "Value bit set but no entries exist");
 
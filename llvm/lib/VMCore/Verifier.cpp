@@ -60,8 +60,11 @@
 #include "llvm/CodeGen/ValueTypes.h"
 #include "llvm/Support/CallSite.h"
 #include "llvm/Support/CFG.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/InstVisitor.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
@@ -73,6 +76,11 @@
 #include <cstdarg>
 using namespace llvm;
 
+static cl::opt<bool>
+VerifyModifiedOnly("verify-modified-only", cl::Hidden,
+  cl::desc("Only verify the bodies of functions that changed since they "
+           "were last verified"));
+
 namespace {  // Anonymous namespace for class
   struct PreVerifier : public FunctionPass {
     static char ID; // Pass ID, replacement for typeid
@@ -85,6 +93,8 @@ namespace {  // Anonymous namespace for class
       AU.setPreservesAll();
     }
 
+    virtual bool isParallelSafe() const { return true; }
+
     // Check that the prerequisites for successful DominatorTree construction
     // are satisfied.
     bool runOnFunction(Function &F) {
@@ -118,8 +128,10 @@ namespace {
     static char ID; // Pass ID, replacement for typeid
     bool Broken;          // Is this module found to be broken?
     bool RealPass;        // Are we not being run by a PassManager?
+    bool OnlyModified;    // Skip bodies verified at their current epoch?
     VerifierFailureAction action;
                           // What to do if verification fails.
+    Verifier *Primary;    // The verifier this is a parallel instance of, or 0
     Module *Mod;          // Module we are verifying right now
     LLVMContext *Context; // Context within which we are verifying
     DominatorTree *DT;    // Dominator Tree, caution can be null!
@@ -142,40 +154,79 @@ namespace {
     /// the same personality function.
     const Value *PersonalityFn;
 
+    /// LocalDT - The dominator tree of the function being verified, when
+    /// OnlyModified keeps the pass manager from computing one for every
+    /// function.
+    OwningPtr<DominatorTree> LocalDT;
+
+    /// FunctionMessages - The messages about the functions that parallel
+    /// instances found to be broken.  The primary instance prints them in
+    /// module order.
+    std::vector<std::pair<const Function *, std::string> > FunctionMessages;
+
     Verifier()
       : FunctionPass(ID), Broken(false), RealPass(true),
-        action(AbortProcessAction), Mod(0), Context(0), DT(0),
-        MessagesStr(Messages), PersonalityFn(0) {
+        OnlyModified(VerifyModifiedOnly), action(AbortProcessAction),
+        Primary(0), Mod(0), Context(0), DT(0), MessagesStr(Messages),
+        PersonalityFn(0) {
       initializeVerifierPass(*PassRegistry::getPassRegistry());
     }
-    explicit Verifier(VerifierFailureAction ctn)
-      : FunctionPass(ID), Broken(false), RealPass(true), action(ctn), Mod(0),
-        Context(0), DT(0), MessagesStr(Messages), PersonalityFn(0) {
+    Verifier(VerifierFailureAction ctn, bool OnlyModified)
+      : FunctionPass(ID), Broken(false), RealPass(true),
+        OnlyModified(OnlyModified), action(ctn),
+        Primary(0), Mod(0), Context(0), DT(0), MessagesStr(Messages),
+        PersonalityFn(0) {
       initializeVerifierPass(*PassRegistry::getPassRegistry());
     }
 
+    /// Each function is verified on its own, and the module level checks are
+    /// left to the primary instance.
+    virtual bool isParallelSafe() const { return true; }
+
+    virtual Pass *createParallelInstance() const {
+      Verifier *V = new Verifier(action, OnlyModified);
+      V->Primary = const_cast<Verifier *>(this);
+      return V;
+    }
+
     bool doInitialization(Module &M) {
       Mod = &M;
       Context = &M.getContext();
 
+      // Do this here rather than on a worker thread when this is a parallel
+      // instance.
+      if (OnlyModified && !LocalDT)
+        LocalDT.reset(new DominatorTree());
+
       // If this is a real pass, in a pass manager, we must abort before
       // returning back to the pass manager, or else the pass manager may try to
       // run other passes on the broken module.
-      if (RealPass)
+      if (RealPass && !Primary)
         return abortIfBroken();
       return false;
     }
 
     bool runOnFunction(Function &F) {
-      // Get dominator information if we are being run by PassManager
-      if (RealPass) DT = &getAnalysis<DominatorTree>();
-
       Mod = F.getParent();
       if (!Context) Context = &F.getContext();
 
-      visit(F);
-      InstsInThisBlock.clear();
-      PersonalityFn = 0;
+      // The checks of a body only look at the body and at the types of the
+      // values it uses, so a body that has not changed since it was last
+      // found to be well formed is still well formed.
+      if (OnlyModified && F.getVerifiedEpoch() == F.getModificationEpoch())
+        visitFunction(F);
+      else
+        verifyBody(F);
+
+      // A parallel instance leaves reporting to the primary instance, which
+      // can keep the messages in module order, unless it has to abort.
+      if (Primary && action != AbortProcessAction) {
+        if (!MessagesStr.str().empty()) {
+          FunctionMessages.push_back(std::make_pair(&F, Messages));
+          Messages.clear();
+        }
+        return false;
+      }
 
       // If this is a real pass, in a pass manager, we must abort before
       // returning back to the pass manager, or else the pass manager may try to
@@ -186,7 +237,56 @@ namespace {
       return false;
     }
 
+    /// verifyBody - Check F and its body, and record its modification epoch
+    /// if it is well formed.
+    void verifyBody(Function &F) {
+      // Get dominator information if we are being run by PassManager.  A
+      // parallel instance can't use one that is merely available, as it may
+      // belong to another thread.
+      if (RealPass) {
+        if (!OnlyModified)
+          DT = &getAnalysis<DominatorTree>();
+        else if (Primary || !(DT = getAnalysisIfAvailable<DominatorTree>())) {
+          if (!LocalDT)
+            LocalDT.reset(new DominatorTree());
+          LocalDT->runOnFunction(F);
+          DT = LocalDT.get();
+        }
+      }
+
+      bool WasBroken = Broken;
+      Broken = false;
+      visit(F);
+      InstsInThisBlock.clear();
+      PersonalityFn = 0;
+      if (LocalDT)
+        LocalDT->releaseMemory();
+
+      if (!Broken)
+        F.setVerifiedEpoch(F.getModificationEpoch());
+      Broken |= WasBroken;
+    }
+
     bool doFinalization(Module &M) {
+      if (Primary) {
+        Primary->Broken |= Broken;
+        Primary->FunctionMessages.insert(Primary->FunctionMessages.end(),
+                                         FunctionMessages.begin(),
+                                         FunctionMessages.end());
+        FunctionMessages.clear();
+        return false;
+      }
+
+      if (!FunctionMessages.empty()) {
+        DenseMap<const Function *, const std::string *> ByFunction;
+        for (unsigned i = 0, e = FunctionMessages.size(); i != e; ++i)
+          ByFunction[FunctionMessages[i].first] = &FunctionMessages[i].second;
+        for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+          if (const std::string *Msg = ByFunction.lookup(I))
+            MessagesStr << *Msg;
+        FunctionMessages.clear();
+      }
+
       // Scan through, checking all of the external function's linkage now...
       for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
         visitGlobalValue(*I);
@@ -214,7 +314,7 @@ namespace {
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
       AU.setPreservesAll();
       AU.addRequiredID(PreVerifyID);
-      if (RealPass)
+      if (RealPass && !OnlyModified)
         AU.addRequired<DominatorTree>();
     }
 
@@ -2021,8 +2121,9 @@ void Verifier::VerifyIntrinsicPrototype(Intrinsic::ID ID, Function *F,
 //  Implement the public interfaces to this file...
 //===----------------------------------------------------------------------===//
 
-FunctionPass *llvm::createVerifierPass(VerifierFailureAction action) {
-  return new Verifier(action);
+FunctionPass *llvm::createVerifierPass(VerifierFailureAction action,
+                                       bool OnlyModified) {
+  return new Verifier(action, OnlyModified || VerifyModifiedOnly);
 }
 
 
@@ -2034,7 +2135,7 @@ bool llvm::verifyFunction(const Function &f, VerifierFailureAction action) {
   assert(!F.isDeclaration() && "Cannot verify external functions");
 
   FunctionPassManager FPM(F.getParent());
-  Verifier *V = new Verifier(action);
+  Verifier *V = new Verifier(action, false);
   FPM.add(V);
   FPM.run(F);
   return V->Broken;
@@ -2044,9 +2145,9 @@ bool llvm::verifyFunction(const Function &f, VerifierFailureAction action) {
 /// Return true if the module is corrupt.
 ///
 bool llvm::verifyModule(const Module &M, VerifierFailureAction action,
-                        std::string *ErrorInfo) {
+                        std::string *ErrorInfo, bool OnlyModified) {
   PassManager PM;
-  Verifier *V = new Verifier(action);
+  Verifier *V = new Verifier(action, OnlyModified);
   PM.add(V);
   PM.run(const_cast<Module&>(M));
 
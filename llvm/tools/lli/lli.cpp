@@ -24,6 +24,7 @@
 #include "llvm/ExecutionEngine/JIT.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/IRReader.h"
 #include "llvm/Support/ManagedStatic.h"
@@ -60,6 +61,29 @@ namespace {
     "use-mcjit", cl::desc("Enable use of the MC-based JIT (if available)"),
     cl::init(false));
 
+  cl::opt<bool>
+  PerfMap("perf-map",
+          cl::desc("List JIT-compiled functions in /tmp/perf-<pid>.map for "
+                   "the Linux perf tool"));
+
+  cl::opt<std::string>
+  JITDumpDir("jitdump-dir",
+             cl::desc("Write JIT-compiled functions with their code and line "
+                      "tables to a jitdump file for perf in this directory"),
+             cl::value_desc("directory"));
+
+  cl::opt<std::string>
+  ObjectCacheDir("object-cache-dir",
+                 cl::desc("Reuse objects generated by the MC-based JIT in "
+                          "earlier runs, caching them in this directory"),
+                 cl::value_desc("directory"));
+
+  cl::opt<unsigned>
+  ObjectCacheSize("object-cache-size",
+                  cl::desc("Maximum size in kilobytes of the object cache "
+                           "directory (default = unlimited)"),
+                  cl::init(0));
+
   // Determine optimization level.
   cl::opt<char>
   OptLevel("O",
@@ -109,6 +133,29 @@ namespace {
                   cl::desc("Disable JIT lazy compilation"),
                   cl::init(false));
 
+  cl::opt<bool>
+  BackgroundCompilation("jit-background-compilation",
+                        cl::desc("Compile lazily called functions ahead on "
+                                 "a background thread"),
+                        cl::init(false));
+
+  cl::opt<bool>
+  Tiered("tiered",
+         cl::desc("Start out interpreting, and JIT compile hot functions"),
+         cl::init(false));
+
+  cl::opt<unsigned>
+  Tier1Threshold("tier1-threshold",
+                 cl::desc("Calls and loop iterations after which a function "
+                          "is compiled at -O1 (0 = never)"),
+                 cl::init(100));
+
+  cl::opt<unsigned>
+  Tier2Threshold("tier2-threshold",
+                 cl::desc("Calls and loop iterations after which a function "
+                          "is compiled at -O3 (0 = never)"),
+                 cl::init(10000));
+
   cl::opt<Reloc::Model>
   RelocModel("relocation-model",
              cl::desc("Choose relocation model"),
@@ -143,11 +190,15 @@ namespace {
 }
 
 static ExecutionEngine *EE = 0;
+static ObjectCache *ObjCache = 0;
+static JITEventListener *PerfListener = 0;
 
 static void do_shutdown() {
   // Cygwin-1.5 invokes DLL's dtors before atexit handler.
 #ifndef DO_NOTHING_ATEXIT
   delete EE;
+  delete ObjCache;
+  delete PerfListener;
   llvm_shutdown();
 #endif
 }
@@ -224,6 +275,9 @@ int main(int argc, char **argv, char * const *envp) {
   }
   builder.setOptLevel(OLvl);
 
+  if (Tiered)
+    builder.setTieredCompilation(Tier1Threshold, Tier2Threshold);
+
   EE = builder.create();
   if (!EE) {
     if (!ErrorMsg.empty())
@@ -234,8 +288,19 @@ int main(int argc, char **argv, char * const *envp) {
   }
 
   EE->RegisterJITEventListener(createOProfileJITEventListener());
+  if (PerfMap || !JITDumpDir.empty()) {
+    PerfListener = createPerfJITEventListener(JITDumpDir);
+    EE->RegisterJITEventListener(PerfListener);
+  }
+
+  if (!ObjectCacheDir.empty()) {
+    ObjCache = new DiskObjectCache(ObjectCacheDir,
+                                   uint64_t(ObjectCacheSize) * 1024);
+    EE->setObjectCache(ObjCache);
+  }
 
   EE->DisableLazyCompilation(NoLazyCompilation);
+  EE->EnableBackgroundCompilation(BackgroundCompilation);
 
   // If the user specifically requested an argv[0] to pass into the program,
   // do it now.
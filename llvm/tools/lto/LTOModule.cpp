@@ -84,10 +84,16 @@ LTOModule::LTOModule(Module *m, TargetMachine *t)
 {
 }
 
+/// BitcodeAccessHints - How the bitcode files are read: the whole module is
+/// read in, mostly front to back.
+static const unsigned BitcodeAccessHints =
+  MemoryBuffer::AH_Sequential | MemoryBuffer::AH_WillNeed;
+
 LTOModule *LTOModule::makeLTOModule(const char *path,
                                     std::string &errMsg) {
   OwningPtr<MemoryBuffer> buffer;
-  if (error_code ec = MemoryBuffer::getFile(path, buffer)) {
+  if (error_code ec = MemoryBuffer::getFile(path, buffer, -1, true,
+                                            BitcodeAccessHints)) {
     errMsg = ec.message();
     return NULL;
   }
@@ -106,7 +112,8 @@ LTOModule *LTOModule::makeLTOModule(int fd, const char *path,
                                     std::string &errMsg) {
   OwningPtr<MemoryBuffer> buffer;
   if (error_code ec = MemoryBuffer::getOpenFile(fd, path, buffer, file_size,
-                                                map_size, offset, false)) {
+                                                map_size, offset, false,
+                                                BitcodeAccessHints)) {
     errMsg = ec.message();
     return NULL;
   }
@@ -9,6 +9,7 @@
 
 #include "gtest/gtest.h"
 #include "llvm/ADT/DenseMap.h"
+#include <string>
 
 using namespace llvm;
 
@@ -176,4 +177,24 @@ TEST_F(DenseMapTest, ConstIteratorTest) {
   EXPECT_TRUE(cit == cit2);
 }
 
+// StringRef keys are compared by contents, not by address.
+TEST_F(DenseMapTest, StringRefTest) {
+  DenseMap<StringRef, int> M;
+  std::string Foo = "foo";
+  M[""] = 0;
+  M["foo"] = 1;
+  M["bar"] = 2;
+
+  EXPECT_EQ(3u, M.size());
+  EXPECT_EQ(0, M.lookup(""));
+  EXPECT_EQ(1, M.lookup(Foo));
+  EXPECT_EQ(2, M.lookup("bar"));
+  EXPECT_TRUE(M.find(StringRef("barx", 3)) != M.end());
+  EXPECT_TRUE(M.find("baz") == M.end());
+
+  M.erase("foo");
+  EXPECT_EQ(2u, M.size());
+  EXPECT_EQ(0, M.lookup(Foo));
+}
+
 }
@@ -0,0 +1,170 @@
+//===- llvm/unittest/ADT/FlatHashMapTest.cpp - FlatHashMap unit tests -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/ADT/FlatHashMap.h"
+#include <map>
+
+using namespace llvm;
+
+namespace {
+
+// Counts the live instances, to check that the map constructs and destroys
+// exactly the entries in use.
+struct Counted {
+  static int Live;
+  unsigned Val;
+  Counted(unsigned V = 0) : Val(V) { ++Live; }
+  Counted(const Counted &Other) : Val(Other.Val) { ++Live; }
+  ~Counted() { --Live; }
+};
+int Counted::Live = 0;
+
+// Test fixture
+class FlatHashMapTest : public testing::Test {
+protected:
+  FlatHashMap<uint32_t, uint32_t> uintMap;
+  FlatHashMap<uint32_t *, uint32_t *> uintPtrMap;
+  uint32_t dummyInt;
+};
+
+// Empty map tests
+TEST_F(FlatHashMapTest, EmptyMapTest) {
+  EXPECT_EQ(0u, uintMap.size());
+  EXPECT_TRUE(uintMap.empty());
+  EXPECT_TRUE(uintMap.begin() == uintMap.end());
+  EXPECT_FALSE(uintMap.count(0u));
+  EXPECT_TRUE(uintMap.find(0u) == uintMap.end());
+  EXPECT_EQ(0u, uintMap.lookup(0u));
+
+  const FlatHashMap<uint32_t *, uint32_t *> &constUintPtrMap = uintPtrMap;
+  EXPECT_TRUE(constUintPtrMap.begin() == constUintPtrMap.end());
+  EXPECT_TRUE(constUintPtrMap.find(&dummyInt) == constUintPtrMap.end());
+  EXPECT_EQ(0, constUintPtrMap.lookup(&dummyInt));
+}
+
+// A map with a single entry
+TEST_F(FlatHashMapTest, SingleEntryMapTest) {
+  uintMap[0] = 1;
+
+  EXPECT_EQ(1u, uintMap.size());
+  EXPECT_FALSE(uintMap.empty());
+
+  FlatHashMap<uint32_t, uint32_t>::iterator it = uintMap.begin();
+  EXPECT_EQ(0u, it->first);
+  EXPECT_EQ(1u, it->second);
+  ++it;
+  EXPECT_TRUE(it == uintMap.end());
+
+  EXPECT_TRUE(uintMap.count(0u));
+  EXPECT_TRUE(uintMap.find(0u) == uintMap.begin());
+  EXPECT_EQ(1u, uintMap.lookup(0u));
+  EXPECT_FALSE(uintMap.insert(std::make_pair(0u, 2u)).second);
+  EXPECT_EQ(1u, uintMap[0]);
+}
+
+// Test erase(iterator), erase(value) and clear()
+TEST_F(FlatHashMapTest, EraseAndClearTest) {
+  uintMap[0] = 1;
+  uintMap[1] = 2;
+  uintMap.erase(uintMap.find(0));
+  EXPECT_EQ(1u, uintMap.size());
+  EXPECT_FALSE(uintMap.count(0));
+  EXPECT_TRUE(uintMap.erase(1));
+  EXPECT_FALSE(uintMap.erase(1));
+  EXPECT_TRUE(uintMap.empty());
+  EXPECT_TRUE(uintMap.begin() == uintMap.end());
+
+  uintMap[2] = 3;
+  uintMap.clear();
+  EXPECT_TRUE(uintMap.empty());
+  EXPECT_TRUE(uintMap.begin() == uintMap.end());
+}
+
+// Test the copy constructor and the assignment operator
+TEST_F(FlatHashMapTest, CopyTest) {
+  for (uint32_t i = 0; i != 100; ++i)
+    uintMap[i] = i + 1;
+
+  FlatHashMap<uint32_t, uint32_t> copyMap(uintMap);
+  FlatHashMap<uint32_t, uint32_t> assignedMap;
+  assignedMap = uintMap;
+  EXPECT_EQ(100u, copyMap.size());
+  EXPECT_EQ(100u, assignedMap.size());
+  for (uint32_t i = 0; i != 100; ++i) {
+    EXPECT_EQ(i + 1, copyMap.lookup(i));
+    EXPECT_EQ(i + 1, assignedMap.lookup(i));
+  }
+}
+
+// Iteration visits every entry once, and erasing the current entry doesn't
+// disturb it.
+TEST_F(FlatHashMapTest, IterationTest) {
+  bool visited[100];
+  for (int i = 0; i < 100; ++i) {
+    visited[i] = false;
+    uintMap[i] = 3;
+  }
+
+  for (FlatHashMap<uint32_t, uint32_t>::iterator it = uintMap.begin(),
+       e = uintMap.end(); it != e; ) {
+    FlatHashMap<uint32_t, uint32_t>::iterator cur = it++;
+    ASSERT_FALSE(visited[cur->first]);
+    visited[cur->first] = true;
+    if (cur->first % 2)
+      uintMap.erase(cur);
+  }
+
+  for (int i = 0; i < 100; ++i)
+    ASSERT_TRUE(visited[i]) << "Entry #" << i << " was never visited";
+  EXPECT_EQ(50u, uintMap.size());
+}
+
+// Only the entries in use are constructed, and all of them are destroyed.
+TEST_F(FlatHashMapTest, ConstructionTest) {
+  {
+    FlatHashMap<uint32_t, Counted> Map;
+    for (uint32_t i = 0; i != 1000; ++i)
+      Map[i] = Counted(i);
+    EXPECT_EQ(1000, Counted::Live);
+    for (uint32_t i = 0; i != 1000; i += 2)
+      Map.erase(i);
+    EXPECT_EQ(500, Counted::Live);
+
+    FlatHashMap<uint32_t, Counted> Copy(Map);
+    EXPECT_EQ(1000, Counted::Live);
+    Copy.clear();
+    EXPECT_EQ(500, Counted::Live);
+  }
+  EXPECT_EQ(0, Counted::Live);
+}
+
+// A map whose entries keep being replaced by new ones stays as big as it
+// needs to be for its size, and agrees with std::map throughout.
+TEST_F(FlatHashMapTest, ChurnTest) {
+  std::map<uint32_t, uint32_t> Reference;
+  size_t MaxMemory = 0;
+  for (uint32_t i = 0; i != 100000; ++i) {
+    uintMap[i] = i;
+    Reference[i] = i;
+    if (i >= 500) {
+      EXPECT_TRUE(uintMap.erase(i - 500));
+      Reference.erase(i - 500);
+    }
+    MaxMemory = std::max(MaxMemory, uintMap.getMemorySize());
+  }
+
+  EXPECT_EQ(Reference.size(), uintMap.size());
+  for (std::map<uint32_t, uint32_t>::iterator I = Reference.begin(),
+       E = Reference.end(); I != E; ++I)
+    EXPECT_EQ(I->second, uintMap.lookup(I->first));
+  EXPECT_GE(1024 * (sizeof(std::pair<uint32_t, uint32_t>) + 1), MaxMemory);
+}
+
+}
@@ -0,0 +1,83 @@
+//===- llvm/unittest/ADT/HashingTest.cpp - hash_value unit tests ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+/// countBits - Return the number of bits set in V.
+static unsigned countBits(unsigned V) {
+  unsigned Count = 0;
+  for (; V; V &= V - 1)
+    ++Count;
+  return Count;
+}
+
+TEST(HashingTest, AlignmentDoesNotMatter) {
+  const char *Text = "_ZN4llvm12DenseMapInfoINS_9StringRefEE12getHashValueES1_";
+  std::string Copy(Text);
+  for (unsigned Offset = 0; Offset != 8; ++Offset) {
+    std::string Shifted = std::string(Offset, ' ') + Copy;
+    EXPECT_EQ(hash_value(Copy), hash_value(StringRef(Shifted).substr(Offset)));
+  }
+}
+
+TEST(HashingTest, LengthMatters) {
+  // Strings of zeros differ only in their lengths.
+  std::string Zeros(32, '\0');
+  std::vector<unsigned> Hashes;
+  for (unsigned Len = 0; Len <= Zeros.size(); ++Len) {
+    unsigned Hash = hash_value(StringRef(Zeros.data(), Len));
+    for (unsigned i = 0; i != Hashes.size(); ++i)
+      EXPECT_NE(Hashes[i], Hash) << "lengths " << i << " and " << Len;
+    Hashes.push_back(Hash);
+  }
+}
+
+TEST(HashingTest, Avalanche) {
+  // Flipping any one input bit should flip about half of the output bits.
+  std::string Key = "_ZNK4llvm5Value7getTypeEv";
+  unsigned Base = hash_value(Key);
+  unsigned Flipped = 0;
+  for (unsigned Bit = 0, e = Key.size() * 8; Bit != e; ++Bit) {
+    std::string Changed = Key;
+    Changed[Bit / 8] ^= char(1 << (Bit % 8));
+    unsigned Diff = countBits(Base ^ hash_value(Changed));
+    EXPECT_LT(0U, Diff) << "bit " << Bit;
+    Flipped += Diff;
+  }
+  double Average = double(Flipped) / (Key.size() * 8);
+  EXPECT_LT(12.0, Average);
+  EXPECT_GT(20.0, Average);
+}
+
+TEST(HashingTest, LowBitsSpreadSimilarNames) {
+  // Mangled names that only differ in a few characters in the middle must
+  // still spread over the buckets of a power of two sized table.
+  const unsigned NumBuckets = 4096;
+  std::vector<unsigned> Load(NumBuckets);
+  unsigned MaxLoad = 0;
+  for (unsigned i = 0; i != NumBuckets; ++i) {
+    SmallString<64> Name;
+    raw_svector_ostream(Name) << "_ZN4llvm7Bucket" << i << "E3getEv";
+    unsigned &L = Load[hash_value(Name.str()) & (NumBuckets - 1)];
+    if (++L > MaxLoad)
+      MaxLoad = L;
+  }
+  EXPECT_GT(10U, MaxLoad);
+}
+
+}
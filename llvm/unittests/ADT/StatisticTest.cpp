@@ -0,0 +1,92 @@
+//===- llvm/unittest/ADT/StatisticTest.cpp - Statistic unit tests ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "unittest"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Config/config.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#if LLVM_ENABLE_THREADS != 0 && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#endif
+
+using namespace llvm;
+
+STATISTIC(Counter, "Counts things");
+STATISTIC(Counter2, "Counts other \"things\"");
+STATISTIC(Threaded, "Counts things on several threads");
+
+namespace {
+
+TEST(StatisticTest, Count) {
+  EnableStatistics();
+
+  EXPECT_EQ(0u, Counter);
+  ++Counter;
+#ifdef LLVM_THREAD_LOCAL
+  // From now on the thread finds its counters without calling out of line.
+  EXPECT_TRUE(Statistic::ThreadChunks != 0);
+#endif
+  ++Counter;
+  Counter += 5;
+  EXPECT_EQ(7u, Counter.getValue());
+  EXPECT_EQ(7u, Counter--);
+  EXPECT_EQ(6u, Counter);
+
+  Counter = 10;
+  EXPECT_EQ(10u, Counter);
+  ++Counter;
+  Counter *= 2;
+  EXPECT_EQ(22u, Counter);
+  Counter /= 11;
+  EXPECT_EQ(2u, Counter);
+}
+
+#if LLVM_ENABLE_THREADS != 0 && defined(HAVE_PTHREAD_H)
+static void *bumpThreaded(void *) {
+  for (unsigned i = 0; i != 10000; ++i)
+    ++Threaded;
+  return 0;
+}
+
+// The counts of every thread add up, including those of exited threads.
+TEST(StatisticTest, Threads) {
+  pthread_t Threads[4];
+  for (unsigned i = 0; i != 4; ++i)
+    pthread_create(&Threads[i], 0, bumpThreaded, 0);
+  for (unsigned i = 0; i != 4; ++i)
+    pthread_join(Threads[i], 0);
+  ++Threaded;
+  EXPECT_EQ(40001u, Threaded);
+
+  // The exited threads' shards get reused.
+  pthread_t Thread;
+  pthread_create(&Thread, 0, bumpThreaded, 0);
+  pthread_join(Thread, 0);
+  EXPECT_EQ(50001u, Threaded);
+}
+#endif
+
+TEST(StatisticTest, JSON) {
+  EnableStatistics();
+  Counter2 = 3;
+
+  std::string Str;
+  raw_string_ostream OS(Str);
+  PrintStatisticsJSON(OS);
+  OS.str();
+  EXPECT_EQ(0u, Str.find("{\n  \"version\": 1,\n  \"statistics\": [\n"));
+  EXPECT_NE(std::string::npos,
+            Str.find("    { \"group\": \"unittest\", \"name\": \"Counter2\", "
+                     "\"desc\": \"Counts other \\\"things\\\"\", "
+                     "\"value\": 3 }"));
+  EXPECT_LT(Str.find("\"Counter\""), Str.find("\"Counter2\""));
+}
+
+}  // end anonymous namespace
@@ -8,15 +8,27 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Analysis/Verifier.h"
+#include "llvm/Bitcode/BitstreamReader.h"
 #include "llvm/Bitcode/BitstreamWriter.h"
+#include "llvm/Bitcode/LLVMBitCodes.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/Constants.h"
 #include "llvm/Instructions.h"
 #include "llvm/LLVMContext.h"
+#include "llvm/Metadata.h"
 #include "llvm/Module.h"
 #include "llvm/PassManager.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/DebugLoc.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
 #include "gtest/gtest.h"
+#include <algorithm>
+#include <cstdlib>
 
 namespace llvm {
 namespace {
@@ -61,5 +73,273 @@ TEST(BitReaderTest, MaterializeFunctionsForBlockAddr) { // PR11677
   passes.run(*m);
 }
 
+// A context that discards value names reads the names of globals only.
+TEST(BitReaderTest, DiscardValueNames) {
+  std::vector<unsigned char> Mem;
+  writeModuleToBuffer(Mem);
+  StringRef Data((const char*)&Mem[0], Mem.size());
+  MemoryBuffer *Buffer = MemoryBuffer::getMemBuffer(Data, "test", false);
+  LLVMContext Context;
+  Context.setDiscardValueNames(true);
+  std::string errMsg;
+  OwningPtr<Module> m(ParseBitcodeFile(Buffer, Context, &errMsg));
+  delete Buffer;
+  ASSERT_TRUE(m != 0) << errMsg;
+  Function *F = m->getFunction("func");
+  ASSERT_TRUE(F != 0);
+  EXPECT_TRUE(m->getGlobalVariable("table") != 0);
+  for (Function::iterator BB = F->begin(), E = F->end(); BB != E; ++BB)
+    EXPECT_FALSE(BB->hasName());
+  EXPECT_FALSE(verifyModule(*m, ReturnStatusAction));
+}
+
+/// makeModuleWithBodies - Return a module of NumFunctions functions, where
+/// function fN adds its argument to itself N+1 times.
+static Module *makeModuleWithBodies(LLVMContext &Context,
+                                    unsigned NumFunctions) {
+  Module *Mod = new Module("bodies", Context);
+  Type *Int32Ty = Type::getInt32Ty(Context);
+  std::vector<Type*> Params(1, Int32Ty);
+  FunctionType *FuncTy = FunctionType::get(Int32Ty, Params, false);
+  for (unsigned i = 0; i != NumFunctions; ++i) {
+    Function *Func = Function::Create(FuncTy, GlobalValue::ExternalLinkage,
+                                      "f" + utostr(i), Mod);
+    BasicBlock *Entry = BasicBlock::Create(Context, "entry", Func);
+    Value *V = Func->arg_begin();
+    for (unsigned j = 0; j <= i; ++j)
+      V = BinaryOperator::CreateAdd(V, V, "", Entry);
+    ReturnInst::Create(Context, V, Entry);
+  }
+  return Mod;
+}
+
+// The writer indexes the function bodies, and a lazy reader materializes
+// each one from the index, in any order.
+TEST(BitReaderTest, FunctionIndex) {
+  const unsigned NumFunctions = 5;
+  LLVMContext Context;
+  std::vector<unsigned char> Mem;
+  {
+    OwningPtr<Module> Mod(makeModuleWithBodies(Context, NumFunctions));
+    BitstreamWriter Stream(Mem);
+    WriteBitcodeToStream(Mod.get(), Stream);
+  }
+
+  // The module block points at the index, which has an entry per body.
+  BitstreamReader Reader(&Mem[0], &Mem[0] + Mem.size());
+  BitstreamCursor Cursor(Reader);
+  Cursor.Read(32);
+  ASSERT_EQ(unsigned(bitc::ENTER_SUBBLOCK), Cursor.ReadCode());
+  ASSERT_EQ(unsigned(bitc::MODULE_BLOCK_ID), Cursor.ReadSubBlockID());
+  ASSERT_FALSE(Cursor.EnterSubBlock(bitc::MODULE_BLOCK_ID));
+  uint64_t ModuleStartBit = Cursor.GetCurrentBitNo();
+  uint64_t IndexOffset = 0;
+  unsigned NumIndexBlocks = 0;
+  SmallVector<uint64_t, 64> Record;
+  for (unsigned Code = Cursor.ReadCode(); Code != bitc::END_BLOCK;
+       Code = Cursor.ReadCode()) {
+    if (Code == bitc::ENTER_SUBBLOCK) {
+      uint64_t BlockBit = Cursor.GetCurrentBitNo() - Cursor.GetAbbrevIDWidth();
+      unsigned BlockID = Cursor.ReadSubBlockID();
+      if (BlockID == bitc::BLOCKINFO_BLOCK_ID) {
+        ASSERT_FALSE(Cursor.ReadBlockInfoBlock());
+        continue;
+      }
+      if (BlockID == bitc::FUNCTION_INDEX_BLOCK_ID) {
+        EXPECT_EQ(ModuleStartBit + IndexOffset, BlockBit);
+        ++NumIndexBlocks;
+      }
+      ASSERT_FALSE(Cursor.SkipBlock());
+    } else if (Code == bitc::DEFINE_ABBREV) {
+      Cursor.ReadAbbrevRecord();
+    } else {
+      Record.clear();
+      if (Cursor.ReadRecord(Code, Record) == bitc::MODULE_CODE_FNINDEX_OFFSET)
+        IndexOffset = Record[0] | Record[1] << 32;
+    }
+  }
+  EXPECT_NE(0u, IndexOffset);
+  EXPECT_EQ(1u, NumIndexBlocks);
+
+  StringRef Data((const char*)&Mem[0], Mem.size());
+  MemoryBuffer *Buffer = MemoryBuffer::getMemBuffer(Data, "test", false);
+  std::string ErrMsg;
+  OwningPtr<Module> M(getLazyBitcodeModule(Buffer, Context, &ErrMsg));
+  ASSERT_TRUE(M != 0) << ErrMsg;
+  for (unsigned i = NumFunctions; i-- != 0; ) {
+    Function *F = M->getFunction("f" + utostr(i));
+    ASSERT_TRUE(F != 0);
+    ASSERT_TRUE(F->isMaterializable());
+    ASSERT_FALSE(F->Materialize(&ErrMsg)) << ErrMsg;
+    ASSERT_EQ(1u, F->size());
+    EXPECT_EQ(i + 2, F->front().size());
+    if (i) {
+      EXPECT_TRUE(M->getFunction("f0")->isMaterializable());
+    }
+  }
+  EXPECT_FALSE(verifyModule(*M, ReturnStatusAction));
+}
+
+// Encoding the function bodies on several threads gives the same bitcode as
+// writing them one after the other.
+TEST(BitReaderTest, ParallelWriterOutput) {
+  LLVMContext Context;
+  OwningPtr<Module> Mod(makeModuleWithBodies(Context, 300));
+
+  // Function-local metadata, metadata attachments and debug locations.
+  MDNode *Scope = MDNode::get(Context, MDString::get(Context, "scope"));
+  unsigned Line = 1;
+  for (Module::iterator F = Mod->begin(), E = Mod->end(); F != E; ++F) {
+    Value *Arg = F->arg_begin();
+    for (BasicBlock::iterator I = F->front().begin(), IE = F->front().end();
+         I != IE; ++I) {
+      I->setDebugLoc(DebugLoc::get(Line++, 1, Scope));
+      I->setMetadata("local", MDNode::get(Context, Arg));
+    }
+  }
+  // A block address, which refers to a basic block by its number.
+  BasicBlock *BB = BasicBlock::Create(Context, "bb", Mod->begin());
+  new UnreachableInst(Context, BB);
+  new GlobalVariable(*Mod, Type::getInt8PtrTy(Context), /*isConstant=*/true,
+                     GlobalValue::ExternalLinkage, BlockAddress::get(BB),
+                     "table");
+
+  std::vector<unsigned char> Serial, Parallel;
+  {
+    BitstreamWriter Stream(Serial);
+    WriteBitcodeToStream(Mod.get(), Stream);
+  }
+  {
+    ThreadPool Pool(4);
+    BitstreamWriter Stream(Parallel);
+    WriteBitcodeToStream(Mod.get(), Stream, &Pool);
+  }
+  ASSERT_EQ(Serial.size(), Parallel.size());
+  EXPECT_TRUE(Serial == Parallel);
+
+  StringRef Data((const char*)&Parallel[0], Parallel.size());
+  OwningPtr<MemoryBuffer> Buffer(MemoryBuffer::getMemBuffer(Data, "test",
+                                                            false));
+  LLVMContext ReadContext;
+  std::string ErrMsg;
+  OwningPtr<Module> M(ParseBitcodeFile(Buffer.get(), ReadContext, &ErrMsg));
+  ASSERT_TRUE(M != 0) << ErrMsg;
+  EXPECT_FALSE(verifyModule(*M, ReturnStatusAction));
+}
+
+/// makeLargeModule - Return a module of NumFunctions functions, each a chain
+/// of named arithmetic, like unoptimized front-end output.
+static Module *makeLargeModule(LLVMContext &Context, unsigned NumFunctions) {
+  Module *Mod = new Module("large", Context);
+  Type *Int32Ty = Type::getInt32Ty(Context);
+  std::vector<Type*> Params(2, Int32Ty);
+  FunctionType *FuncTy = FunctionType::get(Int32Ty, Params, false);
+  for (unsigned i = 0; i != NumFunctions; ++i) {
+    Function *Func = Function::Create(FuncTy, GlobalValue::ExternalLinkage,
+                                      "func", Mod);
+    BasicBlock *Entry = BasicBlock::Create(Context, "entry", Func);
+    Value *A = Func->arg_begin(), *B = ++Func->arg_begin();
+    for (unsigned j = 0; j != 200; ++j) {
+      Value *C = ConstantInt::get(Int32Ty, j * 7919);
+      Value *Sum = BinaryOperator::CreateAdd(A, B, "sum", Entry);
+      A = B;
+      B = BinaryOperator::CreateXor(Sum, C, "mix", Entry);
+    }
+    ReturnInst::Create(Context, B, Entry);
+  }
+  return Mod;
+}
+
+/// walkBlock - Decode every record in the block the cursor has entered, and
+/// in its sub-blocks, and return how many there were.
+static unsigned walkBlock(BitstreamCursor &Cursor) {
+  SmallVector<uint64_t, 64> Vals;
+  unsigned NumRecords = 0;
+  while (!Cursor.AtEndOfStream()) {
+    unsigned Code = Cursor.ReadCode();
+    if (Code == bitc::END_BLOCK) {
+      Cursor.ReadBlockEnd();
+      break;
+    }
+    if (Code == bitc::ENTER_SUBBLOCK) {
+      unsigned BlockID = Cursor.ReadSubBlockID();
+      if (BlockID == bitc::BLOCKINFO_BLOCK_ID) {
+        Cursor.ReadBlockInfoBlock();
+      } else {
+        Cursor.EnterSubBlock(BlockID);
+        NumRecords += walkBlock(Cursor);
+      }
+      continue;
+    }
+    if (Code == bitc::DEFINE_ABBREV) {
+      Cursor.ReadAbbrevRecord();
+      continue;
+    }
+    Vals.clear();
+    Cursor.ReadRecord(Code, Vals);
+    ++NumRecords;
+  }
+  return NumRecords;
+}
+
+static void printThroughput(const char *What, size_t Bytes, unsigned Runs,
+                            sys::TimeValue Elapsed) {
+  double MSecs = std::max<double>(Elapsed.msec(), 1);
+  outs() << What << ": " << Elapsed.msec() / Runs << "ms per read, "
+         << uint64_t(Bytes * Runs * 1000.0 / (MSecs * 1024 * 1024))
+         << " MB/s\n";
+}
+
+// Read throughput benchmark: the time to decode every record of a large
+// module with a bare cursor, and to parse it into IR.  The module is the
+// bitcode file LLVM_BITCODE_BENCH_FILE names, or a generated one.  Run with
+// --gtest_also_run_disabled_tests.
+TEST(BitReaderTest, DISABLED_ReadThroughput) {
+  const unsigned Runs = 10;
+  OwningPtr<MemoryBuffer> File;
+  if (const char *Path = getenv("LLVM_BITCODE_BENCH_FILE")) {
+    error_code ec = MemoryBuffer::getFile(Path, File);
+    ASSERT_FALSE(ec) << Path << ": " << ec.message();
+  } else {
+    LLVMContext Context;
+    OwningPtr<Module> Mod(makeLargeModule(Context, 1000));
+    std::string Bitcode;
+    raw_string_ostream OS(Bitcode);
+    WriteBitcodeToFile(Mod.get(), OS);
+    OS.flush();
+    File.reset(MemoryBuffer::getMemBufferCopy(Bitcode, "large.bc"));
+  }
+  const unsigned char *BufPtr =
+    (const unsigned char *)File->getBufferStart();
+  const unsigned char *BufEnd = BufPtr + File->getBufferSize();
+  unsigned char *Start = const_cast<unsigned char *>(BufPtr);
+  unsigned char *End = const_cast<unsigned char *>(BufEnd);
+  ASSERT_FALSE(isBitcodeWrapper(Start, End) &&
+               SkipBitcodeWrapperHeader(Start, End));
+  outs() << "bitcode: " << (End - Start) / 1024 << "KB\n";
+
+  unsigned NumRecords = 0;
+  sys::TimeValue Begin = sys::TimeValue::now();
+  for (unsigned i = 0; i != Runs; ++i) {
+    BitstreamReader Reader(Start, End);
+    BitstreamCursor Cursor(Reader);
+    Cursor.Read(32);
+    NumRecords = walkBlock(Cursor);
+  }
+  printThroughput("cursor", End - Start, Runs,
+                  sys::TimeValue::now() - Begin);
+  outs() << "records: " << NumRecords << "\n";
+
+  Begin = sys::TimeValue::now();
+  for (unsigned i = 0; i != Runs; ++i) {
+    LLVMContext Context;
+    std::string ErrMsg;
+    OwningPtr<Module> Mod(ParseBitcodeFile(File.get(), Context, &ErrMsg));
+    ASSERT_TRUE(Mod != 0) << ErrMsg;
+  }
+  printThroughput("ParseBitcodeFile", End - Start, Runs,
+                  sys::TimeValue::now() - Begin);
+}
+
 }
 }
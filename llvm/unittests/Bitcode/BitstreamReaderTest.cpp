@@ -0,0 +1,284 @@
+//===- llvm/unittest/Bitcode/BitstreamReaderTest.cpp - BitstreamReader ----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Bitcode/BitstreamReader.h"
+#include "llvm/Bitcode/BitstreamWriter.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "gtest/gtest.h"
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+/// Field - A value written to the stream, and how.
+struct Field {
+  enum Kind { Fixed, Fixed64, VBR, VBR64 } K;
+  unsigned Width;
+  uint64_t Value;
+  uint64_t BitNo;
+};
+
+/// Random - A small deterministic generator, so failures reproduce.
+struct Random {
+  uint64_t State;
+  explicit Random(uint64_t Seed) : State(Seed) {}
+  uint64_t next() {
+    State = State * 6364136223846793005ULL + 1442695040888963407ULL;
+    return State >> 11;
+  }
+  unsigned below(unsigned N) { return unsigned(next() % N); }
+};
+
+static uint64_t lowBits(uint64_t V, unsigned Width) {
+  return Width == 64 ? V : V & ((uint64_t(1) << Width) - 1);
+}
+
+/// writeFields - Write NumFields random fields of every kind and width, and
+/// return what was written.
+static void writeFields(unsigned NumFields, std::vector<unsigned char> &Buffer,
+                        std::vector<Field> &Fields) {
+  Random R(NumFields);
+  BitstreamWriter Stream(Buffer);
+  for (unsigned i = 0; i != NumFields; ++i) {
+    Field F;
+    F.K = Field::Kind(R.below(4));
+    F.BitNo = Stream.GetCurrentBitNo();
+    // Mostly small values, as in real bitcode, and the odd large one.
+    uint64_t V = R.next() >> R.below(64);
+    switch (F.K) {
+    case Field::Fixed:
+      F.Width = 1 + R.below(32);
+      F.Value = lowBits(V, F.Width);
+      Stream.Emit(uint32_t(F.Value), F.Width);
+      break;
+    case Field::Fixed64:
+      F.Width = 1 + R.below(64);
+      F.Value = lowBits(V, F.Width);
+      Stream.Emit64(F.Value, F.Width);
+      break;
+    case Field::VBR:
+      F.Width = 2 + R.below(31);
+      F.Value = uint32_t(V);
+      Stream.EmitVBR(uint32_t(F.Value), F.Width);
+      break;
+    case Field::VBR64:
+      F.Width = 2 + R.below(31);
+      F.Value = V;
+      Stream.EmitVBR64(F.Value, F.Width);
+      break;
+    }
+    Fields.push_back(F);
+  }
+  Stream.FlushToWord();
+}
+
+static uint64_t readField(BitstreamCursor &Cursor, const Field &F) {
+  switch (F.K) {
+  case Field::Fixed: return Cursor.Read(F.Width);
+  case Field::Fixed64: return Cursor.Read64(F.Width);
+  case Field::VBR: return Cursor.ReadVBR(F.Width);
+  case Field::VBR64: return Cursor.ReadVBR64(F.Width);
+  }
+  return 0;
+}
+
+// Fields of every width read back the same, in order and after jumping to
+// them, whether or not the stream is a whole number of 64-bit words long.
+TEST(BitstreamReaderTest, Fields) {
+  for (unsigned NumFields = 1; NumFields <= 300; NumFields += 23) {
+    std::vector<unsigned char> Buffer;
+    std::vector<Field> Fields;
+    writeFields(NumFields, Buffer, Fields);
+    BitstreamReader Reader(&Buffer[0], &Buffer[0] + Buffer.size());
+
+    BitstreamCursor Cursor(Reader);
+    for (unsigned i = 0; i != NumFields; ++i) {
+      ASSERT_EQ(Fields[i].BitNo, Cursor.GetCurrentBitNo());
+      ASSERT_EQ(Fields[i].Value, readField(Cursor, Fields[i]))
+        << "field " << i << " of " << NumFields;
+    }
+    EXPECT_EQ(Buffer.size() * 8 - Cursor.GetCurrentBitNo() < 32, true);
+
+    Random R(NumFields + 1);
+    for (unsigned j = 0; j != 100; ++j) {
+      unsigned i = R.below(NumFields);
+      Cursor.JumpToBit(Fields[i].BitNo);
+      ASSERT_EQ(Fields[i].BitNo, Cursor.GetCurrentBitNo());
+      ASSERT_EQ(Fields[i].Value, readField(Cursor, Fields[i]));
+    }
+
+    // Reading past the end gives zeros.
+    Cursor.JumpToBit(Buffer.size() * 8);
+    EXPECT_TRUE(Cursor.AtEndOfStream());
+    EXPECT_EQ(0u, Cursor.Read(32));
+  }
+}
+
+// Zero-width fields take no bits and read as zero, on their own and in
+// abbreviated records and arrays.
+TEST(BitstreamReaderTest, ZeroWidthFields) {
+  std::vector<unsigned char> Buffer;
+  {
+    BitstreamWriter Stream(Buffer);
+    Stream.Emit(5, 3);
+    Stream.EnterSubblock(8, 3);
+    BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+    Abbv->Add(BitCodeAbbrevOp(1));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 0));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 0));
+    unsigned AbbrevID = Stream.EmitAbbrev(Abbv);
+    SmallVector<uint64_t, 8> Vals(4, uint64_t(0));
+    Stream.EmitRecord(1, Vals, AbbrevID);
+    Stream.ExitBlock();
+    Stream.FlushToWord();
+  }
+
+  BitstreamReader Reader(&Buffer[0], &Buffer[0] + Buffer.size());
+  BitstreamCursor Cursor(Reader);
+  EXPECT_EQ(0u, Cursor.Read(0));
+  EXPECT_EQ(0u, Cursor.GetCurrentBitNo());
+  EXPECT_EQ(5u, Cursor.Read(3));
+  EXPECT_EQ(0u, Cursor.Read(0));
+  EXPECT_EQ(3u, Cursor.GetCurrentBitNo());
+
+  ASSERT_EQ(unsigned(bitc::ENTER_SUBBLOCK), Cursor.ReadCode());
+  ASSERT_EQ(8u, Cursor.ReadSubBlockID());
+  ASSERT_FALSE(Cursor.EnterSubBlock(8));
+  ASSERT_EQ(unsigned(bitc::DEFINE_ABBREV), Cursor.ReadCode());
+  Cursor.ReadAbbrevRecord();
+  SmallVector<uint64_t, 8> Vals;
+  ASSERT_EQ(1u, Cursor.ReadRecord(Cursor.ReadCode(), Vals));
+  ASSERT_EQ(4u, Vals.size());
+  for (unsigned i = 0; i != 4; ++i)
+    EXPECT_EQ(0u, Vals[i]);
+  EXPECT_EQ(unsigned(bitc::END_BLOCK), Cursor.ReadCode());
+}
+
+// Abbreviated arrays and blobs, and blocks that are skipped or read, at every
+// alignment the preceding fields can leave them at.
+TEST(BitstreamReaderTest, RecordsAndBlocks) {
+  for (unsigned Pad = 0; Pad < 64; Pad += 5) {
+    std::vector<unsigned char> Buffer;
+    {
+      BitstreamWriter Stream(Buffer);
+      Stream.Emit(0, 2);
+      if (Pad)
+        Stream.Emit64(0, Pad);
+
+      Stream.EnterSubblock(8, 3);
+      BitCodeAbbrev *FixedArray = new BitCodeAbbrev();
+      FixedArray->Add(BitCodeAbbrevOp(1));
+      FixedArray->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+      FixedArray->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 7));
+      unsigned FixedAbbrev = Stream.EmitAbbrev(FixedArray);
+      BitCodeAbbrev *VBRArray = new BitCodeAbbrev();
+      VBRArray->Add(BitCodeAbbrevOp(2));
+      VBRArray->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+      VBRArray->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6));
+      unsigned VBRAbbrev = Stream.EmitAbbrev(VBRArray);
+      BitCodeAbbrev *Char6Array = new BitCodeAbbrev();
+      Char6Array->Add(BitCodeAbbrevOp(3));
+      Char6Array->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+      Char6Array->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Char6));
+      unsigned Char6Abbrev = Stream.EmitAbbrev(Char6Array);
+      BitCodeAbbrev *Blob = new BitCodeAbbrev();
+      Blob->Add(BitCodeAbbrevOp(4));
+      Blob->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Blob));
+      unsigned BlobAbbrev = Stream.EmitAbbrev(Blob);
+
+      SmallVector<uint64_t, 64> Vals;
+      for (unsigned i = 0; i != 50; ++i)
+        Vals.push_back(i * 37 % 128);
+      Stream.EmitRecord(1, Vals, FixedAbbrev);
+      Vals.clear();
+      for (unsigned i = 0; i != 50; ++i)
+        Vals.push_back(uint64_t(1) << i);
+      Stream.EmitRecord(2, Vals, VBRAbbrev);
+      Vals.clear();
+      StringRef Name("abc_XYZ.019");
+      Vals.append(Name.begin(), Name.end());
+      Stream.EmitRecord(3, Vals, Char6Abbrev);
+      for (unsigned Len = 0; Len != 10; ++Len) {
+        Vals.clear();
+        Vals.push_back(4);
+        Stream.EmitRecordWithBlob(BlobAbbrev, Vals,
+                                  StringRef("blob data!", Len));
+      }
+      Stream.ExitBlock();
+
+      // A block to skip, then a record after it.
+      Stream.EnterSubblock(9, 5);
+      Vals.clear();
+      Vals.append(100, uint64_t(12345));
+      Stream.EmitRecord(5, Vals);
+      Stream.ExitBlock();
+      Vals.clear();
+      Vals.push_back(42);
+      Stream.EmitRecord(6, Vals);
+      Stream.FlushToWord();
+    }
+
+    BitstreamReader Reader(&Buffer[0], &Buffer[0] + Buffer.size());
+    BitstreamCursor Cursor(Reader);
+    Cursor.Read(2);
+    if (Pad)
+      Cursor.Read64(Pad);
+    ASSERT_EQ(unsigned(bitc::ENTER_SUBBLOCK), Cursor.ReadCode());
+    ASSERT_EQ(8u, Cursor.ReadSubBlockID());
+    ASSERT_FALSE(Cursor.EnterSubBlock(8));
+    for (unsigned i = 0; i != 4; ++i) {
+      ASSERT_EQ(unsigned(bitc::DEFINE_ABBREV), Cursor.ReadCode());
+      Cursor.ReadAbbrevRecord();
+    }
+
+    SmallVector<uint64_t, 64> Vals;
+    ASSERT_EQ(1u, Cursor.ReadRecord(Cursor.ReadCode(), Vals));
+    ASSERT_EQ(50u, Vals.size());
+    for (unsigned i = 0; i != 50; ++i)
+      EXPECT_EQ(i * 37 % 128, Vals[i]);
+    Vals.clear();
+    ASSERT_EQ(2u, Cursor.ReadRecord(Cursor.ReadCode(), Vals));
+    ASSERT_EQ(50u, Vals.size());
+    for (unsigned i = 0; i != 50; ++i)
+      EXPECT_EQ(uint64_t(1) << i, Vals[i]);
+    Vals.clear();
+    ASSERT_EQ(3u, Cursor.ReadRecord(Cursor.ReadCode(), Vals));
+    EXPECT_EQ("abc_XYZ.019", std::string(Vals.begin(), Vals.end()));
+    for (unsigned Len = 0; Len != 10; ++Len) {
+      // Odd lengths are copied into the record, even ones referenced.
+      Vals.clear();
+      if (Len % 2) {
+        ASSERT_EQ(4u, Cursor.ReadRecord(Cursor.ReadCode(), Vals));
+        EXPECT_EQ(std::string("blob data!", Len),
+                  std::string(Vals.begin(), Vals.end()));
+      } else {
+        const char *BlobStart;
+        unsigned BlobLen;
+        ASSERT_EQ(4u, Cursor.ReadRecord(Cursor.ReadCode(), Vals, BlobStart,
+                                        BlobLen));
+        EXPECT_EQ(StringRef("blob data!", Len), StringRef(BlobStart, BlobLen));
+      }
+    }
+    ASSERT_EQ(unsigned(bitc::END_BLOCK), Cursor.ReadCode());
+    ASSERT_FALSE(Cursor.ReadBlockEnd());
+
+    ASSERT_EQ(unsigned(bitc::ENTER_SUBBLOCK), Cursor.ReadCode());
+    ASSERT_EQ(9u, Cursor.ReadSubBlockID());
+    ASSERT_FALSE(Cursor.SkipBlock());
+    Vals.clear();
+    ASSERT_EQ(6u, Cursor.ReadRecord(Cursor.ReadCode(), Vals));
+    ASSERT_EQ(1u, Vals.size());
+    EXPECT_EQ(42u, Vals[0]);
+  }
+}
+
+}
@@ -0,0 +1,236 @@
+//===- InterpreterTest.cpp - Unit tests for the interpreter cores ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+#include "llvm/Intrinsics.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ExecutionEngine/GenericValue.h"
+#include "llvm/ExecutionEngine/Interpreter.h"
+#include "llvm/Support/IRBuilder.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+// fib - Iterates with two PHI nodes that read each other.
+Function *makeFib(Module *M) {
+  LLVMContext &Context = M->getContext();
+  Type *Int32Ty = Type::getInt32Ty(Context);
+  std::vector<Type*> Params(1, Int32Ty);
+  Function *F = Function::Create(FunctionType::get(Int32Ty, Params, false),
+                                 GlobalValue::ExternalLinkage, "fib", M);
+  BasicBlock *Entry = BasicBlock::Create(Context, "entry", F);
+  BasicBlock *Loop = BasicBlock::Create(Context, "loop", F);
+  BasicBlock *Exit = BasicBlock::Create(Context, "exit", F);
+
+  IRBuilder<> Builder(Entry);
+  Builder.CreateBr(Loop);
+
+  Builder.SetInsertPoint(Loop);
+  PHINode *I = Builder.CreatePHI(Int32Ty, 2, "i");
+  PHINode *A = Builder.CreatePHI(Int32Ty, 2, "a");
+  PHINode *B = Builder.CreatePHI(Int32Ty, 2, "b");
+  Value *Sum = Builder.CreateAdd(A, B, "sum");
+  Value *Next = Builder.CreateAdd(I, Builder.getInt32(1), "next");
+  I->addIncoming(Builder.getInt32(0), Entry);
+  I->addIncoming(Next, Loop);
+  A->addIncoming(Builder.getInt32(0), Entry);
+  A->addIncoming(B, Loop);
+  B->addIncoming(Builder.getInt32(1), Entry);
+  B->addIncoming(Sum, Loop);
+  Builder.CreateCondBr(Builder.CreateICmpULT(Next, F->arg_begin()), Loop,
+                       Exit);
+
+  Builder.SetInsertPoint(Exit);
+  Builder.CreateRet(B);
+  return F;
+}
+
+// fact - Recurses, so that frames are stacked.
+Function *makeFact(Module *M) {
+  LLVMContext &Context = M->getContext();
+  Type *Int64Ty = Type::getInt64Ty(Context);
+  std::vector<Type*> Params(1, Int64Ty);
+  Function *F = Function::Create(FunctionType::get(Int64Ty, Params, false),
+                                 GlobalValue::ExternalLinkage, "fact", M);
+  BasicBlock *Entry = BasicBlock::Create(Context, "entry", F);
+  BasicBlock *Recurse = BasicBlock::Create(Context, "recurse", F);
+  BasicBlock *Done = BasicBlock::Create(Context, "done", F);
+  Value *N = F->arg_begin();
+
+  IRBuilder<> Builder(Entry);
+  Builder.CreateCondBr(Builder.CreateICmpULE(N, Builder.getInt64(1)), Done,
+                       Recurse);
+
+  Builder.SetInsertPoint(Recurse);
+  Value *Sub = Builder.CreateCall(F, Builder.CreateSub(N, Builder.getInt64(1)));
+  Builder.CreateRet(Builder.CreateMul(N, Sub));
+
+  Builder.SetInsertPoint(Done);
+  Builder.CreateRet(Builder.getInt64(1));
+  return F;
+}
+
+// bits - Calls the bit manipulation intrinsics, which the visitor lowers in
+// the IR.
+Function *makeBits(Module *M) {
+  LLVMContext &Context = M->getContext();
+  Type *Int32Ty = Type::getInt32Ty(Context);
+  std::vector<Type*> Params(1, Int32Ty);
+  Function *F = Function::Create(FunctionType::get(Int32Ty, Params, false),
+                                 GlobalValue::ExternalLinkage, "bits", M);
+  Value *X = F->arg_begin();
+
+  IRBuilder<> Builder(BasicBlock::Create(Context, "entry", F));
+  Type *Tys[] = { Int32Ty };
+  Intrinsic::ID IDs[] = {
+    Intrinsic::ctpop, Intrinsic::ctlz, Intrinsic::cttz, Intrinsic::bswap
+  };
+  Value *Result = X;
+  for (unsigned i = 0; i != array_lengthof(IDs); ++i) {
+    Value *Callee = Intrinsic::getDeclaration(M, IDs[i], Tys);
+    Result = Builder.CreateXor(Result, Builder.CreateCall(Callee, X));
+  }
+  Builder.CreateRet(Result);
+  return F;
+}
+
+// mem - Calls the memory intrinsics.
+Function *makeMem(Module *M) {
+  LLVMContext &Context = M->getContext();
+  Type *Int32Ty = Type::getInt32Ty(Context);
+  std::vector<Type*> Params(1, Int32Ty);
+  Function *F = Function::Create(FunctionType::get(Int32Ty, Params, false),
+                                 GlobalValue::ExternalLinkage, "mem", M);
+  Value *X = F->arg_begin();
+
+  IRBuilder<> Builder(BasicBlock::Create(Context, "entry", F));
+  Value *Src = Builder.CreateAlloca(Int32Ty, 0, "src");
+  Value *Dest = Builder.CreateAlloca(Int32Ty, 0, "dest");
+  Value *Src8 = Builder.CreateBitCast(Src, Builder.getInt8PtrTy());
+  Value *Dest8 = Builder.CreateBitCast(Dest, Builder.getInt8PtrTy());
+  Builder.CreateMemSet(Src8, Builder.CreateTrunc(X, Builder.getInt8Ty()), 4,
+                       4);
+  Builder.CreateMemCpy(Dest8, Src8, 4, 4);
+  Builder.CreateRet(Builder.CreateLoad(Dest));
+  return F;
+}
+
+// root - Calls the floating point intrinsics.
+Function *makeRoot(Module *M) {
+  LLVMContext &Context = M->getContext();
+  Type *DoubleTy = Type::getDoubleTy(Context);
+  std::vector<Type*> Params(1, DoubleTy);
+  Function *F = Function::Create(FunctionType::get(DoubleTy, Params, false),
+                                 GlobalValue::ExternalLinkage, "root", M);
+
+  IRBuilder<> Builder(BasicBlock::Create(Context, "entry", F));
+  Type *Tys[] = { DoubleTy };
+  Value *Pow = Builder.CreateCall2(
+    Intrinsic::getDeclaration(M, Intrinsic::pow, Tys), F->arg_begin(),
+    ConstantFP::get(DoubleTy, 3.0));
+  Builder.CreateRet(Builder.CreateCall(
+    Intrinsic::getDeclaration(M, Intrinsic::sqrt, Tys), Pow));
+  return F;
+}
+
+Module *makeModule(LLVMContext &Context) {
+  Module *M = new Module("interpreter-test", Context);
+  makeFib(M);
+  makeFact(M);
+  makeBits(M);
+  makeMem(M);
+  makeRoot(M);
+  return M;
+}
+
+GenericValue intArg(unsigned Bits, uint64_t Val) {
+  GenericValue GV;
+  GV.IntVal = APInt(Bits, Val);
+  return GV;
+}
+
+GenericValue doubleArg(double Val) {
+  GenericValue GV;
+  GV.DoubleVal = Val;
+  return GV;
+}
+
+ExecutionEngine *createInterpreter(Module *M, bool UseBytecode) {
+  std::string Error;
+  ExecutionEngine *EE = EngineBuilder(M)
+                        .setEngineKind(EngineKind::Interpreter)
+                        .setInterpreterBytecode(UseBytecode)
+                        .setErrorStr(&Error)
+                        .create();
+  EXPECT_TRUE(EE != 0) << Error;
+  return EE;
+}
+
+// runFunctions - Return what the functions of makeModule that only use
+// intrinsics the visitor lowers in the IR return for a few arguments.
+std::vector<uint64_t> runFunctions(ExecutionEngine *EE, Module *M) {
+  std::vector<uint64_t> Results;
+  for (unsigned i = 0; i != 5; ++i) {
+    std::vector<GenericValue> Args(1, intArg(32, i * 7 + 1));
+    Results.push_back(EE->runFunction(M->getFunction("fib"), Args)
+                      .IntVal.getZExtValue());
+    Results.push_back(EE->runFunction(M->getFunction("bits"), Args)
+                      .IntVal.getZExtValue());
+    Args[0] = intArg(64, i * 4 + 2);
+    Results.push_back(EE->runFunction(M->getFunction("fact"), Args)
+                      .IntVal.getZExtValue());
+  }
+  return Results;
+}
+
+// Run the same functions through the visitor and through the bytecode, and
+// check that they agree and that the bytecode left the IR alone.  The visitor
+// lowers the memory and math intrinsics to library calls, which it can only
+// make with libffi, so those are only run as bytecode.
+TEST(InterpreterTest, BytecodeMatchesVisitor) {
+  LLVMContext Context;
+  Module *VisitorM = makeModule(Context);
+  OwningPtr<ExecutionEngine> Visitor(createInterpreter(VisitorM, false));
+  ASSERT_TRUE(Visitor.get() != 0);
+  std::vector<uint64_t> Expected = runFunctions(Visitor.get(), VisitorM);
+  ASSERT_EQ(15U, Expected.size());
+  EXPECT_EQ(1U, Expected[0]);               // fib(1)
+  EXPECT_EQ(3628800U, Expected[2 * 3 + 2]); // fact(10)
+
+  Module *BytecodeM = makeModule(Context);
+  OwningPtr<ExecutionEngine> Bytecode(createInterpreter(BytecodeM, true));
+  ASSERT_TRUE(Bytecode.get() != 0);
+  EXPECT_EQ(Expected, runFunctions(Bytecode.get(), BytecodeM));
+
+  std::vector<GenericValue> MemArgs(1, intArg(32, 0x12345678));
+  EXPECT_EQ(0x78787878U,
+            Bytecode->runFunction(BytecodeM->getFunction("mem"), MemArgs)
+            .IntVal.getZExtValue());
+  std::vector<GenericValue> RootArgs(1, doubleArg(4.0));
+  EXPECT_EQ(8.0,
+            Bytecode->runFunction(BytecodeM->getFunction("root"), RootArgs)
+            .DoubleVal);
+
+  unsigned NumIntrinsics = 0;
+  for (Module::iterator F = BytecodeM->begin(), E = BytecodeM->end(); F != E;
+       ++F)
+    if (F->isIntrinsic())
+      NumIntrinsics += F->getNumUses();
+  EXPECT_EQ(8U, NumIntrinsics);
+}
+
+}
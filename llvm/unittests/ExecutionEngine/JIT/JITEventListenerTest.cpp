@@ -15,11 +15,21 @@
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/CodeGen/MachineCodeInfo.h"
 #include "llvm/ExecutionEngine/JIT.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/TypeBuilder.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
 #include "gtest/gtest.h"
+#include <cstring>
 #include <vector>
 
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
 using namespace llvm;
 
 int dummy;
@@ -226,6 +236,65 @@ TEST_F(JITEventListenerTest, MatchesMachineCodeInfo) {
   EXPECT_EQ(F_addr, Listener.FreedEvents[0].Code);
 }
 
+#if defined(__linux__)
+static std::string readFile(const std::string &Path) {
+  OwningPtr<MemoryBuffer> Buffer;
+  if (MemoryBuffer::getFile(Path, Buffer))
+    return std::string();
+  return Buffer->getBuffer();
+}
+
+TEST_F(JITEventListenerTest, PerfMapAndJITDump) {
+  std::string ErrMsg;
+  sys::Path Dir = sys::Path::GetTemporaryDirectory(&ErrMsg);
+  ASSERT_FALSE(Dir.isEmpty()) << ErrMsg;
+
+  OwningPtr<JITEventListener> Listener(createPerfJITEventListener(Dir.str()));
+  ASSERT_TRUE(Listener.get() != NULL);
+  EE->RegisterJITEventListener(Listener.get());
+  Function *F = buildFunction(M);
+  MachineCodeInfo MCI;
+  EE->runJITOnFunction(F, &MCI);
+  EE->UnregisterJITEventListener(Listener.get());
+  Listener.reset();
+
+  std::string Expected;
+  raw_string_ostream(Expected) << format("%lx %lx id\n",
+                                         (unsigned long)MCI.address(),
+                                         (unsigned long)MCI.size());
+  std::string MapName;
+  raw_string_ostream(MapName) << "/tmp/perf-" << getpid() << ".map";
+  EXPECT_EQ(Expected, readFile(MapName));
+  sys::Path(MapName).eraseFromDisk();
+
+  // The dump holds the header, the function's load record, with its name
+  // and code, and the close record.
+  std::string DumpName;
+  raw_string_ostream(DumpName) << Dir.str() << "/jit-" << getpid() << ".dump";
+  std::string Dump = readFile(DumpName);
+  const size_t LoadSize = 16 + 40 + 3 + MCI.size();
+  ASSERT_EQ(40 + LoadSize + 16, Dump.size());
+  uint32_t Magic, LoadId, LoadTotalSize;
+  uint64_t CodeAddr, CodeSize;
+  memcpy(&Magic, &Dump[0], 4);
+  memcpy(&LoadId, &Dump[40], 4);
+  memcpy(&LoadTotalSize, &Dump[44], 4);
+  memcpy(&CodeAddr, &Dump[40 + 24], 8);
+  memcpy(&CodeSize, &Dump[40 + 40], 8);
+  EXPECT_EQ(0x4A695444U, Magic);
+  EXPECT_EQ(0U, LoadId);
+  EXPECT_EQ(LoadSize, LoadTotalSize);
+  EXPECT_EQ((uintptr_t)MCI.address(), CodeAddr);
+  EXPECT_EQ(MCI.size(), CodeSize);
+  EXPECT_EQ(std::string("id", 3), Dump.substr(40 + 56, 3));
+  EXPECT_EQ(std::string((const char*)MCI.address(), MCI.size()),
+            Dump.substr(40 + 59, MCI.size()));
+
+  EE->freeMachineCodeForFunction(F);
+  Dir.eraseFromDisk(true);
+}
+#endif
+
 class JITEnvironment : public testing::Environment {
   virtual void SetUp() {
     // Required to create a JIT.
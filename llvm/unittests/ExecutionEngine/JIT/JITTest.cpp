@@ -13,6 +13,7 @@
 #include "llvm/Assembly/Parser.h"
 #include "llvm/BasicBlock.h"
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Config/config.h"
 #include "llvm/Constant.h"
 #include "llvm/Constants.h"
 #include "llvm/DerivedTypes.h"
@@ -28,6 +29,7 @@
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TypeBuilder.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Type.h"
 
 #include <vector>
@@ -656,6 +658,48 @@ TEST_F(JITTest, EscapedLazyStubStillCallable) {
   EXPECT_EQ(42, stubbed());
 }
 
+#if LLVM_ENABLE_THREADS != 0 && defined(HAVE_PTHREAD_H)
+// With background compilation the callees of a function are compiled before
+// anything calls them, and calls through their stubs end up in that code.
+TEST_F(JITTest, BackgroundCompilation) {
+  ThreadPool Pool(2);
+  TheJIT->DisableLazyCompilation(false);
+  TheJIT->EnableBackgroundCompilation(true, &Pool);
+  LoadAssembly("define internal i32 @triple(i32 %x) { "
+               "  %r = mul i32 %x, 3 "
+               "  ret i32 %r "
+               "} "
+               " "
+               "define internal i32 @inc(i32 %x) { "
+               "  %r = add i32 %x, 1 "
+               "  ret i32 %r "
+               "} "
+               " "
+               "define i32 @compute(i32 %x) { "
+               "  %t = call i32 @triple(i32 %x) "
+               "  %r = call i32 @inc(i32 %t) "
+               "  ret i32 %r "
+               "} ");
+  typedef int32_t(*ComputeTy)(int32_t);
+  ComputeTy compute = reinterpret_cast<ComputeTy>(
+    (intptr_t)TheJIT->getPointerToFunction(M->getFunction("compute")));
+
+  // Nothing has called triple or inc yet, so only the background compiler
+  // can have compiled them.
+  TheJIT->waitForBackgroundCompilation();
+  EXPECT_TRUE(TheJIT->isCompilingInBackground());
+  EXPECT_TRUE(TheJIT->getPointerToGlobalIfAvailable(M->getFunction("triple"))
+              != NULL);
+  EXPECT_TRUE(TheJIT->getPointerToGlobalIfAvailable(M->getFunction("inc"))
+              != NULL);
+  for (int32_t i = 0; i != 100; ++i)
+    EXPECT_EQ(3 * i + 1, compute(i));
+
+  // The pool has to outlive the JIT.
+  TheJIT.reset();
+}
+#endif
+
 // Converts the LLVM assembly to bitcode and returns it in a std::string.  An
 // empty string indicates an error.
 std::string AssembleToBitcode(LLVMContext &Context, const char *Assembly) {
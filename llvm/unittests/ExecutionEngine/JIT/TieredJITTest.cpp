@@ -0,0 +1,131 @@
+//===- TieredJITTest.cpp - Unit tests for tiered execution ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Assembly/Parser.h"
+#include "llvm/ExecutionEngine/GenericValue.h"
+#include "llvm/ExecutionEngine/Interpreter.h"
+#include "llvm/ExecutionEngine/JIT.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+// ARM tests disabled pending fix for PR10783.
+#if !defined(__arm__)
+
+class TieredJITTest : public testing::Test {
+protected:
+  LLVMContext Context;
+  Module *M;  // Owned by TheEE.
+  OwningPtr<ExecutionEngine> TheEE;
+
+  /// createEngine - Parse Assembly into M and create a tiered engine for it,
+  /// which moves functions up after Tier1 and Tier2 calls.
+  void createEngine(const char *Assembly, unsigned Tier1, unsigned Tier2) {
+    M = new Module("<main>", Context);
+    SMDiagnostic Error;
+    bool Success = ParseAssemblyString(Assembly, M, Error, Context) != NULL;
+    std::string ErrMsg;
+    raw_string_ostream OS(ErrMsg);
+    Error.print("", OS);
+    ASSERT_TRUE(Success) << OS.str();
+
+    std::string ErrorStr;
+    TheEE.reset(EngineBuilder(M).setErrorStr(&ErrorStr)
+                                .setTieredCompilation(Tier1, Tier2)
+                                .create());
+    ASSERT_TRUE(TheEE.get() != NULL) << ErrorStr;
+  }
+
+  int64_t callWithInt(Function *F, int64_t Arg) {
+    std::vector<GenericValue> Args(1);
+    Args[0].IntVal = APInt(32, Arg);
+    return TheEE->runFunction(F, Args).IntVal.getSExtValue();
+  }
+};
+
+TEST_F(TieredJITTest, GlobalsAreSharedAcrossTiers) {
+  createEngine("@counter = global i32 0 "
+               "define i32 @bump(i32 %n) { "
+               "entry: "
+               "  %old = load i32* @counter "
+               "  %new = add i32 %old, %n "
+               "  store i32 %new, i32* @counter "
+               "  ret i32 %new "
+               "} ", 3, 6);
+  Function *Bump = M->getFunction("bump");
+
+  // The first calls are interpreted, the next ones run the -O1 code and the
+  // last ones the -O3 code, all updating the same counter.
+  for (int i = 1; i <= 10; ++i)
+    EXPECT_EQ(i * 2, callWithInt(Bump, 2));
+  int32_t *Counter =
+    (int32_t*)TheEE->getPointerToGlobal(M->getGlobalVariable("counter"));
+  EXPECT_EQ(20, *Counter);
+
+  // The thunks that call the native code were not added to the module.
+  EXPECT_EQ(1U, M->size());
+}
+
+TEST_F(TieredJITTest, LoopsCountTowardsTheThreshold) {
+  createEngine("define i32 @sum(i32 %n) { "
+               "entry: "
+               "  br label %loop "
+               "loop: "
+               "  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ] "
+               "  %acc = phi i32 [ 0, %entry ], [ %acc.next, %loop ] "
+               "  %acc.next = add i32 %acc, %i "
+               "  %i.next = add i32 %i, 1 "
+               "  %done = icmp eq i32 %i.next, %n "
+               "  br i1 %done, label %exit, label %loop "
+               "exit: "
+               "  ret i32 %acc.next "
+               "} ", 50, 0);
+  Function *Sum = M->getFunction("sum");
+
+  // The first call loops often enough to make the second one native.
+  EXPECT_EQ(4950, callWithInt(Sum, 100));
+  EXPECT_EQ(4950, callWithInt(Sum, 100));
+  EXPECT_EQ(45, callWithInt(Sum, 10));
+}
+
+TEST_F(TieredJITTest, IndirectCallsStayInterpreted) {
+  createEngine("define i32 @twice(i32 %x) { "
+               "entry: "
+               "  %r = mul i32 %x, 2 "
+               "  ret i32 %r "
+               "} "
+               "define i32 @apply(i32 (i32)* %f, i32 %x) { "
+               "entry: "
+               "  %r = call i32 %f(i32 %x) "
+               "  ret i32 %r "
+               "} "
+               "define i32 @caller(i32 %x) { "
+               "entry: "
+               "  %r = call i32 @apply(i32 (i32)* @twice, i32 %x) "
+               "  ret i32 %r "
+               "} ", 2, 4);
+  Function *Caller = M->getFunction("caller");
+
+  // The interpreter's function pointers are not callable from native code,
+  // so apply and its callers must keep being interpreted.
+  for (int i = 0; i != 10; ++i)
+    EXPECT_EQ(i * 2, callWithInt(Caller, i));
+}
+
+#endif // !defined(__arm__)
+
+}
@@ -0,0 +1,263 @@
+//===- MCJITTest.cpp - Unit tests for the MC-based JIT --------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Assembly/Parser.h"
+#include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/ExecutionEngine/RuntimeDyld.h"
+#include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+namespace {
+
+// The runtime dynamic linker only handles ELF objects for x86-64 so far.
+#if defined(__x86_64__) && defined(__ELF__)
+
+class MCJITTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    InitializeNativeTarget();
+    InitializeNativeTargetAsmPrinter();
+  }
+
+  // Parse Assembly into a new module and compile it all with the MCJIT.
+  void createJIT(const char *Assembly) {
+    Module *M = new Module("<main>", Context);
+    SMDiagnostic Err;
+    if (!ParseAssemblyString(Assembly, M, Err, Context)) {
+      std::string ErrMsg;
+      raw_string_ostream OS(ErrMsg);
+      Err.print("", OS);
+      delete M;
+      FAIL() << OS.str();
+    }
+    this->M = M;
+
+    std::string Error;
+    TheJIT.reset(EngineBuilder(M).setEngineKind(EngineKind::JIT)
+                 .setUseMCJIT(true)
+                 .setErrorStr(&Error).create());
+    ASSERT_TRUE(TheJIT.get() != NULL) << Error;
+  }
+
+  void *getPointerToFunction(StringRef Name) {
+    Function *F = M->getFunction(Name);
+    EXPECT_TRUE(F != NULL) << Name.str();
+    return F ? TheJIT->getPointerToFunction(F) : 0;
+  }
+
+  LLVMContext Context;
+  Module *M;  // Owned by ExecutionEngine.
+  OwningPtr<ExecutionEngine> TheJIT;
+};
+
+TEST_F(MCJITTest, ReturnConstant) {
+  createJIT("define i32 @answer() { "
+            "entry: "
+            "  ret i32 42 "
+            "} ");
+  int (*Answer)() = (int(*)())(intptr_t)getPointerToFunction("answer");
+  ASSERT_TRUE(Answer != NULL);
+  EXPECT_EQ(42, Answer());
+}
+
+TEST_F(MCJITTest, CallsWithinModule) {
+  createJIT("define internal i32 @add1(i32 %x) { "
+            "entry: "
+            "  %r = add i32 %x, 1 "
+            "  ret i32 %r "
+            "} "
+            "define i32 @foo(i32 %x) { "
+            "entry: "
+            "  %a = call i32 @add1(i32 %x) "
+            "  %b = call i32 @add1(i32 %a) "
+            "  ret i32 %b "
+            "} ");
+  int (*Foo)(int) = (int(*)(int))(intptr_t)getPointerToFunction("foo");
+  ASSERT_TRUE(Foo != NULL);
+  EXPECT_EQ(12, Foo(10));
+}
+
+// Globals end up in data sections (initialized, zero initialized, read only
+// and common), which the code refers to through relocations.
+TEST_F(MCJITTest, GlobalVariables) {
+  createJIT("@counter = global i32 5 "
+            "@zeroed = global i32 0 "
+            "@shared = common global i32 0, align 4 "
+            "@table = internal constant [4 x i32] [i32 2, i32 3, i32 5, "
+            "                                      i32 7] "
+            "define i32 @bump() { "
+            "entry: "
+            "  %c = load i32* @counter "
+            "  %z = load i32* @zeroed "
+            "  %s = load i32* @shared "
+            "  %c1 = add i32 %c, 1 "
+            "  %z1 = add i32 %z, 1 "
+            "  store i32 %c1, i32* @counter "
+            "  store i32 %z1, i32* @zeroed "
+            "  store i32 %z1, i32* @shared "
+            "  %r = add i32 %c1, %s "
+            "  ret i32 %r "
+            "} "
+            "define i32 @lookup(i32 %i) { "
+            "entry: "
+            "  %p = getelementptr [4 x i32]* @table, i32 0, i32 %i "
+            "  %v = load i32* %p "
+            "  ret i32 %v "
+            "} ");
+  int (*Bump)() = (int(*)())(intptr_t)getPointerToFunction("bump");
+  ASSERT_TRUE(Bump != NULL);
+  EXPECT_EQ(6, Bump());
+  EXPECT_EQ(8, Bump());
+  EXPECT_EQ(10, Bump());
+
+  int (*Lookup)(int) = (int(*)(int))(intptr_t)getPointerToFunction("lookup");
+  ASSERT_TRUE(Lookup != NULL);
+  EXPECT_EQ(2, Lookup(0));
+  EXPECT_EQ(7, Lookup(3));
+}
+
+static int square(int X) {
+  return X * X;
+}
+
+// Calls out of the module go through stubs that hold the full address of
+// the callee, which may be anywhere in the address space.
+TEST_F(MCJITTest, ExternalFunctions) {
+  sys::DynamicLibrary::AddSymbol("mcjit_test_square",
+                                 (void*)(intptr_t)square);
+  createJIT("@str = private constant [6 x i8] c\"hello\\00\" "
+            "declare i32 @mcjit_test_square(i32) "
+            "declare i64 @strlen(i8*) "
+            "define i32 @square_plus_len(i32 %x) { "
+            "entry: "
+            "  %s = call i32 @mcjit_test_square(i32 %x) "
+            "  %p = getelementptr [6 x i8]* @str, i32 0, i32 0 "
+            "  %l = call i64 @strlen(i8* %p) "
+            "  %l32 = trunc i64 %l to i32 "
+            "  %r = add i32 %s, %l32 "
+            "  ret i32 %r "
+            "} ");
+  int (*F)(int) = (int(*)(int))(intptr_t)getPointerToFunction(
+                                                            "square_plus_len");
+  ASSERT_TRUE(F != NULL);
+  EXPECT_EQ(54, F(7));
+}
+
+/// CountingObjectCache - Keeps objects in memory and counts lookups.
+class CountingObjectCache : public ObjectCache {
+  StringMap<std::string> Objects;
+public:
+  unsigned Hits, Misses;
+
+  CountingObjectCache() : Hits(0), Misses(0) {}
+
+  virtual MemoryBuffer *getObject(StringRef Key) {
+    StringMap<std::string>::iterator I = Objects.find(Key);
+    if (I == Objects.end()) {
+      ++Misses;
+      return 0;
+    }
+    ++Hits;
+    return MemoryBuffer::getMemBufferCopy(I->getValue());
+  }
+
+  virtual void notifyObjectCompiled(StringRef Key, const MemoryBuffer *Obj) {
+    Objects[Key] = Obj->getBuffer();
+  }
+};
+
+TEST_F(MCJITTest, ObjectCache) {
+  const char *Assembly = "@counter = global i32 5 "
+                         "define i32 @bump() { "
+                         "entry: "
+                         "  %c = load i32* @counter "
+                         "  %c1 = add i32 %c, 1 "
+                         "  store i32 %c1, i32* @counter "
+                         "  ret i32 %c1 "
+                         "} ";
+  CountingObjectCache Cache;
+
+  createJIT(Assembly);
+  TheJIT->setObjectCache(&Cache);
+  int (*Bump)() = (int(*)())(intptr_t)getPointerToFunction("bump");
+  ASSERT_TRUE(Bump != NULL);
+  EXPECT_EQ(6, Bump());
+  EXPECT_EQ(0U, Cache.Hits);
+  EXPECT_EQ(1U, Cache.Misses);
+
+  // The same module loads the object generated before, and gets its own copy
+  // of the global.
+  createJIT(Assembly);
+  TheJIT->setObjectCache(&Cache);
+  Bump = (int(*)())(intptr_t)getPointerToFunction("bump");
+  ASSERT_TRUE(Bump != NULL);
+  EXPECT_EQ(6, Bump());
+  EXPECT_EQ(7, Bump());
+  EXPECT_EQ(1U, Cache.Hits);
+  EXPECT_EQ(1U, Cache.Misses);
+
+  // A different module misses the cache.
+  createJIT("define i32 @answer() { "
+            "entry: "
+            "  ret i32 42 "
+            "} ");
+  TheJIT->setObjectCache(&Cache);
+  int (*Answer)() = (int(*)())(intptr_t)getPointerToFunction("answer");
+  ASSERT_TRUE(Answer != NULL);
+  EXPECT_EQ(42, Answer());
+  EXPECT_EQ(1U, Cache.Hits);
+  EXPECT_EQ(2U, Cache.Misses);
+}
+
+#endif
+
+// FunctionBodyMemoryManager - A memory manager that only knows about function
+// bodies, as those written before sections were loaded do.
+class FunctionBodyMemoryManager : public RTDyldMemoryManager {
+public:
+  char Buffer[256];
+  std::vector<std::string> Names;
+
+  uint8_t *startFunctionBody(const char *Name, uintptr_t &Size) {
+    Names.push_back(Name);
+    Size = sizeof(Buffer) - 1;
+    return (uint8_t*)Buffer + 1;
+  }
+  void endFunctionBody(const char *Name, uint8_t *FunctionStart,
+                       uint8_t *FunctionEnd) {}
+};
+
+TEST(RTDyldMemoryManagerTest, SectionsAsFunctionBodies) {
+  FunctionBodyMemoryManager MM;
+  uint8_t *Code = MM.allocateCodeSection(100, 16, 0);
+  ASSERT_TRUE(Code != NULL);
+  EXPECT_EQ(0U, (uintptr_t)Code % 16);
+  EXPECT_TRUE(Code >= (uint8_t*)MM.Buffer + 1);
+  EXPECT_TRUE(MM.allocateDataSection(8, 8, 1) != NULL);
+  ASSERT_EQ(2U, MM.Names.size());
+  EXPECT_EQ("section.0", MM.Names[0]);
+  EXPECT_EQ("section.1", MM.Names[1]);
+
+  // Not enough memory was handed out to align the section.
+  EXPECT_TRUE(MM.allocateCodeSection(250, 16, 2) == NULL);
+}
+
+} // anonymous namespace
@@ -0,0 +1,117 @@
+//===- ObjectCacheTest.cpp - Unit tests for the on-disk object cache ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/PathV2.h"
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+
+using namespace llvm;
+
+namespace {
+
+class DiskObjectCacheTest : public testing::Test {
+protected:
+  /// Unique temporary directory holding the cache, removed after each test.
+  SmallString<128> TestDirectory;
+
+  virtual void SetUp() {
+    int FD;
+    ASSERT_FALSE(sys::fs::unique_file("object-cache-test-%%-%%-%%-%%/anchor",
+                                      FD, TestDirectory));
+    ::close(FD);
+    TestDirectory = sys::path::parent_path(TestDirectory);
+  }
+
+  virtual void TearDown() {
+    uint32_t Removed;
+    sys::fs::remove_all(TestDirectory.str(), Removed);
+  }
+
+  std::string getCacheDir() const {
+    return (TestDirectory + "/cache").str();
+  }
+
+  bool isCached(StringRef Key) {
+    bool Result;
+    return !sys::fs::exists(getCacheDir() + "/" + Key + ".o", Result) &&
+           Result;
+  }
+
+  /// setLastUsed - Pretend the object for Key was last used Seconds seconds
+  /// after the epoch.
+  void setLastUsed(StringRef Key, uint64_t Seconds) {
+    sys::PathWithStatus P(getCacheDir() + "/" + Key.str() + ".o");
+    const sys::FileStatus *Status = P.getFileStatus();
+    ASSERT_TRUE(Status != NULL);
+    sys::FileStatus NewStatus = *Status;
+    NewStatus.modTime.fromEpochTime(Seconds);
+    ASSERT_FALSE(P.setStatusInfoOnDisk(NewStatus));
+  }
+
+  void addObject(DiskObjectCache &Cache, StringRef Key, StringRef Contents) {
+    OwningPtr<MemoryBuffer> Obj(MemoryBuffer::getMemBufferCopy(Contents));
+    Cache.notifyObjectCompiled(Key, Obj.get());
+  }
+};
+
+TEST_F(DiskObjectCacheTest, RoundTrip) {
+  DiskObjectCache Cache(getCacheDir());
+  EXPECT_TRUE(Cache.getObject("missing") == NULL);
+
+  addObject(Cache, "key", "object contents");
+  OwningPtr<MemoryBuffer> Obj(Cache.getObject("key"));
+  ASSERT_TRUE(Obj.get() != NULL);
+  EXPECT_EQ("object contents", Obj->getBuffer());
+
+  // Another cache on the same directory sees the object too.
+  DiskObjectCache Other(getCacheDir());
+  Obj.reset(Other.getObject("key"));
+  ASSERT_TRUE(Obj.get() != NULL);
+  EXPECT_EQ("object contents", Obj->getBuffer());
+}
+
+TEST_F(DiskObjectCacheTest, EvictLeastRecentlyUsed) {
+  DiskObjectCache Cache(getCacheDir(), 0, 3);
+  addObject(Cache, "a", "aaaa");
+  addObject(Cache, "b", "bbbb");
+  addObject(Cache, "c", "cccc");
+  setLastUsed("a", 1000);
+  setLastUsed("b", 2000);
+  setLastUsed("c", 3000);
+
+  // Using "a" makes "b" the least recently used object.
+  delete Cache.getObject("a");
+  addObject(Cache, "d", "dddd");
+  EXPECT_TRUE(isCached("a"));
+  EXPECT_FALSE(isCached("b"));
+  EXPECT_TRUE(isCached("c"));
+  EXPECT_TRUE(isCached("d"));
+}
+
+TEST_F(DiskObjectCacheTest, SizeLimit) {
+  DiskObjectCache Cache(getCacheDir(), 10);
+  addObject(Cache, "a", "aaaa");
+  addObject(Cache, "b", "bbbb");
+  setLastUsed("a", 1000);
+  setLastUsed("b", 2000);
+
+  addObject(Cache, "c", "cccc");
+  EXPECT_FALSE(isCached("a"));
+  EXPECT_TRUE(isCached("b"));
+  EXPECT_TRUE(isCached("c"));
+}
+
+} // anonymous namespace
@@ -8,6 +8,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/RecyclingAllocator.h"
 
 #include "gtest/gtest.h"
 #include <cstdlib>
@@ -140,4 +141,82 @@ TEST(AllocatorTest, TestBigAlignment) {
   EXPECT_LE(Ptr + 3000, ((uintptr_t)Slab) + Slab->Size);
 }
 
+// Named allocators count their slabs under their name while they live.
+TEST(AllocatorTest, TestNamedCounters) {
+  {
+    BumpPtrAllocator Alloc(4096, 4096);
+    Alloc.Allocate(3000, 0);
+    Alloc.setName("AllocatorTest");
+    Alloc.Allocate(3000, 0);
+    Alloc.Allocate(10000, 0);
+
+    AllocatorCounters C = getAllocatorCounters("AllocatorTest");
+    EXPECT_EQ(1U, C.NumAllocators);
+    EXPECT_EQ(3U, C.NumSlabs);
+    EXPECT_EQ(Alloc.getTotalMemory(), C.SlabBytes);
+
+    Alloc.Reset();
+    C = getAllocatorCounters("AllocatorTest");
+    EXPECT_EQ(1U, C.NumSlabs);
+    EXPECT_EQ(Alloc.getTotalMemory(), C.SlabBytes);
+  }
+
+  AllocatorCounters C = getAllocatorCounters("AllocatorTest");
+  EXPECT_EQ(0U, C.NumAllocators);
+  EXPECT_EQ(0U, C.NumSlabs);
+  EXPECT_EQ(0U, C.SlabBytes);
+  EXPECT_LE(2 * 4096U + 10000U, C.PeakSlabBytes);
+  EXPECT_EQ(0U, getAllocatorCounters("NoSuchAllocator").PeakSlabBytes);
+}
+
+// A slab pool keeps the slabs it gets back, within its limit, and reuses the
+// ones that fit.
+TEST(AllocatorTest, TestSlabPool) {
+  SlabPool Pool(3 * 4096);
+  {
+    BumpPtrAllocator Alloc(4096, 4096, Pool);
+    for (unsigned i = 0; i != 4; ++i)
+      Alloc.Allocate(3000, 0);
+    EXPECT_EQ(4U, Alloc.GetNumSlabs());
+    EXPECT_EQ(0U, Pool.getRetainedMemory());
+  }
+  EXPECT_EQ(3 * 4096U, Pool.getRetainedMemory());
+
+  {
+    BumpPtrAllocator Alloc(4096, 4096, Pool);
+    Alloc.Allocate(3000, 0);
+    EXPECT_EQ(2 * 4096U, Pool.getRetainedMemory());
+
+    // Slabs more than twice as big as asked for are not reused.
+    BumpPtrAllocator Small(1024, 1024, Pool);
+    Small.Allocate(100, 0);
+    EXPECT_EQ(2 * 4096U, Pool.getRetainedMemory());
+  }
+
+  Pool.releaseMemory();
+  EXPECT_EQ(0U, Pool.getRetainedMemory());
+}
+
+// A recycling allocator passes its slab allocator on to the bump allocator,
+// and the slabs go back to the pool when it is destroyed.
+TEST(AllocatorTest, TestRecyclingSlabPool) {
+  SlabPool Pool;
+  {
+    RecyclingAllocator<BumpPtrAllocator, uint64_t, 64> Alloc(Pool);
+    uint64_t *P = Alloc.Allocate();
+    Alloc.Deallocate(P);
+    EXPECT_EQ(P, Alloc.Allocate());
+    EXPECT_EQ(0U, Pool.getRetainedMemory());
+  }
+  EXPECT_EQ(4096U, Pool.getRetainedMemory());
+}
+
+// The shared pool stays the same and backs allocators like any other pool.
+TEST(AllocatorTest, TestSharedSlabPool) {
+  SlabPool &Pool = SlabPool::getShared();
+  EXPECT_EQ(&Pool, &SlabPool::getShared());
+  BumpPtrAllocator Alloc(Pool);
+  EXPECT_NE((void*)0, Alloc.Allocate(100, 8));
+}
+
 }  // anonymous namespace
@@ -0,0 +1,91 @@
+//===- llvm/unittest/Support/MemoryBufferTest.cpp - MemoryBuffer tests ----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Support/system_error.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+class MemoryBufferTest : public testing::Test {
+protected:
+  FILE *File;
+  std::string Contents;
+
+  virtual void SetUp() {
+    File = tmpfile();
+    ASSERT_TRUE(File != 0);
+  }
+
+  virtual void TearDown() {
+    fclose(File);
+  }
+
+  void writeFile(size_t Size) {
+    for (size_t i = 0; i != Size; ++i)
+      Contents += char('a' + i % 26);
+    ASSERT_EQ(Size, fwrite(Contents.data(), 1, Size, File));
+    ASSERT_EQ(0, fflush(File));
+  }
+};
+
+// A file big enough to be mapped, and not a whole number of pages, can be
+// read with every hint, and ends up all in memory when populated.
+TEST_F(MemoryBufferTest, MappedWithHints) {
+  writeFile(65537);
+  OwningPtr<MemoryBuffer> Buf;
+  unsigned Hints = MemoryBuffer::AH_Sequential | MemoryBuffer::AH_WillNeed |
+                   MemoryBuffer::AH_Populate | MemoryBuffer::AH_HugePages;
+  ASSERT_FALSE(MemoryBuffer::getOpenFile(fileno(File), "mapped", Buf,
+                                         -1, -1, 0, true, Hints));
+  EXPECT_EQ(Contents, Buf->getBuffer().str());
+  EXPECT_EQ('\0', *Buf->getBufferEnd());
+  if (Buf->getBufferKind() == MemoryBuffer::MemoryBuffer_MMap) {
+    EXPECT_EQ(Buf->getBufferSize(), Buf->getResidentSize());
+  }
+}
+
+// Part of a file, at an offset inside a page.
+TEST_F(MemoryBufferTest, MappedSlice) {
+  writeFile(100000);
+  OwningPtr<MemoryBuffer> Buf;
+  ASSERT_FALSE(MemoryBuffer::getOpenFile(fileno(File), "slice", Buf,
+                                         100000, 50000, 1234, false,
+                                         MemoryBuffer::AH_Populate));
+  EXPECT_EQ(Contents.substr(1234, 50000), Buf->getBuffer().str());
+  EXPECT_EQ(50000u, Buf->getResidentSize());
+}
+
+// Small files are read rather than mapped, and are always resident.
+TEST_F(MemoryBufferTest, ReadWithHints) {
+  writeFile(100);
+  OwningPtr<MemoryBuffer> Buf;
+  ASSERT_FALSE(MemoryBuffer::getOpenFile(fileno(File), "read", Buf,
+                                         -1, -1, 0, true,
+                                         MemoryBuffer::AH_Sequential));
+  EXPECT_EQ(Contents, Buf->getBuffer().str());
+  EXPECT_EQ(MemoryBuffer::MemoryBuffer_Malloc, Buf->getBufferKind());
+  EXPECT_EQ(100u, Buf->getResidentSize());
+}
+
+TEST(MemoryBufferPrefetchTest, MissingFiles) {
+  std::vector<std::string> Names;
+  Names.push_back("");
+  Names.push_back("/this/file/does/not/exist");
+  MemoryBuffer::prefetchFiles(Names);
+}
+
+}
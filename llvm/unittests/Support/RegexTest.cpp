@@ -9,7 +9,10 @@
 
 #include "gtest/gtest.h"
 #include "llvm/Support/Regex.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/ThreadPool.h"
 #include <cstring>
 
 using namespace llvm;
@@ -91,4 +94,131 @@ TEST_F(RegexTest, Substitution) {
   EXPECT_EQ(Error, "invalid backreference string '100'");
 }
 
+TEST_F(RegexTest, Automaton) {
+  // Both matchers must agree on every pattern, including those with
+  // ambiguous submatches, which regexec divides up.  The last few are handled
+  // by regexec alone.
+  static const char *const Patterns[] = {
+    "^[0-9]+$", "[0-9]+([a-f])?:([0-9]+)", "a[^b]+b", "x{2,3}y", "x{2,}",
+    "ax{0,1}z", "^(foo|bar)baz$", "a$", "(^|,)([^,]*)", "[A-Z]+", "{x",
+    "%[a-z]+[0-9]*", "a\\.b", "[[:alpha:]_][[:alnum:]_]*", "[]a-]+", "()x",
+    "(a|b)*c", "^$", "b(x|y)?$", "(a|ab)(c|bcd)?(d*)", "(a*)*(b|bb)*",
+    "(x|xy)(y|$)", "(ab|a)(bc|c)*", "[^a-c]", ".", "[[:<:]]foo", "[[=a=]]",
+    "[[.-.]]"
+  };
+  static const char *const Strings[] = {
+    "", "916", "9a", "9a:513b", "9:513b", "abb", "axxb", "xxxxy", "xy",
+    "axz", "az", "foobaz", "barbaz\nfoobaz", "xbarbaz", "ba", "a\nb",
+    "x,yy,,z", "ABC def", "{x", "%reg12 = add", "a.b", "axb", "_foo1 bar",
+    "]-a", "x", "aabbc", "by\n", "\n\n", "a-foo", "Foo", "abcd", "xyy",
+    "aabbb", "ba\nab"
+  };
+  static const unsigned Flags[] = {
+    Regex::NoFlags, Regex::IgnoreCase, Regex::Newline
+  };
+
+  SmallVector<StringRef, 4> Matches, Expected;
+  for (unsigned p = 0; p != array_lengthof(Patterns); ++p)
+    for (unsigned f = 0; f != array_lengthof(Flags); ++f) {
+      Regex Fast(Patterns[p], Flags[f]);
+      Regex Slow(Patterns[p], Flags[f] | Regex::NoAutomaton);
+      std::string Error;
+      ASSERT_TRUE(Fast.isValid(Error)) << Patterns[p];
+      for (unsigned s = 0; s != array_lengthof(Strings); ++s) {
+        StringRef String(Strings[s]);
+        bool Matched = Slow.match(String, &Expected);
+        EXPECT_EQ(Matched, Fast.match(String)) << Patterns[p] << " " << s;
+        ASSERT_EQ(Matched, Fast.match(String, &Matches))
+          << Patterns[p] << " " << s;
+        if (!Matched)
+          continue;
+        ASSERT_EQ(Expected.size(), Matches.size());
+        for (unsigned i = 0; i != Matches.size(); ++i) {
+          EXPECT_EQ(Expected[i].data(), Matches[i].data())
+            << Patterns[p] << " " << s << " " << i;
+          EXPECT_EQ(Expected[i].size(), Matches[i].size())
+            << Patterns[p] << " " << s << " " << i;
+        }
+      }
+    }
+}
+
+TEST_F(RegexTest, LeftmostLongest) {
+  SmallVector<StringRef, 3> Matches;
+  EXPECT_TRUE(Regex("abcd|c").match("xabcd", &Matches));
+  EXPECT_EQ("abcd", Matches[0]);
+  EXPECT_TRUE(Regex("a|ab|abc").match("abcd", &Matches));
+  EXPECT_EQ("abc", Matches[0]);
+  EXPECT_TRUE(Regex("(a*)(a*)").match("aaa", &Matches));
+  EXPECT_EQ("aaa", Matches[1]);
+  EXPECT_EQ("", Matches[2]);
+  EXPECT_TRUE(Regex("(a|b)*").match("abab", &Matches));
+  EXPECT_EQ("abab", Matches[0]);
+  EXPECT_EQ("b", Matches[1]);
+}
+
+TEST_F(RegexTest, LongInput) {
+  // Nested repetitions make a backtracking matcher try exponentially many
+  // ways to match the string.
+  std::string String(100000, 'a');
+  SmallVector<StringRef, 2> Matches;
+  Regex R("(a|aa)*(a*)*b");
+  EXPECT_FALSE(R.match(String));
+  EXPECT_FALSE(R.match(String, &Matches));
+  String += 'b';
+  EXPECT_TRUE(R.match(String));
+  // The submatches of this pattern are ambiguous, so regexec places them in
+  // the match; keep that short.
+  EXPECT_TRUE(R.match(StringRef(String).substr(String.size() - 8), &Matches));
+  EXPECT_EQ(8U, Matches[0].size());
+
+  // Lines as FileCheck searches them.
+  std::string Lines;
+  for (unsigned i = 0; i != 10000; ++i)
+    Lines += "  movl %eax, %ebx\n";
+  Lines += "  ret\n";
+  Regex Ret("^[ \t]*(ret|jmp)[ \t]*$", Regex::Newline);
+  EXPECT_TRUE(Ret.match(Lines, &Matches));
+  EXPECT_EQ("  ret", Matches[0]);
+  EXPECT_EQ("ret", Matches[1]);
+}
+
+// MatchJob - Lines for a thread to search with a shared Regex.
+struct MatchJob {
+  Regex *R;
+  std::string Lines;
+  unsigned NumMatched;
+};
+
+void matchLines(void *Arg) {
+  MatchJob *Job = static_cast<MatchJob*>(Arg);
+  SmallVector<StringRef, 3> Matches;
+  StringRef Rest(Job->Lines);
+  while (!Rest.empty()) {
+    std::pair<StringRef, StringRef> Line = Rest.split('\n');
+    if (Job->R->match(Line.first, &Matches) && Matches[2] == "%ebx")
+      ++Job->NumMatched;
+    Rest = Line.second;
+  }
+}
+
+TEST_F(RegexTest, Threads) {
+  // The DFA is built while matching, so threads sharing a Regex take turns.
+  Regex R("^[ \t]*(movl|ret)[ \t]+%[a-z]+, (%[a-z]+)$");
+  MatchJob Jobs[8];
+  ThreadPool Pool(4);
+  {
+    TaskGroup Group(Pool);
+    for (unsigned i = 0; i != array_lengthof(Jobs); ++i) {
+      Jobs[i].R = &R;
+      Jobs[i].NumMatched = 0;
+      for (unsigned j = 0; j != 1000; ++j)
+        Jobs[i].Lines += j % 2 ? "  movl %eax, %ebx\n" : "\tmovl\t%ecx, %edx\n";
+      Group.spawn(matchLines, &Jobs[i]);
+    }
+  }
+  for (unsigned i = 0; i != array_lengthof(Jobs); ++i)
+    EXPECT_EQ(500U, Jobs[i].NumMatched);
+}
+
 }
@@ -0,0 +1,51 @@
+//===- llvm/unittest/Support/SHA256Test.cpp - SHA-256 tests ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/Support/SHA256.h"
+#include <cstring>
+#include <string>
+
+using namespace llvm;
+
+namespace {
+
+// Test vectors from FIPS 180-4 and NIST.
+TEST(SHA256Test, KnownDigests) {
+  EXPECT_EQ("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+            SHA256::hashToHex(""));
+  EXPECT_EQ("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+            SHA256::hashToHex("abc"));
+  EXPECT_EQ("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+            SHA256::hashToHex(
+              "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"));
+  EXPECT_EQ("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0",
+            SHA256::hashToHex(std::string(1000000, 'a')));
+}
+
+// Data added in pieces that straddle blocks hashes like the whole.
+TEST(SHA256Test, IncrementalUpdate) {
+  std::string Data;
+  for (unsigned i = 0; i != 300; ++i)
+    Data += char(i * 7);
+
+  uint8_t Whole[SHA256::DigestSize], Pieces[SHA256::DigestSize];
+  SHA256 Hash;
+  Hash.update(Data);
+  Hash.final(Whole);
+  for (unsigned Step = 1; Step < 70; Step += 13) {
+    Hash.init();
+    for (unsigned i = 0; i < Data.size(); i += Step)
+      Hash.update(StringRef(Data).slice(i, i + Step));
+    Hash.final(Pieces);
+    EXPECT_EQ(0, memcmp(Whole, Pieces, sizeof(Whole))) << Step;
+  }
+}
+
+}
@@ -0,0 +1,83 @@
+//===- llvm/unittest/Support/SourceMgrTest.cpp - SourceMgr tests ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include <cstdlib>
+#include <string>
+
+using namespace llvm;
+
+namespace {
+
+class SourceMgrTest : public testing::Test {
+protected:
+  SourceMgr SM;
+
+  unsigned addBuffer(StringRef Text) {
+    return SM.AddNewSourceBuffer(MemoryBuffer::getMemBufferCopy(Text),
+                                 SMLoc());
+  }
+
+  SMLoc getLoc(unsigned BufferID, unsigned Offset) {
+    return SMLoc::getFromPointer(
+      SM.getMemoryBuffer(BufferID)->getBufferStart() + Offset);
+  }
+};
+
+TEST_F(SourceMgrTest, LineAndColumn) {
+  unsigned Buf = addBuffer("abc\n\ndef\nghi");
+  EXPECT_EQ(std::make_pair(1u, 1u), SM.getLineAndColumn(getLoc(Buf, 0)));
+  EXPECT_EQ(std::make_pair(1u, 3u), SM.getLineAndColumn(getLoc(Buf, 2)));
+  // The newline belongs to the line it ends.
+  EXPECT_EQ(std::make_pair(1u, 4u), SM.getLineAndColumn(getLoc(Buf, 3)));
+  EXPECT_EQ(std::make_pair(2u, 1u), SM.getLineAndColumn(getLoc(Buf, 4)));
+  EXPECT_EQ(std::make_pair(3u, 2u), SM.getLineAndColumn(getLoc(Buf, 6)));
+  EXPECT_EQ(4u, SM.FindLineNumber(getLoc(Buf, 10), Buf));
+  // The null at the end of the buffer is part of the last line.
+  EXPECT_EQ(std::make_pair(4u, 4u), SM.getLineAndColumn(getLoc(Buf, 12)));
+}
+
+TEST_F(SourceMgrTest, EmptyBuffer) {
+  unsigned Buf = addBuffer("");
+  EXPECT_EQ(std::make_pair(1u, 1u), SM.getLineAndColumn(getLoc(Buf, 0), Buf));
+}
+
+TEST_F(SourceMgrTest, SeveralBuffers) {
+  unsigned First = addBuffer("a\nb\n");
+  unsigned Second = addBuffer("\n\n\nc");
+  EXPECT_EQ(4u, SM.FindLineNumber(getLoc(Second, 3)));
+  EXPECT_EQ(2u, SM.FindLineNumber(getLoc(First, 2)));
+  EXPECT_EQ(3u, SM.FindLineNumber(getLoc(First, 4)));
+}
+
+// Lookups in any order agree with counting the newlines, however the lines
+// fall relative to the chunks the buffer is scanned in.
+TEST_F(SourceMgrTest, UnorderedLookups) {
+  std::string Text;
+  srand(0);
+  for (unsigned i = 0; i != 10000; ++i)
+    Text += rand() % 8 ? char('a' + rand() % 26) : '\n';
+  unsigned Buf = addBuffer(Text);
+
+  for (unsigned i = 0; i != 1000; ++i) {
+    unsigned Offset = rand() % (Text.size() + 1);
+    unsigned Line = 1, Column = 1;
+    for (unsigned j = 0; j != Offset; ++j, ++Column)
+      if (Text[j] == '\n') {
+        ++Line;
+        Column = 0;
+      }
+    EXPECT_EQ(std::make_pair(Line, Column),
+              SM.getLineAndColumn(getLoc(Buf, Offset), Buf));
+  }
+}
+
+}
@@ -0,0 +1,138 @@
+//===- llvm/unittest/Support/ThreadPoolTest.cpp - ThreadPool tests --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Atomic.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+static void incrementCounter(void *Arg) {
+  sys::AtomicIncrement(static_cast<volatile sys::cas_flag*>(Arg));
+}
+
+TEST(ThreadPoolTest, TaskGroupWait) {
+  ThreadPool Pool(4);
+  volatile sys::cas_flag Count = 0;
+  {
+    TaskGroup Group(Pool);
+    for (unsigned i = 0; i != 1000; ++i)
+      Group.spawn(incrementCounter, const_cast<sys::cas_flag*>(&Count));
+    Group.wait();
+    EXPECT_EQ(1000U, Count);
+
+    // A group can be reused after waiting on it.
+    for (unsigned i = 0; i != 10; ++i)
+      Group.spawn(incrementCounter, const_cast<sys::cas_flag*>(&Count));
+  }
+  // The destructor of the group waits as well.
+  EXPECT_EQ(1010U, Count);
+}
+
+TEST(ThreadPoolTest, Synchronous) {
+  ThreadPool Pool(1);
+  EXPECT_EQ(0U, Pool.getNumThreads());
+
+  volatile sys::cas_flag Count = 0;
+  TaskGroup Group(Pool);
+  Group.spawn(incrementCounter, const_cast<sys::cas_flag*>(&Count));
+  // Tasks of a synchronous pool have run by the time spawn returns.
+  EXPECT_EQ(1U, Count);
+}
+
+/// NestedTask - Spawns a group of children from inside the pool and waits on
+/// them, which must not deadlock even when every worker is doing the same.
+class NestedTask : public Task {
+  unsigned Depth;
+  volatile sys::cas_flag *Count;
+public:
+  NestedTask(unsigned Depth, volatile sys::cas_flag *Count)
+    : Depth(Depth), Count(Count) {}
+
+  virtual void run() {
+    sys::AtomicIncrement(Count);
+    if (Depth == 0)
+      return;
+    TaskGroup Children(getGroup()->getPool());
+    for (unsigned i = 0; i != 4; ++i)
+      Children.spawn(new NestedTask(Depth - 1, Count));
+    Children.wait();
+  }
+};
+
+TEST(ThreadPoolTest, NestedGroups) {
+  ThreadPool Pool(2);
+  volatile sys::cas_flag Count = 0;
+  TaskGroup Group(Pool);
+  Group.spawn(new NestedTask(4, &Count));
+  Group.wait();
+  // 1 + 4 + 16 + 64 + 256 tasks.
+  EXPECT_EQ(341U, Count);
+}
+
+TEST(ThreadPoolTest, Cancel) {
+  ThreadPool Pool(2);
+  volatile sys::cas_flag Count = 0;
+  TaskGroup Group(Pool);
+  Group.cancel();
+  EXPECT_TRUE(Group.isCancelled());
+  for (unsigned i = 0; i != 100; ++i)
+    Group.spawn(incrementCounter, const_cast<sys::cas_flag*>(&Count));
+  Group.wait();
+  EXPECT_EQ(0U, Count);
+}
+
+struct Square {
+  unsigned *Out;
+  explicit Square(unsigned *Out) : Out(Out) {}
+  void operator()(const unsigned &In) const {
+    // Every element is visited exactly once, so the writes don't race.
+    Out[In] = In * In;
+  }
+};
+
+TEST(ThreadPoolTest, ParallelForEach) {
+  ThreadPool Pool(4);
+  SmallVector<unsigned, 0> In, Out(10000);
+  for (unsigned i = 0; i != 10000; ++i)
+    In.push_back(i);
+
+  parallel_for_each(Pool, makeArrayRef(In), Square(Out.data()));
+  for (unsigned i = 0; i != 10000; ++i)
+    EXPECT_EQ(i * i, Out[i]);
+}
+
+static void emptyTask(void *) {}
+
+// Microbenchmark of the scheduling overhead: the time to spawn and run empty
+// tasks, for a growing number of workers.  Run with
+// --gtest_also_run_disabled_tests.
+TEST(ThreadPoolTest, DISABLED_SchedulingOverhead) {
+  const unsigned NumTasks = 1000000;
+  for (unsigned NumThreads = 1; NumThreads <= 8; NumThreads *= 2) {
+    ThreadPool Pool(NumThreads);
+    sys::TimeValue Start = sys::TimeValue::now();
+    {
+      TaskGroup Group(Pool);
+      for (unsigned i = 0; i != NumTasks; ++i)
+        Group.spawn(emptyTask, 0);
+    }
+    sys::TimeValue Elapsed = sys::TimeValue::now() - Start;
+    outs() << "threads: " << NumThreads << "  tasks: " << NumTasks
+           << "  ns/task: " << Elapsed.usec() * 1000 / NumTasks << "\n";
+  }
+}
+
+} // anonymous namespace
@@ -0,0 +1,186 @@
+//===- llvm/unittest/Support/TimerTest.cpp - Timer tests ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/Timer.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Config/config.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#if LLVM_ENABLE_THREADS != 0 && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+using namespace llvm;
+
+namespace {
+
+// getEvent - Return the line of the trace that holds the event named Name.
+StringRef getEvent(StringRef Trace, StringRef Name) {
+  SmallVector<StringRef, 8> Lines;
+  Trace.split(Lines, "\n");
+  std::string Key = "\"name\":\"" + Name.str() + "\"";
+  for (unsigned i = 0, e = Lines.size(); i != e; ++i)
+    if (Lines[i].find(Key) != StringRef::npos)
+      return Lines[i];
+  return StringRef();
+}
+
+// getField - Return the value of the integer field Field of Event.
+uint64_t getField(StringRef Event, StringRef Field) {
+  std::string Key = "\"" + Field.str() + "\":";
+  size_t Pos = Event.find(Key);
+  if (Pos == StringRef::npos)
+    return ~0ULL;
+  StringRef Value = Event.substr(Pos + Key.size());
+  unsigned long long Result;
+  if (Value.slice(0, Value.find(',')).getAsInteger(10, Result))
+    return ~0ULL;
+  return Result;
+}
+
+#if LLVM_ENABLE_THREADS != 0 && defined(HAVE_PTHREAD_H)
+void *traceInThread(void *) {
+  TimeTraceRegion R("threaded", "g");
+  return 0;
+}
+#endif
+
+TEST(TimeTraceTest, ChromeTrace) {
+  ASSERT_FALSE(TimeTraceRegion::isEnabled());
+  TimeTraceRegion::beginTrace(0);
+  ASSERT_TRUE(TimeTraceRegion::isEnabled());
+
+  {
+    TimeTraceRegion Outer("outer", "main \"thread\"");
+    TimeTraceRegion Inner("inner", "f");
+  }
+#if LLVM_ENABLE_THREADS != 0 && defined(HAVE_PTHREAD_H)
+  pthread_t Thread;
+  pthread_create(&Thread, 0, traceInThread, 0);
+  pthread_join(Thread, 0);
+#endif
+
+  std::string Str;
+  raw_string_ostream OS(Str);
+  TimeTraceRegion::endTrace(OS);
+  EXPECT_FALSE(TimeTraceRegion::isEnabled());
+  StringRef Trace = OS.str();
+  EXPECT_TRUE(Trace.startswith("{\"traceEvents\":[\n"));
+  EXPECT_TRUE(Trace.endswith("],\"displayTimeUnit\":\"ms\"}\n"));
+
+  // Both regions are complete events, with their details as arguments.
+  StringRef Outer = getEvent(Trace, "outer");
+  StringRef Inner = getEvent(Trace, "inner");
+  EXPECT_TRUE(Outer.startswith("{\"pid\":1,\"tid\":"));
+  EXPECT_NE(StringRef::npos, Outer.find(",\"ph\":\"X\","));
+  EXPECT_TRUE(Outer.endswith(
+                ",\"args\":{\"detail\":\"main \\\"thread\\\"\"}},"));
+  EXPECT_NE(StringRef::npos, Inner.find(",\"ph\":\"X\","));
+  EXPECT_TRUE(Inner.endswith(",\"args\":{\"detail\":\"f\"}},"));
+
+  // The outer region encloses the inner one, on the same track.
+  EXPECT_EQ(getField(Outer, "tid"), getField(Inner, "tid"));
+  EXPECT_LE(getField(Outer, "ts"), getField(Inner, "ts"));
+  EXPECT_GE(getField(Outer, "ts") + getField(Outer, "dur"),
+            getField(Inner, "ts") + getField(Inner, "dur"));
+
+#if LLVM_ENABLE_THREADS != 0 && defined(HAVE_PTHREAD_H)
+  // The other thread gets its own track.
+  StringRef Threaded = getEvent(Trace, "threaded");
+  EXPECT_NE(StringRef::npos, Threaded.find(",\"ph\":\"X\","));
+  EXPECT_NE(~0ULL, getField(Threaded, "tid"));
+  EXPECT_NE(getField(Outer, "tid"), getField(Threaded, "tid"));
+#endif
+}
+
+TEST(TimeTraceTest, Granularity) {
+  // Events shorter than the granularity are dropped, and the events of an
+  // earlier trace are gone.
+  TimeTraceRegion::beginTrace(1000000);
+  {
+    TimeTraceRegion Short("short", "");
+  }
+  std::string Str;
+  raw_string_ostream OS(Str);
+  TimeTraceRegion::endTrace(OS);
+  EXPECT_TRUE(getEvent(OS.str(), "short").empty());
+  EXPECT_TRUE(getEvent(OS.str(), "outer").empty());
+  EXPECT_FALSE(TimeTraceRegion::isEnabled());
+}
+
+// openNone - Counts nothing, as when perf_event_open is not allowed.
+int openNone(TimeRecord::HWCounter, int) {
+  return -1;
+}
+
+TEST(HWCounterGroupTest, Unavailable) {
+  std::string Warnings;
+  raw_string_ostream OS(Warnings);
+  HWCounterGroup Group(OS, openNone);
+  for (unsigned i = 0; i != TimeRecord::NumHWCounters; ++i)
+    EXPECT_FALSE(Group.isCounting(TimeRecord::HWCounter(i)));
+  EXPECT_EQ("warning: hardware performance counters are not available, "
+            "ignoring -track-perf-counters\n", OS.str());
+
+  TimeRecord Record;
+  Group.read(Record);
+  for (unsigned i = 0; i != TimeRecord::NumHWCounters; ++i)
+    EXPECT_EQ(0, Record.getCounter(TimeRecord::HWCounter(i)));
+}
+
+#ifdef HAVE_UNISTD_H
+// openAllButLLC - Opens a pipe for every counter but the LLC misses.  The
+// leader's pipe holds one read of the group, which the kernel ran half of
+// the time it was enabled.
+int openAllButLLC(TimeRecord::HWCounter C, int GroupFD) {
+  int FDs[2];
+  if (C == TimeRecord::LLCMisses || pipe(FDs))
+    return -1;
+  if (GroupFD < 0) {
+    const uint64_t Values[] = { 4, 200, 100, 1000, 2000, 30, 40 };
+    if (write(FDs[1], Values, sizeof(Values)) != sizeof(Values))
+      ADD_FAILURE() << "cannot fill the pipe";
+  }
+  close(FDs[1]);
+  return FDs[0];
+}
+
+TEST(HWCounterGroupTest, Fallback) {
+  std::string Warnings;
+  raw_string_ostream OS(Warnings);
+  HWCounterGroup Group(OS, openAllButLLC);
+  EXPECT_TRUE(Group.isCounting(TimeRecord::Cycles));
+  EXPECT_FALSE(Group.isCounting(TimeRecord::LLCMisses));
+  EXPECT_EQ("warning: cannot count LLC read misses, leaving them out of "
+            "-track-perf-counters\n", OS.str());
+
+  // The values are scaled up for the multiplexing, and skip the LLC misses.
+  TimeRecord Record;
+  Group.read(Record);
+  EXPECT_EQ(2000, Record.getCounter(TimeRecord::Cycles));
+  EXPECT_EQ(4000, Record.getCounter(TimeRecord::Instructions));
+  EXPECT_EQ(60, Record.getCounter(TimeRecord::L1DMisses));
+  EXPECT_EQ(0, Record.getCounter(TimeRecord::LLCMisses));
+  EXPECT_EQ(80, Record.getCounter(TimeRecord::BranchMisses));
+  EXPECT_EQ(2.0, Record.getIPC());
+
+  // The report gives the IPC and the misses per thousand instructions, and
+  // dashes for the events that were not counted.
+  std::string Report;
+  raw_string_ostream ReportOS(Report);
+  Record.print(Record, ReportOS);
+  EXPECT_EQ("        -----        2.00     15.00     -----     20.00  ",
+            ReportOS.str());
+}
+#endif
+
+}
@@ -143,4 +143,20 @@ TEST(raw_ostreamTest, WriteEscaped) {
   EXPECT_EQ("\\001\\010\\200", Str);
 }
 
+TEST(raw_ostreamTest, WriteJSONString) {
+  std::string Str;
+
+  Str = "";
+  raw_string_ostream(Str).write_json_string("hi");
+  EXPECT_EQ("\"hi\"", Str);
+
+  Str = "";
+  raw_string_ostream(Str).write_json_string("\\\t\n\"");
+  EXPECT_EQ("\"\\\\\\t\\n\\\"\"", Str);
+
+  Str = "";
+  raw_string_ostream(Str).write_json_string("\1\37\200");
+  EXPECT_EQ("\"\\u0001\\u001F\200\"", Str);
+}
+
 }
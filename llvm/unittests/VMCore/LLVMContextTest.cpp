@@ -0,0 +1,174 @@
+//===- llvm/unittest/VMCore/LLVMContextTest.cpp - LLVMContext tests -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Function.h"
+#include "llvm/GlobalVariable.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Metadata.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/IRBuilder.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Config/config.h"
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+TEST(LLVMContextTest, ConcurrentUniquingFlag) {
+  LLVMContext Context;
+  EXPECT_FALSE(Context.hasConcurrentUniquing());
+  Context.setConcurrentUniquing(true);
+  EXPECT_TRUE(Context.hasConcurrentUniquing());
+
+  // The tables must keep uniquing when the mode is switched.
+  Constant *C = ConstantInt::get(Type::getInt32Ty(Context), 42);
+  Context.setConcurrentUniquing(false);
+  EXPECT_EQ(C, ConstantInt::get(Type::getInt32Ty(Context), 42));
+}
+
+TEST(LLVMContextTest, DiscardValueNames) {
+  LLVMContext Context;
+  Module M("discard", Context);
+  FunctionType *FTy = FunctionType::get(Type::getInt32Ty(Context),
+                                        Type::getInt32Ty(Context), false);
+  Function *F = Function::Create(FTy, GlobalValue::ExternalLinkage, "before",
+                                 &M);
+  F->arg_begin()->setName("x");
+
+  EXPECT_FALSE(Context.shouldDiscardValueNames());
+  Context.setDiscardValueNames(true);
+  EXPECT_TRUE(Context.shouldDiscardValueNames());
+
+  // Globals keep getting names, other values don't.
+  Function *G = Function::Create(FTy, GlobalValue::ExternalLinkage, "after",
+                                 &M);
+  EXPECT_EQ("after", G->getName());
+  BasicBlock *BB = BasicBlock::Create(Context, "entry", G);
+  EXPECT_FALSE(BB->hasName());
+  IRBuilder<> Builder(BB);
+  Value *Sum = Builder.CreateAdd(G->arg_begin(), G->arg_begin(), "sum");
+  EXPECT_FALSE(Sum->hasName());
+  Builder.CreateRet(Sum);
+  EXPECT_TRUE(M.getGlobalVariable("global") == 0);
+  new GlobalVariable(M, Type::getInt32Ty(Context), false,
+                     GlobalValue::ExternalLinkage, 0, "global");
+  EXPECT_TRUE(M.getGlobalVariable("global") != 0);
+
+  // A name given earlier stays until it is changed.
+  Argument *X = F->arg_begin();
+  EXPECT_EQ("x", X->getName());
+  X->setName("y");
+  EXPECT_FALSE(X->hasName());
+}
+
+#if LLVM_ENABLE_THREADS != 0 && defined(HAVE_PTHREAD_H)
+
+/// UniquingWorker - The state of one thread of the concurrent uniquing tests.
+/// Each thread creates the same sequence of objects, recording what it got so
+/// the results of all the threads can be compared afterwards.
+struct UniquingWorker {
+  LLVMContext *Context;
+  unsigned NumIterations;
+  SmallVector<Value*, 0> Values;
+  SmallVector<Type*, 0> Types;
+
+  static void *run(void *Arg) {
+    UniquingWorker *W = static_cast<UniquingWorker*>(Arg);
+    LLVMContext &Ctx = *W->Context;
+    for (unsigned i = 0; i != W->NumIterations; ++i) {
+      IntegerType *ITy = IntegerType::get(Ctx, 1 + i % 128);
+      Type *PTy = PointerType::getUnqual(ArrayType::get(ITy, i % 16));
+      Constant *CI = ConstantInt::get(ITy, i);
+      Constant *CF = ConstantFP::get(Type::getDoubleTy(Ctx), double(i));
+
+      SmallString<16> Name;
+      raw_svector_ostream(Name) << "md" << i;
+      MDString *S = MDString::get(Ctx, Name);
+      Value *Ops[] = { S, CI };
+      MDNode *N = MDNode::get(Ctx, Ops);
+
+      W->Types.push_back(PTy);
+      W->Values.push_back(CI);
+      W->Values.push_back(CF);
+      W->Values.push_back(S);
+      W->Values.push_back(N);
+    }
+    return 0;
+  }
+};
+
+static void runUniquingWorkers(UniquingWorker *Workers, unsigned NumThreads) {
+  SmallVector<pthread_t, 8> Threads(NumThreads);
+  for (unsigned i = 0; i != NumThreads; ++i)
+    pthread_create(&Threads[i], 0, UniquingWorker::run, &Workers[i]);
+  for (unsigned i = 0; i != NumThreads; ++i)
+    pthread_join(Threads[i], 0);
+}
+
+TEST(LLVMContextTest, ConcurrentUniquing) {
+  LLVMContext Context;
+  Context.setConcurrentUniquing(true);
+
+  const unsigned NumThreads = 4;
+  UniquingWorker Workers[NumThreads];
+  for (unsigned i = 0; i != NumThreads; ++i) {
+    Workers[i].Context = &Context;
+    Workers[i].NumIterations = 2000;
+  }
+  runUniquingWorkers(Workers, NumThreads);
+
+  // Every thread must have been handed the very same objects.
+  for (unsigned i = 1; i != NumThreads; ++i) {
+    ASSERT_EQ(Workers[0].Values.size(), Workers[i].Values.size());
+    for (unsigned j = 0, e = Workers[0].Values.size(); j != e; ++j)
+      EXPECT_EQ(Workers[0].Values[j], Workers[i].Values[j]);
+    for (unsigned j = 0, e = Workers[0].Types.size(); j != e; ++j)
+      EXPECT_EQ(Workers[0].Types[j], Workers[i].Types[j]);
+  }
+}
+
+// Contention benchmark for the concurrent uniquing tables: compare the time
+// taken by one thread against several threads hammering the same context.
+// Run with --gtest_also_run_disabled_tests.
+TEST(LLVMContextTest, DISABLED_ConcurrentUniquingContention) {
+  const unsigned NumIterations = 200000;
+  const unsigned MaxThreads = 8;
+
+  for (unsigned NumThreads = 1; NumThreads <= MaxThreads; NumThreads *= 2) {
+    LLVMContext Context;
+    Context.setConcurrentUniquing(true);
+
+    UniquingWorker Workers[MaxThreads];
+    for (unsigned i = 0; i != NumThreads; ++i) {
+      Workers[i].Context = &Context;
+      Workers[i].NumIterations = NumIterations / NumThreads;
+    }
+
+    sys::TimeValue Start = sys::TimeValue::now();
+    runUniquingWorkers(Workers, NumThreads);
+    sys::TimeValue Elapsed = sys::TimeValue::now() - Start;
+
+    outs() << "threads: " << NumThreads << "  iterations: " << NumIterations
+           << "  time: " << Elapsed.msec() << "ms\n";
+  }
+}
+
+#endif
+
+} // anonymous namespace
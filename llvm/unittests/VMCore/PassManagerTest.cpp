@@ -24,10 +24,15 @@
 #include "llvm/BasicBlock.h"
 #include "llvm/Instructions.h"
 #include "llvm/InlineAsm.h"
+#include "llvm/Config/config.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/PassManager.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/Twine.h"
 #include "llvm/Analysis/Verifier.h"
 #include "llvm/Assembly/PrintModulePass.h"
 #include "gtest/gtest.h"
@@ -40,6 +45,8 @@ namespace llvm {
   void initializeCGPassPass(PassRegistry&);
   void initializeLPassPass(PassRegistry&);
   void initializeBPassPass(PassRegistry&);
+  void initializeFoldConstantsPass(PassRegistry&);
+  void initializeAddCallsPass(PassRegistry&);
 
   namespace {
     // ND = no deps
@@ -534,6 +541,193 @@ namespace llvm {
       return mod;
     }
 
+    // FoldConstants - Folds binary operators with constant operands, which
+    // creates new uniqued constants in the context of the function.
+    struct FoldConstants : public FunctionPass {
+      static char ID;
+      static int copies;
+      FoldConstants() : FunctionPass(ID) {
+        initializeFoldConstantsPass(*PassRegistry::getPassRegistry());
+      }
+      virtual bool isParallelSafe() const { return true; }
+      virtual Pass *createParallelInstance() const {
+        copies++;
+        return new FoldConstants();
+      }
+      virtual bool runOnFunction(Function &F) {
+        bool Changed = false;
+        for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+          for (BasicBlock::iterator I = BB->begin(); I != BB->end(); ) {
+            BinaryOperator *BO = dyn_cast<BinaryOperator>(I++);
+            if (!BO || !isa<Constant>(BO->getOperand(0)) ||
+                !isa<Constant>(BO->getOperand(1)))
+              continue;
+            BO->replaceAllUsesWith(
+              ConstantExpr::get(BO->getOpcode(),
+                                cast<Constant>(BO->getOperand(0)),
+                                cast<Constant>(BO->getOperand(1))));
+            BO->eraseFromParent();
+            Changed = true;
+          }
+        return Changed;
+      }
+      virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+        AU.setPreservesCFG();
+      }
+    };
+    char FoldConstants::ID=0;
+    int FoldConstants::copies=0;
+
+    Module *makeFoldModule(LLVMContext &Context) {
+      Module *M = new Module("test-parallel", Context);
+      Type *Int32Ty = Type::getInt32Ty(Context);
+      std::vector<Type*> Params(1, Int32Ty);
+      FunctionType *FTy = FunctionType::get(Int32Ty, Params, false);
+      for (unsigned i = 0; i != 64; ++i) {
+        Function *F = Function::Create(FTy, GlobalValue::ExternalLinkage,
+                                       "f" + Twine(i), M);
+        BasicBlock *BB = BasicBlock::Create(Context, "entry", F);
+        Value *V = BinaryOperator::CreateAdd(ConstantInt::get(Int32Ty, i),
+                                             ConstantInt::get(Int32Ty, 7),
+                                             "a", BB);
+        V = BinaryOperator::CreateMul(V, ConstantInt::get(Int32Ty, 1000 + i),
+                                      "b", BB);
+        V = BinaryOperator::CreateAdd(F->arg_begin(), V, "c", BB);
+        ReturnInst::Create(Context, V, BB);
+      }
+      return M;
+    }
+
+    // AddCalls - Makes every function load the global "g" and call one of a
+    // few external functions, which it declares if they are not there yet.
+    struct AddCalls : public FunctionPass {
+      static char ID;
+      AddCalls() : FunctionPass(ID) {
+        initializeAddCallsPass(*PassRegistry::getPassRegistry());
+      }
+      virtual bool isParallelSafe() const { return true; }
+      virtual Pass *createParallelInstance() const { return new AddCalls(); }
+      virtual bool runOnFunction(Function &F) {
+        Module *M = F.getParent();
+        unsigned N = 0;
+        F.getName().substr(1).getAsInteger(10, N);
+        Instruction *Ret = F.getEntryBlock().getTerminator();
+        Value *G = new LoadInst(M->getGlobalVariable("g"), "g", Ret);
+        Constant *Callee =
+          M->getOrInsertFunction("callee" + utostr(N % 8),
+                                 F.getFunctionType());
+        CallInst *Call = CallInst::Create(Callee, G, "call", Ret);
+        Ret->setOperand(0, Call);
+        return true;
+      }
+    };
+
+    char AddCalls::ID=0;
+
+    // getUsers - Return the names of the functions that use V, in the order
+    // of the use list of V.
+    std::string getUsers(Value *V) {
+      std::string Users;
+      for (Value::use_iterator UI = V->use_begin(), E = V->use_end();
+           UI != E; ++UI)
+        Users += cast<Instruction>(*UI)->getParent()->getParent()->getName()
+                   .str() + " ";
+      return Users;
+    }
+
+    std::string runFoldPipeline(Module &M, ThreadPool *Pool = 0) {
+      PassManager Passes;
+      Passes.setThreadPool(Pool);
+      Passes.add(new FoldConstants());
+      Passes.add(createVerifierPass());
+      Passes.run(M);
+
+      std::string Str;
+      raw_string_ostream OS(Str);
+      OS << M;
+      return OS.str();
+    }
+
+#if LLVM_ENABLE_THREADS != 0
+    // ParallelMode - Turns on -parallel-function-passes and multithreading
+    // for the lifetime of the object, so that other tests are not affected.
+    class ParallelMode {
+      bool WasEnabled, WasMultithreaded;
+    public:
+      ParallelMode()
+        : WasEnabled(ParallelFunctionPassesEnabled),
+          WasMultithreaded(llvm_is_multithreaded()) {
+        ParallelFunctionPassesEnabled = true;
+        if (!WasMultithreaded)
+          llvm_start_multithreaded();
+      }
+      ~ParallelMode() {
+        ParallelFunctionPassesEnabled = WasEnabled;
+        if (!WasMultithreaded)
+          llvm_stop_multithreaded();
+      }
+    };
+
+    TEST(PassManager, ParallelFunctionPasses) {
+      FoldConstants::copies = 0;
+      LLVMContext SerialContext;
+      OwningPtr<Module> Serial(makeFoldModule(SerialContext));
+      std::string Expected = runFoldPipeline(*Serial);
+      EXPECT_EQ(0, FoldConstants::copies);
+
+      ParallelMode Mode;
+      ASSERT_TRUE(llvm_is_multithreaded());
+      ThreadPool Pool(4);
+      ASSERT_EQ(4U, Pool.getNumThreads());
+
+      LLVMContext ParallelContext;
+      ParallelContext.setConcurrentUniquing(true);
+      OwningPtr<Module> Parallel(makeFoldModule(ParallelContext));
+      std::string Actual = runFoldPipeline(*Parallel, &Pool);
+
+      // Every worker of the pool ran its own copy of the pass.
+      EXPECT_EQ(4, FoldConstants::copies);
+      EXPECT_EQ(Expected, Actual);
+    }
+
+    TEST(PassManager, ParallelFunctionPassesAreDeterministic) {
+      ParallelMode Mode;
+      ThreadPool Pool(4);
+      std::string Expected, ExpectedUsers;
+      for (unsigned Run = 0; Run != 4; ++Run) {
+        LLVMContext Context;
+        Context.setConcurrentUniquing(true);
+        OwningPtr<Module> M(makeFoldModule(Context));
+        Type *Int32Ty = Type::getInt32Ty(Context);
+        GlobalVariable *G =
+          new GlobalVariable(*M, Int32Ty, false, GlobalValue::ExternalLinkage,
+                             0, "g");
+
+        PassManager Passes;
+        Passes.setThreadPool(&Pool);
+        Passes.add(new AddCalls());
+        Passes.add(createVerifierPass());
+        Passes.run(*M);
+
+        // The declarations and the use lists of the shared values must not
+        // depend on the order in which the threads got to them.
+        std::string Printed, Users = getUsers(G);
+        for (unsigned i = 0; i != 8; ++i)
+          Users += "| " + getUsers(M->getFunction("callee" + utostr(i)));
+        raw_string_ostream OS(Printed);
+        OS << *M;
+        OS.flush();
+        if (Run == 0) {
+          Expected = Printed;
+          ExpectedUsers = Users;
+        } else {
+          EXPECT_EQ(Expected, Printed);
+          EXPECT_EQ(ExpectedUsers, Users);
+        }
+      }
+    }
+#endif
+
   }
 }
 
@@ -546,3 +740,5 @@ INITIALIZE_PASS_BEGIN(LPass, "lp","lp", false, false)
 INITIALIZE_PASS_DEPENDENCY(LoopInfo)
 INITIALIZE_PASS_END(LPass, "lp","lp", false, false)
 INITIALIZE_PASS(BPass, "bp","bp", false, false)
+INITIALIZE_PASS(FoldConstants, "fold-constants", "fold-constants", false, false)
+INITIALIZE_PASS(AddCalls, "add-calls", "add-calls", false, false)
@@ -60,5 +60,78 @@ TEST(VerifierTest, AliasUnnamedAddr) {
   EXPECT_TRUE(verifyModule(M, ReturnStatusAction, &Error));
   EXPECT_TRUE(StringRef(Error).startswith("Alias cannot have unnamed_addr"));
 }
+
+TEST(VerifierTest, ModificationEpoch) {
+  LLVMContext &C = getGlobalContext();
+  Module M("M", C);
+  Type *I32 = Type::getInt32Ty(C);
+  Type *Params[] = { I32 };
+  FunctionType *FTy = FunctionType::get(I32, Params, /*isVarArg=*/false);
+  Function *F = Function::Create(FTy, GlobalValue::ExternalLinkage, "f", &M);
+  Argument *Arg = F->arg_begin();
+  BasicBlock *Entry = BasicBlock::Create(C, "entry", F);
+  ReturnInst *Ret = ReturnInst::Create(C, Arg, Entry);
+
+  unsigned Epoch = F->getModificationEpoch();
+  Instruction *Add = BinaryOperator::CreateAdd(Arg, Arg, "add", Ret);
+  EXPECT_LT(Epoch, F->getModificationEpoch());
+
+  Epoch = F->getModificationEpoch();
+  Instruction *Mul = BinaryOperator::CreateMul(Arg, Arg, "mul", Ret);
+  Mul->moveBefore(Add);
+  EXPECT_LT(Epoch, F->getModificationEpoch());
+
+  Epoch = F->getModificationEpoch();
+  Arg->replaceAllUsesWith(ConstantInt::get(I32, 1));
+  EXPECT_LT(Epoch, F->getModificationEpoch());
+
+  Epoch = F->getModificationEpoch();
+  Ret->replaceUsesOfWith(ConstantInt::get(I32, 1), Add);
+  EXPECT_LT(Epoch, F->getModificationEpoch());
+
+  Epoch = F->getModificationEpoch();
+  Mul->eraseFromParent();
+  EXPECT_LT(Epoch, F->getModificationEpoch());
+
+  Epoch = F->getModificationEpoch();
+  BasicBlock::Create(C, "dead", F);
+  EXPECT_LT(Epoch, F->getModificationEpoch());
+}
+
+TEST(VerifierTest, OnlyModified) {
+  LLVMContext &C = getGlobalContext();
+  Module M("M", C);
+  FunctionType *FTy = FunctionType::get(Type::getVoidTy(C), /*isVarArg=*/false);
+  Function *F = Function::Create(FTy, GlobalValue::ExternalLinkage, "f", &M);
+  BasicBlock *Entry = BasicBlock::Create(C, "entry", F);
+  BasicBlock *Exit = BasicBlock::Create(C, "exit", F);
+  ReturnInst::Create(C, Exit);
+  BranchInst *BI = BranchInst::Create(Exit, Exit, ConstantInt::getFalse(C),
+                                      Entry);
+
+  EXPECT_FALSE(verifyModule(M, ReturnStatusAction, 0, true));
+  EXPECT_EQ(F->getModificationEpoch(), F->getVerifiedEpoch());
+
+  // Setting an operand does not advance the epoch, so the broken body is not
+  // looked at again until the function is marked as modified.
+  BI->setOperand(0, ConstantInt::get(IntegerType::get(C, 32), 0));
+  EXPECT_FALSE(verifyModule(M, ReturnStatusAction, 0, true));
+
+  F->markModified();
+  std::string Error;
+  EXPECT_TRUE(verifyModule(M, ReturnStatusAction, &Error, true));
+  EXPECT_TRUE(StringRef(Error).startswith("Branch condition is not 'i1' type"));
+  EXPECT_NE(F->getModificationEpoch(), F->getVerifiedEpoch());
+
+  BI->setOperand(0, ConstantInt::getFalse(C));
+  F->markModified();
+  EXPECT_FALSE(verifyModule(M, ReturnStatusAction, 0, true));
+  EXPECT_EQ(F->getModificationEpoch(), F->getVerifiedEpoch());
+
+  // The checks of the function itself, as opposed to its body, are always
+  // done.
+  F->setLinkage(GlobalValue::CommonLinkage);
+  EXPECT_TRUE(verifyModule(M, ReturnStatusAction, 0, true));
+}
 }
 }
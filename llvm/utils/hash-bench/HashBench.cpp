@@ -0,0 +1,141 @@
+//===- HashBench - Benchmark the string hash functions --------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program collects the names in the symbol tables of the given modules,
+// and compares HashString with hash_value on them: it outputs the time taken
+// to hash all names, and the number of probes and full hash collisions when
+// the names are inserted into a StringMap-like table.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/ValueSymbolTable.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/IRReader.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+static llvm::cl::list<std::string>
+InputFiles(llvm::cl::Positional, llvm::cl::OneOrMore,
+           llvm::cl::desc("<input bitcode or assembly files>"));
+
+static llvm::cl::opt<unsigned>
+Runs("runs", llvm::cl::desc("Number of times to hash every name"),
+     llvm::cl::init(100));
+
+/// addNames - Append the names in Symtab to Names.
+static void addNames(const llvm::ValueSymbolTable &Symtab,
+                     std::vector<std::string> &Names) {
+  for (llvm::ValueSymbolTable::const_iterator I = Symtab.begin(),
+         E = Symtab.end(); I != E; ++I)
+    Names.push_back(I->getKey());
+}
+
+static unsigned bernstein(llvm::StringRef S) { return llvm::HashString(S); }
+static unsigned wordAtATime(llvm::StringRef S) { return llvm::hash_value(S); }
+
+/// benchmark - Time HashFn over Names, then insert the distinct names into a
+/// table sized and probed like a StringMap's and count the probes.
+static void benchmark(llvm::TimerGroup &Group, const char *Name,
+                      unsigned (*HashFn)(llvm::StringRef),
+                      const std::vector<std::string> &Names,
+                      const std::vector<std::string> &Distinct) {
+  llvm::Timer T(Name, Group);
+  unsigned Sum = 0;
+  T.startTimer();
+  for (unsigned Run = 0; Run != Runs; ++Run)
+    for (unsigned i = 0, e = Names.size(); i != e; ++i)
+      Sum += HashFn(Names[i]);
+  T.stopTimer();
+  volatile unsigned DontOptimizeOut = Sum; (void)DontOptimizeOut;
+
+  // StringMap grows once it is more than three quarters full.
+  unsigned NumBuckets = 16;
+  while (Distinct.size() * 4 > NumBuckets * 3)
+    NumBuckets *= 2;
+  std::vector<bool> Full(NumBuckets);
+  std::vector<unsigned> Hashes(NumBuckets);
+  uint64_t Probes = 0, Collisions = 0;
+  unsigned MaxProbes = 0;
+  for (unsigned i = 0, e = Distinct.size(); i != e; ++i) {
+    unsigned Hash = HashFn(Distinct[i]);
+    unsigned BucketNo = Hash & (NumBuckets - 1);
+    unsigned ProbeAmt = 1;
+    for (; Full[BucketNo]; ++ProbeAmt) {
+      // Equal full hashes make StringMap compare the strings themselves.
+      if (Hashes[BucketNo] == Hash)
+        ++Collisions;
+      BucketNo = (BucketNo + ProbeAmt) & (NumBuckets - 1);
+    }
+    Full[BucketNo] = true;
+    Hashes[BucketNo] = Hash;
+    Probes += ProbeAmt;
+    MaxProbes = std::max(MaxProbes, ProbeAmt);
+  }
+
+  llvm::outs() << Name << ": " << Distinct.size() << " names in "
+               << NumBuckets << " buckets, "
+               << llvm::format("%.3f", double(Probes) / Distinct.size())
+               << " probes per insertion, " << MaxProbes << " at most, "
+               << Collisions << " full hash collisions\n";
+}
+
+int main(int argc, char **argv) {
+  llvm::cl::ParseCommandLineOptions(argc, argv);
+
+  llvm::LLVMContext Context;
+  std::vector<std::string> Names;
+  for (unsigned i = 0, e = InputFiles.size(); i != e; ++i) {
+    llvm::SMDiagnostic Err;
+    llvm::OwningPtr<llvm::Module> M(llvm::ParseIRFile(InputFiles[i], Err,
+                                                      Context));
+    if (!M) {
+      Err.print(argv[0], llvm::errs());
+      return 1;
+    }
+    addNames(M->getValueSymbolTable(), Names);
+    for (llvm::Module::const_iterator F = M->begin(), FE = M->end(); F != FE;
+         ++F)
+      addNames(F->getValueSymbolTable(), Names);
+  }
+
+  std::vector<std::string> Distinct(Names);
+  std::sort(Distinct.begin(), Distinct.end());
+  Distinct.erase(std::unique(Distinct.begin(), Distinct.end()),
+                 Distinct.end());
+  if (Distinct.empty()) {
+    llvm::errs() << "The modules have no named values\n";
+    return 1;
+  }
+
+  llvm::TimerGroup Group("String hash benchmark");
+  benchmark(Group, "HashString", bernstein, Names, Distinct);
+  benchmark(Group, "hash_value", wordAtATime, Names, Distinct);
+
+  // The real thing, which uses hash_value.
+  llvm::Timer T("StringMap insert and lookup", Group);
+  T.startTimer();
+  for (unsigned Run = 0; Run != Runs; ++Run) {
+    llvm::StringMap<unsigned> Map;
+    for (unsigned i = 0, e = Names.size(); i != e; ++i)
+      ++Map[Names[i]];
+  }
+  T.stopTimer();
+  return 0;
+}
@@ -0,0 +1,118 @@
+//===- InterpBench - Benchmark the interpreter's two cores ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program runs bitcode programs, such as the ones built from the
+// test-suite's SingleSource directory, under "lli -force-interpreter" with the
+// InstVisitor core and with the pre-decoded bytecode core, checks that both
+// print the same output and exit with the same status, and outputs the wall
+// clock times of the runs.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+#include <vector>
+
+static llvm::cl::list<std::string>
+Programs(llvm::cl::Positional, llvm::cl::OneOrMore,
+         llvm::cl::desc("<program bitcode files>"));
+
+static llvm::cl::opt<std::string>
+LLIPath("lli", llvm::cl::desc("Path to the lli to run the programs with"),
+        llvm::cl::init("lli"));
+
+static llvm::cl::opt<unsigned>
+Runs("runs", llvm::cl::desc("Number of times to run each program"),
+     llvm::cl::init(3));
+
+/// runProgram - Run Program Runs times with the given core, leaving the
+/// output in Output.  Returns the exit status of the last run.
+static int runProgram(llvm::TimerGroup &Group, const llvm::sys::Path &LLI,
+                      const std::string &Program, bool Bytecode,
+                      const llvm::sys::Path &Output) {
+  std::vector<const char*> Args;
+  Args.push_back("lli");
+  Args.push_back("-force-interpreter");
+  if (Bytecode)
+    Args.push_back("-interpreter-bytecode");
+  Args.push_back(Program.c_str());
+  Args.push_back(0);
+  llvm::sys::Path DevNull("/dev/null");
+  const llvm::sys::Path *Redirects[] = { &DevNull, &Output, &DevNull };
+
+  llvm::Timer T(Program + (Bytecode ? ": bytecode" : ": visitor"), Group);
+  int Status = 0;
+  T.startTimer();
+  for (unsigned i = 0; i != Runs; ++i) {
+    std::string ErrMsg;
+    Status = llvm::sys::Program::ExecuteAndWait(LLI, &Args[0], 0, Redirects,
+                                                0, 0, &ErrMsg);
+    if (Status < 0) {
+      llvm::errs() << "Failed to run " << LLIPath << ": " << ErrMsg << "\n";
+      exit(1);
+    }
+  }
+  T.stopTimer();
+  return Status;
+}
+
+static std::string readFile(const llvm::sys::Path &Path) {
+  llvm::OwningPtr<llvm::MemoryBuffer> Buffer;
+  if (llvm::MemoryBuffer::getFile(Path.str(), Buffer))
+    return std::string();
+  return Buffer->getBuffer();
+}
+
+int main(int argc, char **argv) {
+  llvm::cl::ParseCommandLineOptions(argc, argv);
+
+  llvm::sys::Path LLI(LLIPath);
+  if (!LLI.canExecute())
+    LLI = llvm::sys::Program::FindProgramByName(LLIPath);
+  if (LLI.isEmpty()) {
+    llvm::errs() << "Cannot find " << LLIPath << "\n";
+    return 1;
+  }
+
+  std::string ErrMsg;
+  llvm::sys::Path TempDir = llvm::sys::Path::GetTemporaryDirectory(&ErrMsg);
+  if (TempDir.isEmpty()) {
+    llvm::errs() << ErrMsg << "\n";
+    return 1;
+  }
+  llvm::sys::Path VisitorOutput = TempDir;
+  VisitorOutput.appendComponent("visitor.out");
+  llvm::sys::Path BytecodeOutput = TempDir;
+  BytecodeOutput.appendComponent("bytecode.out");
+
+  bool Mismatch = false;
+  {
+    llvm::TimerGroup Group("Interpreter benchmark");
+    for (unsigned i = 0, e = Programs.size(); i != e; ++i) {
+      int VisitorStatus = runProgram(Group, LLI, Programs[i], false,
+                                     VisitorOutput);
+      int BytecodeStatus = runProgram(Group, LLI, Programs[i], true,
+                                      BytecodeOutput);
+      if (VisitorStatus != BytecodeStatus ||
+          readFile(VisitorOutput) != readFile(BytecodeOutput)) {
+        llvm::errs() << Programs[i] << ": the cores disagree\n";
+        Mismatch = true;
+      }
+    }
+  }
+
+  TempDir.eraseFromDisk(true);
+  return Mismatch;
+}
@@ -0,0 +1,185 @@
+//===- RegexBench - Benchmark the Regex matchers --------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program searches the given files, or a generated assembly listing, for
+// regular expressions the way FileCheck does: it looks for the first match of
+// a pattern, then for the next one after it, to the end of the buffer.  The
+// patterns are the ones FileCheck builds from typical CHECK lines, or come
+// from a file.  It outputs the time taken by the automaton and by regexec, and
+// checks that they find the same matches.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Regex.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+static llvm::cl::list<std::string>
+InputFiles(llvm::cl::Positional, llvm::cl::ZeroOrMore,
+           llvm::cl::desc("<files to search, instead of a generated listing>"));
+
+static llvm::cl::opt<std::string>
+PatternFile("patterns", llvm::cl::desc("File with one regex per line to use "
+                                       "instead of the built-in ones"),
+            llvm::cl::value_desc("filename"));
+
+static llvm::cl::opt<unsigned>
+ListingLines("lines", llvm::cl::desc("Number of lines of assembly to generate"),
+             llvm::cl::init(100000));
+
+static llvm::cl::opt<unsigned>
+Runs("runs", llvm::cl::desc("Number of times to search for every pattern"),
+     llvm::cl::init(10));
+
+/// Patterns - FileCheck's translations of CHECK lines from the CodeGen and
+/// Transforms tests: literal text is escaped, {{...}} is copied, and
+/// [[VAR:...]] becomes a subexpression.
+static const char *const Patterns[] = {
+  "^_?main:",
+  "movl\t%e([a-d])x, (-?[0-9]+)\\(%[re]sp\\)",
+  "call(l|q)?\t_?foo",
+  "lea(l|q)\t.*\\(%rip\\), (%[a-z0-9]+)",
+  "jmp\t\\.LBB[0-9]+_[0-9]+",
+  "(%[a-z0-9]+) = add nsw i32 %[a-z.0-9]+, [0-9]+",
+  "define .*@test[0-9]+\\(",
+  ".*ret",
+  "^[ \t]*(pushq|popq)[ \t]+%rbp$",
+  "xorps\t(%xmm[0-9]+), (%xmm[0-9]+)"
+};
+
+/// generateListing - Return Lines lines that look like llc output, with the
+/// odd line that some of the patterns match.
+static std::string generateListing(unsigned Lines) {
+  static const char *const Body[] = {
+    "\tmovq\t%rsp, %rbp\n",
+    "\tmovl\t%edi, -4(%rbp)\n",
+    "\taddl\t$1, %eax\n",
+    "\tcmpl\t%esi, %edi\n",
+    "\tmovss\t.LCPI0_0(%rip), %xmm0\n",
+    "\tcallq\tbar\n",
+    "\t.cfi_def_cfa_offset 16\n",
+    "\ttestb\t$1, %al\n"
+  };
+  static const char *const Rare[] = {
+    "\tmovl\t%eax, 8(%rsp)\n",
+    "\tjmp\t.LBB0_3\n",
+    "\tleaq\t.L.str(%rip), %rdi\n",
+    "\tcallq\tfoo\n",
+    "\tpushq\t%rbp\n",
+    "\tretq\n"
+  };
+  const unsigned NumBody = sizeof(Body) / sizeof(Body[0]);
+  const unsigned NumRare = sizeof(Rare) / sizeof(Rare[0]);
+
+  std::string Listing = "main:\n";
+  for (unsigned i = 0; i != Lines; ++i)
+    Listing += i % 97 == 0 ? Rare[i / 97 % NumRare] : Body[i % NumBody];
+  return Listing;
+}
+
+/// searchAll - Search Buffer for every match of Pattern, each one after the
+/// previous, and append the offsets of the matches to Offsets.  Like
+/// FileCheck, compile the pattern anew for each search.
+static void searchAll(const std::string &Pattern, unsigned Flags,
+                      llvm::StringRef Buffer, std::vector<size_t> &Offsets) {
+  llvm::SmallVector<llvm::StringRef, 4> Matches;
+  size_t Pos = 0;
+  while (Pos <= Buffer.size()) {
+    llvm::Regex R(Pattern, Flags);
+    if (!R.match(Buffer.substr(Pos), &Matches))
+      break;
+    Offsets.push_back(Matches[0].data() - Buffer.data());
+    Pos = Offsets.back() + std::max<size_t>(Matches[0].size(), 1);
+  }
+}
+
+/// benchmark - Time the search for every pattern in Regexes, and fill in
+/// Offsets with the matches found.
+static void benchmark(llvm::TimerGroup &Group, const char *Name,
+                      unsigned Flags, const std::vector<std::string> &Regexes,
+                      llvm::StringRef Buffer, std::vector<size_t> &Offsets) {
+  llvm::Timer T(Name, Group);
+  T.startTimer();
+  for (unsigned Run = 0; Run != Runs; ++Run) {
+    Offsets.clear();
+    for (unsigned i = 0, e = Regexes.size(); i != e; ++i)
+      searchAll(Regexes[i], Flags, Buffer, Offsets);
+  }
+  T.stopTimer();
+  llvm::outs() << Name << ": " << Offsets.size() << " matches\n";
+}
+
+int main(int argc, char **argv) {
+  llvm::cl::ParseCommandLineOptions(argc, argv);
+
+  std::vector<std::string> Regexes;
+  if (!PatternFile.empty()) {
+    llvm::OwningPtr<llvm::MemoryBuffer> File;
+    if (llvm::error_code ec = llvm::MemoryBuffer::getFile(PatternFile, File)) {
+      llvm::errs() << PatternFile << ": " << ec.message() << "\n";
+      return 1;
+    }
+    llvm::SmallVector<llvm::StringRef, 16> Lines;
+    File->getBuffer().split(Lines, "\n", -1, false);
+    Regexes.assign(Lines.begin(), Lines.end());
+  } else {
+    Regexes.assign(Patterns, Patterns + sizeof(Patterns) / sizeof(Patterns[0]));
+  }
+  for (unsigned i = 0, e = Regexes.size(); i != e; ++i) {
+    std::string Error;
+    if (!llvm::Regex(Regexes[i]).isValid(Error)) {
+      llvm::errs() << "Invalid regex '" << Regexes[i] << "': " << Error << "\n";
+      return 1;
+    }
+  }
+
+  std::string Buffer;
+  if (InputFiles.empty())
+    Buffer = generateListing(ListingLines);
+  for (unsigned i = 0, e = InputFiles.size(); i != e; ++i) {
+    llvm::OwningPtr<llvm::MemoryBuffer> File;
+    if (llvm::error_code ec = llvm::MemoryBuffer::getFile(InputFiles[i],
+                                                          File)) {
+      llvm::errs() << InputFiles[i] << ": " << ec.message() << "\n";
+      return 1;
+    }
+    Buffer += File->getBuffer();
+  }
+
+  llvm::TimerGroup Group("Regex benchmark");
+  std::vector<size_t> Automaton, Regexec;
+  benchmark(Group, "Automaton", llvm::Regex::Newline, Regexes, Buffer,
+            Automaton);
+  benchmark(Group, "regexec", llvm::Regex::Newline | llvm::Regex::NoAutomaton,
+            Regexes, Buffer, Regexec);
+  if (Automaton != Regexec) {
+    llvm::errs() << "The automaton and regexec found different matches\n";
+    return 1;
+  }
+
+  // Nested repetitions, which take regexec quadratic time or worse to find
+  // the submatches in.
+  std::string Worst(ListingLines / 10, 'a');
+  Worst += 'b';
+  std::vector<std::string> Nested(1, "(a|aa)*(a*)*b");
+  benchmark(Group, "Automaton, nested repetitions", llvm::Regex::NoFlags,
+            Nested, Worst, Automaton);
+  benchmark(Group, "regexec, nested repetitions", llvm::Regex::NoAutomaton,
+            Nested, Worst, Regexec);
+  return 0;
+}
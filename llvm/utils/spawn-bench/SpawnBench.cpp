@@ -0,0 +1,92 @@
+//===- SpawnBench - Benchmark starting child processes --------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program measures how long Program::ExecuteAndWait takes to run a
+// trivial program, as the parent process grows: for each of the given sizes,
+// it allocates and touches that much memory, then runs the program the given
+// number of times with its output redirected, the way the clang driver and
+// bugpoint run their jobs.  With fork, the time goes up with the size of the
+// parent; with posix_spawn or vfork, it shouldn't.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string>
+#include <vector>
+
+static llvm::cl::opt<std::string>
+ProgramName("program", llvm::cl::desc("Program to run"),
+            llvm::cl::init("true"));
+
+static llvm::cl::list<unsigned>
+ResidentSizes("rss", llvm::cl::CommaSeparated,
+              llvm::cl::desc("Sizes of the parent process to measure at, "
+                             "in megabytes (default: 0,256,1024)"),
+              llvm::cl::value_desc("size,..."));
+
+static llvm::cl::opt<unsigned>
+MemoryLimit("memory-limit", llvm::cl::desc("Memory limit to set for the "
+                                           "program, in megabytes"),
+            llvm::cl::init(0));
+
+static llvm::cl::opt<unsigned>
+Runs("runs", llvm::cl::desc("Number of times to run the program"),
+     llvm::cl::init(100));
+
+int main(int argc, char **argv) {
+  llvm::cl::ParseCommandLineOptions(argc, argv);
+  if (ResidentSizes.empty()) {
+    ResidentSizes.push_back(0);
+    ResidentSizes.push_back(256);
+    ResidentSizes.push_back(1024);
+  }
+
+  llvm::sys::Path Program = llvm::sys::Program::FindProgramByName(ProgramName);
+  if (Program.isEmpty()) {
+    llvm::errs() << "Cannot find program '" << ProgramName << "'\n";
+    return 1;
+  }
+  const char *Args[] = { ProgramName.c_str(), 0 };
+
+  // Like the clang driver, send the output nowhere.
+  llvm::sys::Path Null;
+  const llvm::sys::Path *Redirects[] = { 0, &Null, &Null };
+
+  llvm::TimerGroup Group("Process spawn benchmark");
+  std::vector<char> Ballast;
+  for (unsigned i = 0, e = ResidentSizes.size(); i != e; ++i) {
+    // Every page has to be touched to count against the parent.
+    Ballast.clear();
+    Ballast.resize(size_t(ResidentSizes[i]) << 20, 1);
+
+    llvm::SmallString<32> Name;
+    llvm::raw_svector_ostream(Name) << ResidentSizes[i] << " MB resident";
+    llvm::Timer T(Name.str(), Group);
+    T.startTimer();
+    for (unsigned Run = 0; Run != Runs; ++Run) {
+      std::string ErrMsg;
+      int Result = llvm::sys::Program::ExecuteAndWait(Program, Args, 0,
+                                                      Redirects, 0,
+                                                      MemoryLimit, &ErrMsg);
+      if (Result != 0) {
+        llvm::errs() << ProgramName << " failed";
+        if (!ErrMsg.empty())
+          llvm::errs() << ": " << ErrMsg;
+        llvm::errs() << "\n";
+        return 1;
+      }
+    }
+    T.stopTimer();
+  }
+  return 0;
+}